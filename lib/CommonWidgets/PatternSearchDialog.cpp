@@ -0,0 +1,154 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "PatternSearchDialog.h"
+
+#include <QLabel>
+#include <QListWidget>
+#include <QPushButton>
+#include <QGridLayout>
+#include <QCloseEvent>
+
+void PatternSearchThread::run()
+{
+    for (int i = 0; i < m_count && !m_cancel; ++i) {
+        for (const QPoint& position : m_search(i)) {
+            if (m_cancel)
+                return;
+            emit matchFound(i, position);
+        }
+        emit progress(i + 1);
+    }
+}
+
+PatternSearchDialog::PatternSearchDialog(QWidget* parent)
+    : QDialog(parent), m_thread(), m_generation(), m_matchCount()
+{
+    setWindowTitle(tr("Find Pattern"));
+
+    m_results = new QListWidget(this);
+    m_status = new QLabel(this);
+
+    QWidget* buttonAlign = new QWidget(this);
+    m_stopButton = new QPushButton(tr("S&top"), buttonAlign);
+    QPushButton* btnClose = new QPushButton(tr("Clo&se"), buttonAlign);
+    QGridLayout* layButtons = new QGridLayout(buttonAlign);
+    layButtons->setContentsMargins(0, 0, 0, 0);
+    layButtons->setHorizontalSpacing(8);
+    layButtons->addWidget(m_status, 0, 0);
+    layButtons->addItem(new QSpacerItem(0, 0, QSizePolicy::MinimumExpanding, QSizePolicy::Minimum), 0, 1);
+    layButtons->addWidget(m_stopButton, 0, 2);
+    layButtons->addWidget(btnClose, 0, 3);
+
+    QGridLayout* layout = new QGridLayout(this);
+    layout->setContentsMargins(8, 8, 8, 8);
+    layout->setVerticalSpacing(8);
+    layout->addWidget(m_results, 0, 0);
+    layout->addWidget(buttonAlign, 1, 0);
+    resize(400, 360);
+
+    connect(m_results, &QListWidget::itemActivated, this, &PatternSearchDialog::onItemActivated);
+    connect(m_stopButton, &QPushButton::clicked, this, &PatternSearchDialog::stopSearch);
+    connect(btnClose, &QPushButton::clicked, this, &QDialog::close);
+}
+
+PatternSearchDialog::~PatternSearchDialog()
+{
+    stopSearch();
+}
+
+void PatternSearchDialog::startSearch(const QStringList& mapNames,
+                                      const QSize& patternSize,
+                                      PatternSearchFunc search)
+{
+    stopSearch();
+
+    m_results->clear();
+    m_mapNames = mapNames;
+    m_patternSize = patternSize;
+    m_matchCount = 0;
+    onProgress(0);
+
+    // Signals from a stopped search may still be queued, so each search
+    // only accepts results tagged with its own generation
+    const int generation = ++m_generation;
+    m_thread = new PatternSearchThread(mapNames.size(), std::move(search), this);
+    connect(m_thread, &PatternSearchThread::matchFound, this,
+            [this, generation](int index, const QPoint& position) {
+        if (generation == m_generation)
+            onMatchFound(index, position);
+    });
+    connect(m_thread, &PatternSearchThread::progress, this, [this, generation](int searched) {
+        if (generation == m_generation)
+            onProgress(searched);
+    });
+    connect(m_thread, &QThread::finished, this, [this, generation] {
+        if (generation == m_generation)
+            onSearchFinished();
+    });
+    m_stopButton->setEnabled(true);
+    m_thread->start(QThread::LowPriority);
+}
+
+void PatternSearchDialog::stopSearch()
+{
+    if (!m_thread)
+        return;
+
+    m_thread->cancel();
+    m_thread->wait();
+    ++m_generation;
+    onSearchFinished();
+}
+
+void PatternSearchDialog::closeEvent(QCloseEvent* event)
+{
+    stopSearch();
+    event->accept();
+}
+
+void PatternSearchDialog::onMatchFound(int index, const QPoint& position)
+{
+    auto item = new QListWidgetItem(tr("%1 at (%2, %3)").arg(m_mapNames.value(index))
+                                    .arg(position.x()).arg(position.y()), m_results);
+    item->setData(Qt::UserRole, index);
+    item->setData(Qt::UserRole + 1, position);
+    ++m_matchCount;
+}
+
+void PatternSearchDialog::onProgress(int searched)
+{
+    m_status->setText(tr("%1 matches in %2 of %3 maps").arg(m_matchCount)
+                      .arg(searched).arg(m_mapNames.size()));
+}
+
+void PatternSearchDialog::onSearchFinished()
+{
+    if (!m_thread)
+        return;
+
+    m_thread->deleteLater();
+    m_thread = nullptr;
+    m_stopButton->setEnabled(false);
+}
+
+void PatternSearchDialog::onItemActivated(QListWidgetItem* item)
+{
+    const int index = item->data(Qt::UserRole).toInt();
+    const QPoint position = item->data(Qt::UserRole + 1).toPoint();
+    emit matchActivated(index, QRect(position, m_patternSize));
+}
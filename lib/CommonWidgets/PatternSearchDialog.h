@@ -0,0 +1,96 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _PATTERN_SEARCH_DIALOG_H
+#define _PATTERN_SEARCH_DIALOG_H
+
+#include <QDialog>
+#include <QThread>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class QLabel;
+class QListWidget;
+class QListWidgetItem;
+class QPushButton;
+
+// Search function run on the worker thread for each map; returns the
+// top-left corner of every match in that map
+typedef std::function<std::vector<QPoint>(int index)> PatternSearchFunc;
+
+class PatternSearchThread : public QThread {
+    Q_OBJECT
+
+public:
+    PatternSearchThread(int count, PatternSearchFunc search, QObject* parent = nullptr)
+        : QThread(parent), m_count(count), m_search(std::move(search)),
+          m_cancel(false) { }
+
+    void cancel() { m_cancel = true; }
+
+signals:
+    void matchFound(int index, const QPoint& position);
+    void progress(int searched);
+
+protected:
+    void run() override;
+
+private:
+    int m_count;
+    PatternSearchFunc m_search;
+    std::atomic<bool> m_cancel;
+};
+
+// Non-modal list of pattern matches, which fills in as the search runs
+class PatternSearchDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit PatternSearchDialog(QWidget* parent = nullptr);
+    ~PatternSearchDialog() override;
+
+    void startSearch(const QStringList& mapNames, const QSize& patternSize,
+                     PatternSearchFunc search);
+    void stopSearch();
+
+signals:
+    void matchActivated(int index, const QRect& region);
+
+protected:
+    void closeEvent(QCloseEvent*) override;
+
+private slots:
+    void onItemActivated(QListWidgetItem* item);
+
+private:
+    QListWidget* m_results;
+    QLabel* m_status;
+    QPushButton* m_stopButton;
+    PatternSearchThread* m_thread;
+    int m_generation;
+    QStringList m_mapNames;
+    QSize m_patternSize;
+    int m_matchCount;
+
+    void onMatchFound(int index, const QPoint& position);
+    void onProgress(int searched);
+    void onSearchFinished();
+};
+
+#endif
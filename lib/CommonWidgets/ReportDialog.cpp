@@ -0,0 +1,101 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "ReportDialog.h"
+
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QGridLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFontDatabase>
+#include <QFile>
+
+ReportDialog::ReportDialog(const QString& title, const QString& report, QWidget* parent)
+    : QDialog(parent), m_thread()
+{
+    setupUi(title);
+    m_report->setPlainText(report);
+}
+
+ReportDialog::ReportDialog(const QString& title, ReportFunc generate, QWidget* parent)
+    : QDialog(parent)
+{
+    setupUi(title);
+    m_report->setPlainText(tr("Working..."));
+    m_saveButton->setEnabled(false);
+
+    m_thread = new ReportThread(std::move(generate), this);
+    connect(m_thread, &QThread::finished, this, [this] {
+        m_report->setPlainText(m_thread->report());
+        m_saveButton->setEnabled(true);
+    });
+    m_thread->start(QThread::LowPriority);
+}
+
+ReportDialog::~ReportDialog()
+{
+    if (m_thread)
+        m_thread->wait();
+}
+
+void ReportDialog::setupUi(const QString& title)
+{
+    setWindowTitle(title);
+
+    m_report = new QPlainTextEdit(this);
+    m_report->setReadOnly(true);
+    m_report->setLineWrapMode(QPlainTextEdit::NoWrap);
+    m_report->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    QWidget* buttonAlign = new QWidget(this);
+    m_saveButton = new QPushButton(tr("&Save..."), buttonAlign);
+    QPushButton* btnClose = new QPushButton(tr("Clo&se"), buttonAlign);
+    QGridLayout* layButtons = new QGridLayout(buttonAlign);
+    layButtons->setContentsMargins(0, 0, 0, 0);
+    layButtons->setHorizontalSpacing(8);
+    layButtons->addItem(new QSpacerItem(0, 0, QSizePolicy::MinimumExpanding, QSizePolicy::Minimum), 0, 0);
+    layButtons->addWidget(m_saveButton, 0, 1);
+    layButtons->addWidget(btnClose, 0, 2);
+    btnClose->setDefault(true);
+
+    QGridLayout* layout = new QGridLayout(this);
+    layout->setContentsMargins(8, 8, 8, 8);
+    layout->setVerticalSpacing(8);
+    layout->addWidget(m_report, 0, 0);
+    layout->addWidget(buttonAlign, 1, 0);
+    resize(640, 480);
+
+    connect(m_saveButton, &QPushButton::clicked, this, &ReportDialog::onSave);
+    connect(btnClose, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+void ReportDialog::onSave()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Report..."),
+                            QString(), tr("Text files (*.txt);;All files (*)"));
+    if (filename.isEmpty())
+        return;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QMessageBox::critical(this, tr("Error saving report"),
+                              tr("Could not open %1 for writing.").arg(filename));
+        return;
+    }
+    file.write(m_report->toPlainText().toUtf8());
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _REPORT_DIALOG_H
+#define _REPORT_DIALOG_H
+
+#include <QDialog>
+#include <QThread>
+#include <functional>
+
+class QPlainTextEdit;
+class QPushButton;
+
+// Builds a report on a worker thread.  It must not throw, so errors should
+// be returned as part of the report text.
+typedef std::function<QString()> ReportFunc;
+
+class ReportThread : public QThread {
+    Q_OBJECT
+
+public:
+    ReportThread(ReportFunc generate, QObject* parent = nullptr)
+        : QThread(parent), m_generate(std::move(generate)) { }
+
+    const QString& report() const { return m_report; }
+
+protected:
+    void run() override { m_report = m_generate(); }
+
+private:
+    ReportFunc m_generate;
+    QString m_report;
+};
+
+// Displays a plain text report, such as the results of solution verification
+class ReportDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    ReportDialog(const QString& title, const QString& report, QWidget* parent = nullptr);
+
+    /* Build the report in the background, and show it when it is ready.
+     * The report function can't be cancelled, so destroying the dialog
+     * waits for it to finish.
+     */
+    ReportDialog(const QString& title, ReportFunc generate, QWidget* parent = nullptr);
+    ~ReportDialog() override;
+
+private slots:
+    void onSave();
+
+private:
+    QPlainTextEdit* m_report;
+    QPushButton* m_saveButton;
+    ReportThread* m_thread;
+
+    void setupUi(const QString& title);
+};
+
+#endif
@@ -0,0 +1,69 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CONTENTHASH_H
+#define _CONTENTHASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace ccl {
+
+// splitmix64 finalizer
+inline uint64_t HashMix64(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+/* Zobrist keys are derived from a mixing function instead of a stored
+ * table, since the feature spaces used here (cell x tile value) are
+ * sparse.  Keys from different tables never need to be distinct, but
+ * in practice they are. */
+inline uint64_t ZobristKey(uint32_t table, uint32_t feature)
+{
+    return HashMix64((((uint64_t)table << 32) | feature) + 0x9E3779B97F4A7C15ULL);
+}
+
+// Order-dependent combination of two hash values
+inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+{
+    return HashMix64(seed ^ (value + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// FNV-1a over a byte range, finalized so that short inputs still spread
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    uint64_t hash = 0xCBF29CE484222325ULL ^ seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return HashMix64(hash ^ size);
+}
+
+inline uint64_t HashString(const std::string& str, uint64_t seed = 0)
+{
+    return HashBytes(str.data(), str.size(), seed);
+}
+
+}
+
+#endif
@@ -17,6 +17,8 @@
 
 #include "DacFile.h"
 
+#include <QFileInfo>
+#include <QDir>
 #include <cstring>
 #include <cstdlib>
 #include <errno.h>
@@ -127,3 +129,23 @@ void ccl::DacFile::write(FILE* stream) const
     if (m_fixLynx)
         fprintf(stream, "fixlynx=y\n");
 }
+
+ccl::Levelset* ccl::LoadLevelset(const QString& filename)
+{
+    QString datFilename = filename;
+    if (DetermineLevelsetType(filename) == LevelsetDac) {
+        unique_FILE dacFile = FileStream::Fopen(filename, FileStream::ReadText);
+        if (!dacFile)
+            throw IOError(RuntimeError::tr("Could not open file for reading"));
+        DacFile dac;
+        dac.read(dacFile.get());
+        datFilename = QFileInfo(filename).dir().absoluteFilePath(dac.m_filename);
+    }
+
+    FileStream stream;
+    if (!stream.open(datFilename, FileStream::Read))
+        throw IOError(RuntimeError::tr("Could not open file for reading"));
+    std::unique_ptr<Levelset> levelset(new Levelset(0));
+    levelset->read(&stream);
+    return levelset.release();
+}
@@ -42,6 +42,11 @@ struct DacFile {
     bool m_fixLynx;         // default = n
 };
 
+/* Load a levelset from a .dat/.ccl file, or from the data file referenced
+ * by a .dac file.  Throws a RuntimeError on failure.
+ */
+Levelset* LoadLevelset(const QString& filename);
+
 } /* {ccl} */
 
 #endif
@@ -0,0 +1,189 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Fingerprint.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <numeric>
+
+void ccl::Fingerprint::clear()
+{
+    std::fill(signature, signature + SignatureSize, 0xFFFFFFFFU);
+}
+
+void ccl::Fingerprint::addShingle(uint64_t shingle)
+{
+    // The per-slot hash functions are derived from a single 64-bit hash by
+    // double hashing, with a final mix to break up the linear structure
+    const uint64_t hash = HashMix64(shingle);
+    const uint32_t h1 = (uint32_t)hash;
+    const uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    for (uint32_t i = 0; i < SignatureSize; ++i) {
+        uint32_t value = h1 + i * h2;
+        value = (value ^ (value >> 16)) * 0x45D9F3BU;
+        value ^= value >> 16;
+        signature[i] = std::min(signature[i], value);
+    }
+}
+
+double ccl::Fingerprint::similarity(const Fingerprint& other) const
+{
+    int matches = 0;
+    for (int i = 0; i < SignatureSize; ++i) {
+        if (signature[i] == other.signature[i])
+            ++matches;
+    }
+    return (double)matches / SignatureSize;
+}
+
+uint64_t ccl::Fingerprint::bandHash(int band) const
+{
+    return HashBytes(&signature[band * RowsPerBand], RowsPerBand * sizeof(uint32_t),
+                     (uint64_t)band);
+}
+
+ccl::Fingerprint ccl::FingerprintLevel(const LevelData* level)
+{
+    Fingerprint print;
+    print.exactHash = level->gameplayHash();
+
+    // Each shingle packs both layers of a 2x2 window into 64 bits.  Runs
+    // of identical windows (usually open floor) are skipped, since they
+    // can't change the signature.
+    const LevelMap& map = level->map();
+    uint64_t last = 0;
+    bool haveLast = false;
+    for (int y = 0; y < CCL_HEIGHT - 1; ++y) {
+        for (int x = 0; x < CCL_WIDTH - 1; ++x) {
+            const uint64_t shingle =
+                      (uint64_t)map.getFG(x, y)
+                    | ((uint64_t)map.getFG(x + 1, y) << 8)
+                    | ((uint64_t)map.getFG(x, y + 1) << 16)
+                    | ((uint64_t)map.getFG(x + 1, y + 1) << 24)
+                    | ((uint64_t)map.getBG(x, y) << 32)
+                    | ((uint64_t)map.getBG(x + 1, y) << 40)
+                    | ((uint64_t)map.getBG(x, y + 1) << 48)
+                    | ((uint64_t)map.getBG(x + 1, y + 1) << 56);
+            if (haveLast && shingle == last)
+                continue;
+            print.addShingle(shingle);
+            last = shingle;
+            haveLast = true;
+        }
+    }
+    return print;
+}
+
+static size_t findRoot(std::vector<size_t>& parent, size_t index)
+{
+    while (parent[index] != index) {
+        parent[index] = parent[parent[index]];
+        index = parent[index];
+    }
+    return index;
+}
+
+static void unite(std::vector<size_t>& parent, size_t left, size_t right)
+{
+    left = findRoot(parent, left);
+    right = findRoot(parent, right);
+    if (left != right) {
+        // Keep the lowest index as the root, so clusters come out sorted
+        if (right < left)
+            std::swap(left, right);
+        parent[right] = left;
+    }
+}
+
+std::vector<ccl::DuplicateCluster>
+ccl::FindDuplicates(const std::vector<Fingerprint>& prints, double threshold,
+                    unsigned int threads)
+{
+    const size_t count = prints.size();
+    std::vector<size_t> parent(count);
+    std::iota(parent.begin(), parent.end(), 0);
+
+    // Exact duplicates
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&prints](size_t left, size_t right) {
+        return prints[left].exactHash < prints[right].exactHash;
+    });
+    for (size_t i = 1; i < count; ++i) {
+        if (prints[order[i]].exactHash == prints[order[i - 1]].exactHash)
+            unite(parent, order[i - 1], order[i]);
+    }
+    order = std::vector<size_t>();
+
+    // Near duplicates, one LSH band per job
+    typedef std::pair<size_t, size_t> Candidate;
+    std::vector<std::vector<Candidate>> bandMatches(Fingerprint::Bands);
+    RunParallel(Fingerprint::Bands, threads, [&](unsigned int, size_t band) {
+        std::vector<std::pair<uint64_t, size_t>> keys(count);
+        for (size_t i = 0; i < count; ++i)
+            keys[i] = std::make_pair(prints[i].bandHash((int)band), i);
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<Candidate>& matches = bandMatches[band];
+        size_t first = 0;
+        for (size_t i = 1; i < count; ++i) {
+            if (keys[i].first != keys[first].first) {
+                first = i;
+                continue;
+            }
+            const Fingerprint& rep = prints[keys[first].second];
+            const Fingerprint& print = prints[keys[i].second];
+            if (print.exactHash != rep.exactHash && print.similarity(rep) >= threshold)
+                matches.emplace_back(keys[first].second, keys[i].second);
+        }
+    });
+    for (auto& matches : bandMatches) {
+        for (const Candidate& match : matches)
+            unite(parent, match.first, match.second);
+        matches = std::vector<Candidate>();
+    }
+
+    // Collect clusters in order of their lowest member
+    std::vector<size_t> clusterIndex(count, (size_t)-1);
+    std::vector<DuplicateCluster> clusters;
+    std::vector<size_t> sizes(count, 0);
+    for (size_t i = 0; i < count; ++i)
+        ++sizes[findRoot(parent, i)];
+    for (size_t i = 0; i < count; ++i) {
+        const size_t root = findRoot(parent, i);
+        if (sizes[root] < 2)
+            continue;
+        if (clusterIndex[root] == (size_t)-1) {
+            clusterIndex[root] = clusters.size();
+            clusters.emplace_back();
+            clusters.back().exact = true;
+            clusters.back().minSimilarity = 1.0;
+        }
+        DuplicateCluster& cluster = clusters[clusterIndex[root]];
+        if (!cluster.members.empty()) {
+            const Fingerprint& first = prints[cluster.members.front()];
+            if (prints[i].exactHash != first.exactHash) {
+                cluster.exact = false;
+                cluster.minSimilarity = std::min(cluster.minSimilarity,
+                                                 prints[i].similarity(first));
+            }
+        }
+        cluster.members.push_back(i);
+    }
+    return clusters;
+}
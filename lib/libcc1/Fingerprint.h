@@ -0,0 +1,82 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _FINGERPRINT_H
+#define _FINGERPRINT_H
+
+#include <cstdint>
+#include <vector>
+#include "Levelset.h"
+
+namespace ccl {
+
+/* A compact, format-independent summary of a level, for finding duplicates
+ * in large collections.  exactHash identifies levels with identical
+ * gameplay content (names, passwords and hints are ignored).  signature
+ * is a MinHash sketch over the set of 2x2 tile windows in the map, so the
+ * fraction of matching signature slots estimates the Jaccard similarity
+ * of two maps, even if one has been shifted or lightly edited.
+ */
+struct Fingerprint {
+    enum {
+        SignatureSize = 64,
+        // LSH banding:  Two maps become candidates when all rows of at
+        // least one band match.  16 x 4 puts the 50% detection point at
+        // a similarity of about 0.5.
+        Bands = 16,
+        RowsPerBand = SignatureSize / Bands,
+    };
+
+    uint64_t exactHash;
+    uint32_t signature[SignatureSize];
+
+    Fingerprint() : exactHash() { clear(); }
+
+    void clear();
+    void addShingle(uint64_t shingle);
+
+    // Estimated Jaccard similarity, from 0.0 to 1.0
+    double similarity(const Fingerprint& other) const;
+
+    uint64_t bandHash(int band) const;
+};
+
+Fingerprint FingerprintLevel(const LevelData* level);
+
+struct DuplicateCluster {
+    std::vector<size_t> members;    // Indices into the fingerprint list
+    bool exact;                     // All members have the same exactHash
+    double minSimilarity;           // Lowest estimated similarity to the first member
+
+    DuplicateCluster() : exact(), minSimilarity() { }
+};
+
+/* Group fingerprints that are exact duplicates, or whose estimated
+ * similarity is at least threshold.  Candidates are found by sorting
+ * LSH band hashes, and each member of a band bucket is only compared to
+ * the bucket's first member, so the cost stays near-linear even when
+ * thousands of levels share a bucket.  Clusters are formed transitively,
+ * and are returned ordered by their first member.  Only clusters with at
+ * least two members are returned.
+ */
+std::vector<DuplicateCluster> FindDuplicates(const std::vector<Fingerprint>& prints,
+                                             double threshold = 0.8,
+                                             unsigned int threads = 0);
+
+}
+
+#endif
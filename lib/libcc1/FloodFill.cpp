@@ -0,0 +1,69 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "FloodFill.h"
+
+std::vector<ccl::FillSpan> ccl::ScanlineFill(const uint64_t* keys, int width,
+                                             int height, int x, int y)
+{
+    std::vector<FillSpan> spans;
+    if (x < 0 || x >= width || y < 0 || y >= height)
+        return spans;
+
+    const uint64_t key = keys[(y * width) + x];
+    std::vector<uint8_t> filled(width * height, 0);
+    auto matches = [&](int cell) {
+        return keys[cell] == key && !filled[cell];
+    };
+
+    std::vector<int> seeds;
+    seeds.push_back((y * width) + x);
+    while (!seeds.empty()) {
+        const int seed = seeds.back();
+        seeds.pop_back();
+        if (filled[seed])
+            continue;
+
+        // Extend the seed to the whole matching run on its row
+        const int row = (seed / width) * width;
+        int left = seed - row;
+        int right = left;
+        while (left > 0 && matches(row + left - 1))
+            --left;
+        while (right < width - 1 && matches(row + right + 1))
+            ++right;
+        for (int cx = left; cx <= right; ++cx)
+            filled[row + cx] = 1;
+        spans.push_back(FillSpan{ row / width, left, right });
+
+        // Queue one seed for each matching run touching this one in the
+        // rows above and below
+        for (int adjacent : { row - width, row + width }) {
+            if (adjacent < 0 || adjacent >= width * height)
+                continue;
+            bool inRun = false;
+            for (int cx = left; cx <= right; ++cx) {
+                const bool match = matches(adjacent + cx);
+                if (match && !inRun)
+                    seeds.push_back(adjacent + cx);
+                inRun = match;
+            }
+        }
+    }
+
+    return spans;
+}
@@ -0,0 +1,43 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _FLOODFILL_H
+#define _FLOODFILL_H
+
+#include <vector>
+#include <cstdint>
+
+namespace ccl {
+
+// One horizontal run of filled cells, from left to right inclusive
+struct FillSpan {
+    int y;
+    int left, right;
+};
+
+/* Scanline flood fill over a width x height grid of per-cell keys in
+ * reading order.  Returns the region of cells 4-connected to (x, y) with
+ * the same key as (x, y), as horizontal spans in no particular order.
+ * The keys are typically hashes of each cell's tile stack, so comparing
+ * two cells is a single integer compare.
+ */
+std::vector<FillSpan> ScanlineFill(const uint64_t* keys, int width, int height,
+                                   int x, int y);
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "LevelCheck.h"
+#include "Levelset.h"
+#include "TilePlanes.h"
+#include "Reachability.h"
+
+#include <QCoreApplication>
+
+namespace {
+
+class LevelChecker {
+    // Keeps the translation context of CCEdit's error check dialog
+    Q_DECLARE_TR_FUNCTIONS(ErrorCheckDialog)
+
+public:
+    LevelChecker(const ccl::Levelset* levelset, ccl::CheckMode mode)
+        : m_levelset(levelset), m_mode(mode) { }
+
+    void checkLevelset();
+    void checkLevel(int level);
+
+    std::vector<ccl::LevelIssue>& issues() { return m_issues; }
+
+private:
+    const ccl::Levelset* m_levelset;
+    ccl::CheckMode m_mode;
+    std::vector<ccl::LevelIssue> m_issues;
+
+    void report(int level, const QString& text)
+    {
+        m_issues.push_back(ccl::LevelIssue { level, text });
+    }
+};
+
+}
+
+void LevelChecker::checkLevelset()
+{
+    if (m_mode == ccl::CheckMsccStrict && m_levelset->levelCount() != 149)
+        report(-1, tr("[MSCC Compatibility]\n"
+                      "Levelset does not contain exactly 149 levels"));
+    if (m_mode == ccl::CheckLynxPedantic && m_levelset->levelCount() != 149)
+        report(-1, tr("[Lynx Compatibility]\n"
+                      "Levelset does not contain exactly 149 levels"));
+    if ((m_mode == ccl::CheckMsccStrict || m_mode == ccl::CheckMscc)
+        && m_levelset->type() != ccl::Levelset::TypeMS && m_levelset->type() != ccl::Levelset::TypePG)
+        report(-1, tr("[MSCC Compatibility]\n"
+                      "Levelset is configured for Lynx compatibility"));
+
+    for (int i=0; i<m_levelset->levelCount(); ++i)
+        checkLevel(i);
+}
+
+void LevelChecker::checkLevel(int level)
+{
+    const ccl::LevelData* levelData = m_levelset->level(level);
+
+    const ccl::TilePlanes planes(levelData->map());
+    const int chips = planes.count(ccl::TilePlanes::ClassChip);
+    const int players = planes.upper(ccl::TilePlanes::ClassPlayer).count();
+    const bool haveExit = planes.either(ccl::TilePlanes::ClassExit).any();
+
+    // Only visit the cells which have something to report
+    const bool allowIceBlock = m_levelset->type() == ccl::Levelset::TypePG
+                            || m_levelset->type() == ccl::Levelset::TypeLynxPG;
+    const ccl::TileBitmap& buriedPlayers = planes.lower(ccl::TilePlanes::ClassPlayer);
+    const ccl::TileBitmap iceBlocks = allowIceBlock ? ccl::TileBitmap()
+                                    : planes.either(ccl::TilePlanes::ClassIceBlock);
+    const ccl::TileBitmap reserved = planes.either(ccl::TilePlanes::ClassReserved);
+    const ccl::TileBitmap invalid = planes.either(ccl::TilePlanes::ClassInvalid);
+    (buriedPlayers | iceBlocks | reserved | invalid).forEach([&](int x, int y) {
+        if (buriedPlayers.test(x, y))
+            report(level, tr("[Invalid Tile Combo]\n"
+                             "Buried player tile at (%1, %2)")
+                          .arg(x).arg(y));
+        if (iceBlocks.test(x, y))
+            report(level, tr("[Invalid Tile]\n"
+                             "Use of ice block at (%1, %2) in non-PGChips levelset")
+                          .arg(x).arg(y));
+        if (reserved.test(x, y))
+            report(level, tr("[Invalid Tile]\n"
+                             "Use of reserved tile at (%1, %2)")
+                          .arg(x).arg(y));
+        if (invalid.test(x, y))
+            report(level, tr("[Invalid Tile]\n"
+                             "Use of invalid tile at (%1, %2)")
+                          .arg(x).arg(y));
+    });
+
+    if (!haveExit)
+        report(level, tr("[Unsolvable]\n"
+                         "No exit tile is present in the level"));
+    if (chips < levelData->chips())
+        report(level, tr("[Possibly Unsolvable]\n"
+                         "Not enough chips to meet goal (need %1 more)")
+                      .arg(levelData->chips() - chips));
+    if (players == 0)
+        report(level, tr("[Design Warning]\n"
+                         "No player start tile is present in the level"));
+    if (players > 1)
+        report(level, tr("[Design Warning]\n"
+                         "Multiple player start tiles are present in the level"));
+
+    if (players > 0) {
+        const ccl::ReachabilityInfo reach = ccl::AnalyzeReachability(levelData);
+        if (haveExit && !reach.exitReachable)
+            report(level, tr("[Possibly Unsolvable]\n"
+                             "The exit cannot be reached from the player start"));
+        if (chips >= levelData->chips() && reach.chipsReachable < levelData->chips())
+            report(level, tr("[Possibly Unsolvable]\n"
+                             "Only %1 of the %2 required chips can be reached")
+                          .arg(reach.chipsReachable).arg(levelData->chips()));
+
+        // Only report closed off areas that contain something of interest
+        const ccl::TileBitmap items = planes.either(ccl::TilePlanes::ClassChip)
+                                    | planes.either(ccl::TilePlanes::ClassKey)
+                                    | planes.either(ccl::TilePlanes::ClassBoots)
+                                    | planes.either(ccl::TilePlanes::ClassExit);
+        for (const ccl::TileBitmap& region : ccl::ConnectedRegions(reach.lockedOut)) {
+            if ((region & items).none())
+                continue;
+            const ccl::Point where = region.first();
+            report(level, tr("[Design Warning]\n"
+                             "Area of %1 tiles at (%2, %3) cannot be reached")
+                          .arg(region.count()).arg(where.X).arg(where.Y));
+        }
+    }
+
+    std::vector<ccl::Trap>::const_iterator trap_iter;
+    for (trap_iter = levelData->traps().begin(); trap_iter != levelData->traps().end(); ++trap_iter) {
+        if (trap_iter->button.X < 0 || trap_iter->button.X > 31 ||
+            trap_iter->button.Y < 0 || trap_iter->button.Y > 31)
+            report(level, tr("[Invalid Trap]\n"
+                             "Trap button is outside of level region (%1, %2)")
+                          .arg(trap_iter->button.X).arg(trap_iter->button.Y));
+        if (trap_iter->trap.X < 0 || trap_iter->trap.X > 31 ||
+            trap_iter->trap.Y < 0 || trap_iter->trap.Y > 31)
+            report(level, tr("[Invalid Trap]\n"
+                             "Trap target is outside of level region (%1, %2)")
+                          .arg(trap_iter->trap.X).arg(trap_iter->trap.Y));
+        if (levelData->map().getFG(trap_iter->button.X, trap_iter->button.Y) != ccl::TileTrapButton &&
+            levelData->map().getBG(trap_iter->button.X, trap_iter->button.Y) != ccl::TileTrapButton)
+            report(level, tr("[Invalid Trap]\n"
+                             "Trap button points to invalid tile at (%1, %2)")
+                          .arg(trap_iter->button.X).arg(trap_iter->button.Y));
+        if (levelData->map().getFG(trap_iter->trap.X, trap_iter->trap.Y) != ccl::TileTrap &&
+            levelData->map().getBG(trap_iter->trap.X, trap_iter->trap.Y) != ccl::TileTrap)
+            report(level, tr("[Invalid Trap]\n"
+                             "Trap target points to invalid tile at (%1, %2)")
+                          .arg(trap_iter->trap.X).arg(trap_iter->trap.Y));
+    }
+
+    std::vector<ccl::Clone>::const_iterator clone_iter;
+    for (clone_iter = levelData->clones().begin(); clone_iter != levelData->clones().end(); ++clone_iter) {
+        if (clone_iter->button.X < 0 || clone_iter->button.X > 31 ||
+            clone_iter->button.Y < 0 || clone_iter->button.Y > 31)
+            report(level, tr("[Invalid Cloner]\n"
+                             "Clone button is outside of level region (%1, %2)")
+                          .arg(clone_iter->button.X).arg(clone_iter->button.Y));
+        if (clone_iter->clone.X < 0 || clone_iter->clone.X > 31 ||
+            clone_iter->clone.Y < 0 || clone_iter->clone.Y > 31)
+            report(level, tr("[Invalid Cloner]\n"
+                             "Cloner target is outside of level region (%1, %2)")
+                          .arg(clone_iter->clone.X).arg(clone_iter->clone.Y));
+        if (levelData->map().getFG(clone_iter->button.X, clone_iter->button.Y) != ccl::TileCloneButton &&
+            levelData->map().getBG(clone_iter->button.X, clone_iter->button.Y) != ccl::TileCloneButton)
+            report(level, tr("[Invalid Cloner]\n"
+                             "Clone button points to invalid tile at (%1, %2)")
+                          .arg(clone_iter->button.X).arg(clone_iter->button.Y));
+        if (levelData->map().getFG(clone_iter->clone.X, clone_iter->clone.Y) != ccl::TileCloner &&
+            levelData->map().getBG(clone_iter->clone.X, clone_iter->clone.Y) != ccl::TileCloner)
+            report(level, tr("[Invalid Cloner]\n"
+                             "Cloner target points to invalid tile at (%1, %2)")
+                          .arg(clone_iter->clone.X).arg(clone_iter->clone.Y));
+    }
+
+    std::vector<ccl::Point>::const_iterator move_iter;
+    for (move_iter = levelData->moveList().begin(); move_iter != levelData->moveList().end(); ++move_iter) {
+        if (move_iter->X < 0 || move_iter->X > 31 ||
+            move_iter->Y < 0 || move_iter->Y > 31)
+            report(level, tr("[Invalid Mover]\n"
+                             "Monster position is outside of level region (%1, %2)")
+                          .arg(move_iter->X).arg(move_iter->Y));
+        if ((levelData->map().getFG(move_iter->X, move_iter->Y) < ccl::MONSTER_FIRST ||
+            levelData->map().getFG(move_iter->X, move_iter->Y) > ccl::MONSTER_LAST) &&
+            (levelData->map().getBG(move_iter->X, move_iter->Y) < ccl::MONSTER_FIRST ||
+            levelData->map().getBG(move_iter->X, move_iter->Y) > ccl::MONSTER_LAST))
+            report(level, tr("[Invalid Mover]\n"
+                             "Invalid monster tile at mover position (%1, %2)")
+                          .arg(move_iter->X).arg(move_iter->Y));
+    }
+
+    for (int y = 0; y < 32; ++y) {
+        for (int x = 0; x < 32; ++x) {
+            if (m_mode == ccl::CheckLynxPedantic) {
+                if (levelData->map().getFG(x, y) == ccl::TileTrapButton
+                    || levelData->map().getBG(x, y) == ccl::TileTrapButton) {
+                    ccl::PointSpan targets = levelData->linkedTraps(x, y);
+                    if (targets.size() == 0) {
+                        report(level, tr("[Invalid Trap]\n"
+                                         "Trap button at (%1, %2) has no connections")
+                                      .arg(x).arg(y));
+                    } else  if (targets.size() > 1) {
+                        report(level, tr("[Invalid Trap]\n"
+                                         "Trap buttons at (%1, %2) has multiple connections")
+                                      .arg(x).arg(y));
+                    } else if (targets.front() != levelData->map().findNext(x, y, ccl::TileTrap)) {
+                        report(level, tr("[Invalid Trap]\n"
+                                         "Trap connection for (%1, %2) violates the reading-order rule")
+                                      .arg(x).arg(y));
+                    }
+                }
+                if (levelData->map().getFG(x, y) == ccl::TileCloneButton
+                    || levelData->map().getBG(x, y) == ccl::TileCloneButton) {
+                    ccl::PointSpan targets = levelData->linkedCloners(x, y);
+                    if (targets.size() == 0) {
+                        report(level, tr("[Invalid Cloner]\n"
+                                         "Clone button at (%1, %2) has no connections")
+                                      .arg(x).arg(y));
+                    } else  if (targets.size() > 1) {
+                        report(level, tr("[Invalid Cloner]\n"
+                                         "Clone button at (%1, %2) has multiple connections")
+                                      .arg(x).arg(y));
+                    } else  if (targets.front() != levelData->map().findNext(x, y, ccl::TileCloner)) {
+                        report(level, tr("[Invalid Cloner]\n"
+                                         "Cloner connections for (%1, %2) violates the reading-order rule")
+                                      .arg(x).arg(y));
+                    }
+                }
+
+                if (MONSTER_TILE(levelData->map().getFG(x, y))
+                    && levelData->map().getBG(x, y) != ccl::TileCloner
+                    && levelData->map().getBG(x, y) != ccl::TileTrap
+                    && !levelData->checkMove(x, y)) {
+                    report(level, tr("[Non-Moving Monster]\n"
+                                     "Monster at (%1, %2) does not move").arg(x).arg(y));
+                }
+            } /* CheckLynxPedantic */
+        } /* y */
+    } /* x */
+}
+
+std::vector<ccl::LevelIssue> ccl::CheckLevelset(const Levelset* levelset, CheckMode mode)
+{
+    LevelChecker checker(levelset, mode);
+    checker.checkLevelset();
+    return std::move(checker.issues());
+}
+
+std::vector<ccl::LevelIssue> ccl::CheckLevel(const Levelset* levelset, int level, CheckMode mode)
+{
+    LevelChecker checker(levelset, mode);
+    checker.checkLevel(level);
+    return std::move(checker.issues());
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _LEVELCHECK_H
+#define _LEVELCHECK_H
+
+#include <QString>
+#include <vector>
+
+namespace ccl {
+
+class Levelset;
+
+enum CheckMode {
+    CheckMsccStrict,    // MSCC (Unmodified)
+    CheckMscc,          // MSCC (CCPlay / Tile World)
+    CheckTWorldLynx,    // Lynx (Tile World)
+    CheckLynxPedantic,  // Lynx (Pedantic)
+};
+
+struct LevelIssue {
+    int level;          // Level index, or -1 for the levelset as a whole
+    QString text;       // "[Category]\nDescription"
+};
+
+/* Design and compatibility checks for a CC1 levelset, as shown in CCEdit's
+ * error check dialog.  Issues are returned in level order.
+ */
+std::vector<LevelIssue> CheckLevelset(const Levelset* levelset, CheckMode mode);
+std::vector<LevelIssue> CheckLevel(const Levelset* levelset, int level, CheckMode mode);
+
+}
+
+#endif
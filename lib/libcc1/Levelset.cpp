@@ -16,8 +16,10 @@
  ******************************************************************************/
 
 #include "Levelset.h"
+#include "TilePlanes.h"
 
 #include <algorithm>
+#include <functional>
 #include <cstring>
 #include <cstdlib>
 
@@ -25,16 +27,38 @@
     #define snprintf _sprintf_p
 #endif
 
+struct ccl::LevelMap::TileIndex {
+    TileIndex() : users() { }
+
+    int users;
+
+    // Indexed by [layer - 1][tile].  Tile values outside of the known
+    // range are not indexed, and lookups for them fall back to a scan.
+    TileBitmap cells[2][NUM_TILE_TYPES];
+};
+
 ccl::LevelMap::LevelMap()
+    : m_hash()
 {
     memset(m_fgTiles, 0, CCL_WIDTH * CCL_HEIGHT * sizeof(tile_t));
     memset(m_bgTiles, 0, CCL_WIDTH * CCL_HEIGHT * sizeof(tile_t));
 }
 
+ccl::LevelMap::LevelMap(const ccl::LevelMap& init)
+    : m_hash()
+{
+    operator=(init);
+}
+
+ccl::LevelMap::~LevelMap() = default;
+
 ccl::LevelMap& ccl::LevelMap::operator=(const ccl::LevelMap& source)
 {
     memcpy(m_fgTiles, source.m_fgTiles, CCL_WIDTH * CCL_HEIGHT * sizeof(tile_t));
     memcpy(m_bgTiles, source.m_bgTiles, CCL_WIDTH * CCL_HEIGHT * sizeof(tile_t));
+    m_hash = source.m_hash;
+    if (m_tileIndex)
+        rebuildTileIndex();
     return *this;
 }
 
@@ -51,25 +75,23 @@ void ccl::LevelMap::copyFrom(const ccl::LevelMap& source, int srcX, int srcY,
 
     for (int x = 0; x < width; ++x) {
         for (int y = 0; y < height; ++y) {
-            m_fgTiles[((y+destY) * CCL_WIDTH) + (x+destX)]
-                = source.m_fgTiles[((y+srcY) * CCL_WIDTH) + (x+srcX)];
-            m_bgTiles[((y+destY) * CCL_WIDTH) + (x+destX)]
-                = source.m_bgTiles[((y+srcY) * CCL_WIDTH) + (x+srcX)];
+            setFG(x + destX, y + destY, source.getFG(x + srcX, y + srcY));
+            setBG(x + destX, y + destY, source.getBG(x + srcX, y + srcY));
         }
     }
 }
 
 void ccl::LevelMap::push(int x, int y, tile_t tile)
 {
-    m_bgTiles[(y*CCL_WIDTH) + x] = m_fgTiles[(y*CCL_WIDTH) + x];
-    m_fgTiles[(y*CCL_WIDTH) + x] = tile;
+    setBG(x, y, getFG(x, y));
+    setFG(x, y, tile);
 }
 
 tile_t ccl::LevelMap::pop(int x, int y)
 {
-    tile_t tile = m_fgTiles[(y*CCL_WIDTH) + x];
-    m_fgTiles[(y*CCL_WIDTH) + x] = m_bgTiles[(y*CCL_WIDTH) + x];
-    m_bgTiles[(y*CCL_WIDTH) + x] = 0;
+    tile_t tile = getFG(x, y);
+    setFG(x, y, getBG(x, y));
+    setBG(x, y, 0);
     return tile;
 }
 
@@ -78,6 +100,9 @@ long ccl::LevelMap::read(ccl::Stream* stream)
     long begin = stream->tell();
     stream->readRLE(m_fgTiles, CCL_WIDTH * CCL_HEIGHT);
     stream->readRLE(m_bgTiles, CCL_WIDTH * CCL_HEIGHT);
+    recomputeHash();
+    if (m_tileIndex)
+        rebuildTileIndex();
     return stream->tell() - begin;
 }
 
@@ -89,8 +114,19 @@ long ccl::LevelMap::write(ccl::Stream* stream) const
     return outsize;
 }
 
+uint64_t ccl::LevelMap::recomputeHash()
+{
+    m_hash = 0;
+    for (int i = 0; i < CCL_WIDTH * CCL_HEIGHT; ++i)
+        m_hash ^= cellKey(LayerFG, i, m_fgTiles[i]) ^ cellKey(LayerBG, i, m_bgTiles[i]);
+    return m_hash;
+}
+
 ccl::Point ccl::LevelMap::findNext(int x, int y, tile_t tile) const
 {
+    if (m_tileIndex && tile < NUM_TILE_TYPES)
+        return (m_tileIndex->cells[0][tile] | m_tileIndex->cells[1][tile]).findNext(x, y);
+
     ccl::Point result;
     result.X = x;
     result.Y = y;
@@ -110,6 +146,89 @@ ccl::Point ccl::LevelMap::findNext(int x, int y, tile_t tile) const
     }
 }
 
+ccl::Point ccl::LevelMap::findPrev(int x, int y, tile_t tile) const
+{
+    if (m_tileIndex && tile < NUM_TILE_TYPES)
+        return (m_tileIndex->cells[0][tile] | m_tileIndex->cells[1][tile]).findPrev(x, y);
+
+    ccl::Point result;
+    result.X = x;
+    result.Y = y;
+    for ( ;; ) {
+        if (--result.X < 0) {
+            if (--result.Y < 0)
+                result.Y = 31;
+            result.X = 31;
+        }
+        if (getFG(result.X, result.Y) == tile || getBG(result.X, result.Y) == tile)
+            return result;
+        if (result.X == x && result.Y == y) {
+            result.X = -1;
+            result.Y = -1;
+            return result;
+        }
+    }
+}
+
+int ccl::LevelMap::count(tile_t tile) const
+{
+    if (m_tileIndex && tile < NUM_TILE_TYPES)
+        return m_tileIndex->cells[0][tile].count() + m_tileIndex->cells[1][tile].count();
+
+    int total = 0;
+    for (int i = 0; i < CCL_WIDTH * CCL_HEIGHT; ++i) {
+        if (m_fgTiles[i] == tile)
+            ++total;
+        if (m_bgTiles[i] == tile)
+            ++total;
+    }
+    return total;
+}
+
+void ccl::LevelMap::refTileIndex()
+{
+    if (!m_tileIndex) {
+        m_tileIndex.reset(new TileIndex);
+        rebuildTileIndex();
+    }
+    ++m_tileIndex->users;
+}
+
+void ccl::LevelMap::unrefTileIndex()
+{
+    if (m_tileIndex && --m_tileIndex->users == 0)
+        m_tileIndex.reset();
+}
+
+void ccl::LevelMap::moveIndexed(int layer, int index, tile_t from, tile_t to)
+{
+    TileBitmap* cells = m_tileIndex->cells[layer - 1];
+    const int x = index % CCL_WIDTH;
+    const int y = index / CCL_WIDTH;
+    if (from < NUM_TILE_TYPES)
+        cells[from].reset(x, y);
+    if (to < NUM_TILE_TYPES)
+        cells[to].set(x, y);
+}
+
+void ccl::LevelMap::rebuildTileIndex()
+{
+    for (auto& layer : m_tileIndex->cells) {
+        for (auto& bitmap : layer)
+            bitmap.clear();
+    }
+    for (int y = 0; y < CCL_HEIGHT; ++y) {
+        for (int x = 0; x < CCL_WIDTH; ++x) {
+            const tile_t fg = getFG(x, y);
+            const tile_t bg = getBG(x, y);
+            if (fg < NUM_TILE_TYPES)
+                m_tileIndex->cells[0][fg].set(x, y);
+            if (bg < NUM_TILE_TYPES)
+                m_tileIndex->cells[1][bg].set(x, y);
+        }
+    }
+}
+
 
 void ccl::LevelData::copyFrom(const ccl::LevelData* init)
 {
@@ -124,76 +243,131 @@ void ccl::LevelData::copyFrom(const ccl::LevelData* init)
     m_traps = init->m_traps;
     m_clones = init->m_clones;
     m_moveList = init->m_moveList;
+    invalidateLinks();
 }
 
-std::list<ccl::Point> ccl::LevelData::linkedTraps(int x, int y) const
+uint64_t ccl::LevelData::gameplayHash() const
 {
-    std::list<ccl::Point> result;
-    std::list<ccl::Trap>::const_iterator iter = m_traps.begin();
-    while (iter != m_traps.end()) {
-        if (iter->button.X == x && iter->button.Y == y)
-            result.push_back(iter->trap);
-        ++iter;
+    uint64_t hash = HashCombine(m_map.hash(),
+                                ((uint64_t)(uint16_t)m_chips << 16) | (uint16_t)m_timer);
+
+    // Connection order matters to the game, so the lists are hashed in order
+    for (const ccl::Trap& trap : m_traps) {
+        hash = HashCombine(hash, ZobristKey(FieldTraps,
+                    (trap.button.X << 24) | (trap.button.Y << 16)
+                    | (trap.trap.X << 8) | trap.trap.Y));
     }
-    return result;
+    for (const ccl::Clone& clone : m_clones) {
+        hash = HashCombine(hash, ZobristKey(FieldClones,
+                    (clone.button.X << 24) | (clone.button.Y << 16)
+                    | (clone.clone.X << 8) | clone.clone.Y));
+    }
+    for (const ccl::Point& mover : m_moveList)
+        hash = HashCombine(hash, ZobristKey(FieldMoveList, (mover.X << 8) | mover.Y));
+
+    return hash;
 }
 
-std::list<ccl::Point> ccl::LevelData::linkedTrapButtons(int x, int y) const
+uint64_t ccl::LevelData::contentHash() const
 {
-    std::list<ccl::Point> result;
-    std::list<ccl::Trap>::const_iterator iter = m_traps.begin();
-    while (iter != m_traps.end()) {
-        if (iter->trap.X == x && iter->trap.Y == y)
-            result.push_back(iter->button);
-        ++iter;
-    }
-    return result;
+    uint64_t hash = gameplayHash();
+    hash = HashCombine(hash, HashString(m_name));
+    hash = HashCombine(hash, HashString(m_hint));
+    hash = HashCombine(hash, HashString(m_password));
+    hash = HashCombine(hash, HashString(m_author));
+    return hash;
 }
 
-std::list<ccl::Point> ccl::LevelData::linkedCloners(int x, int y) const
+const ccl::LevelData::LinkIndex& ccl::LevelData::linkIndex() const
 {
-    std::list<ccl::Point> result;
-    std::list<ccl::Clone>::const_iterator iter = m_clones.begin();
-    while (iter != m_clones.end()) {
-        if (iter->button.X == x && iter->button.Y == y)
-            result.push_back(iter->clone);
-        ++iter;
+    if (m_linksValid)
+        return *m_links;
+    if (!m_links)
+        m_links.reset(new LinkIndex);
+
+    // Bucket each connection by the cell it is looked up from.  Points
+    // outside of the map can't be looked up, so they are left out.
+    auto inMap = [](const Point& pos) {
+        return pos.X >= 0 && pos.X < CCL_WIDTH && pos.Y >= 0 && pos.Y < CCL_HEIGHT;
+    };
+    auto build = [this, &inMap](LinkType type, size_t count,
+                                const std::function<void(size_t, Point&, Point&)>& link) {
+        uint16_t* first = m_links->first[type];
+        std::vector<Point>& points = m_links->points[type];
+        std::fill(first, first + (CCL_WIDTH * CCL_HEIGHT) + 1, 0);
+
+        Point from, to;
+        for (size_t i = 0; i < count; ++i) {
+            link(i, from, to);
+            if (inMap(from))
+                ++first[(from.Y * CCL_WIDTH) + from.X + 1];
+        }
+        for (int cell = 0; cell < CCL_WIDTH * CCL_HEIGHT; ++cell)
+            first[cell + 1] += first[cell];
+
+        // Fill each cell's run in list order, using the run starts as
+        // cursors and restoring them afterwards
+        points.resize(first[CCL_WIDTH * CCL_HEIGHT]);
+        for (size_t i = 0; i < count; ++i) {
+            link(i, from, to);
+            if (inMap(from))
+                points[first[(from.Y * CCL_WIDTH) + from.X]++] = to;
+        }
+        for (int cell = CCL_WIDTH * CCL_HEIGHT; cell > 0; --cell)
+            first[cell] = first[cell - 1];
+        first[0] = 0;
+    };
+
+    build(TrapsByButton, m_traps.size(), [this](size_t i, Point& from, Point& to) {
+        from = m_traps[i].button;
+        to = m_traps[i].trap;
+    });
+    build(ButtonsByTrap, m_traps.size(), [this](size_t i, Point& from, Point& to) {
+        from = m_traps[i].trap;
+        to = m_traps[i].button;
+    });
+    build(ClonersByButton, m_clones.size(), [this](size_t i, Point& from, Point& to) {
+        from = m_clones[i].button;
+        to = m_clones[i].clone;
+    });
+    build(ButtonsByCloner, m_clones.size(), [this](size_t i, Point& from, Point& to) {
+        from = m_clones[i].clone;
+        to = m_clones[i].button;
+    });
+
+    std::fill(m_links->movers, m_links->movers + (CCL_WIDTH * CCL_HEIGHT), 0);
+    for (const Point& mover : m_moveList) {
+        if (inMap(mover))
+            m_links->movers[(mover.Y * CCL_WIDTH) + mover.X] = 1;
     }
-    return result;
+
+    m_linksValid = true;
+    return *m_links;
 }
 
-std::list<ccl::Point> ccl::LevelData::linkedCloneButtons(int x, int y) const
+ccl::PointSpan ccl::LevelData::links(LinkType type, int x, int y) const
 {
-    std::list<ccl::Point> result;
-    std::list<ccl::Clone>::const_iterator iter = m_clones.begin();
-    while (iter != m_clones.end()) {
-        if (iter->clone.X == x && iter->clone.Y == y)
-            result.push_back(iter->button);
-        ++iter;
-    }
-    return result;
+    if (x < 0 || x >= CCL_WIDTH || y < 0 || y >= CCL_HEIGHT)
+        return PointSpan();
+
+    const LinkIndex& index = linkIndex();
+    const int cell = (y * CCL_WIDTH) + x;
+    const Point* points = index.points[type].data();
+    return PointSpan(points + index.first[type][cell], points + index.first[type][cell + 1]);
 }
 
 bool ccl::LevelData::checkMove(int x, int y) const
 {
-    std::list<ccl::Point>::const_iterator iter = m_moveList.begin();
-    while (iter != m_moveList.end()) {
-        if (iter->X == x && iter->Y == y)
-            return true;
-        ++iter;
-    }
-    return false;
+    if (x < 0 || x >= CCL_WIDTH || y < 0 || y >= CCL_HEIGHT)
+        return false;
+    return linkIndex().movers[(y * CCL_WIDTH) + x] != 0;
 }
 
 void ccl::LevelData::trapConnect(int buttonX, int buttonY, int trapX, int trapY)
 {
-    std::list<ccl::Trap>::iterator iter = m_traps.begin();
-    while (iter != m_traps.end()) {
-        if (iter->button.X == buttonX && iter->button.Y == buttonY
-            && iter->trap.X == trapX && iter->trap.Y == trapY)
+    for (const Point& trap : linkedTraps(buttonX, buttonY)) {
+        if (trap.X == trapX && trap.Y == trapY)
             return;
-        else
-            ++iter;
     }
 
     ccl::Trap item;
@@ -202,17 +376,14 @@ void ccl::LevelData::trapConnect(int buttonX, int buttonY, int trapX, int trapY)
     item.trap.X = trapX;
     item.trap.Y = trapY;
     m_traps.push_back(item);
+    invalidateLinks();
 }
 
 void ccl::LevelData::cloneConnect(int buttonX, int buttonY, int cloneX, int cloneY)
 {
-    std::list<ccl::Clone>::iterator iter = m_clones.begin();
-    while (iter != m_clones.end()) {
-        if (iter->button.X == buttonX && iter->button.Y == buttonY
-            && iter->clone.X == cloneX && iter->clone.Y == cloneY)
+    for (const Point& clone : linkedCloners(buttonX, buttonY)) {
+        if (clone.X == cloneX && clone.Y == cloneY)
             return;
-        else
-            ++iter;
     }
 
     ccl::Clone item;
@@ -221,28 +392,26 @@ void ccl::LevelData::cloneConnect(int buttonX, int buttonY, int cloneX, int clon
     item.clone.X = cloneX;
     item.clone.Y = cloneY;
     m_clones.push_back(item);
+    invalidateLinks();
 }
 
 void ccl::LevelData::addMover(int moverX, int moverY)
 {
-    std::list<ccl::Point>::iterator iter = m_moveList.begin();
-    while (iter != m_moveList.end()) {
-        if (iter->X == moverX && iter->Y == moverY)
-            return;
-        else
-            ++iter;
-    }
+    if (checkMove(moverX, moverY))
+        return;
 
     ccl::Point item;
     item.X = moverX;
     item.Y = moverY;
     m_moveList.push_back(item);
+    invalidateLinks();
 }
 
 long ccl::LevelData::read(ccl::Stream* stream, bool forClipboard)
 {
     long levelBegin = stream->tell();
     long dataSize = forClipboard ? 0 : (long)stream->read16();
+    invalidateLinks();
 
     m_levelNum = stream->read16();
     m_timer = stream->read16();
@@ -380,7 +549,7 @@ long ccl::LevelData::write(ccl::Stream* stream, bool forClipboard) const
     if (m_traps.size() > 0) {
         stream->write8((uint8_t)FieldTraps);
         stream->write8((uint8_t)(m_traps.size() * 10));
-        std::list<ccl::Trap>::const_iterator it;
+        std::vector<ccl::Trap>::const_iterator it;
         for (it = m_traps.begin(); it != m_traps.end(); ++it) {
             stream->write16(it->button.X);
             stream->write16(it->button.Y);
@@ -392,7 +561,7 @@ long ccl::LevelData::write(ccl::Stream* stream, bool forClipboard) const
     if (m_clones.size() > 0) {
         stream->write8((uint8_t)FieldClones);
         stream->write8((uint8_t)(m_clones.size() * 8));
-        std::list<ccl::Clone>::const_iterator it;
+        std::vector<ccl::Clone>::const_iterator it;
         for (it = m_clones.begin(); it != m_clones.end(); ++it) {
             stream->write16(it->button.X);
             stream->write16(it->button.Y);
@@ -403,7 +572,7 @@ long ccl::LevelData::write(ccl::Stream* stream, bool forClipboard) const
     if (m_moveList.size() > 0) {
         stream->write8((uint8_t)FieldMoveList);
         stream->write8((uint8_t)(m_moveList.size() * 2));
-        std::list<ccl::Point>::const_iterator it;
+        std::vector<ccl::Point>::const_iterator it;
         for (it = m_moveList.begin(); it != m_moveList.end(); ++it) {
             stream->write8(it->X);
             stream->write8(it->Y);
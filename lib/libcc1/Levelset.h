@@ -19,10 +19,12 @@
 #define _LEVELSET_H
 
 #include <string>
-#include <list>
 #include <vector>
+#include <memory>
+#include <algorithm>
 #include <cstdio>
 #include "Stream.h"
+#include "ContentHash.h"
 
 #define CCL_WIDTH   32
 #define CCL_HEIGHT  32
@@ -42,10 +44,29 @@ struct Point {
 struct Trap     { Point button, trap; };
 struct Clone    { Point button, clone; };
 
+// Non-owning view of a run of points
+class PointSpan {
+public:
+    PointSpan() : m_begin(), m_end() { }
+    PointSpan(const Point* begin, const Point* end) : m_begin(begin), m_end(end) { }
+
+    const Point* begin() const { return m_begin; }
+    const Point* end() const { return m_end; }
+    size_t size() const { return (size_t)(m_end - m_begin); }
+    bool empty() const { return m_begin == m_end; }
+    const Point& operator[](size_t index) const { return m_begin[index]; }
+    const Point& front() const { return *m_begin; }
+
+private:
+    const Point* m_begin;
+    const Point* m_end;
+};
+
 class LevelMap {
 public:
     LevelMap();
-    LevelMap(const LevelMap& init) { operator=(init); }
+    LevelMap(const LevelMap& init);
+    ~LevelMap();
 
     LevelMap& operator=(const LevelMap& source);
     void copyFrom(const LevelMap& source, int srcX = 0, int srcY = 0,
@@ -55,8 +76,29 @@ public:
     tile_t getFG(int x, int y) const { return m_fgTiles[(CCL_WIDTH*y) + x]; }
     tile_t getBG(int x, int y) const { return m_bgTiles[(CCL_WIDTH*y) + x]; }
 
-    void setFG(int x, int y, tile_t tile) { m_fgTiles[(CCL_WIDTH*y) + x] = tile; }
-    void setBG(int x, int y, tile_t tile) { m_bgTiles[(CCL_WIDTH*y) + x] = tile; }
+    // Whole layers, CCL_WIDTH * CCL_HEIGHT tiles in reading order
+    const tile_t* fgTiles() const { return m_fgTiles; }
+    const tile_t* bgTiles() const { return m_bgTiles; }
+
+    void setFG(int x, int y, tile_t tile)
+    {
+        tile_t& cell = m_fgTiles[(CCL_WIDTH*y) + x];
+        m_hash ^= cellKey(LayerFG, (CCL_WIDTH*y) + x, cell)
+                ^ cellKey(LayerFG, (CCL_WIDTH*y) + x, tile);
+        if (m_tileIndex)
+            moveIndexed(LayerFG, (CCL_WIDTH*y) + x, cell, tile);
+        cell = tile;
+    }
+
+    void setBG(int x, int y, tile_t tile)
+    {
+        tile_t& cell = m_bgTiles[(CCL_WIDTH*y) + x];
+        m_hash ^= cellKey(LayerBG, (CCL_WIDTH*y) + x, cell)
+                ^ cellKey(LayerBG, (CCL_WIDTH*y) + x, tile);
+        if (m_tileIndex)
+            moveIndexed(LayerBG, (CCL_WIDTH*y) + x, cell, tile);
+        cell = tile;
+    }
 
     void push(int x, int y, tile_t tile);
     tile_t pop(int x, int y);
@@ -64,11 +106,47 @@ public:
     long read(Stream* stream);
     long write(Stream* stream) const;
 
+    /* Next (or previous) cell in reading order holding tile on either
+     * layer, wrapping around the map and ending with (x, y) itself.
+     * Returns (-1, -1) if the tile is not on the map. */
     ccl::Point findNext(int x, int y, tile_t tile) const;
+    ccl::Point findPrev(int x, int y, tile_t tile) const;
+
+    // Number of cells holding tile, counting each layer separately
+    int count(tile_t tile) const;
+
+    /* Optional per-tile-type occupancy index.  While enabled, every write
+     * keeps a bitmap of each tile type's cells on each layer, so findNext,
+     * findPrev and count only touch a few words instead of scanning the
+     * map.  It costs about 28 KiB, so enable it only for maps which are
+     * being edited.  The index is counted: each refTileIndex() call needs
+     * a matching unrefTileIndex(), and the last one frees it. */
+    void refTileIndex();
+    void unrefTileIndex();
+    bool tileIndexEnabled() const { return m_tileIndex != nullptr; }
+
+    /* 64-bit Zobrist hash of both layers, kept up to date by every write.
+     * An all-floor map hashes to 0.  recomputeHash() rebuilds it from the
+     * tile arrays and returns the new value. */
+    uint64_t hash() const { return m_hash; }
+    uint64_t recomputeHash();
 
 private:
     tile_t m_fgTiles[CCL_WIDTH * CCL_HEIGHT];
     tile_t m_bgTiles[CCL_WIDTH * CCL_HEIGHT];
+    uint64_t m_hash;
+
+    struct TileIndex;
+    std::unique_ptr<TileIndex> m_tileIndex;
+
+    enum { LayerFG = 1, LayerBG = 2 };
+    static uint64_t cellKey(uint32_t layer, int index, tile_t tile)
+    {
+        return (tile == 0) ? 0 : ZobristKey(layer, ((uint32_t)index << 8) | tile);
+    }
+
+    void moveIndexed(int layer, int index, tile_t from, tile_t to);
+    void rebuildTileIndex();
 };
 
 
@@ -81,7 +159,7 @@ public:
     };
 
 public:
-    LevelData() : m_refs(1), m_levelNum(), m_chips(), m_timer() { }
+    LevelData() : m_refs(1), m_levelNum(), m_chips(), m_timer(), m_linksValid() { }
     LevelData(const LevelData&) = delete;
     LevelData& operator=(const LevelData&) = delete;
 
@@ -96,17 +174,24 @@ public:
     std::string author() const { return m_author; }
     unsigned short chips() const { return m_chips; }
     unsigned short timer() const { return m_timer; }
-    const std::list<ccl::Trap>& traps() const { return m_traps; }
-    const std::list<ccl::Clone>& clones() const { return m_clones; }
-    const std::list<ccl::Point>& moveList() const { return m_moveList; }
-    std::list<ccl::Trap>& traps() { return m_traps; }
-    std::list<ccl::Clone>& clones() { return m_clones; }
-    std::list<ccl::Point>& moveList() { return m_moveList; }
-
-    std::list<ccl::Point> linkedTraps(int x, int y) const;
-    std::list<ccl::Point> linkedTrapButtons(int x, int y) const;
-    std::list<ccl::Point> linkedCloners(int x, int y) const;
-    std::list<ccl::Point> linkedCloneButtons(int x, int y) const;
+    const std::vector<ccl::Trap>& traps() const { return m_traps; }
+    const std::vector<ccl::Clone>& clones() const { return m_clones; }
+    const std::vector<ccl::Point>& moveList() const { return m_moveList; }
+
+    // Hash of the map and the fields which affect gameplay
+    uint64_t gameplayHash() const;
+
+    // Hash of the gameplay content and all metadata, excluding the level number
+    uint64_t contentHash() const;
+
+    /* Connections and movers by map position.  These are answered from an
+     * index over the whole map, which is rebuilt on the first lookup after
+     * the lists change.  Returned spans stay valid until the next change.
+     * Not safe to call concurrently on the same LevelData. */
+    PointSpan linkedTraps(int x, int y) const { return links(TrapsByButton, x, y); }
+    PointSpan linkedTrapButtons(int x, int y) const { return links(ButtonsByTrap, x, y); }
+    PointSpan linkedCloners(int x, int y) const { return links(ClonersByButton, x, y); }
+    PointSpan linkedCloneButtons(int x, int y) const { return links(ButtonsByCloner, x, y); }
     bool checkMove(int x, int y) const;
 
     void setName(const std::string& name) { m_name = name; }
@@ -121,6 +206,62 @@ public:
     void cloneConnect(int buttonX, int buttonY, int cloneX, int cloneY);
     void addMover(int moverX, int moverY);
 
+    void setTraps(const std::vector<ccl::Trap>& traps)
+    {
+        m_traps = traps;
+        invalidateLinks();
+    }
+
+    void setClones(const std::vector<ccl::Clone>& clones)
+    {
+        m_clones = clones;
+        invalidateLinks();
+    }
+
+    void setMoveList(const std::vector<ccl::Point>& moveList)
+    {
+        m_moveList = moveList;
+        invalidateLinks();
+    }
+
+    // Remove every connection or mover for which pred returns true.
+    // Returns the number of entries removed.
+    template <typename Pred>
+    size_t removeTraps(Pred pred)
+    {
+        auto first = std::remove_if(m_traps.begin(), m_traps.end(), pred);
+        const size_t removed = m_traps.end() - first;
+        if (removed) {
+            m_traps.erase(first, m_traps.end());
+            invalidateLinks();
+        }
+        return removed;
+    }
+
+    template <typename Pred>
+    size_t removeClones(Pred pred)
+    {
+        auto first = std::remove_if(m_clones.begin(), m_clones.end(), pred);
+        const size_t removed = m_clones.end() - first;
+        if (removed) {
+            m_clones.erase(first, m_clones.end());
+            invalidateLinks();
+        }
+        return removed;
+    }
+
+    template <typename Pred>
+    size_t removeMovers(Pred pred)
+    {
+        auto first = std::remove_if(m_moveList.begin(), m_moveList.end(), pred);
+        const size_t removed = m_moveList.end() - first;
+        if (removed) {
+            m_moveList.erase(first, m_moveList.end());
+            invalidateLinks();
+        }
+        return removed;
+    }
+
     long read(Stream* stream, bool forClipboard = false);
     long write(Stream* stream, bool forClipboard = false) const;
 
@@ -148,9 +289,28 @@ private:
     std::string m_author;
     int m_levelNum;
     int m_chips, m_timer;
-    std::list<ccl::Trap> m_traps;
-    std::list<ccl::Clone> m_clones;
-    std::list<ccl::Point> m_moveList;
+    std::vector<ccl::Trap> m_traps;
+    std::vector<ccl::Clone> m_clones;
+    std::vector<ccl::Point> m_moveList;
+
+    enum LinkType {
+        TrapsByButton, ButtonsByTrap, ClonersByButton, ButtonsByCloner,
+        NUM_LINK_TYPES
+    };
+
+    // Points grouped by the map cell they are linked from, with a
+    // cell's points in first[cell] .. first[cell + 1]
+    struct LinkIndex {
+        uint16_t first[NUM_LINK_TYPES][CCL_WIDTH * CCL_HEIGHT + 1];
+        std::vector<Point> points[NUM_LINK_TYPES];
+        uint8_t movers[CCL_WIDTH * CCL_HEIGHT];
+    };
+    mutable std::unique_ptr<LinkIndex> m_links;
+    mutable bool m_linksValid;
+
+    void invalidateLinks() { m_linksValid = false; }
+    const LinkIndex& linkIndex() const;
+    PointSpan links(LinkType type, int x, int y) const;
 };
 
 
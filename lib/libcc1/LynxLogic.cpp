@@ -0,0 +1,960 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "LynxLogic.h"
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/* Directions are stored as an index matching the low bits of the CC1
+ * creature tiles:  North, West, South, East */
+enum { IdxNorth, IdxWest, IdxSouth, IdxEast };
+
+#define DIR_LEFT(dir)   (((dir) + 1) & 0x03)
+#define DIR_BACK(dir)   (((dir) + 2) & 0x03)
+#define DIR_RIGHT(dir)  (((dir) + 3) & 0x03)
+
+#define NUM_CELLS       (CCL_WIDTH * CCL_HEIGHT)
+
+enum ZobristTable {
+    ZobristTerrain, ZobristCreature, ZobristMotion, ZobristInventory,
+    ZobristChips, ZobristRandom, ZobristPhase,
+};
+
+// Plain floor contributes nothing, which keeps open maps cheap to compare
+static uint64_t terrainKey(int pos, tile_t tile)
+{
+    return (tile == ccl::TileFloor) ? 0 : ccl::ZobristKey(ZobristTerrain, (pos << 8) | tile);
+}
+
+static int neighbor(int pos, int dir)
+{
+    const int x = pos % CCL_WIDTH;
+    const int y = pos / CCL_WIDTH;
+    switch (dir) {
+    case IdxNorth:
+        return (y > 0) ? pos - CCL_WIDTH : -1;
+    case IdxWest:
+        return (x > 0) ? pos - 1 : -1;
+    case IdxSouth:
+        return (y < CCL_HEIGHT - 1) ? pos + CCL_WIDTH : -1;
+    case IdxEast:
+        return (x < CCL_WIDTH - 1) ? pos + 1 : -1;
+    default:
+        return -1;
+    }
+}
+
+static bool isIce(tile_t tile)
+{
+    return tile == ccl::TileIce || (tile >= ccl::TileIce_SE && tile <= ccl::TileIce_NE);
+}
+
+static bool isForce(tile_t tile)
+{
+    return FORCE_TILE(tile) || tile == ccl::TileForce_Rand;
+}
+
+static int forceDirection(tile_t tile)
+{
+    switch (tile) {
+    case ccl::TileForce_N:
+        return IdxNorth;
+    case ccl::TileForce_W:
+        return IdxWest;
+    case ccl::TileForce_S:
+        return IdxSouth;
+    case ccl::TileForce_E:
+        return IdxEast;
+    default:
+        return -1;
+    }
+}
+
+// Walls preventing a creature from leaving a tile in the given direction
+static bool exitBlocked(tile_t terrain, int dir)
+{
+    switch (terrain) {
+    case ccl::TileBarrier_N:
+        return dir == IdxNorth;
+    case ccl::TileBarrier_W:
+        return dir == IdxWest;
+    case ccl::TileBarrier_S:
+        return dir == IdxSouth;
+    case ccl::TileBarrier_E:
+        return dir == IdxEast;
+    case ccl::TileBarrier_SE:
+        return dir == IdxSouth || dir == IdxEast;
+    case ccl::TileIce_SE:
+        return dir == IdxNorth || dir == IdxWest;
+    case ccl::TileIce_SW:
+        return dir == IdxNorth || dir == IdxEast;
+    case ccl::TileIce_NW:
+        return dir == IdxSouth || dir == IdxEast;
+    case ccl::TileIce_NE:
+        return dir == IdxSouth || dir == IdxWest;
+    default:
+        return false;
+    }
+}
+
+// Walls preventing a creature moving in the given direction from entering
+static bool entryBlocked(tile_t terrain, int dir)
+{
+    switch (terrain) {
+    case ccl::TileBarrier_N:
+        return dir == IdxSouth;
+    case ccl::TileBarrier_W:
+        return dir == IdxEast;
+    case ccl::TileBarrier_S:
+        return dir == IdxNorth;
+    case ccl::TileBarrier_E:
+        return dir == IdxWest;
+    case ccl::TileBarrier_SE:
+        return dir == IdxNorth || dir == IdxWest;
+    case ccl::TileIce_SE:
+        return dir == IdxSouth || dir == IdxEast;
+    case ccl::TileIce_SW:
+        return dir == IdxSouth || dir == IdxWest;
+    case ccl::TileIce_NW:
+        return dir == IdxNorth || dir == IdxWest;
+    case ccl::TileIce_NE:
+        return dir == IdxNorth || dir == IdxEast;
+    default:
+        return false;
+    }
+}
+
+// Direction a creature leaves an ice corner after entering it
+static int deflect(tile_t terrain, int dir)
+{
+    switch (terrain) {
+    case ccl::TileIce_SE:
+        return (dir == IdxNorth) ? IdxEast : (dir == IdxWest) ? IdxSouth : dir;
+    case ccl::TileIce_SW:
+        return (dir == IdxNorth) ? IdxWest : (dir == IdxEast) ? IdxSouth : dir;
+    case ccl::TileIce_NW:
+        return (dir == IdxSouth) ? IdxWest : (dir == IdxEast) ? IdxNorth : dir;
+    case ccl::TileIce_NE:
+        return (dir == IdxSouth) ? IdxEast : (dir == IdxWest) ? IdxNorth : dir;
+    default:
+        return dir;
+    }
+}
+
+ccl::LynxSimulation::LynxSimulation()
+    : m_terrainHash(), m_status(SimNoPlayer), m_unsupported(), m_tick(), m_timeLimit(),
+      m_chipsLeft(), m_keys(), m_boots(), m_slideDir(), m_stepping(), m_prng1(), m_prng2()
+{
+    // Reserve the full creature list up front, so cloning never reallocates
+    // while references into the list are held
+    m_creatures.reserve(MaxCreatures);
+    std::fill(std::begin(m_terrain), std::end(m_terrain), TileFloor);
+    std::fill(std::begin(m_occupant), std::end(m_occupant), -1);
+}
+
+void ccl::LynxSimulation::reset(const LevelData* level, int initialSlide, int stepping)
+{
+    m_creatures.clear();
+    m_trapLinks.clear();
+    m_cloneLinks.clear();
+    std::fill(std::begin(m_occupant), std::end(m_occupant), -1);
+
+    m_status = SimRunning;
+    m_unsupported = nullptr;
+    m_tick = 0;
+    m_timeLimit = level->timer() * TicksPerSecond;
+    m_chipsLeft = level->chips();
+    std::fill(std::begin(m_keys), std::end(m_keys), 0);
+    std::fill(std::begin(m_boots), std::end(m_boots), false);
+    m_slideDir = initialSlide & 0x03;
+    m_stepping = stepping;
+    m_prng1 = 0;
+    m_prng2 = 0;
+
+    bool havePlayer = false;
+    for (int pos = 0; pos < NUM_CELLS; ++pos) {
+        const int x = pos % CCL_WIDTH;
+        const int y = pos / CCL_WIDTH;
+        const tile_t upper = level->map().getFG(x, y);
+
+        Creature cr;
+        cr.pos = pos;
+        cr.pending = -1;
+        cr.moving = 0;
+        cr.flags = 0;
+        if (upper >= TilePlayer_N && upper <= TilePlayer_E) {
+            cr.type = TilePlayer_N;
+            cr.dir = upper - TilePlayer_N;
+        } else if (upper >= TilePlayerSwim_N && upper <= TilePlayerSwim_E) {
+            cr.type = TilePlayer_N;
+            cr.dir = upper - TilePlayerSwim_N;
+        } else if (upper == TileBlock) {
+            cr.type = TileBlock;
+            cr.dir = IdxNorth;
+        } else if (upper >= TileBlock_N && upper <= TileBlock_E) {
+            cr.type = TileBlock_N;
+            cr.dir = upper - TileBlock_N;
+        } else if (MONSTER_TILE(upper)) {
+            cr.type = upper & 0xFC;
+            cr.dir = upper & 0x03;
+        } else {
+            m_terrain[pos] = upper;
+            continue;
+        }
+        cr.moveDir = cr.dir;
+        m_terrain[pos] = level->map().getBG(x, y);
+
+        if (cr.type == TilePlayer_N) {
+            // Only the first player is controllable; the Lynx always
+            // processes the player first
+            if (havePlayer)
+                continue;
+            m_creatures.insert(m_creatures.begin(), cr);
+            havePlayer = true;
+        } else if (m_creatures.size() < MaxCreatures) {
+            m_creatures.push_back(cr);
+        }
+    }
+
+    m_terrainHash = 0;
+    for (int pos = 0; pos < NUM_CELLS; ++pos)
+        m_terrainHash ^= terrainKey(pos, m_terrain[pos]);
+
+    for (size_t i = 0; i < m_creatures.size(); ++i)
+        m_occupant[m_creatures[i].pos] = (int16_t)i;
+
+    // Buttons are connected to the next matching tile in reading order
+    for (int pos = 0; pos < NUM_CELLS; ++pos) {
+        tile_t target;
+        if (m_terrain[pos] == TileTrapButton)
+            target = TileTrap;
+        else if (m_terrain[pos] == TileCloneButton)
+            target = TileCloner;
+        else
+            continue;
+
+        for (int scan = (pos + 1) % NUM_CELLS; scan != pos; scan = (scan + 1) % NUM_CELLS) {
+            if (m_terrain[scan] == target) {
+                if (target == TileTrap)
+                    m_trapLinks.emplace_back(pos, scan);
+                else
+                    m_cloneLinks.emplace_back(pos, scan);
+                break;
+            }
+        }
+    }
+
+    if (!havePlayer)
+        m_status = SimNoPlayer;
+}
+
+int ccl::LynxSimulation::timeLeft() const
+{
+    if (m_timeLimit == 0)
+        return -1;
+    return (int)(m_timeLimit - std::min(m_tick, m_timeLimit));
+}
+
+bool ccl::LynxSimulation::haveBoots(tile_t boots) const
+{
+    if (!BOOT_TILE(boots))
+        return false;
+    return m_boots[boots - TileFlippers];
+}
+
+void ccl::LynxSimulation::exportState(LevelData* level) const
+{
+    for (int pos = 0; pos < NUM_CELLS; ++pos) {
+        level->map().setFG(pos % CCL_WIDTH, pos / CCL_WIDTH, m_terrain[pos]);
+        level->map().setBG(pos % CCL_WIDTH, pos / CCL_WIDTH, TileFloor);
+    }
+
+    for (const Creature& cr : m_creatures) {
+        if ((cr.flags & CreatureHidden) != 0)
+            continue;
+
+        tile_t tile;
+        if (cr.type == TileBlock)
+            tile = TileBlock;
+        else if (cr.type == TilePlayer_N && m_terrain[cr.pos] == TileWater)
+            tile = TilePlayerSwim_N + cr.dir;
+        else
+            tile = cr.type + cr.dir;
+        level->map().setBG(cr.pos % CCL_WIDTH, cr.pos / CCL_WIDTH, m_terrain[cr.pos]);
+        level->map().setFG(cr.pos % CCL_WIDTH, cr.pos / CCL_WIDTH, tile);
+    }
+    level->setChips(m_chipsLeft);
+}
+
+ccl::Simulation* ccl::LynxSimulation::clone() const
+{
+    auto copy = new LynxSimulation(*this);
+    // A copied vector does not keep the reserved capacity
+    copy->m_creatures.reserve(MaxCreatures);
+    return copy;
+}
+
+ccl::Point ccl::LynxSimulation::playerPosition() const
+{
+    ccl::Point result;
+    result.X = -1;
+    result.Y = -1;
+    if (m_status == SimNoPlayer || m_creatures.empty())
+        return result;
+
+    const Creature& player = m_creatures[0];
+    if ((player.flags & CreatureHidden) == 0) {
+        result.X = player.pos % CCL_WIDTH;
+        result.Y = player.pos / CCL_WIDTH;
+    }
+    return result;
+}
+
+bool ccl::LynxSimulation::awaitingInput() const
+{
+    if (m_status != SimRunning || m_creatures.empty())
+        return false;
+
+    const Creature& player = m_creatures[0];
+    return (player.flags & (CreatureHidden | CreatureSliding)) == 0
+            && player.moving <= 0;
+}
+
+uint64_t ccl::LynxSimulation::stateHash() const
+{
+    // The terrain is hashed incrementally as it changes, so only the much
+    // shorter creature list is rescanned here
+    uint64_t hash = m_terrainHash;
+
+    bool haveMonsters = false;
+    for (const Creature& cr : m_creatures) {
+        if ((cr.flags & CreatureHidden) != 0)
+            continue;
+        if (classOf(cr) == ClassMonster)
+            haveMonsters = true;
+        hash ^= ccl::ZobristKey(ZobristCreature, (cr.pos << 10) | (cr.type << 2) | cr.dir);
+        if (cr.moving > 0 || (cr.flags & CreatureSliding) != 0) {
+            hash ^= ccl::ZobristKey(ZobristMotion, (cr.pos << 16) | (cr.moveDir << 8)
+                               | ((uint8_t)cr.moving << 3) | (cr.flags & 0x07));
+        }
+    }
+
+    for (int color = 0; color < 4; ++color) {
+        hash ^= ccl::ZobristKey(ZobristInventory, (color << 8) | (uint8_t)m_keys[color]);
+        if (m_boots[color])
+            hash ^= ccl::ZobristKey(ZobristInventory, 0x1000 | color);
+    }
+    hash ^= ccl::ZobristKey(ZobristChips, (uint32_t)m_chipsLeft);
+    hash ^= ccl::ZobristKey(ZobristRandom, (m_slideDir << 16) | (m_prng1 << 8) | m_prng2);
+
+    // Monster movement depends on the tick phase
+    if (haveMonsters)
+        hash ^= ccl::ZobristKey(ZobristPhase, (m_tick + m_stepping) & 0x07);
+
+    return hash;
+}
+
+ccl::LynxSimulation::CreatureClass ccl::LynxSimulation::classOf(const Creature& cr)
+{
+    if (cr.type == TilePlayer_N)
+        return ClassPlayer;
+    if (cr.type == TileBlock || cr.type == TileBlock_N)
+        return ClassBlock;
+    return ClassMonster;
+}
+
+/* The Lynx pseudo-random number generator.  This is reset at the start of
+ * every level, so random creature movement is fully reproducible. */
+uint8_t ccl::LynxSimulation::random()
+{
+    uint8_t n = (uint8_t)((m_prng1 >> 2) - m_prng1);
+    if ((m_prng1 & 0x02) == 0)
+        --n;
+    m_prng1 = (uint8_t)((m_prng1 >> 1) | (m_prng2 & 0x80));
+    m_prng2 = (uint8_t)((m_prng2 << 1) | (n & 0x01));
+    return m_prng1 ^ m_prng2;
+}
+
+void ccl::LynxSimulation::setTerrain(int pos, tile_t tile)
+{
+    m_terrainHash ^= terrainKey(pos, m_terrain[pos]) ^ terrainKey(pos, tile);
+    m_terrain[pos] = tile;
+}
+
+bool ccl::LynxSimulation::trapOpen(int pos) const
+{
+    for (const auto& link : m_trapLinks) {
+        if (link.second == pos && m_occupant[link.first] >= 0)
+            return true;
+    }
+    return false;
+}
+
+bool ccl::LynxSimulation::canEnter(const Creature& cr, int dest, int dir) const
+{
+    const tile_t terrain = m_terrain[dest];
+    if (entryBlocked(terrain, dir))
+        return false;
+
+    const CreatureClass crClass = classOf(cr);
+    switch (terrain) {
+    case TileWall:
+    case TileInvisWall:
+    case TileBlueWall:
+    case TileToggleWall:
+    case TileAppearingWall:
+    case TileCloner:
+    case TileIceBlock:
+    case Tile_UNUSED_20:
+    case Tile_UNUSED_36:
+    case Tile_UNUSED_37:
+    case TilePlayerSplash:
+    case TilePlayerFire:
+    case TilePlayerBurnt:
+    case TilePlayerExit:
+    case TileExitAnim2:
+    case TileExitAnim3:
+        return false;
+    case TileDoor_Blue:
+    case TileDoor_Red:
+    case TileDoor_Green:
+    case TileDoor_Yellow:
+        return crClass == ClassPlayer && m_keys[terrain - TileDoor_Blue] > 0;
+    case TileSocket:
+        return crClass == ClassPlayer && m_chipsLeft == 0;
+    case TileExit:
+    case TileChip:
+    case TileDirt:
+    case TileBlueFloor:
+    case TilePopUpWall:
+    case TileThief:
+    case TileFlippers:
+    case TileFireBoots:
+    case TileIceSkates:
+    case TileForceBoots:
+        return crClass == ClassPlayer;
+    case TileGravel:
+        return crClass != ClassMonster;
+    case TileFire:
+        // Lynx monsters treat fire as a wall, except for fireballs
+        return crClass != ClassMonster || cr.type == TileFireball_N;
+    default:
+        return terrain < NUM_TILE_TYPES;
+    }
+}
+
+bool ccl::LynxSimulation::canMove(const Creature& cr, int from, int dir) const
+{
+    if (exitBlocked(m_terrain[from], dir))
+        return false;
+    if (m_terrain[from] == TileTrap && !trapOpen(from))
+        return false;
+
+    const int dest = neighbor(from, dir);
+    if (dest < 0 || !canEnter(cr, dest, dir))
+        return false;
+
+    const int occupant = m_occupant[dest];
+    if (occupant < 0)
+        return true;
+
+    const Creature& other = m_creatures[occupant];
+    if (classOf(cr) == ClassPlayer) {
+        // Blocks can be pushed, and walking into a monster is fatal
+        if (classOf(other) == ClassBlock)
+            return other.moving <= 0 && canMove(other, dest, dir);
+        return true;
+    }
+    return classOf(other) == ClassPlayer;
+}
+
+ccl::SimulationStatus ccl::LynxSimulation::tick(int input)
+{
+    if (m_status != SimRunning)
+        return m_status;
+    if (m_timeLimit != 0 && m_tick >= m_timeLimit) {
+        m_status = SimTimeOut;
+        return m_status;
+    }
+
+    // Creatures cloned during this tick don't act until the next one
+    const size_t count = m_creatures.size();
+    for (size_t i = count; i > 0; --i)
+        m_creatures[i - 1].pending = (int8_t)chooseMove(i - 1, input);
+
+    for (size_t i = count; i > 0 && m_status == SimRunning; --i) {
+        Creature& cr = m_creatures[i - 1];
+        if (cr.pending < 0 || (cr.flags & CreatureHidden) != 0 || cr.moving > 0)
+            continue;
+
+        const int dir = cr.pending;
+        cr.pending = -1;
+        if (canMove(cr, cr.pos, dir))
+            startMove(i - 1, dir);
+        else if (classOf(cr) == ClassPlayer)
+            bump(cr.pos, dir);
+    }
+
+    for (size_t i = count; i > 0 && m_status == SimRunning; --i) {
+        Creature& cr = m_creatures[i - 1];
+        if ((cr.flags & CreatureHidden) != 0 || cr.moving <= 0)
+            continue;
+
+        cr.moving -= ((cr.flags & CreatureFast) != 0) ? 4 : 2;
+        if (cr.moving <= 0) {
+            cr.moving = 0;
+            arrive(i - 1);
+        }
+    }
+
+    ++m_tick;
+    return m_status;
+}
+
+int ccl::LynxSimulation::chooseMove(size_t idx, int input)
+{
+    Creature& cr = m_creatures[idx];
+    if ((cr.flags & CreatureHidden) != 0 || cr.moving > 0)
+        return -1;
+
+    const CreatureClass crClass = classOf(cr);
+    if (crClass != ClassPlayer && m_terrain[cr.pos] == TileCloner) {
+        // Creatures on a clone machine only move when cloned
+        return -1;
+    }
+    if (m_terrain[cr.pos] == TileTrap && !trapOpen(cr.pos))
+        return -1;
+
+    if ((cr.flags & CreatureSliding) != 0) {
+        const int dir = forcedMove(cr, input);
+        if (dir >= 0)
+            return dir;
+    }
+    cr.flags &= ~(CreatureSliding | CreatureFast);
+
+    if (crClass == ClassMonster)
+        return chooseMonsterMove(cr);
+    if (crClass == ClassBlock)
+        return -1;
+
+    input &= InputDirMask;
+    if (input == InputNone)
+        return -1;
+
+    int tryDirs[4];
+    int numDirs = 0;
+    for (int dir = IdxNorth; dir <= IdxEast; ++dir) {
+        if ((input & (1 << dir)) != 0)
+            tryDirs[numDirs++] = dir;
+    }
+    // For diagonal input, try turning away from the current facing first
+    if (numDirs == 2 && (tryDirs[0] & 0x01) == (cr.dir & 0x01))
+        std::swap(tryDirs[0], tryDirs[1]);
+
+    for (int i = 0; i < numDirs; ++i) {
+        if (canMove(cr, cr.pos, tryDirs[i]))
+            return tryDirs[i];
+        bump(cr.pos, tryDirs[i]);
+    }
+    cr.dir = tryDirs[0];
+    return -1;
+}
+
+int ccl::LynxSimulation::forcedMove(Creature& cr, int input)
+{
+    const tile_t terrain = m_terrain[cr.pos];
+    if (classOf(cr) == ClassPlayer && isForce(terrain) && (input & InputDirMask) != 0) {
+        // The player may step off of a force floor, but not against it
+        for (int dir = IdxNorth; dir <= IdxEast; ++dir) {
+            if ((input & (1 << dir)) != 0 && dir != DIR_BACK(cr.moveDir)
+                    && canMove(cr, cr.pos, dir)) {
+                cr.flags &= ~(CreatureSliding | CreatureFast);
+                return dir;
+            }
+        }
+    }
+
+    if (canMove(cr, cr.pos, cr.moveDir)) {
+        cr.flags |= CreatureFast;
+        return cr.moveDir;
+    }
+    if (isIce(terrain)) {
+        // Bounce off of walls while sliding on ice
+        const int back = DIR_BACK(cr.moveDir);
+        if (canMove(cr, cr.pos, back)) {
+            cr.flags |= CreatureFast;
+            return back;
+        }
+    }
+    return -1;
+}
+
+int ccl::LynxSimulation::chooseMonsterMove(Creature& cr)
+{
+    int dirs[4];
+    int numDirs = 0;
+    const int facing = cr.dir;
+
+    switch (cr.type) {
+    case TileBug_N:
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case TileFireball_N:
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case TileBall_N:
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case TileTank_N:
+        dirs[numDirs++] = facing;
+        break;
+    case TileGlider_N:
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case TileCrawler_N:
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case TileWalker_N:
+        if (canMove(cr, cr.pos, facing))
+            return facing;
+        // Turn in a random direction when blocked
+        {
+            const int start = random() & 0x03;
+            for (int i = 0; i < 4; ++i) {
+                const int dir = (facing + start + i) & 0x03;
+                if (dir != facing)
+                    dirs[numDirs++] = dir;
+            }
+        }
+        break;
+    case TileBlob_N:
+        if (((m_tick + m_stepping) & 0x04) != 0)
+            return -1;
+        {
+            const int start = random() & 0x03;
+            for (int i = 0; i < 4; ++i)
+                dirs[numDirs++] = (start + i) & 0x03;
+        }
+        break;
+    case TileTeeth_N:
+        if (((m_tick + m_stepping) & 0x04) != 0)
+            return -1;
+        {
+            const Creature& player = m_creatures[0];
+            const int dx = (player.pos % CCL_WIDTH) - (cr.pos % CCL_WIDTH);
+            const int dy = (player.pos / CCL_WIDTH) - (cr.pos / CCL_WIDTH);
+            const int horiz = (dx < 0) ? IdxWest : (dx > 0) ? IdxEast : -1;
+            const int vert = (dy < 0) ? IdxNorth : (dy > 0) ? IdxSouth : -1;
+            if (std::abs(dx) > std::abs(dy)) {
+                dirs[numDirs++] = horiz;
+                if (vert >= 0)
+                    dirs[numDirs++] = vert;
+            } else if (vert >= 0) {
+                dirs[numDirs++] = vert;
+                if (horiz >= 0)
+                    dirs[numDirs++] = horiz;
+            }
+            // Teeth always face the player, even when blocked
+            if (numDirs > 0)
+                cr.dir = dirs[0];
+        }
+        break;
+    default:
+        return -1;
+    }
+
+    for (int i = 0; i < numDirs; ++i) {
+        if (canMove(cr, cr.pos, dirs[i]))
+            return dirs[i];
+    }
+    return -1;
+}
+
+void ccl::LynxSimulation::startMove(size_t idx, int dir)
+{
+    Creature& cr = m_creatures[idx];
+    const int dest = neighbor(cr.pos, dir);
+    Q_ASSERT(dest >= 0);
+
+    const CreatureClass crClass = classOf(cr);
+    const int occupant = m_occupant[dest];
+    if (occupant >= 0) {
+        Creature& other = m_creatures[occupant];
+        if (crClass == ClassPlayer && classOf(other) == ClassBlock) {
+            other.flags &= ~(CreatureSliding | CreatureFast);
+            startMove(occupant, dir);
+        } else if (other.moving > 0) {
+            // Both creatures are moving in the same tick.  Tile World decides
+            // whether they meet from the animation frame each one has reached,
+            // which isn't modeled here, so don't guess at the outcome.
+            m_status = SimUnsupported;
+            m_unsupported = "a collision between two moving creatures";
+            return;
+        } else {
+            // Either the player walked into a creature, or a creature
+            // walked into the player
+            m_status = SimDied;
+        }
+    }
+
+    if (m_occupant[cr.pos] == (int16_t)idx)
+        m_occupant[cr.pos] = -1;
+
+    if (crClass == ClassPlayer) {
+        if (m_terrain[cr.pos] == TilePopUpWall)
+            setTerrain(cr.pos, TileWall);
+
+        switch (m_terrain[dest]) {
+        case TileDoor_Blue:
+        case TileDoor_Red:
+        case TileDoor_Yellow:
+            --m_keys[m_terrain[dest] - TileDoor_Blue];
+            setTerrain(dest, TileFloor);
+            break;
+        case TileDoor_Green:
+            // Green keys are never used up
+            setTerrain(dest, TileFloor);
+            break;
+        case TileSocket:
+        case TileDirt:
+        case TileBlueFloor:
+            setTerrain(dest, TileFloor);
+            break;
+        default:
+            break;
+        }
+    }
+
+    m_occupant[dest] = (int16_t)idx;
+    cr.pos = dest;
+    cr.dir = dir;
+    cr.moveDir = dir;
+    cr.moving = 8;
+    cr.flags &= ~CreatureSliding;
+}
+
+void ccl::LynxSimulation::arrive(size_t idx)
+{
+    Creature& cr = m_creatures[idx];
+    const tile_t& terrain = m_terrain[cr.pos];
+    cr.flags &= ~CreatureFast;
+
+    switch (classOf(cr)) {
+    case ClassPlayer:
+        switch (terrain) {
+        case TileWater:
+            if (!m_boots[TileFlippers - TileFlippers])
+                m_status = SimDied;
+            break;
+        case TileFire:
+            if (!m_boots[TileFireBoots - TileFlippers])
+                m_status = SimDied;
+            break;
+        case TileBomb:
+            setTerrain(cr.pos, TileFloor);
+            m_status = SimDied;
+            break;
+        case TileChip:
+            if (m_chipsLeft > 0)
+                --m_chipsLeft;
+            setTerrain(cr.pos, TileFloor);
+            break;
+        case TileKey_Blue:
+        case TileKey_Red:
+        case TileKey_Green:
+        case TileKey_Yellow:
+            ++m_keys[terrain - TileKey_Blue];
+            setTerrain(cr.pos, TileFloor);
+            break;
+        case TileFlippers:
+        case TileFireBoots:
+        case TileIceSkates:
+        case TileForceBoots:
+            m_boots[terrain - TileFlippers] = true;
+            setTerrain(cr.pos, TileFloor);
+            break;
+        case TileThief:
+            std::fill(std::begin(m_boots), std::end(m_boots), false);
+            break;
+        case TileExit:
+            m_status = SimSuccess;
+            break;
+        default:
+            break;
+        }
+        break;
+    case ClassBlock:
+        if (terrain == TileWater) {
+            setTerrain(cr.pos, TileDirt);
+            removeCreature(idx);
+            return;
+        }
+        if (terrain == TileBomb) {
+            setTerrain(cr.pos, TileFloor);
+            removeCreature(idx);
+            return;
+        }
+        break;
+    case ClassMonster:
+        if ((terrain == TileWater && cr.type != TileGlider_N)
+                || (terrain == TileFire && cr.type != TileFireball_N)) {
+            removeCreature(idx);
+            return;
+        }
+        if (terrain == TileBomb) {
+            setTerrain(cr.pos, TileFloor);
+            removeCreature(idx);
+            return;
+        }
+        break;
+    }
+
+    if (m_status != SimRunning)
+        return;
+
+    pressButton(cr.pos);
+    if (terrain == TileTeleport) {
+        teleport(idx);
+        return;
+    }
+
+    const bool isPlayer = (classOf(cr) == ClassPlayer);
+    if (isIce(terrain) && !(isPlayer && m_boots[TileIceSkates - TileFlippers])) {
+        cr.moveDir = deflect(terrain, cr.moveDir);
+        if (!isPlayer)
+            cr.dir = cr.moveDir;
+        cr.flags |= CreatureSliding;
+    } else if (isForce(terrain) && !(isPlayer && m_boots[TileForceBoots - TileFlippers])) {
+        if (terrain == TileForce_Rand) {
+            m_slideDir = DIR_RIGHT(m_slideDir);
+            cr.moveDir = m_slideDir;
+        } else {
+            cr.moveDir = forceDirection(terrain);
+        }
+        cr.flags |= CreatureSliding;
+    }
+}
+
+void ccl::LynxSimulation::bump(int pos, int dir)
+{
+    // The player reveals hidden walls by bumping into them
+    const int dest = neighbor(pos, dir);
+    if (dest < 0)
+        return;
+    if (m_terrain[dest] == TileBlueWall || m_terrain[dest] == TileAppearingWall)
+        setTerrain(dest, TileWall);
+}
+
+void ccl::LynxSimulation::pressButton(int pos)
+{
+    switch (m_terrain[pos]) {
+    case TileToggleButton:
+        for (int cell = 0; cell < NUM_CELLS; ++cell) {
+            if (m_terrain[cell] == TileToggleWall)
+                setTerrain(cell, TileToggleFloor);
+            else if (m_terrain[cell] == TileToggleFloor)
+                setTerrain(cell, TileToggleWall);
+        }
+        break;
+    case TileTankButton:
+        for (Creature& cr : m_creatures) {
+            if (cr.type == TileTank_N && (cr.flags & CreatureHidden) == 0) {
+                cr.dir = DIR_BACK(cr.dir);
+                if (cr.moving <= 0)
+                    cr.moveDir = cr.dir;
+            }
+        }
+        break;
+    case TileCloneButton:
+        for (const auto& link : m_cloneLinks) {
+            if (link.first == pos)
+                cloneCreature(link.second);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void ccl::LynxSimulation::cloneCreature(int clonerPos)
+{
+    const int idx = m_occupant[clonerPos];
+    if (idx < 0 || m_creatures.size() >= MaxCreatures)
+        return;
+
+    Creature& original = m_creatures[idx];
+    if (classOf(original) == ClassPlayer || original.moving > 0
+            || !canMove(original, clonerPos, original.dir))
+        return;
+
+    // The original leaves the clone machine, and the copy remains behind
+    // to be cloned again later
+    Creature clone = original;
+    clone.pending = -1;
+    clone.moving = 0;
+    clone.flags = 0;
+    startMove(idx, original.dir);
+
+    m_occupant[clonerPos] = (int16_t)m_creatures.size();
+    m_creatures.push_back(clone);
+}
+
+void ccl::LynxSimulation::teleport(size_t idx)
+{
+    Creature& cr = m_creatures[idx];
+    const int start = cr.pos;
+
+    // Search backwards in reading order for a teleport the creature can
+    // exit from.  If none is found, the creature stays where it is.
+    int pos = start;
+    do {
+        pos = (pos == 0 ? NUM_CELLS : pos) - 1;
+        if (m_terrain[pos] == TileTeleport && m_occupant[pos] < 0
+                && canMove(cr, pos, cr.moveDir))
+            break;
+    } while (pos != start);
+
+    if (pos != start) {
+        m_occupant[start] = -1;
+        m_occupant[pos] = (int16_t)idx;
+        cr.pos = pos;
+    }
+    cr.flags |= CreatureSliding;
+}
+
+void ccl::LynxSimulation::removeCreature(size_t idx)
+{
+    Creature& cr = m_creatures[idx];
+    cr.flags |= CreatureHidden;
+    if (m_occupant[cr.pos] == (int16_t)idx)
+        m_occupant[cr.pos] = -1;
+}
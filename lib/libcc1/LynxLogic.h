@@ -0,0 +1,123 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _LYNXLOGIC_H
+#define _LYNXLOGIC_H
+
+#include "Simulation.h"
+
+namespace ccl {
+
+/* Simulation of the Atari Lynx ruleset, modeled after the Tile World
+ * implementation.  The Lynx rules ignore the trap/clone connections and
+ * monster list stored in the level, and instead derive them from the
+ * positions of the tiles in the map.
+ *
+ * Movement is tracked in eighths of a tile, not in Tile World's animation
+ * frames, so a collision with a creature that is still moving into its cell
+ * can't be resolved the way Tile World does.  Play ends with SimUnsupported
+ * when that happens, rather than with a result that may be wrong.
+ */
+class LynxSimulation : public Simulation {
+public:
+    LynxSimulation();
+
+    Simulation* clone() const override;
+
+    void reset(const LevelData* level, int initialSlide = 0,
+               int stepping = 0) override;
+    SimulationStatus tick(int input) override;
+
+    SimulationStatus status() const override { return m_status; }
+    unsigned int tickCount() const override { return m_tick; }
+    int chipsLeft() const override { return m_chipsLeft; }
+    int timeLeft() const override;
+
+    void exportState(LevelData* level) const override;
+    ccl::Point playerPosition() const override;
+    bool awaitingInput() const override;
+    uint64_t stateHash() const override;
+
+    const char* unsupportedFeature() const override { return m_unsupported; }
+
+    // Count of keys held, indexed by door color (Blue, Red, Green, Yellow)
+    int keys(int color) const { return m_keys[color & 0x03]; }
+    bool haveBoots(tile_t boots) const;
+
+    enum { MaxCreatures = 128 };
+
+private:
+    struct Creature {
+        int pos;
+        tile_t type;        // Creature tile, facing North
+        uint8_t dir;        // Facing direction (North, West, South, East)
+        uint8_t moveDir;    // Direction of the current or forced move
+        int8_t pending;     // Direction chosen for this tick, or -1
+        int8_t moving;      // Remaining movement, in eighths of a tile
+        uint8_t flags;
+    };
+
+    enum CreatureFlags {
+        CreatureHidden  = (1<<0),   // Removed from play
+        CreatureSliding = (1<<1),   // Next move is forced by the terrain
+        CreatureFast    = (1<<2),   // Current move is a slide
+    };
+
+    enum CreatureClass { ClassPlayer, ClassBlock, ClassMonster };
+
+    tile_t m_terrain[CCL_WIDTH * CCL_HEIGHT];
+    int16_t m_occupant[CCL_WIDTH * CCL_HEIGHT];
+    uint64_t m_terrainHash;     // Zobrist hash of m_terrain, kept by setTerrain()
+    std::vector<Creature> m_creatures;
+    std::vector<std::pair<int, int>> m_trapLinks;
+    std::vector<std::pair<int, int>> m_cloneLinks;
+
+    SimulationStatus m_status;
+    const char* m_unsupported;
+    unsigned int m_tick;
+    unsigned int m_timeLimit;
+    int m_chipsLeft;
+    int m_keys[4];
+    bool m_boots[4];
+    int m_slideDir;
+    int m_stepping;
+    uint8_t m_prng1, m_prng2;
+
+    static CreatureClass classOf(const Creature& cr);
+    uint8_t random();
+    void setTerrain(int pos, tile_t tile);
+
+    bool trapOpen(int pos) const;
+    bool canEnter(const Creature& cr, int dest, int dir) const;
+    bool canMove(const Creature& cr, int from, int dir) const;
+
+    int chooseMove(size_t idx, int input);
+    int chooseMonsterMove(Creature& cr);
+    int forcedMove(Creature& cr, int input);
+    void startMove(size_t idx, int dir);
+    void arrive(size_t idx);
+    void bump(int pos, int dir);
+
+    void pressButton(int pos);
+    void cloneCreature(int clonerPos);
+    void teleport(size_t idx);
+    void removeCreature(size_t idx);
+};
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+unsigned int ccl::RunParallel(size_t count, unsigned int threads,
+                              const std::function<void(unsigned int, size_t)>& job)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > count)
+        threads = (unsigned int)count;
+    if (threads == 0)
+        return 0;
+
+    std::atomic<size_t> next(0);
+    auto worker = [&next, &job, count](unsigned int workerId) {
+        for ( ;; ) {
+            const size_t index = next.fetch_add(1);
+            if (index >= count)
+                break;
+            job(workerId, index);
+        }
+    };
+
+    // The calling thread acts as the first worker
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned int i = 1; i < threads; ++i)
+        pool.emplace_back(worker, i);
+    worker(0);
+    for (auto& thread : pool)
+        thread.join();
+
+    return threads;
+}
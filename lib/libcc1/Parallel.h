@@ -0,0 +1,37 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <functional>
+#include <cstddef>
+
+namespace ccl {
+
+/* Run job(worker, index) for each index in [0, count) on a pool of worker
+ * threads.  Each worker index is only ever used by one thread at a time,
+ * so it can be used to select per-thread state.  If threads is 0, the
+ * number of hardware threads is used.  Returns the number of workers
+ * that were started.
+ */
+unsigned int RunParallel(size_t count, unsigned int threads,
+                         const std::function<void(unsigned int, size_t)>& job);
+
+}
+
+#endif
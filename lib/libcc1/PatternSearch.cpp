@@ -0,0 +1,114 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "PatternSearch.h"
+
+// Arbitrary odd multipliers; arithmetic is modulo 2^64
+static const uint64_t RowBase = 0x9E3779B97F4A7C15ULL;
+static const uint64_t ColumnBase = 0xC2B2AE3D27D4EB4FULL;
+
+static uint64_t power(uint64_t base, int exponent)
+{
+    uint64_t result = 1;
+    while (exponent-- > 0)
+        result *= base;
+    return result;
+}
+
+std::vector<ccl::Point> ccl::FindPattern2D(const std::vector<uint64_t>& cells,
+                                           int width, int height,
+                                           const std::vector<uint64_t>& pattern,
+                                           int patternWidth, int patternHeight)
+{
+    std::vector<Point> matches;
+    if (patternWidth <= 0 || patternHeight <= 0
+            || patternWidth > width || patternHeight > height)
+        return matches;
+
+    // Cell codes are often small and similar (tile numbers), so they are
+    // mixed before hashing to keep the polynomial hash well distributed
+    auto cellValue = [](uint64_t code) { return HashMix64(code); };
+
+    uint64_t patternHash = 0;
+    for (int y = 0; y < patternHeight; ++y) {
+        uint64_t rowHash = 0;
+        for (int x = 0; x < patternWidth; ++x)
+            rowHash = (rowHash * RowBase) + cellValue(pattern[(y * patternWidth) + x]);
+        patternHash = (patternHash * ColumnBase) + rowHash;
+    }
+
+    // Rolling hashes of each patternWidth-wide window, for every row
+    const int windows = width - patternWidth + 1;
+    const uint64_t rowDrop = power(RowBase, patternWidth);
+    std::vector<uint64_t> rowHashes((size_t)(windows * height));
+    for (int y = 0; y < height; ++y) {
+        const uint64_t* row = &cells[y * width];
+        uint64_t hash = 0;
+        for (int x = 0; x < width; ++x) {
+            hash = (hash * RowBase) + cellValue(row[x]);
+            if (x >= patternWidth)
+                hash -= cellValue(row[x - patternWidth]) * rowDrop;
+            if (x >= patternWidth - 1)
+                rowHashes[(y * windows) + x - (patternWidth - 1)] = hash;
+        }
+    }
+
+    // Roll the row hashes down each column of windows
+    const uint64_t columnDrop = power(ColumnBase, patternHeight);
+    std::vector<uint64_t> columnHashes((size_t)windows, 0);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < windows; ++x) {
+            uint64_t& hash = columnHashes[x];
+            hash = (hash * ColumnBase) + rowHashes[(y * windows) + x];
+            if (y >= patternHeight)
+                hash -= rowHashes[((y - patternHeight) * windows) + x] * columnDrop;
+        }
+        if (y < patternHeight - 1)
+            continue;
+
+        const int top = y - (patternHeight - 1);
+        for (int x = 0; x < windows; ++x) {
+            if (columnHashes[x] != patternHash)
+                continue;
+
+            bool same = true;
+            for (int py = 0; same && py < patternHeight; ++py) {
+                const uint64_t* cellRow = &cells[((top + py) * width) + x];
+                const uint64_t* patternRow = &pattern[py * patternWidth];
+                for (int px = 0; same && px < patternWidth; ++px)
+                    same = (cellRow[px] == patternRow[px]);
+            }
+            if (same)
+                matches.push_back(Point { x, top });
+        }
+    }
+
+    // Matches are found row by row, which is already reading order
+    return matches;
+}
+
+std::vector<uint64_t> ccl::LevelCellCodes(const LevelMap& map, int x, int y,
+                                          int width, int height)
+{
+    std::vector<uint64_t> codes;
+    codes.reserve((size_t)(width * height));
+    for (int py = y; py < y + height; ++py) {
+        for (int px = x; px < x + width; ++px)
+            codes.push_back(((uint64_t)map.getBG(px, py) << 8) | map.getFG(px, py));
+    }
+    return codes;
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _PATTERNSEARCH_H
+#define _PATTERNSEARCH_H
+
+#include <cstdint>
+#include <vector>
+#include "Levelset.h"
+
+namespace ccl {
+
+/* Find every placement of a pattern grid within a larger grid.  Both grids
+ * are given as 64-bit cell codes in row-major order.  This is a 2D
+ * Rabin-Karp search:  Each row is hashed with a rolling hash over
+ * patternWidth columns, and those row hashes are then rolled down over
+ * patternHeight rows.  Hash hits are verified cell by cell, so the result
+ * is exact, and the cost is linear in the grid area.  Matches are
+ * returned in reading order, and may overlap.
+ */
+std::vector<Point> FindPattern2D(const std::vector<uint64_t>& cells,
+                                 int width, int height,
+                                 const std::vector<uint64_t>& pattern,
+                                 int patternWidth, int patternHeight);
+
+// Cell codes for a region of a CC1 map, covering both layers
+std::vector<uint64_t> LevelCellCodes(const LevelMap& map, int x, int y,
+                                     int width, int height);
+
+}
+
+#endif
@@ -0,0 +1,287 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Reachability.h"
+
+enum {
+    SideNorth = 0, SideWest, SideSouth, SideEast, NUM_SIDES,
+};
+
+static const ccl::Direction s_sideDirs[] = {
+    ccl::DirNorth, ccl::DirWest, ccl::DirSouth, ccl::DirEast,
+};
+
+// Terrain of a level, as seen by a player moving through it
+struct TerrainMaps {
+    ccl::TileBitmap open;           // Always passable
+    ccl::TileBitmap stop;           // Passable, but ends the player's movement
+    ccl::TileBitmap water, fire, bombs, sockets, toggleWalls, teleports;
+    ccl::TileBitmap doors[4];
+    ccl::TileBitmap keys[4];
+    ccl::TileBitmap flippers, fireBoots;
+    ccl::TileBitmap chips;
+
+    // Cells which cannot be left or entered across a given side
+    ccl::TileBitmap blockedSide[NUM_SIDES];
+
+    bool haveBlocks, haveIceBlocks, haveMonsters, haveToggleButtons;
+
+    TerrainMaps()
+        : haveBlocks(), haveIceBlocks(), haveMonsters(), haveToggleButtons() { }
+};
+
+static void blockSides(TerrainMaps& terrain, int x, int y, int side1, int side2 = -1)
+{
+    terrain.blockedSide[side1].set(x, y);
+    if (side2 >= 0)
+        terrain.blockedSide[side2].set(x, y);
+}
+
+static void classifyTerrain(TerrainMaps& terrain, const ccl::LevelMap& map)
+{
+    for (int y = 0; y < CCL_HEIGHT; ++y) {
+        for (int x = 0; x < CCL_WIDTH; ++x) {
+            tile_t tile = map.getFG(x, y);
+            const uint32_t upperClass = ccl::TilePlanes::classMask(tile);
+            if ((upperClass & (1U << ccl::TilePlanes::ClassIceBlock)) != 0)
+                terrain.haveIceBlocks = true;
+            if ((upperClass & (1U << ccl::TilePlanes::ClassBlock)) != 0)
+                terrain.haveBlocks = true;
+            if ((upperClass & (1U << ccl::TilePlanes::ClassMonster)) != 0)
+                terrain.haveMonsters = true;
+
+            // Mobile objects move off of the terrain underneath them
+            if ((upperClass & ((1U << ccl::TilePlanes::ClassBlock)
+                               | (1U << ccl::TilePlanes::ClassMonster)
+                               | (1U << ccl::TilePlanes::ClassPlayer))) != 0)
+                tile = map.getBG(x, y);
+
+            switch (tile) {
+            case ccl::TileWall:
+            case ccl::TileInvisWall:
+            case ccl::TileAppearingWall:
+            case ccl::TileBlueWall:
+            case ccl::TileCloner:
+                // Never passable
+                break;
+            case ccl::TileWater:
+                terrain.water.set(x, y);
+                break;
+            case ccl::TileFire:
+                terrain.fire.set(x, y);
+                break;
+            case ccl::TileBomb:
+                terrain.bombs.set(x, y);
+                break;
+            case ccl::TileSocket:
+                terrain.sockets.set(x, y);
+                break;
+            case ccl::TileToggleWall:
+                terrain.toggleWalls.set(x, y);
+                break;
+            case ccl::TileTeleport:
+                terrain.teleports.set(x, y);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileExit:
+                terrain.stop.set(x, y);
+                break;
+            case ccl::TileDoor_Blue:
+            case ccl::TileDoor_Red:
+            case ccl::TileDoor_Green:
+            case ccl::TileDoor_Yellow:
+                terrain.doors[tile - ccl::TileDoor_Blue].set(x, y);
+                break;
+            case ccl::TileKey_Blue:
+            case ccl::TileKey_Red:
+            case ccl::TileKey_Green:
+            case ccl::TileKey_Yellow:
+                terrain.keys[tile - ccl::TileKey_Blue].set(x, y);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileFlippers:
+                terrain.flippers.set(x, y);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileFireBoots:
+                terrain.fireBoots.set(x, y);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileChip:
+                terrain.chips.set(x, y);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileToggleButton:
+                terrain.haveToggleButtons = true;
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileBarrier_N:
+                blockSides(terrain, x, y, SideNorth);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileBarrier_W:
+                blockSides(terrain, x, y, SideWest);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileBarrier_S:
+                blockSides(terrain, x, y, SideSouth);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileBarrier_E:
+                blockSides(terrain, x, y, SideEast);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileBarrier_SE:
+                blockSides(terrain, x, y, SideSouth, SideEast);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileIce_SE:
+                blockSides(terrain, x, y, SideNorth, SideWest);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileIce_SW:
+                blockSides(terrain, x, y, SideNorth, SideEast);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileIce_NW:
+                blockSides(terrain, x, y, SideSouth, SideEast);
+                terrain.open.set(x, y);
+                break;
+            case ccl::TileIce_NE:
+                blockSides(terrain, x, y, SideSouth, SideWest);
+                terrain.open.set(x, y);
+                break;
+            default:
+                if (ccl::TilePlanes::classMask(tile) & ((1U << ccl::TilePlanes::ClassReserved)
+                                                       | (1U << ccl::TilePlanes::ClassInvalid)))
+                    break;
+                terrain.open.set(x, y);
+                break;
+            }
+        }
+    }
+}
+
+/* Expand the reachable set through the passable cells until it stops
+ * growing.  Each step moves the whole frontier one cell in all four
+ * directions at once.
+ */
+static void expand(ccl::TileBitmap& reach, const ccl::TileBitmap& passable,
+                   const TerrainMaps& terrain)
+{
+    ccl::TileBitmap frontier = reach;
+    while (frontier.any()) {
+        const ccl::TileBitmap movers = frontier & ~terrain.stop;
+        ccl::TileBitmap next;
+        for (int side = 0; side < NUM_SIDES; ++side) {
+            // Entering a cell moving north crosses its south side, etc.
+            const int entrySide = (side + 2) % NUM_SIDES;
+            next |= (movers & ~terrain.blockedSide[side]).shifted(s_sideDirs[side])
+                    & ~terrain.blockedSide[entrySide];
+        }
+        next &= passable & ~reach;
+
+        // Any teleport can lead to any other teleport
+        if ((next & terrain.teleports).any())
+            next |= terrain.teleports & ~reach;
+
+        reach |= next;
+        frontier = next;
+    }
+}
+
+ccl::ReachabilityInfo ccl::AnalyzeReachability(const LevelData* level)
+{
+    const LevelMap& map = level->map();
+    const TilePlanes planes(map);
+
+    ReachabilityInfo info;
+    info.chipsTotal = planes.count(TilePlanes::ClassChip);
+
+    TerrainMaps terrain;
+    classifyTerrain(terrain, map);
+    info.haveExit = terrain.stop.any();
+
+    TileBitmap reach = planes.upper(TilePlanes::ClassPlayer);
+    info.havePlayer = reach.any();
+
+    // Hazards which may be removed by other objects rather than the player
+    TileBitmap passable = terrain.open | terrain.stop;
+    if (terrain.haveBlocks)
+        passable |= terrain.water;
+    if (terrain.haveIceBlocks)
+        passable |= terrain.fire;
+    if (terrain.haveBlocks || terrain.haveMonsters)
+        passable |= terrain.bombs;
+    if (terrain.haveToggleButtons)
+        passable |= terrain.toggleWalls;
+
+    for ( ;; ) {
+        expand(reach, passable, terrain);
+
+        // Collect everything reachable, and open up anything it unlocks
+        TileBitmap unlocked;
+        for (int color = 0; color < 4; ++color) {
+            if ((reach & terrain.keys[color]).any())
+                unlocked |= terrain.doors[color];
+        }
+        if ((reach & terrain.flippers).any())
+            unlocked |= terrain.water;
+        if ((reach & terrain.fireBoots).any())
+            unlocked |= terrain.fire;
+        info.chipsReachable = (reach & terrain.chips).count();
+        if (info.chipsReachable >= level->chips())
+            unlocked |= terrain.sockets;
+
+        unlocked &= ~passable;
+        if (unlocked.none())
+            break;
+        passable |= unlocked;
+    }
+
+    info.reachable = reach;
+    info.exitReachable = (reach & terrain.stop).any();
+
+    // Anything the player could ever stand on, given every item
+    TileBitmap everOpen = terrain.open | terrain.stop | terrain.water | terrain.fire
+                        | terrain.bombs | terrain.sockets | terrain.toggleWalls;
+    for (const auto& doors : terrain.doors)
+        everOpen |= doors;
+    info.lockedOut = everOpen & ~reach;
+
+    return info;
+}
+
+std::vector<ccl::TileBitmap> ccl::ConnectedRegions(TileBitmap cells)
+{
+    std::vector<TileBitmap> regions;
+    while (cells.any()) {
+        const Point seed = cells.first();
+        TileBitmap region;
+        region.set(seed.X, seed.Y);
+
+        TileBitmap frontier = region;
+        while (frontier.any()) {
+            frontier = frontier.neighbors() & cells & ~region;
+            region |= frontier;
+        }
+
+        cells &= ~region;
+        regions.push_back(region);
+    }
+    return regions;
+}
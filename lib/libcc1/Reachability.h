@@ -0,0 +1,55 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _REACHABILITY_H
+#define _REACHABILITY_H
+
+#include <vector>
+#include "TilePlanes.h"
+
+namespace ccl {
+
+struct ReachabilityInfo {
+    TileBitmap reachable;       // Cells the player may be able to reach
+    TileBitmap lockedOut;       // Open cells which can never be reached
+    int chipsTotal;             // All chips in the level, in either layer
+    int chipsReachable;
+    bool havePlayer;
+    bool haveExit;
+    bool exitReachable;
+
+    ReachabilityInfo()
+        : chipsTotal(), chipsReachable(), havePlayer(), haveExit(),
+          exitReachable() { }
+};
+
+/* Static analysis of which cells the player can reach from the start
+ * position.  The player's inventory of keys, boots and collected chips is
+ * treated as a lattice which only grows, so the flood is repeated until
+ * no new doors, hazards or sockets open up.  The analysis is optimistic:
+ * key consumption, monster and block timing, and forced movement are
+ * ignored, so anything it reports as unreachable really is, but a cell
+ * which is considered reachable may still be impossible to get to.
+ */
+ReachabilityInfo AnalyzeReachability(const LevelData* level);
+
+// Split a bitmap into its orthogonally connected regions, in reading order
+std::vector<TileBitmap> ConnectedRegions(TileBitmap cells);
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Simulation.h"
+#include "LynxLogic.h"
+#include "Errors.h"
+
+/* Tile World records a mouse click as an absolute move, encoding the clicked
+ * cell's offset from the player in a 19x19 grid after the direction flags */
+enum {
+    MouseRangeMin = -9,
+    MouseRange = 19,
+    MouseMoveFirst = 16,
+    MouseMoveLast = MouseMoveFirst + MouseRange * MouseRange - 1,
+};
+
+ccl::SimulationStatus ccl::Simulation::replay(const LevelData* level,
+                                              const LevelSolution& solution)
+{
+    reset(level, solution.initialSlide, solution.stepping);
+
+    // Allow a short grace period past the recorded length, since the final
+    // move may still need a few ticks to complete
+    const unsigned int lastTick = solution.ticks + TicksPerSecond;
+    auto move = solution.moves.cbegin();
+    while (status() == SimRunning && tickCount() <= lastTick) {
+        int input = InputNone;
+        while (move != solution.moves.cend() && move->when <= tickCount()) {
+            if (move->when == tickCount()) {
+                if (move->dir >= MouseMoveFirst && move->dir <= MouseMoveLast) {
+                    const int offset = move->dir - MouseMoveFirst;
+                    throw RuntimeError(RuntimeError::tr(
+                            "Mouse move to (%1, %2) at tick %3 is not supported")
+                            .arg(offset % MouseRange + MouseRangeMin)
+                            .arg(offset / MouseRange + MouseRangeMin)
+                            .arg(move->when));
+                }
+                if (move->dir < 0 || move->dir > MouseMoveLast) {
+                    throw RuntimeError(RuntimeError::tr("Invalid move %1 at tick %2")
+                            .arg(move->dir).arg(move->when));
+                }
+                input = move->dir;
+            }
+            ++move;
+        }
+        tick(input);
+    }
+
+    return status();
+}
+
+bool ccl::SimulationSupported(unsigned int levelsetType)
+{
+    return levelsetType == Levelset::TypeLynx || levelsetType == Levelset::TypeLynxPG;
+}
+
+ccl::Simulation* ccl::CreateSimulation(unsigned int levelsetType)
+{
+    if (!SimulationSupported(levelsetType)) {
+        throw RuntimeError(RuntimeError::tr(
+                "The MSCC ruleset is not supported by the simulator.  "
+                "Only Lynx levelsets and solutions can be played back."));
+    }
+    return new LynxSimulation;
+}
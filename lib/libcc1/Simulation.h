@@ -0,0 +1,100 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include "Levelset.h"
+#include "Solution.h"
+
+namespace ccl {
+
+enum SimulationStatus {
+    SimRunning,     // Level is still in progress
+    SimSuccess,     // Player reached the exit
+    SimDied,        // Player was killed
+    SimTimeOut,     // Level timer ran out
+    SimNoPlayer,    // Level has no player tile to control
+    SimUnsupported, // Play reached a case the simulation does not model
+};
+
+/* Headless level simulation.  Instances may be reset() and reused for any
+ * number of levels, which avoids reallocating internal state when replaying
+ * an entire levelset in batch.
+ */
+class Simulation {
+public:
+    Simulation() { }
+    virtual ~Simulation() { }
+
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Create an independent copy of the current simulation state
+    virtual Simulation* clone() const = 0;
+
+    virtual void reset(const LevelData* level, int initialSlide = 0,
+                       int stepping = 0) = 0;
+    virtual SimulationStatus tick(int input) = 0;
+
+    virtual SimulationStatus status() const = 0;
+    virtual unsigned int tickCount() const = 0;
+    virtual int chipsLeft() const = 0;
+
+    // Remaining time in ticks, or -1 if the level has no time limit
+    virtual int timeLeft() const = 0;
+
+    // Write the current simulation state back to a level's map
+    virtual void exportState(LevelData* level) const = 0;
+
+    // Position of the controlled player, or (-1, -1) if there is none
+    virtual ccl::Point playerPosition() const = 0;
+
+    // True if the player has finished moving and will act on the next input
+    virtual bool awaitingInput() const = 0;
+
+    // The case that ended play with SimUnsupported, or nullptr
+    virtual const char* unsupportedFeature() const = 0;
+
+    /* Zobrist hash of the state that affects future play.  The tick count
+     * and remaining time are excluded, so states reached at different
+     * times compare equal.
+     */
+    virtual uint64_t stateHash() const = 0;
+
+    /* Run a recorded solution from the beginning of the level.  The
+     * simulation stops when the level ends, or shortly after the recorded
+     * tick count is reached.  Throws ccl::RuntimeError if the solution
+     * uses mouse moves, which the simulation does not model.
+     */
+    SimulationStatus replay(const LevelData* level, const LevelSolution& solution);
+
+    // Number of simulated ticks per second of the level timer
+    static constexpr int TicksPerSecond = 20;
+
+protected:
+    Simulation(const Simulation&) = default;
+};
+
+// Only the Lynx ruleset has a simulation so far
+bool SimulationSupported(unsigned int levelsetType);
+
+// Throws ccl::RuntimeError if the ruleset is not supported
+Simulation* CreateSimulation(unsigned int levelsetType);
+
+}
+
+#endif
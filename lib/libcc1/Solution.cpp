@@ -0,0 +1,157 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Solution.h"
+
+#include <cstring>
+
+#define TWS_SIGNATURE   0x999B3335
+
+// Maps the packed direction index from a TWS file to InputFlags
+static const int s_packedDirs[] = {
+    ccl::InputNorth, ccl::InputWest, ccl::InputSouth, ccl::InputEast,
+    ccl::InputNorth | ccl::InputWest, ccl::InputSouth | ccl::InputWest,
+    ccl::InputNorth | ccl::InputEast, ccl::InputSouth | ccl::InputEast,
+};
+
+static void expandMoves(std::vector<ccl::SolutionMove>& moves,
+                        const uint8_t* data, size_t size)
+{
+    const uint8_t* end = data + size;
+    ccl::SolutionMove move;
+    move.when = (unsigned int)-1;
+    move.dir = ccl::InputNone;
+
+    while (data < end) {
+        switch (data[0] & 0x03) {
+        case 0:
+            // Three moves, four ticks apart, packed into one byte
+            for (int shift = 2; shift < 8; shift += 2) {
+                move.dir = s_packedDirs[(data[0] >> shift) & 0x03];
+                move.when += 4;
+                moves.push_back(move);
+            }
+            data += 1;
+            break;
+        case 1:
+            move.dir = s_packedDirs[(data[0] >> 2) & 0x07];
+            move.when += ((data[0] >> 5) & 0x07) + 1;
+            moves.push_back(move);
+            data += 1;
+            break;
+        case 2:
+            if (data + 2 > end)
+                throw ccl::FormatError(ccl::RuntimeError::tr("Truncated solution move data"));
+            move.dir = s_packedDirs[(data[0] >> 2) & 0x07];
+            move.when += (((data[0] >> 5) & 0x07) | ((unsigned int)data[1] << 3)) + 1;
+            moves.push_back(move);
+            data += 2;
+            break;
+        case 3:
+            if ((data[0] & 0x10) != 0) {
+                // Extended (mouse) move with a variable length time delta
+                const int extra = (data[0] >> 2) & 0x03;
+                if (data + 2 + extra > end)
+                    throw ccl::FormatError(ccl::RuntimeError::tr("Truncated solution move data"));
+                move.dir = ((data[0] >> 5) & 0x07) | ((data[1] & 0x3F) << 3);
+                unsigned int delta = (data[1] >> 6) & 0x03;
+                for (int i = 0; i < extra; ++i)
+                    delta |= (unsigned int)data[2 + i] << (2 + (8 * i));
+                move.when += delta + 1;
+                moves.push_back(move);
+                data += 2 + extra;
+            } else {
+                if (data + 4 > end)
+                    throw ccl::FormatError(ccl::RuntimeError::tr("Truncated solution move data"));
+                move.dir = s_packedDirs[(data[0] >> 2) & 0x03];
+                move.when += (((data[0] >> 5) & 0x07) | ((unsigned int)data[1] << 3)
+                              | ((unsigned int)data[2] << 11)
+                              | ((unsigned int)data[3] << 19)) + 1;
+                moves.push_back(move);
+                data += 4;
+            }
+            break;
+        }
+    }
+}
+
+const ccl::LevelSolution* ccl::SolutionSet::solution(int levelNum) const
+{
+    // Later records for the same level replace earlier ones
+    for (auto iter = m_solutions.rbegin(); iter != m_solutions.rend(); ++iter) {
+        if (iter->levelNum == levelNum)
+            return &(*iter);
+    }
+    return nullptr;
+}
+
+void ccl::SolutionSet::read(Stream* stream)
+{
+    if (stream->read32() != TWS_SIGNATURE)
+        throw ccl::FormatError(ccl::RuntimeError::tr("Invalid TWS file signature"));
+
+    m_ruleset = (Ruleset)stream->read8();
+    stream->read8();    // Reserved
+    stream->read8();    // Reserved
+    const uint8_t extraBytes = stream->read8();
+    stream->seek(extraBytes, SEEK_CUR);
+
+    m_setName.clear();
+    m_solutions.clear();
+    std::vector<uint8_t> moveData;
+    while (!stream->eof()) {
+        const uint32_t size = stream->read32();
+        if (size == 0xFFFFFFFF)
+            break;
+        if (size == 0)
+            continue;
+        if (size < 6)
+            throw ccl::FormatError(ccl::RuntimeError::tr("Invalid TWS record size"));
+
+        LevelSolution solution;
+        solution.levelNum = stream->read16();
+        solution.password = stream->read32();
+        if (size == 6) {
+            // Level was visited, but never solved
+            continue;
+        }
+        if (size < 16)
+            throw ccl::FormatError(ccl::RuntimeError::tr("Invalid TWS record size"));
+
+        stream->read8();    // Other flags
+        const uint8_t slideStep = stream->read8();
+        solution.initialSlide = slideStep & 0x07;
+        solution.stepping = (slideStep >> 3) & 0x07;
+        solution.rngSeed = stream->read32();
+        solution.ticks = stream->read32();
+
+        moveData.resize(size - 16);
+        if (!moveData.empty() && stream->read(&moveData[0], 1, moveData.size()) != moveData.size())
+            throw ccl::IOError(ccl::RuntimeError::tr("Read past end of stream"));
+
+        if (solution.levelNum == 0 && solution.password == 0) {
+            // Special levelset name record
+            m_setName.assign(moveData.begin(), moveData.end());
+            m_setName.resize(strlen(m_setName.c_str()));
+            continue;
+        }
+
+        if (!moveData.empty())
+            expandMoves(solution.moves, &moveData[0], moveData.size());
+        m_solutions.emplace_back(std::move(solution));
+    }
+}
@@ -0,0 +1,78 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _SOLUTION_H
+#define _SOLUTION_H
+
+#include <vector>
+#include <string>
+#include "Stream.h"
+
+namespace ccl {
+
+/* Input directions, matching the bit layout used by Tile World */
+enum InputFlags {
+    InputNone  = 0,
+    InputNorth = (1<<0),
+    InputWest  = (1<<1),
+    InputSouth = (1<<2),
+    InputEast  = (1<<3),
+    InputDirMask = 0x0F,
+};
+
+struct SolutionMove {
+    unsigned int when;  // Tick on which the input is applied
+    int dir;            // InputFlags, or >= 16 for absolute (mouse) moves
+};
+
+struct LevelSolution {
+    int levelNum;
+    uint32_t password;
+    int initialSlide;       // Initial direction for random force floors
+    int stepping;           // Creature stepping phase
+    uint32_t rngSeed;
+    unsigned int ticks;     // Total ticks of the recorded solution
+    std::vector<SolutionMove> moves;
+
+    LevelSolution()
+        : levelNum(), password(), initialSlide(), stepping(), rngSeed(),
+          ticks() { }
+};
+
+class SolutionSet {
+public:
+    enum Ruleset { RulesetNone = 0, RulesetLynx = 1, RulesetMS = 2 };
+
+    SolutionSet() : m_ruleset(RulesetNone) { }
+
+    Ruleset ruleset() const { return m_ruleset; }
+    const std::string& setName() const { return m_setName; }
+    const std::vector<LevelSolution>& solutions() const { return m_solutions; }
+
+    const LevelSolution* solution(int levelNum) const;
+
+    void read(Stream* stream);
+
+private:
+    Ruleset m_ruleset;
+    std::string m_setName;
+    std::vector<LevelSolution> m_solutions;
+};
+
+}
+
+#endif
@@ -0,0 +1,281 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Solver.h"
+#include "Parallel.h"
+#include "Errors.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <cstdlib>
+
+// Rough heap cost of one stored simulation snapshot, used for budgeting
+#define SNAPSHOT_COST   5120
+
+// Share of the memory budget given to the transposition table
+#define TABLE_SHARE     4
+
+namespace {
+
+/* Fixed-size, lossy table of visited states.  Each hash maps to a small
+ * bucket of slots; when a bucket is full, the entry reached latest is
+ * replaced, so the table may forget states but never grows.
+ */
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t memory)
+    {
+        size_t entries = 1024;
+        while (entries * 2 * sizeof(Entry) <= memory)
+            entries *= 2;
+        m_entries.resize(entries);
+        m_mask = entries - 1;
+    }
+
+    size_t memoryUsage() const { return m_entries.size() * sizeof(Entry); }
+
+    // Returns true if the state was already reached no later than tick
+    bool visit(uint64_t hash, uint32_t tick)
+    {
+        if (hash == 0)
+            hash = 1;
+
+        Entry* victim = nullptr;
+        for (size_t probe = 0; probe < BucketSize; ++probe) {
+            Entry& entry = m_entries[(hash + probe) & m_mask];
+            if (entry.hash == hash) {
+                if (entry.tick <= tick)
+                    return true;
+                entry.tick = tick;
+                return false;
+            }
+            if (entry.hash == 0) {
+                entry.hash = hash;
+                entry.tick = tick;
+                return false;
+            }
+            if (!victim || entry.tick > victim->tick)
+                victim = &entry;
+        }
+        victim->hash = hash;
+        victim->tick = tick;
+        return false;
+    }
+
+private:
+    enum { BucketSize = 4 };
+
+    struct Entry {
+        uint64_t hash;
+        uint32_t tick;
+
+        Entry() : hash(), tick() { }
+    };
+
+    std::vector<Entry> m_entries;
+    size_t m_mask;
+};
+
+struct SearchNode {
+    int parent;
+    unsigned int when;      // Tick at which the input was applied
+    int input;
+    unsigned int goalTicks; // Length of the solution if this move wins, or 0
+    std::unique_ptr<ccl::Simulation> state;     // Only kept while open
+
+    SearchNode(int parent, unsigned int when, int input, ccl::Simulation* state)
+        : parent(parent), when(when), input(input), goalTicks(), state(state) { }
+};
+
+struct OpenEntry {
+    unsigned int cost;      // Estimated total ticks
+    unsigned int order;     // Insertion order, for a stable search
+    int node;
+
+    // std::priority_queue pops the largest element first
+    bool operator<(const OpenEntry& other) const
+    {
+        if (cost != other.cost)
+            return cost > other.cost;
+        return order > other.order;
+    }
+};
+
+}
+
+/* A lower bound on the ticks needed to reach the nearest exit.  Sliding
+ * moves a cell every 2 ticks, so that is the fastest possible speed. */
+static unsigned int estimateTicks(const ccl::Point& player,
+                                  const std::vector<ccl::Point>& exits)
+{
+    if (exits.empty() || player.X < 0)
+        return 0;
+
+    int best = CCL_WIDTH + CCL_HEIGHT;
+    for (const ccl::Point& exit : exits)
+        best = std::min(best, std::abs(exit.X - player.X) + std::abs(exit.Y - player.Y));
+    return (unsigned int)best * 2;
+}
+
+ccl::SolverResult ccl::SolveLevel(const LevelData* level, unsigned int levelsetType,
+                                  const SolverOptions& options)
+{
+    SolverResult result;
+    auto startTime = std::chrono::steady_clock::now();
+    auto elapsedMs = [startTime]() {
+        std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - startTime;
+        return elapsed.count();
+    };
+
+    if (!SimulationSupported(levelsetType))
+        return result;
+    std::unique_ptr<Simulation> root(CreateSimulation(levelsetType));
+    root->reset(level);
+    while (root->status() == SimRunning && !root->awaitingInput()
+            && root->tickCount() < options.maxTicks)
+        root->tick(InputNone);
+
+    // Teleports can move the player arbitrarily far, so the distance
+    // estimate is only a lower bound without them
+    std::vector<Point> exits;
+    bool haveTeleports = false;
+    for (int y = 0; y < CCL_HEIGHT; ++y) {
+        for (int x = 0; x < CCL_WIDTH; ++x) {
+            const tile_t fg = level->map().getFG(x, y);
+            const tile_t bg = level->map().getBG(x, y);
+            if (fg == TileExit || bg == TileExit)
+                exits.push_back(Point { x, y });
+            if (fg == TileTeleport || bg == TileTeleport)
+                haveTeleports = true;
+        }
+    }
+    if (haveTeleports)
+        exits.clear();
+
+    TranspositionTable visited(options.memoryBudget / TABLE_SHARE);
+    std::vector<SearchNode> nodes;
+    std::priority_queue<OpenEntry> open;
+    unsigned int order = 0;
+    size_t openStates = 0;
+
+    result.outcome = SolverResult::Exhausted;
+    if (root->status() == SimRunning) {
+        visited.visit(root->stateHash(), root->tickCount());
+        const unsigned int cost = root->tickCount()
+                                + estimateTicks(root->playerPosition(), exits);
+        nodes.emplace_back(-1, 0, InputNone, root.release());
+        open.push(OpenEntry { cost, order++, 0 });
+        ++openStates;
+    }
+
+    static const int s_moves[] = { InputNorth, InputWest, InputSouth, InputEast };
+    while (!open.empty()) {
+        if ((result.statesExplored & 0x3F) == 0) {
+            if (elapsedMs() > options.timeBudget * 1000.0) {
+                result.outcome = SolverResult::OutOfTime;
+                break;
+            }
+            const size_t memory = visited.memoryUsage()
+                                + (nodes.capacity() * sizeof(SearchNode))
+                                + (openStates * SNAPSHOT_COST);
+            if (memory > options.memoryBudget) {
+                result.outcome = SolverResult::OutOfMemory;
+                break;
+            }
+        }
+
+        const int current = open.top().node;
+        open.pop();
+
+        // A winning move is only accepted once it is the cheapest open
+        // entry, since a longer path may have found the exit first
+        if (nodes[(size_t)current].goalTicks != 0) {
+            LevelSolution& solution = result.solution;
+            solution.ticks = nodes[(size_t)current].goalTicks;
+            for (int node = current; nodes[(size_t)node].parent >= 0;
+                    node = nodes[(size_t)node].parent) {
+                solution.moves.push_back(SolutionMove { nodes[(size_t)node].when,
+                                                        nodes[(size_t)node].input });
+            }
+            std::reverse(solution.moves.begin(), solution.moves.end());
+            result.outcome = SolverResult::Solved;
+            break;
+        }
+
+        std::unique_ptr<Simulation> state = std::move(nodes[(size_t)current].state);
+        --openStates;
+        ++result.statesExplored;
+
+        for (int input : s_moves) {
+            std::unique_ptr<Simulation> child(state->clone());
+            const unsigned int when = child->tickCount();
+            child->tick(input);
+            while (child->status() == SimRunning && !child->awaitingInput()
+                    && child->tickCount() < options.maxTicks)
+                child->tick(InputNone);
+
+            if (child->status() == SimSuccess) {
+                // The cost of a finished level is exact, so it needs no state
+                nodes.emplace_back(current, when, input, nullptr);
+                nodes.back().goalTicks = std::max(1u, child->tickCount());
+                open.push(OpenEntry { child->tickCount(), order++, (int)nodes.size() - 1 });
+                continue;
+            }
+            if (child->status() != SimRunning || child->tickCount() >= options.maxTicks)
+                continue;
+            if (visited.visit(child->stateHash(), child->tickCount()))
+                continue;
+
+            const unsigned int cost = child->tickCount()
+                                    + estimateTicks(child->playerPosition(), exits);
+            nodes.emplace_back(current, when, input, child.release());
+            open.push(OpenEntry { cost, order++, (int)nodes.size() - 1 });
+            ++openStates;
+        }
+    }
+
+    result.elapsed = elapsedMs();
+    return result;
+}
+
+std::vector<ccl::SolverResult> ccl::SolveLevelset(const Levelset* levelset,
+                                                  unsigned int levelsetType,
+                                                  const SolverOptions& options,
+                                                  unsigned int threads)
+{
+    if (!SimulationSupported(levelsetType))
+        throw RuntimeError(RuntimeError::tr("The MSCC ruleset is not supported by the solver."));
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    SolverOptions workerOptions = options;
+    workerOptions.memoryBudget /= threads;
+
+    std::vector<SolverResult> results;
+    results.resize((size_t)levelset->levelCount());
+    RunParallel(results.size(), threads, [&](unsigned int, size_t index) {
+        results[index] = SolveLevel(levelset->level((int)index), levelsetType,
+                                    workerOptions);
+        results[index].solution.levelNum = (int)index + 1;
+    });
+    return results;
+}
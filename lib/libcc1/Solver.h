@@ -0,0 +1,75 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _SOLVER_H
+#define _SOLVER_H
+
+#include "Simulation.h"
+
+namespace ccl {
+
+struct SolverOptions {
+    size_t memoryBudget;        // Maximum search memory per level, in bytes
+    double timeBudget;          // Maximum search time per level, in seconds
+    unsigned int maxTicks;      // Give up on paths longer than this
+
+    SolverOptions()
+        : memoryBudget(64 * 1024 * 1024), timeBudget(10.0), maxTicks(20000) { }
+};
+
+struct SolverResult {
+    enum Outcome {
+        Solved,         // solution holds a working move list
+        Exhausted,      // Every reachable state was searched without success
+        OutOfMemory,    // Memory budget reached before a solution was found
+        OutOfTime,      // Time budget reached before a solution was found
+        Unsupported,    // No simulation exists for the level's ruleset
+    };
+
+    Outcome outcome;
+    LevelSolution solution;
+    size_t statesExplored;
+    double elapsed;             // Wall clock time, in milliseconds
+
+    SolverResult() : outcome(Unsupported), statesExplored(), elapsed() { }
+};
+
+/* Search for a move list which completes the level, using A* over the
+ * states of a headless simulation.  Each step is a single player move,
+ * followed by any forced movement until the player can act again, so the
+ * solver only suits puzzle-style levels that do not depend on waiting for
+ * monsters.  Visited states are recorded by their Zobrist hash in a fixed
+ * size transposition table.  A solution is only accepted when it is the
+ * cheapest open entry, so it takes the fewest ticks of any move sequence
+ * the search can express (one that never waits for input), barring a
+ * 64-bit hash collision.
+ */
+SolverResult SolveLevel(const LevelData* level, unsigned int levelsetType,
+                        const SolverOptions& options = SolverOptions());
+
+/* Solve every level of a levelset in parallel.  The memory budget is
+ * shared between the worker threads.  Throws ccl::RuntimeError if the
+ * ruleset can't be simulated.
+ */
+std::vector<SolverResult> SolveLevelset(const Levelset* levelset,
+                                        unsigned int levelsetType,
+                                        const SolverOptions& options = SolverOptions(),
+                                        unsigned int threads = 0);
+
+}
+
+#endif
@@ -0,0 +1,310 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "TilePlanes.h"
+
+// Bits of each word that fall in the first and last map columns
+#define COLUMN_FIRST_MASK   0x0000000100000001ULL
+#define COLUMN_LAST_MASK    0x8000000080000000ULL
+
+static int nextSetBit(const ccl::TileBitmap& bitmap, int from)
+{
+    if (from >= ccl::TileBitmap::NumWords * 64)
+        return -1;
+
+    int word = from >> 6;
+    uint64_t bits = bitmap.word(word) & (~0ULL << (from & 63));
+    for ( ;; ) {
+        if (bits)
+            return (word * 64) + ccl::LowestBit64(bits);
+        if (++word >= ccl::TileBitmap::NumWords)
+            return -1;
+        bits = bitmap.word(word);
+    }
+}
+
+static int prevSetBit(const ccl::TileBitmap& bitmap, int from)
+{
+    if (from < 0)
+        return -1;
+
+    int word = from >> 6;
+    uint64_t bits = bitmap.word(word) & (~0ULL >> (63 - (from & 63)));
+    for ( ;; ) {
+        if (bits)
+            return (word * 64) + ccl::HighestBit64(bits);
+        if (--word < 0)
+            return -1;
+        bits = bitmap.word(word);
+    }
+}
+
+static ccl::Point pointAt(int index)
+{
+    ccl::Point result;
+    result.X = (index < 0) ? -1 : index % CCL_WIDTH;
+    result.Y = (index < 0) ? -1 : index / CCL_WIDTH;
+    return result;
+}
+
+ccl::TileBitmap ccl::TileBitmap::full()
+{
+    TileBitmap result;
+    for (auto& word : result.m_words)
+        word = ~0ULL;
+    return result;
+}
+
+void ccl::TileBitmap::clear()
+{
+    for (auto& word : m_words)
+        word = 0;
+}
+
+bool ccl::TileBitmap::any() const
+{
+    uint64_t bits = 0;
+    for (auto word : m_words)
+        bits |= word;
+    return bits != 0;
+}
+
+int ccl::TileBitmap::count() const
+{
+    int total = 0;
+    for (auto word : m_words)
+        total += PopCount64(word);
+    return total;
+}
+
+ccl::Point ccl::TileBitmap::first() const
+{
+    return pointAt(nextSetBit(*this, 0));
+}
+
+ccl::Point ccl::TileBitmap::findNext(int x, int y) const
+{
+    const int start = (y * CCL_WIDTH) + x;
+    int index = nextSetBit(*this, start + 1);
+    if (index < 0) {
+        index = nextSetBit(*this, 0);
+        if (index > start)
+            index = -1;
+    }
+    return pointAt(index);
+}
+
+ccl::Point ccl::TileBitmap::findPrev(int x, int y) const
+{
+    const int start = (y * CCL_WIDTH) + x;
+    int index = prevSetBit(*this, start - 1);
+    if (index < 0) {
+        index = prevSetBit(*this, (NumWords * 64) - 1);
+        if (index < start)
+            index = -1;
+    }
+    return pointAt(index);
+}
+
+ccl::TileBitmap ccl::TileBitmap::shifted(ccl::Direction dir) const
+{
+    TileBitmap result;
+    switch (dir) {
+    case DirNorth:
+        // Rows are 32 bits wide, so each row moves into the other half of
+        // the same word or the previous one
+        for (int i = 0; i < NumWords; ++i) {
+            result.m_words[i] = m_words[i] >> 32;
+            if (i + 1 < NumWords)
+                result.m_words[i] |= m_words[i + 1] << 32;
+        }
+        break;
+    case DirSouth:
+        for (int i = 0; i < NumWords; ++i) {
+            result.m_words[i] = m_words[i] << 32;
+            if (i > 0)
+                result.m_words[i] |= m_words[i - 1] >> 32;
+        }
+        break;
+    case DirWest:
+        for (int i = 0; i < NumWords; ++i) {
+            result.m_words[i] = m_words[i] >> 1;
+            if (i + 1 < NumWords)
+                result.m_words[i] |= m_words[i + 1] << 63;
+            result.m_words[i] &= ~COLUMN_LAST_MASK;
+        }
+        break;
+    case DirEast:
+        for (int i = 0; i < NumWords; ++i) {
+            result.m_words[i] = m_words[i] << 1;
+            if (i > 0)
+                result.m_words[i] |= m_words[i - 1] >> 63;
+            result.m_words[i] &= ~COLUMN_FIRST_MASK;
+        }
+        break;
+    default:
+        return *this;
+    }
+    return result;
+}
+
+ccl::TileBitmap ccl::TileBitmap::neighbors() const
+{
+    return shifted(DirNorth) | shifted(DirSouth) | shifted(DirWest) | shifted(DirEast);
+}
+
+ccl::TileBitmap& ccl::TileBitmap::operator&=(const TileBitmap& other)
+{
+    for (int i = 0; i < NumWords; ++i)
+        m_words[i] &= other.m_words[i];
+    return *this;
+}
+
+ccl::TileBitmap& ccl::TileBitmap::operator|=(const TileBitmap& other)
+{
+    for (int i = 0; i < NumWords; ++i)
+        m_words[i] |= other.m_words[i];
+    return *this;
+}
+
+ccl::TileBitmap& ccl::TileBitmap::operator^=(const TileBitmap& other)
+{
+    for (int i = 0; i < NumWords; ++i)
+        m_words[i] ^= other.m_words[i];
+    return *this;
+}
+
+ccl::TileBitmap ccl::TileBitmap::operator~() const
+{
+    TileBitmap result;
+    for (int i = 0; i < NumWords; ++i)
+        result.m_words[i] = ~m_words[i];
+    return result;
+}
+
+bool ccl::TileBitmap::operator==(const TileBitmap& other) const
+{
+    for (int i = 0; i < NumWords; ++i) {
+        if (m_words[i] != other.m_words[i])
+            return false;
+    }
+    return true;
+}
+
+
+#define CLASS_BIT(cls)  (1U << ccl::TilePlanes::cls)
+
+struct TileClassTable {
+    uint32_t masks[256];
+
+    TileClassTable()
+    {
+        using namespace ccl;
+
+        for (int tile = 0; tile < 256; ++tile)
+            masks[tile] = CLASS_BIT(ClassInvalid);
+        for (int tile = 0; tile < NUM_TILE_TYPES; ++tile)
+            masks[tile] = 0;
+
+        masks[TileFloor] = CLASS_BIT(ClassFloor);
+        masks[TileWall] = CLASS_BIT(ClassWall);
+        masks[TileInvisWall] = CLASS_BIT(ClassWall);
+        masks[TileAppearingWall] = CLASS_BIT(ClassWall);
+        masks[TileBlueWall] = CLASS_BIT(ClassWall);
+        masks[TileBlueFloor] = CLASS_BIT(ClassFakeWall);
+        for (tile_t tile = TileBarrier_N; tile <= TileBarrier_E; ++tile)
+            masks[tile] = CLASS_BIT(ClassThinWall);
+        masks[TileBarrier_SE] = CLASS_BIT(ClassThinWall);
+        masks[TileToggleWall] = CLASS_BIT(ClassToggle);
+        masks[TileToggleFloor] = CLASS_BIT(ClassToggle);
+        masks[TilePopUpWall] = CLASS_BIT(ClassPopUpWall);
+        masks[TileWater] = CLASS_BIT(ClassWater);
+        masks[TileFire] = CLASS_BIT(ClassFire);
+        masks[TileIce] = CLASS_BIT(ClassIce);
+        for (tile_t tile = TileIce_SE; tile <= TileIce_NE; ++tile)
+            masks[tile] = CLASS_BIT(ClassIce);
+        masks[TileForce_N] = CLASS_BIT(ClassForce);
+        masks[TileForce_W] = CLASS_BIT(ClassForce);
+        masks[TileForce_S] = CLASS_BIT(ClassForce);
+        masks[TileForce_E] = CLASS_BIT(ClassForce);
+        masks[TileForce_Rand] = CLASS_BIT(ClassForce);
+        masks[TileDirt] = CLASS_BIT(ClassDirt);
+        masks[TileGravel] = CLASS_BIT(ClassGravel);
+        masks[TileBomb] = CLASS_BIT(ClassBomb);
+        masks[TileThief] = CLASS_BIT(ClassThief);
+        masks[TileHint] = CLASS_BIT(ClassHint);
+        masks[TileChip] = CLASS_BIT(ClassChip);
+        masks[TileSocket] = CLASS_BIT(ClassSocket);
+        masks[TileExit] = CLASS_BIT(ClassExit);
+        for (tile_t tile = TileDoor_Blue; tile <= TileDoor_Yellow; ++tile)
+            masks[tile] = CLASS_BIT(ClassDoor);
+        for (tile_t tile = TileKey_Blue; tile <= TileKey_Yellow; ++tile)
+            masks[tile] = CLASS_BIT(ClassKey);
+        for (tile_t tile = TileFlippers; tile <= TileForceBoots; ++tile)
+            masks[tile] = CLASS_BIT(ClassBoots);
+        masks[TileToggleButton] = CLASS_BIT(ClassButton);
+        masks[TileCloneButton] = CLASS_BIT(ClassButton);
+        masks[TileTrapButton] = CLASS_BIT(ClassButton);
+        masks[TileTankButton] = CLASS_BIT(ClassButton);
+        masks[TileTeleport] = CLASS_BIT(ClassTeleport);
+        masks[TileTrap] = CLASS_BIT(ClassTrap);
+        masks[TileCloner] = CLASS_BIT(ClassCloner);
+        masks[TileBlock] = CLASS_BIT(ClassBlock);
+        for (tile_t tile = TileBlock_N; tile <= TileBlock_E; ++tile)
+            masks[tile] = CLASS_BIT(ClassBlock);
+        masks[TileIceBlock] = CLASS_BIT(ClassBlock) | CLASS_BIT(ClassIceBlock);
+        for (tile_t tile = MONSTER_FIRST; tile <= MONSTER_LAST; ++tile)
+            masks[tile] = CLASS_BIT(ClassMonster);
+        for (tile_t tile = TilePlayer_N; tile <= TilePlayer_E; ++tile)
+            masks[tile] = CLASS_BIT(ClassPlayer);
+
+        masks[Tile_UNUSED_20] = CLASS_BIT(ClassReserved);
+        for (tile_t tile = TilePlayerSplash; tile <= TilePlayerSwim_E; ++tile) {
+            if (tile != TileIceBlock)
+                masks[tile] = CLASS_BIT(ClassReserved);
+        }
+    }
+};
+
+uint32_t ccl::TilePlanes::classMask(tile_t tile)
+{
+    static const TileClassTable s_table;
+    return s_table.masks[tile];
+}
+
+void ccl::TilePlanes::build(const LevelMap& map)
+{
+    for (auto& plane : m_upper)
+        plane.clear();
+    for (auto& plane : m_lower)
+        plane.clear();
+
+    for (int y = 0; y < CCL_HEIGHT; ++y) {
+        for (int x = 0; x < CCL_WIDTH; ++x) {
+            uint32_t mask = classMask(map.getFG(x, y));
+            while (mask) {
+                m_upper[LowestBit64(mask)].set(x, y);
+                mask &= mask - 1;
+            }
+            mask = classMask(map.getBG(x, y));
+            while (mask) {
+                m_lower[LowestBit64(mask)].set(x, y);
+                mask &= mask - 1;
+            }
+        }
+    }
+}
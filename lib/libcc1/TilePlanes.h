@@ -0,0 +1,215 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _TILEPLANES_H
+#define _TILEPLANES_H
+
+#include "Levelset.h"
+
+namespace ccl {
+
+inline int PopCount64(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(value);
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the lowest set bit.  value must not be zero.
+inline int LowestBit64(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#else
+    int index = 0;
+    while ((value & 1) == 0) {
+        value >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Index of the highest set bit.  value must not be zero.
+inline int HighestBit64(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int index = 63;
+    while ((value & (1ULL << 63)) == 0) {
+        value <<= 1;
+        --index;
+    }
+    return index;
+#endif
+}
+
+/* One bit for each cell of a 32x32 CC1 map, in reading order.  Each 64-bit
+ * word covers two map rows, so whole-map operations touch only 16 words.
+ */
+class TileBitmap {
+public:
+    enum { NumWords = (CCL_WIDTH * CCL_HEIGHT) / 64 };
+
+    TileBitmap() : m_words() { }
+
+    static TileBitmap full();
+
+    bool test(int x, int y) const
+    {
+        const int index = (y * CCL_WIDTH) + x;
+        return (m_words[index >> 6] & (1ULL << (index & 63))) != 0;
+    }
+
+    void set(int x, int y)
+    {
+        const int index = (y * CCL_WIDTH) + x;
+        m_words[index >> 6] |= (1ULL << (index & 63));
+    }
+
+    void reset(int x, int y)
+    {
+        const int index = (y * CCL_WIDTH) + x;
+        m_words[index >> 6] &= ~(1ULL << (index & 63));
+    }
+
+    void clear();
+    bool any() const;
+    bool none() const { return !any(); }
+    int count() const;
+
+    // First set cell in reading order, or (-1, -1) if the bitmap is empty
+    ccl::Point first() const;
+
+    /* Next set cell after (x, y) in reading order, wrapping around the end
+     * of the map and ending with (x, y) itself.  Returns (-1, -1) if the
+     * bitmap is empty.  This matches LevelMap::findNext.
+     */
+    ccl::Point findNext(int x, int y) const;
+
+    // As findNext, but searching backwards in reading order
+    ccl::Point findPrev(int x, int y) const;
+
+    // Call func(x, y) for every set cell, in reading order
+    template <typename Func>
+    void forEach(Func func) const
+    {
+        for (int word = 0; word < NumWords; ++word) {
+            uint64_t bits = m_words[word];
+            while (bits) {
+                const int index = (word * 64) + LowestBit64(bits);
+                func(index % CCL_WIDTH, index / CCL_WIDTH);
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    // Move every cell one step in the given direction, dropping any that
+    // would leave the map
+    TileBitmap shifted(ccl::Direction dir) const;
+
+    // Cells orthogonally adjacent to any set cell
+    TileBitmap neighbors() const;
+
+    uint64_t word(int index) const { return m_words[index]; }
+    void setWord(int index, uint64_t bits) { m_words[index] = bits; }
+
+    TileBitmap& operator&=(const TileBitmap& other);
+    TileBitmap& operator|=(const TileBitmap& other);
+    TileBitmap& operator^=(const TileBitmap& other);
+    TileBitmap operator~() const;
+
+    bool operator==(const TileBitmap& other) const;
+    bool operator!=(const TileBitmap& other) const { return !operator==(other); }
+
+private:
+    uint64_t m_words[NumWords];
+};
+
+inline TileBitmap operator&(TileBitmap lhs, const TileBitmap& rhs) { return lhs &= rhs; }
+inline TileBitmap operator|(TileBitmap lhs, const TileBitmap& rhs) { return lhs |= rhs; }
+inline TileBitmap operator^(TileBitmap lhs, const TileBitmap& rhs) { return lhs ^= rhs; }
+
+/* Derived per-class bitmaps for both layers of a LevelMap.  These are built
+ * on demand from a map snapshot, and are not updated when the map changes.
+ */
+class TilePlanes {
+public:
+    enum TileClass {
+        ClassFloor,         // Plain floor
+        ClassWall,          // Solid and invisible/appearing/blue walls
+        ClassFakeWall,      // Passable fake blue walls
+        ClassThinWall,      // Directional barriers
+        ClassToggle,        // Toggle walls and floors
+        ClassPopUpWall,
+        ClassWater,
+        ClassFire,
+        ClassIce,           // Ice and ice corners
+        ClassForce,         // Force floors, including random
+        ClassDirt,
+        ClassGravel,
+        ClassBomb,
+        ClassThief,
+        ClassHint,
+        ClassChip,
+        ClassSocket,
+        ClassExit,
+        ClassDoor,
+        ClassKey,
+        ClassBoots,
+        ClassButton,        // Any button type
+        ClassTeleport,
+        ClassTrap,
+        ClassCloner,
+        ClassBlock,         // Dirt blocks, including ice blocks
+        ClassIceBlock,
+        ClassMonster,
+        ClassPlayer,
+        ClassReserved,      // Unused or animation-only tiles
+        ClassInvalid,       // Out of range tile values
+        NUM_TILE_CLASSES
+    };
+
+    // Bit mask of (1 << TileClass) for each class the tile belongs to
+    static uint32_t classMask(tile_t tile);
+
+    TilePlanes() { }
+    explicit TilePlanes(const LevelMap& map) { build(map); }
+
+    void build(const LevelMap& map);
+
+    const TileBitmap& upper(TileClass cls) const { return m_upper[cls]; }
+    const TileBitmap& lower(TileClass cls) const { return m_lower[cls]; }
+    TileBitmap either(TileClass cls) const { return m_upper[cls] | m_lower[cls]; }
+
+    // Number of tiles of the class, counting each layer separately
+    int count(TileClass cls) const { return m_upper[cls].count() + m_lower[cls].count(); }
+
+private:
+    TileBitmap m_upper[NUM_TILE_CLASSES];
+    TileBitmap m_lower[NUM_TILE_CLASSES];
+};
+
+}
+
+#endif
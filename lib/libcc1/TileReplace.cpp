@@ -0,0 +1,146 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "TileReplace.h"
+#include "Parallel.h"
+
+#define BYTE_LOW_BITS   0x7F7F7F7F7F7F7F7FULL
+#define BYTE_ONES       0x0101010101010101ULL
+
+// Eight consecutive tiles, with the first tile in the lowest byte
+static uint64_t loadCells(const tile_t* cells)
+{
+    uint64_t word = 0;
+    for (int i = 7; i >= 0; --i)
+        word = (word << 8) | cells[i];
+    return word;
+}
+
+// One bit for each byte of word equal to the matching byte of pattern
+static uint64_t matchBytes(uint64_t word, uint64_t pattern)
+{
+    const uint64_t diff = word ^ pattern;
+
+    // The high bit of each byte is set only where the byte of diff is zero.
+    // Masking off the high bits first keeps carries from crossing bytes.
+    const uint64_t zero = ~(((diff & BYTE_LOW_BITS) + BYTE_LOW_BITS) | diff | BYTE_LOW_BITS);
+
+    // Gather the eight high bits into the top byte, then shift them down
+    return ((zero >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+ccl::TileBitmap ccl::MatchTileLayer(const tile_t* cells, tile_t tile)
+{
+    const uint64_t pattern = BYTE_ONES * tile;
+
+    TileBitmap result;
+    for (int word = 0; word < TileBitmap::NumWords; ++word) {
+        uint64_t bits = 0;
+        for (int chunk = 0; chunk < 8; ++chunk) {
+            const tile_t* chunkCells = cells + (word * 64) + (chunk * 8);
+            bits |= matchBytes(loadCells(chunkCells), pattern) << (chunk * 8);
+        }
+        result.setWord(word, bits);
+    }
+    return result;
+}
+
+int ccl::CountTileMatches(const LevelMap& map, const TileReplaceRule& rule)
+{
+    // Same no-op check as ReplaceTiles, so a preview matches the result
+    if (rule.find == rule.replace)
+        return 0;
+
+    int count = 0;
+    if (rule.layers & TileReplaceRule::LayerUpper)
+        count += MatchTileLayer(map.fgTiles(), rule.find).count();
+    if (rule.layers & TileReplaceRule::LayerLower)
+        count += MatchTileLayer(map.bgTiles(), rule.find).count();
+    return count;
+}
+
+int ccl::ReplaceTiles(LevelData* level, const TileReplaceRule& rule)
+{
+    if (rule.find == rule.replace)
+        return 0;
+
+    LevelMap& map = level->map();
+    TileBitmap upper, lower;
+    if (rule.layers & TileReplaceRule::LayerUpper)
+        upper = MatchTileLayer(map.fgTiles(), rule.find);
+    if (rule.layers & TileReplaceRule::LayerLower)
+        lower = MatchTileLayer(map.bgTiles(), rule.find);
+
+    const int count = upper.count() + lower.count();
+    if (count == 0)
+        return 0;
+
+    // The lower layer goes first, so an upper layer pop brings up the
+    // replaced tile rather than the original
+    lower.forEach([&map, &rule](int x, int y) {
+        map.setBG(x, y, rule.replace);
+    });
+    upper.forEach([&map, &rule](int x, int y) {
+        if (rule.replace == TileFloor)
+            map.pop(x, y);
+        else
+            map.setFG(x, y, rule.replace);
+    });
+
+    /* Drop connections and movers which no longer point at the right tile.
+     * Only endpoints in replaced cells are checked; links which were
+     * already stale elsewhere in the level are left for the user. */
+    TileBitmap changed = upper;
+    changed |= lower;
+    auto wasChanged = [&changed](const Point& pos) {
+        return pos.X >= 0 && pos.X < CCL_WIDTH && pos.Y >= 0 && pos.Y < CCL_HEIGHT
+            && changed.test(pos.X, pos.Y);
+    };
+    auto lostTile = [&map, &wasChanged](const Point& pos, tile_t tile) {
+        return wasChanged(pos)
+            && map.getFG(pos.X, pos.Y) != tile && map.getBG(pos.X, pos.Y) != tile;
+    };
+    level->removeTraps([&lostTile](const Trap& trap) {
+        return lostTile(trap.button, TileTrapButton) || lostTile(trap.trap, TileTrap);
+    });
+    level->removeClones([&lostTile](const Clone& clone) {
+        return lostTile(clone.button, TileCloneButton) || lostTile(clone.clone, TileCloner);
+    });
+    level->removeMovers([&map, &wasChanged](const Point& mover) {
+        return wasChanged(mover) && !MONSTER_TILE(map.getFG(mover.X, mover.Y));
+    });
+
+    if (MONSTER_TILE(rule.replace) && !MONSTER_TILE(rule.find)) {
+        upper.forEach([level, &map](int x, int y) {
+            if (map.getBG(x, y) != TileCloner && level->moveList().size() < MAX_MOVERS)
+                level->addMover(x, y);
+        });
+    }
+
+    return count;
+}
+
+std::vector<int> ccl::CountTileMatches(const Levelset* levelset,
+                                       const TileReplaceRule& rule,
+                                       unsigned int threads)
+{
+    std::vector<int> counts(levelset->levelCount());
+    RunParallel(counts.size(), threads, [&](unsigned int, size_t index) {
+        counts[index] = CountTileMatches(levelset->level((int)index)->map(), rule);
+    });
+    return counts;
+}
@@ -0,0 +1,68 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _TILEREPLACE_H
+#define _TILEREPLACE_H
+
+#include "Levelset.h"
+#include "TilePlanes.h"
+
+namespace ccl {
+
+/* Replace every copy of one tile with another, in the upper layer, the
+ * lower layer or both.  Replacing an upper layer tile with floor pops the
+ * lower layer up, the same as erasing the tile in the editor.
+ */
+struct TileReplaceRule {
+    enum LayerMask {
+        LayerUpper = 0x1,
+        LayerLower = 0x2,
+        LayerBoth = LayerUpper | LayerLower,
+    };
+
+    TileReplaceRule() : find(), replace(), layers(LayerBoth) { }
+    TileReplaceRule(tile_t findTile, tile_t replaceTile, int layerMask = LayerBoth)
+        : find(findTile), replace(replaceTile), layers(layerMask) { }
+
+    tile_t find;
+    tile_t replace;
+    int layers;
+};
+
+/* Cells of one layer (CCL_WIDTH * CCL_HEIGHT tiles, in reading order)
+ * holding the given tile.  The layer is compared eight cells at a time.
+ */
+TileBitmap MatchTileLayer(const tile_t* cells, tile_t tile);
+
+// Number of cells matching the rule, counting each layer separately
+int CountTileMatches(const LevelMap& map, const TileReplaceRule& rule);
+
+/* Apply the rule to a level, returning the number of tiles replaced.
+ * Trap and clone connections and movers at replaced cells which no longer
+ * refer to a matching tile are removed, and monsters placed by the rule
+ * are added to the move list.
+ */
+int ReplaceTiles(LevelData* level, const TileReplaceRule& rule);
+
+// Match counts for every level of the levelset, in level order
+std::vector<int> CountTileMatches(const Levelset* levelset,
+                                  const TileReplaceRule& rule,
+                                  unsigned int threads = 0);
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Verifier.h"
+#include "Parallel.h"
+#include "Errors.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cstdio>
+
+static const char* statusName(ccl::SimulationStatus status)
+{
+    switch (status) {
+    case ccl::SimRunning:
+        return "Level did not finish";
+    case ccl::SimSuccess:
+        return "Level completed";
+    case ccl::SimDied:
+        return "Player died";
+    case ccl::SimTimeOut:
+        return "Time ran out";
+    case ccl::SimNoPlayer:
+        return "Level has no player";
+    case ccl::SimUnsupported:
+        return "Level reached a case the simulation does not model";
+    }
+    return "Unknown status";
+}
+
+std::vector<ccl::VerifyResult> ccl::VerifyLevelset(const Levelset* levelset,
+                                                   const SolutionSet& solutions,
+                                                   unsigned int threads)
+{
+    // The TWS ruleset takes precedence over the levelset's own type, since
+    // that is what the solutions were recorded against
+    unsigned int simType = levelset->type();
+    if (solutions.ruleset() == SolutionSet::RulesetLynx)
+        simType = Levelset::TypeLynx;
+    else if (solutions.ruleset() == SolutionSet::RulesetMS)
+        simType = Levelset::TypeMS;
+
+    std::vector<VerifyResult> results;
+    results.resize((size_t)levelset->levelCount());
+
+    // Each worker keeps its own simulation, which is reset for every level
+    std::vector<std::unique_ptr<Simulation>> sims;
+    sims.resize(threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+
+    // Create the first one up front, so an unsupported ruleset fails the
+    // whole run here instead of throwing from a worker thread
+    sims[0].reset(CreateSimulation(simType));
+
+    RunParallel(results.size(), (unsigned int)sims.size(),
+                [&](unsigned int worker, size_t index) {
+        const LevelData* level = levelset->level((int)index);
+        VerifyResult& result = results[index];
+        result.levelNum = (int)index + 1;
+        result.name = level->name();
+
+        const LevelSolution* solution = solutions.solution(result.levelNum);
+        if (!solution) {
+            result.outcome = VerifyResult::NoSolution;
+            result.detail = "No recorded solution";
+            return;
+        }
+        result.expectedTicks = solution->ticks;
+
+        auto& sim = sims[worker];
+        if (!sim)
+            sim.reset(CreateSimulation(simType));
+
+        auto startTime = std::chrono::steady_clock::now();
+        try {
+            SimulationStatus status = sim->replay(level, *solution);
+            if (status == SimUnsupported) {
+                result.outcome = VerifyResult::Unsupported;
+                result.detail = std::string("Solution reaches ") + sim->unsupportedFeature()
+                              + ", which the simulation does not model";
+            } else {
+                result.outcome = (status == SimSuccess) ? VerifyResult::Passed
+                                                        : VerifyResult::Failed;
+                result.detail = statusName(status);
+            }
+        } catch (const RuntimeError& err) {
+            result.outcome = VerifyResult::Error;
+            result.detail = err.message().toStdString();
+        }
+        result.ticks = sim->tickCount();
+        std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - startTime;
+        result.elapsed = elapsed.count();
+    });
+
+    return results;
+}
+
+std::string ccl::FormatVerifyReport(const std::vector<VerifyResult>& results,
+                                    double totalElapsed)
+{
+    static const char* outcomeNames[] = { "PASS", "FAIL", "NONE", "ERROR", "SKIP" };
+
+    std::string report;
+    char buffer[64];
+    int counts[5] = { 0, 0, 0, 0, 0 };
+    for (const auto& result : results) {
+        counts[result.outcome] += 1;
+        snprintf(buffer, sizeof(buffer), "%4d  %-5s %8.2f ms  ", result.levelNum,
+                 outcomeNames[result.outcome], result.elapsed);
+        report += buffer;
+        report += result.name;
+        if (result.outcome != VerifyResult::Passed) {
+            report += " (" + result.detail;
+            if (result.outcome == VerifyResult::Failed) {
+                snprintf(buffer, sizeof(buffer), " at tick %u of %u",
+                         result.ticks, result.expectedTicks);
+                report += buffer;
+            }
+            report += ")";
+        }
+        report += "\n";
+    }
+
+    snprintf(buffer, sizeof(buffer), "\n%d passed, %d failed, %d unsolved",
+             counts[VerifyResult::Passed], counts[VerifyResult::Failed],
+             counts[VerifyResult::NoSolution]);
+    report += buffer;
+    if (counts[VerifyResult::Error]) {
+        snprintf(buffer, sizeof(buffer), ", %d errors", counts[VerifyResult::Error]);
+        report += buffer;
+    }
+    if (counts[VerifyResult::Unsupported]) {
+        snprintf(buffer, sizeof(buffer), ", %d unsupported", counts[VerifyResult::Unsupported]);
+        report += buffer;
+    }
+    snprintf(buffer, sizeof(buffer), " in %.2f ms\n", totalElapsed);
+    report += buffer;
+
+    // Skipped levels were never checked, so say so up front rather than
+    // leaving them to be read as passes
+    if (counts[VerifyResult::Unsupported]) {
+        snprintf(buffer, sizeof(buffer),
+                 "WARNING: %d of %d levels (%.1f%%) were skipped and NOT verified,\n",
+                 counts[VerifyResult::Unsupported], (int)results.size(),
+                 100.0 * counts[VerifyResult::Unsupported] / results.size());
+        report.insert(0, std::string(buffer)
+                         + "because they use features the simulation does not model.\n\n");
+    }
+    return report;
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _VERIFIER_H
+#define _VERIFIER_H
+
+#include <string>
+#include <vector>
+#include "Simulation.h"
+
+namespace ccl {
+
+struct VerifyResult {
+    enum Outcome { Passed, Failed, NoSolution, Error, Unsupported };
+
+    int levelNum;
+    std::string name;
+    Outcome outcome;
+    std::string detail;         // Reason for a failure or error
+    unsigned int ticks;         // Ticks simulated
+    unsigned int expectedTicks; // Ticks in the recorded solution
+    double elapsed;             // Wall clock time, in milliseconds
+
+    VerifyResult()
+        : levelNum(), outcome(Error), ticks(), expectedTicks(), elapsed() { }
+};
+
+/* Replay every level in the levelset with the matching solution from the
+ * solution set, and report whether each level is still solved.  Results
+ * are returned in level order.  Throws ccl::RuntimeError if the ruleset
+ * can't be simulated.
+ */
+std::vector<VerifyResult> VerifyLevelset(const Levelset* levelset,
+                                         const SolutionSet& solutions,
+                                         unsigned int threads = 0);
+
+// Produce a plain text pass/fail report, suitable for a console or log
+std::string FormatVerifyReport(const std::vector<VerifyResult>& results,
+                               double totalElapsed);
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Fingerprint.h"
+
+ccl::Fingerprint cc2::FingerprintMap(const Map* map)
+{
+    ccl::Fingerprint print;
+    const MapData& data = map->mapData();
+    const MapOption& option = map->option();
+    print.exactHash = ccl::HashCombine(data.hash(),
+                                       ((uint32_t)option.timeLimit() << 16)
+                                       | ((uint32_t)option.blobPattern() << 8)
+                                       | (option.cc1Boots() ? 1 : 0));
+
+    const int width = data.width();
+    const int height = data.height();
+    std::vector<uint64_t> cells((size_t)(width * height));
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x)
+            cells[(y * width) + x] = data.tile(x, y).hash();
+    }
+
+    uint64_t last = 0;
+    bool haveLast = false;
+    for (int y = 0; y < height - 1; ++y) {
+        for (int x = 0; x < width - 1; ++x) {
+            const uint64_t* row = &cells[(y * width) + x];
+            uint64_t shingle = ccl::HashCombine(row[0], row[1]);
+            shingle = ccl::HashCombine(shingle, row[width]);
+            shingle = ccl::HashCombine(shingle, row[width + 1]);
+            if (haveLast && shingle == last)
+                continue;
+            print.addShingle(shingle);
+            last = shingle;
+            haveLast = true;
+        }
+    }
+
+    // Maps too narrow for any windows fall back to single cells
+    if (!haveLast) {
+        for (uint64_t cell : cells)
+            print.addShingle(cell);
+    }
+    return print;
+}
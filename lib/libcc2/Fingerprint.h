@@ -0,0 +1,34 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_FINGERPRINT_H
+#define _CC2_FINGERPRINT_H
+
+#include "Map.h"
+#include "libcc1/Fingerprint.h"
+
+namespace cc2 {
+
+/* Fingerprint a CC2 map for duplicate detection.  Shingles are built from
+ * the full tile stacks of each 2x2 window, so CC2 fingerprints are only
+ * comparable with other CC2 fingerprints.
+ */
+ccl::Fingerprint FingerprintMap(const Map* map);
+
+}
+
+#endif
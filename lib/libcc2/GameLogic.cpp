@@ -21,11 +21,12 @@
 
 #define TILE_DIR(dir)   (cc2::Tile::Direction)((dir) & 0x03)
 
-static void getPreferredDirections(const cc2::Tile* tile, cc2::Tile::Direction dirs[])
+static void getPreferredDirections(cc2::Tile::Type type, cc2::Tile::Direction facing,
+                                   cc2::Tile::Direction dirs[])
 {
-    const int myDir = tile->direction();
+    const int myDir = facing;
 
-    switch (tile->type()) {
+    switch (type) {
     case cc2::Tile::Ant:        // L,F,R,B
         dirs[0] = TILE_DIR(myDir + 3);
         dirs[1] = TILE_DIR(myDir    );
@@ -126,19 +127,19 @@ static cc2::Tile::Direction trackDirection(cc2::Tile::Direction dir,
     return cc2::Tile::InvalidDir;
 }
 
-static void getPreferredTrackDirections(const cc2::Tile* tile,
+static void getPreferredTrackDirections(cc2::Tile::Type type,
+                                        cc2::Tile::Direction myDir,
                                         cc2::Tile::Direction dirs[],
                                         uint32_t tracks)
 {
     tracks = effectiveTracks(tracks);
 
-    const cc2::Tile::Direction myDir = tile->direction();
     dirs[0] = cc2::Tile::InvalidDir;
     dirs[1] = cc2::Tile::InvalidDir;
     dirs[2] = cc2::Tile::InvalidDir;
     dirs[3] = cc2::Tile::InvalidDir;
 
-    switch (tile->type()) {
+    switch (type) {
     case cc2::Tile::Ant:        // L,F,R
         dirs[0] = trackDirection(TILE_DIR(myDir + 3), myDir, tracks);
         dirs[1] = trackDirection(TILE_DIR(myDir    ), myDir, tracks);
@@ -167,17 +168,6 @@ static void getPreferredTrackDirections(const cc2::Tile* tile,
     }
 }
 
-static const cc2::Tile* findPanel(const cc2::Tile* tile)
-{
-    do {
-        if (tile->isPanelCanopy())
-            return tile;
-        tile = tile->lower();
-    } while (tile);
-
-    return nullptr;
-}
-
 static const cc2::Tile* peekTile(const cc2::MapData& map, int x, int y,
                                  cc2::Tile::Direction dir)
 {
@@ -196,20 +186,48 @@ static const cc2::Tile* peekTile(const cc2::MapData& map, int x, int y,
 }
 
 cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y)
+{
+    return CheckMove(map, tile->type(), tile->direction(), x, y);
+}
+
+// Tiles in a stack which block every mob, including ghosts
+static constexpr cc2::Tile::TypeSet s_blockAllMobs {
+    cc2::Tile::MirrorPlayer, cc2::Tile::MirrorPlayer2, cc2::Tile::BlueTank,
+    cc2::Tile::YellowTank, cc2::Tile::DirtBlock, cc2::Tile::IceBlock,
+    cc2::Tile::DirBlock,
+};
+
+// Items which block every mob except ghosts
+static constexpr cc2::Tile::TypeSet s_blockingItems {
+    cc2::Tile::Chip, cc2::Tile::ExtraChip, cc2::Tile::GreenChip,
+    cc2::Tile::Key_Yellow, cc2::Tile::Key_Green,
+    cc2::Tile::TimeBonus, cc2::Tile::TimePenalty, cc2::Tile::ToggleClock,
+    cc2::Tile::Flag10, cc2::Tile::Flag100, cc2::Tile::Flag1000, cc2::Tile::Flag2x,
+    cc2::Tile::IceCleats, cc2::Tile::MagnoShoes, cc2::Tile::FireShoes,
+    cc2::Tile::Flippers, cc2::Tile::SpeedShoes, cc2::Tile::HikingBoots,
+    cc2::Tile::TimeBomb, cc2::Tile::Lightning, cc2::Tile::BowlingBall,
+    cc2::Tile::Helmet, cc2::Tile::RRSign, cc2::Tile::SteelFoil,
+    cc2::Tile::Eye, cc2::Tile::Bribe, cc2::Tile::Hook,
+};
+
+static constexpr cc2::Tile::TypeSet s_bombs { cc2::Tile::RedBomb, cc2::Tile::GreenBomb };
+
+cc2::MoveState cc2::CheckMove(const MapData& map, Tile::Type type, Tile::Direction facing,
+                              int x, int y)
 {
     Tile::Direction dirs[4];
-    getPreferredDirections(tile, dirs);
+    getPreferredDirections(type, facing, dirs);
     if (dirs[0] == Tile::InvalidDir)
         return MoveBlocked;
 
     const Tile& mapTile = map.tile(x, y);
     const Tile& baseTile = mapTile.bottom();
-    const int myDir = tile->direction();
+    const int myDir = facing;
     int state = 0;
 
     switch (baseTile.type()) {
     case Tile::Force_N:
-        if (tile->type() != Tile::Ghost) {
+        if (type != Tile::Ghost) {
             dirs[0] = Tile::North;
             dirs[1] = Tile::InvalidDir;
             dirs[2] = Tile::InvalidDir;
@@ -217,7 +235,7 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Force_E:
-        if (tile->type() != Tile::Ghost) {
+        if (type != Tile::Ghost) {
             dirs[0] = Tile::East;
             dirs[1] = Tile::InvalidDir;
             dirs[2] = Tile::InvalidDir;
@@ -225,7 +243,7 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Force_S:
-        if (tile->type() != Tile::Ghost) {
+        if (type != Tile::Ghost) {
             dirs[0] = Tile::South;
             dirs[1] = Tile::InvalidDir;
             dirs[2] = Tile::InvalidDir;
@@ -233,7 +251,7 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Force_W:
-        if (tile->type() != Tile::Ghost) {
+        if (type != Tile::Ghost) {
             dirs[0] = Tile::West;
             dirs[1] = Tile::InvalidDir;
             dirs[2] = Tile::InvalidDir;
@@ -241,19 +259,19 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Force_Rand:
-        if (tile->type() != Tile::Ghost) {
+        if (type != Tile::Ghost) {
             // TODO: Blocked isn't really accurate here...
             return MoveBlocked;
         }
         break;
     case Tile::Trap:
-        if (tile->type() != Tile::Ghost) {
+        if (type != Tile::Ghost) {
             state |= MoveTrapped;
             // TODO: Check if the corresponding button is pressed...
         }
         break;
     case Tile::Ice:
-        if (tile->type() != Tile::Ghost) {
+        if (type != Tile::Ghost) {
             // Preferred directions are only straight and back when on ice.
             dirs[0] = (Tile::Direction)((myDir    ) & 0x03);
             dirs[1] = (Tile::Direction)((myDir + 2) & 0x03);
@@ -262,13 +280,13 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Ice_SE:
-        if (tile->type() != Tile::Ghost) {
-            if (tile->direction() == Tile::North) {
+        if (type != Tile::Ghost) {
+            if (facing == Tile::North) {
                 dirs[0] = Tile::East;
                 dirs[1] = Tile::South;
                 dirs[2] = Tile::InvalidDir;
                 dirs[3] = Tile::InvalidDir;
-            } else if (tile->direction() == Tile::West) {
+            } else if (facing == Tile::West) {
                 dirs[0] = Tile::South;
                 dirs[1] = Tile::East;
                 dirs[2] = Tile::InvalidDir;
@@ -277,13 +295,13 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Ice_SW:
-        if (tile->type() != Tile::Ghost) {
-            if (tile->direction() == Tile::North) {
+        if (type != Tile::Ghost) {
+            if (facing == Tile::North) {
                 dirs[0] = Tile::West;
                 dirs[1] = Tile::South;
                 dirs[2] = Tile::InvalidDir;
                 dirs[3] = Tile::InvalidDir;
-            } else if (tile->direction() == Tile::East) {
+            } else if (facing == Tile::East) {
                 dirs[0] = Tile::South;
                 dirs[1] = Tile::West;
                 dirs[2] = Tile::InvalidDir;
@@ -292,13 +310,13 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Ice_NW:
-        if (tile->type() != Tile::Ghost) {
-            if (tile->direction() == Tile::South) {
+        if (type != Tile::Ghost) {
+            if (facing == Tile::South) {
                 dirs[0] = Tile::West;
                 dirs[1] = Tile::North;
                 dirs[2] = Tile::InvalidDir;
                 dirs[3] = Tile::InvalidDir;
-            } else if (tile->direction() == Tile::East) {
+            } else if (facing == Tile::East) {
                 dirs[0] = Tile::North;
                 dirs[1] = Tile::West;
                 dirs[2] = Tile::InvalidDir;
@@ -307,13 +325,13 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::Ice_NE:
-        if (tile->type() != Tile::Ghost) {
-            if (tile->direction() == Tile::South) {
+        if (type != Tile::Ghost) {
+            if (facing == Tile::South) {
                 dirs[0] = Tile::East;
                 dirs[1] = Tile::North;
                 dirs[2] = Tile::InvalidDir;
                 dirs[3] = Tile::InvalidDir;
-            } else if (tile->direction() == Tile::West) {
+            } else if (facing == Tile::West) {
                 dirs[0] = Tile::North;
                 dirs[1] = Tile::East;
                 dirs[2] = Tile::InvalidDir;
@@ -322,19 +340,20 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
         break;
     case Tile::TrainTracks:
-        if (tile->type() != Tile::Ghost)
-            getPreferredTrackDirections(tile, dirs, baseTile.modifier());
+        if (type != Tile::Ghost)
+            getPreferredTrackDirections(type, facing, dirs, baseTile.modifier());
         break;
     default:
         break;
     }
 
+    const Tile* myPanel = mapTile.findClass(Tile::ClassPanelCanopy);
     for (Tile::Direction dir : dirs) {
         if (dir == Tile::InvalidDir)
             continue;
 
-        const Tile* panelTile = findPanel(&mapTile);
-        if (panelTile && (tile->type() != Tile::Ghost)) {
+        const Tile* panelTile = myPanel;
+        if (panelTile && (type != Tile::Ghost)) {
             switch (panelTile->type()) {
             case Tile::CC1_Barrier_S:
                 if (dir == Tile::South)
@@ -372,9 +391,7 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         const Tile* peekBase = &peek->bottom();
         if (peekBase->type() == Tile::SteelWall || peekBase->type() == Tile::StyledWall
                 || peekBase->type() >= Tile::NUM_TILE_TYPES
-                || peek->haveTile({Tile::MirrorPlayer, Tile::MirrorPlayer2, Tile::BlueTank,
-                                   Tile::YellowTank, Tile::DirtBlock, Tile::IceBlock,
-                                   Tile::DirBlock})) {
+                || peek->haveTile(s_blockAllMobs)) {
             // These tiles block ALL mobs
             continue;
         }
@@ -394,22 +411,14 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
                 || (peekBase->type() == Tile::RevolvDoor_NW && (dir == Tile::South || dir == Tile::East))
                 || (peekBase->type() == Tile::RevolvDoor_NE && (dir == Tile::South || dir == Tile::West))
                 || (peekBase->type() == Tile::RevolvDoor_SE && (dir == Tile::North || dir == Tile::West))
-                || (peek->haveTile({Tile::Chip, Tile::ExtraChip, Tile::GreenChip,
-                                    Tile::Key_Yellow, Tile::Key_Green,
-                                    Tile::TimeBonus, Tile::TimePenalty, Tile::ToggleClock,
-                                    Tile::Flag10, Tile::Flag100, Tile::Flag1000, Tile::Flag2x,
-                                    Tile::IceCleats, Tile::MagnoShoes, Tile::FireShoes,
-                                    Tile::Flippers, Tile::SpeedShoes, Tile::HikingBoots,
-                                    Tile::TimeBomb, Tile::Lightning, Tile::BowlingBall,
-                                    Tile::Helmet, Tile::RRSign, Tile::SteelFoil,
-                                    Tile::Eye, Tile::Bribe, Tile::Hook})))
-                && (tile->type() != Tile::Ghost))
+                || peek->haveTile(s_blockingItems))
+                && (type != Tile::Ghost))
             continue;
-        if (peekBase->type() == Tile::StyledFloor && tile->type() == Tile::Ghost)
+        if (peekBase->type() == Tile::StyledFloor && type == Tile::Ghost)
             continue;
 
-        panelTile = findPanel(peek);
-        if (panelTile && (tile->type() != Tile::Ghost)) {
+        panelTile = peek->findClass(Tile::ClassPanelCanopy);
+        if (panelTile && (type != Tile::Ghost)) {
             switch (panelTile->type()) {
             case Tile::CC1_Barrier_S:
                 if (dir == Tile::North)
@@ -439,7 +448,7 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
                 Q_ASSERT(false);
             }
         }
-        if (peekBase->type() == Tile::TrainTracks && tile->type() != Tile::Ghost) {
+        if (peekBase->type() == Tile::TrainTracks && type != Tile::Ghost) {
             const uint32_t tracks = effectiveTracks(peekBase->modifier());
             switch (dir) {
             case cc2::Tile::North:
@@ -468,21 +477,21 @@ cc2::MoveState cc2::CheckMove(const MapData& map, const Tile* tile, int x, int y
         }
 
         if (peekBase->type() == Tile::Water) {
-            if (tile->type() == Tile::Ghost)
+            if (type == Tile::Ghost)
                 continue;
-            if (tile->type() != Tile::Ship)
+            if (type != Tile::Ship)
                 state |= MoveDeath;
         }
-        if (peekBase->type() == Tile::Turtle && (tile->type() == Tile::Ghost
-                || tile->type() == Tile::FireBox))
+        if (peekBase->type() == Tile::Turtle && (type == Tile::Ghost
+                || type == Tile::FireBox))
             continue;
-        if (peekBase->type() == Tile::Fire && tile->type() != Tile::FireBox
-                && tile->type() != Tile::Ghost)
+        if (peekBase->type() == Tile::Fire && type != Tile::FireBox
+                && type != Tile::Ghost)
             continue;
-        if (peekBase->type() == Tile::FlameJet_On && tile->type() != Tile::FireBox)
+        if (peekBase->type() == Tile::FlameJet_On && type != Tile::FireBox)
             state |= MoveDeath;
-        if ((peekBase->type() == Tile::Slime || peek->haveTile({Tile::RedBomb, Tile::GreenBomb}))
-                && tile->type() != Tile::Ghost)
+        if ((peekBase->type() == Tile::Slime || peek->haveTile(s_bombs))
+                && type != Tile::Ghost)
             state |= MoveDeath;
         if (peekBase->type() >= Tile::Teleport_Red && peekBase->type() <= Tile::Teleport_Green)
             state |= MoveTeleport;
@@ -37,6 +37,8 @@ enum MoveState {
 };
 
 MoveState CheckMove(const MapData& map, const Tile* tile, int x, int y);
+MoveState CheckMove(const MapData& map, Tile::Type type, Tile::Direction facing,
+                    int x, int y);
 void TurnCreature(Tile* tile, MoveState state);
 QPoint AdvanceCreature(const QPoint& pos, MoveState state);
 
@@ -16,207 +16,438 @@
  ******************************************************************************/
 
 #include "GameScript.h"
+#include "ScriptFlow.h"
 #include "libcc1/Errors.h"
 #include "libcc1/Stream.h"
 
-#include <memory>
-#include <vector>
+#include <algorithm>
+#include <cctype>
 #include <cstring>
 
 #ifdef _WIN32
-#  define stricmp _stricmp
+#  define strnicmp _strnicmp
 #else
-#  define stricmp strcasecmp
+#  define strnicmp strncasecmp
 #endif
 
-std::string matchOperator(const char* lineBuffer)
+void* cc2::ScriptArena::allocate(size_t size, size_t align)
 {
-    switch (lineBuffer[0]) {
+    size_t padding = (align - (reinterpret_cast<uintptr_t>(m_current) & (align - 1))) & (align - 1);
+    if (padding + size > m_remaining) {
+        // Oversized requests get a block of their own
+        const size_t blockSize = std::max<size_t>(BlockSize, size + align);
+        m_blocks.emplace_back(new char[blockSize]);
+        m_current = m_blocks.back().get();
+        m_remaining = blockSize;
+        padding = (align - (reinterpret_cast<uintptr_t>(m_current) & (align - 1))) & (align - 1);
+    }
+
+    void* result = m_current + padding;
+    m_current += padding + size;
+    m_remaining -= padding + size;
+    return result;
+}
+
+const char* cc2::ScriptArena::copyString(const char* text, size_t length)
+{
+    auto copy = static_cast<char*>(allocate(length + 1, 1));
+    memcpy(copy, text, length);
+    copy[length] = 0;
+    return copy;
+}
+
+void cc2::ScriptArena::addCleanup(void* object, void (*destroy)(void*))
+{
+    auto cleanup = static_cast<Cleanup*>(allocate(sizeof(Cleanup), alignof(Cleanup)));
+    cleanup->destroy = destroy;
+    cleanup->object = object;
+    cleanup->next = m_cleanup;
+    m_cleanup = cleanup;
+}
+
+void cc2::ScriptArena::clear()
+{
+    for (Cleanup* cleanup = m_cleanup; cleanup; cleanup = cleanup->next)
+        cleanup->destroy(cleanup->object);
+    m_cleanup = nullptr;
+    m_blocks.clear();
+    m_current = nullptr;
+    m_remaining = 0;
+}
+
+static uint32_t hashName(const char* name, size_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t)name[i]) * 16777619U;
+    return hash;
+}
+
+size_t cc2::ScriptAtoms::probe(const char* name, size_t length, uint32_t hash) const
+{
+    const size_t mask = m_slots.size() - 1;
+    size_t slot = hash & mask;
+    while (m_slots[slot] != NoAtom) {
+        const Name& entry = m_names[m_slots[slot]];
+        if (entry.hash == hash && entry.length == length
+                && memcmp(entry.text, name, length) == 0)
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void cc2::ScriptAtoms::grow()
+{
+    m_slots.assign(std::max<size_t>(64, m_slots.size() * 2), NoAtom);
+    for (uint32_t atom = 0; atom < m_names.size(); ++atom) {
+        const Name& entry = m_names[atom];
+        m_slots[probe(entry.text, entry.length, entry.hash)] = atom;
+    }
+}
+
+uint32_t cc2::ScriptAtoms::intern(const char* name, size_t length)
+{
+    // Keep the table at most half full
+    if ((m_names.size() + 1) * 2 > m_slots.size())
+        grow();
+
+    const uint32_t hash = hashName(name, length);
+    const size_t slot = probe(name, length, hash);
+    if (m_slots[slot] == NoAtom) {
+        m_slots[slot] = (uint32_t)m_names.size();
+        m_names.push_back(Name { m_arena->copyString(name, length), (uint32_t)length, hash });
+    }
+    return m_slots[slot];
+}
+
+uint32_t cc2::ScriptAtoms::find(const char* name) const
+{
+    if (m_slots.empty())
+        return NoAtom;
+    const size_t length = strlen(name);
+    return m_slots[probe(name, length, hashName(name, length))];
+}
+
+void cc2::ScriptAtoms::clear()
+{
+    m_names.clear();
+    m_slots.clear();
+}
+
+const char* cc2::OperatorNode::tokenName(Operator op)
+{
+    static const char* const tokens[] = {
+        "=", "<", "<=", ">", ">=", "==", "!=", "*", "/", "+", "-", "%",
+        "^", "&&", "&", "||", "|",
+    };
+    static_assert(sizeof(tokens) / sizeof(tokens[0]) == NUM_OPERATORS,
+                  "Operator token table is out of sync");
+    return tokens[op];
+}
+
+// Returns the length of the operator token, or 0 if this isn't an operator
+static size_t matchOperator(const char* text, cc2::OperatorNode::Operator* op)
+{
+    using cc2::OperatorNode;
+
+    const bool doubled = (text[1] == text[0]);
+    const bool equals = (text[1] == '=');
+    switch (text[0]) {
     case '<':
+        *op = equals ? OperatorNode::OpLessEqual : OperatorNode::OpLess;
+        return equals ? 2 : 1;
     case '>':
+        *op = equals ? OperatorNode::OpGreaterEqual : OperatorNode::OpGreater;
+        return equals ? 2 : 1;
     case '=':
-        if (lineBuffer[1] == '=')
-            return std::string(lineBuffer, 2);
-        return std::string(lineBuffer, 1);
+        *op = equals ? OperatorNode::OpEqual : OperatorNode::OpAssign;
+        return equals ? 2 : 1;
     case '!':
-        if (lineBuffer[1] == '=')
-            return std::string(lineBuffer, 2);
-        break;
+        *op = OperatorNode::OpNotEqual;
+        return equals ? 2 : 0;
     case '*':
+        *op = OperatorNode::OpMultiply;
+        return 1;
     case '/':
+        *op = OperatorNode::OpDivide;
+        return 1;
     case '+':
+        *op = OperatorNode::OpAdd;
+        return 1;
     case '-':
+        *op = OperatorNode::OpSubtract;
+        return 1;
     case '%':
+        *op = OperatorNode::OpModulo;
+        return 1;
     case '^':
-        return std::string(lineBuffer, 1);
+        *op = OperatorNode::OpXor;
+        return 1;
     case '&':
+        *op = doubled ? OperatorNode::OpLogicalAnd : OperatorNode::OpBitAnd;
+        return doubled ? 2 : 1;
     case '|':
-        if (lineBuffer[1] == lineBuffer[0])
-            return std::string(lineBuffer, 2);
-        return std::string(lineBuffer, 1);
+        *op = doubled ? OperatorNode::OpLogicalOr : OperatorNode::OpBitOr;
+        return doubled ? 2 : 1;
     default:
-        break;
+        // Not an operator token
+        return 0;
     }
+}
 
-    // Not an operator token
-    return std::string();
+/* Keywords are matched case insensitively through a perfect hash of the
+ * first and last characters and the length, so an identifier costs at most
+ * one string comparison.
+ */
+namespace {
+
+struct Keyword {
+    const char* name;
+    size_t length;
+    int type;
+};
+
+struct KeywordTable {
+    enum { Size = 32 };
+    Keyword entries[Size];
+};
+
+constexpr Keyword s_keywords[] = {
+    { "music", 5, cc2::C2GNode::NodeMusic },
+    { "map", 3, cc2::C2GNode::NodeMap },
+    { "goto", 4, cc2::C2GNode::NodeGoto },
+    { "do", 2, cc2::C2GNode::NodeDo },
+    { "end", 3, cc2::C2GNode::NodeEnd },
+    { "script", 6, cc2::C2GNode::NodeScript },
+    { "edit", 4, cc2::C2GNode::NodeEdit },
+    { "chain", 5, cc2::C2GNode::NodeChain },
+    { "chdir", 5, cc2::C2GNode::NodeChdir },
+    { "art", 3, cc2::C2GNode::NodeArt },
+    { "wav", 3, cc2::C2GNode::NodeWav },
+    { "main", 4, cc2::C2GNode::NodeMain },
+    { "game", 4, cc2::C2GNode::NodeGame },
+    { "dlc", 3, cc2::C2GNode::NodeDLC },
+};
+
+constexpr int asciiLower(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? (ch - 'A' + 'a') : (uint8_t)ch;
+}
+
+constexpr size_t keywordSlot(const char* name, size_t length)
+{
+    return (asciiLower(name[0]) + 13 * asciiLower(name[length - 1]) + 5 * length)
+           % KeywordTable::Size;
+}
+
+constexpr KeywordTable buildKeywordTable()
+{
+    KeywordTable table { };
+    for (const Keyword& keyword : s_keywords)
+        table.entries[keywordSlot(keyword.name, keyword.length)] = keyword;
+    return table;
 }
 
+constexpr KeywordTable s_keywordTable = buildKeywordTable();
+
+constexpr bool keywordsArePerfect()
+{
+    for (const Keyword& keyword : s_keywords) {
+        if (s_keywordTable.entries[keywordSlot(keyword.name, keyword.length)].type != keyword.type)
+            return false;
+    }
+    return true;
+}
+
+static_assert(keywordsArePerfect(), "Keyword hash has a collision");
+
+}
+
+static int keywordType(const char* name, size_t length)
+{
+    const Keyword& keyword = s_keywordTable.entries[keywordSlot(name, length)];
+    if (keyword.name && keyword.length == length && strnicmp(keyword.name, name, length) == 0)
+        return keyword.type;
+    return cc2::C2GNode::NodeIdentifier;
+}
+
+static bool isSpace(char ch) { return std::isspace((uint8_t)ch) != 0; }
+static bool isDigit(char ch) { return std::isdigit((uint8_t)ch) != 0; }
+static bool isAlpha(char ch) { return std::isalpha((uint8_t)ch) != 0; }
+static bool isWordChar(char ch) { return std::isalnum((uint8_t)ch) != 0 || ch == '_'; }
+
 void cc2::GameScript::read(const QString& filename)
 {
     ccl::unique_FILE stream = ccl::FileStream::Fopen(filename, ccl::FileStream::ReadText);
     if (!stream)
         throw ccl::IOError(ccl::RuntimeError::tr("Could not open file for reading"));
 
-    int lineNo = 0;
-    std::vector<char> lineBuffer;
-    lineBuffer.resize(128);
+    // Read the whole script at once; they are small, and this lets the
+    // parser work through a single buffer.
+    std::vector<char> text;
+    size_t length = 0;
     for ( ;; ) {
-        if (fgets(&lineBuffer[0], lineBuffer.size(), stream.get()) == nullptr) {
-            if (ferror(stream.get()))
-                throw ccl::IOError(ccl::RuntimeError::tr("Error reading from script file"));
+        text.resize(length + 16384);
+        const size_t count = fread(&text[length], 1, text.size() - length, stream.get());
+        length += count;
+        if (count == 0 || length < text.size())
             break;
-        }
-        ++lineNo;
+    }
+    if (ferror(stream.get()))
+        throw ccl::IOError(ccl::RuntimeError::tr("Error reading from script file"));
+
+    parse(text.data(), length);
+}
+
+void cc2::GameScript::parse(const char* text, size_t length)
+{
+    m_nodes.clear();
+    m_atoms.clear();
+    m_arena.clear();
 
-        size_t length = std::char_traits<char>::length(&lineBuffer[0]);
-        if (length == 0)
+    int lineNo = 0;
+    std::vector<char> line;
+    const char* end = text + length;
+    while (text < end) {
+        // A NUL at the start of a line ends the script
+        if (*text == 0)
             break;
 
-        while (lineBuffer[length - 1] != '\r' && lineBuffer[length - 1] != '\n') {
-            // Incomplete line, or unterminated final line
-            lineBuffer.resize(lineBuffer.size() * 2);
-            if (fgets(&lineBuffer[length], lineBuffer.size() - length, stream.get()) == nullptr) {
-                if (ferror(stream.get()))
-                    throw ccl::IOError(ccl::RuntimeError::tr("Error reading from script file"));
-                break;
-            }
-            length = std::char_traits<char>::length(&lineBuffer[0]);
-        }
-        // Strip any newline characters
-        while (length > 0 && (lineBuffer[length - 1] == '\r' || lineBuffer[length - 1] == '\n'))
-            lineBuffer[--length] = 0;
+        const char* eol = static_cast<const char*>(memchr(text, '\n', end - text));
+        if (!eol)
+            eol = end;
+        ++lineNo;
 
-        if (length == 0)
+        line.assign(text, eol);
+        text = (eol == end) ? end : eol + 1;
+
+        // Strip any newline characters
+        while (!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+            line.pop_back();
+        if (line.empty())
             continue;
 
-        C2GNode* currentNode = nullptr;
-        int column = 0;
-        while (lineBuffer[column] != 0) {
-            // Scan for a token
-            while (std::isspace(lineBuffer[column]))
-                ++column;
+        line.push_back(0);
+        parseLine(line.data(), lineNo);
+    }
+}
 
-            if (lineBuffer[column] == ';'
-                    || (lineBuffer[column] == '/' && lineBuffer[column + 1] == '/')) {
-                // The rest of this line is a comment
-                break;
-            } else if (std::isdigit(lineBuffer[column])) {
-                char* end = nullptr;
-                unsigned long value = strtoul(&lineBuffer[column], &end, 10);
-                currentNode = new NumberNode(value, lineNo);
-                m_nodes.push_back(currentNode);
-                column = end - &lineBuffer[0];
-            } else if (lineBuffer[column] == '"') {
-                int endColumn = ++column;
-                while (lineBuffer[endColumn] && lineBuffer[endColumn] != '"')
-                    ++endColumn;
-                currentNode = new StringNode(std::string(&lineBuffer[column], endColumn - column), lineNo);
-                if (!m_nodes.empty()) {
-                    C2GNode* lastNode = m_nodes.back();
-                    switch (lastNode->type()) {
-                    case C2GNode::NodeMusic:
-                    case C2GNode::NodeMap:
-                    case C2GNode::NodeChain:
-                    case C2GNode::NodeChdir:
-                    case C2GNode::NodeArt:
-                    case C2GNode::NodeWav:
-                    case C2GNode::NodeGame:
-                    case C2GNode::NodeDLC:
-                        if (!static_cast<CommandNode*>(lastNode)->param())
-                            static_cast<CommandNode*>(lastNode)->setParam(currentNode);
-                        else
-                            m_nodes.push_back(currentNode);
-                        break;
-                    case C2GNode::NodeScript:
-                        static_cast<ScriptNode*>(lastNode)->addLine(currentNode);
-                        break;
-                    default:
+void cc2::GameScript::parseLine(const char* line, int lineNo)
+{
+    C2GNode* currentNode = nullptr;
+    const char* pos = line;
+    while (*pos != 0) {
+        // Scan for a token
+        while (isSpace(*pos))
+            ++pos;
+
+        if (*pos == ';' || (pos[0] == '/' && pos[1] == '/')) {
+            // The rest of this line is a comment
+            break;
+        } else if (isDigit(*pos)) {
+            char* end = nullptr;
+            unsigned long value = strtoul(pos, &end, 10);
+            currentNode = m_arena.create<NumberNode>(value, lineNo);
+            m_nodes.push_back(currentNode);
+            pos = end;
+        } else if (*pos == '"') {
+            const char* start = ++pos;
+            while (*pos && *pos != '"')
+                ++pos;
+            currentNode = m_arena.create<StringNode>(m_arena.copyString(start, pos - start),
+                                                     pos - start, lineNo);
+            if (!m_nodes.empty()) {
+                C2GNode* lastNode = m_nodes.back();
+                switch (lastNode->type()) {
+                case C2GNode::NodeMusic:
+                case C2GNode::NodeMap:
+                case C2GNode::NodeChain:
+                case C2GNode::NodeChdir:
+                case C2GNode::NodeArt:
+                case C2GNode::NodeWav:
+                case C2GNode::NodeGame:
+                case C2GNode::NodeDLC:
+                    if (!static_cast<CommandNode*>(lastNode)->param())
+                        static_cast<CommandNode*>(lastNode)->setParam(currentNode);
+                    else
                         m_nodes.push_back(currentNode);
-                        break;
-                    }
-                }
-                column = endColumn + 1;
-            } else if (lineBuffer[column] == '#') {
-                int end = ++column;
-                while (std::isalnum(lineBuffer[end]) || lineBuffer[end] == '_')
-                    ++end;
-                currentNode = new LabelNode(std::string(&lineBuffer[column], end - column), lineNo);
-                m_nodes.push_back(currentNode);
-                column = end;
-            } else if (std::isalpha(lineBuffer[column]) || lineBuffer[column] == '_') {
-                int end = column;
-                while (std::isalnum(lineBuffer[end]) || lineBuffer[end] == '_')
-                    ++end;
-                std::string identifier(&lineBuffer[column], end - column);
-
-                if (stricmp(identifier.c_str(), "music") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeMusic, lineNo);
-                else if (stricmp(identifier.c_str(), "map") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeMap, lineNo);
-                else if (stricmp(identifier.c_str(), "goto") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeGoto, lineNo);
-                else if (stricmp(identifier.c_str(), "do") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeDo, lineNo);
-                else if (stricmp(identifier.c_str(), "end") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeEnd, lineNo);
-                else if (stricmp(identifier.c_str(), "script") == 0)
-                    currentNode = new ScriptNode(lineNo);
-                else if (stricmp(identifier.c_str(), "edit") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeEdit, lineNo);
-                else if (stricmp(identifier.c_str(), "chain") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeChain, lineNo);
-                else if (stricmp(identifier.c_str(), "chdir") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeChdir, lineNo);
-                else if (stricmp(identifier.c_str(), "art") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeArt, lineNo);
-                else if (stricmp(identifier.c_str(), "wav") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeWav, lineNo);
-                else if (stricmp(identifier.c_str(), "main") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeMain, lineNo);
-                else if (stricmp(identifier.c_str(), "game") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeGame, lineNo);
-                else if (stricmp(identifier.c_str(), "dlc") == 0)
-                    currentNode = new CommandNode(C2GNode::NodeDLC, lineNo);
-                else
-                    currentNode = new IdentifierNode(identifier, lineNo);
-
-                if (currentNode->type() == C2GNode::NodeIdentifier &&
-                        !m_nodes.empty() && m_nodes.back()->type() == C2GNode::NodeScript) {
-                    // TODO: Need to see how the actual game engine handles these
-                    static_cast<ScriptNode*>(m_nodes.back())->addLine(currentNode);
-                } else {
-                    m_nodes.push_back(currentNode);
-                }
-                column = end;
-            } else {
-                std::string opToken = matchOperator(&lineBuffer[column]);
-                if (!opToken.empty() && m_nodes.size() >= 2) {
-                    C2GNode* op1 = m_nodes.back();
-                    m_nodes.pop_back();
-                    C2GNode* op2 = m_nodes.back();
-                    m_nodes.pop_back();
-                    currentNode = new OperatorNode(opToken, op1, op2, lineNo);
-                    m_nodes.push_back(currentNode);
-                    column += opToken.size();
-                } else {
-                    // Treat anything we don't recognize as junk, and store
-                    // it for the checker to flag
-                    currentNode = new JunkNode(&lineBuffer[column], lineNo);
+                    break;
+                case C2GNode::NodeScript:
+                    static_cast<ScriptNode*>(lastNode)->addLine(currentNode);
+                    break;
+                default:
                     m_nodes.push_back(currentNode);
                     break;
                 }
             }
+            // Skip the closing quote, if there is one
+            if (*pos)
+                ++pos;
+        } else if (*pos == '#') {
+            const char* start = ++pos;
+            while (isWordChar(*pos))
+                ++pos;
+            const uint32_t atom = m_atoms.intern(start, pos - start);
+            currentNode = m_arena.create<LabelNode>(atom, m_atoms.name(atom), lineNo);
+            m_nodes.push_back(currentNode);
+        } else if (isAlpha(*pos) || *pos == '_') {
+            const char* start = pos;
+            while (isWordChar(*pos))
+                ++pos;
+
+            const int type = keywordType(start, pos - start);
+            if (type == C2GNode::NodeIdentifier) {
+                const uint32_t atom = m_atoms.intern(start, pos - start);
+                currentNode = m_arena.create<IdentifierNode>(atom, m_atoms.name(atom), lineNo);
+            } else if (type == C2GNode::NodeScript) {
+                currentNode = m_arena.create<ScriptNode>(lineNo);
+            } else {
+                currentNode = m_arena.create<CommandNode>(type, lineNo);
+            }
+
+            if (currentNode->type() == C2GNode::NodeIdentifier &&
+                    !m_nodes.empty() && m_nodes.back()->type() == C2GNode::NodeScript) {
+                // TODO: Need to see how the actual game engine handles these
+                static_cast<ScriptNode*>(m_nodes.back())->addLine(currentNode);
+            } else {
+                m_nodes.push_back(currentNode);
+            }
+        } else {
+            OperatorNode::Operator op;
+            const size_t opLength = matchOperator(pos, &op);
+            if (opLength != 0 && m_nodes.size() >= 2) {
+                C2GNode* op1 = m_nodes.back();
+                m_nodes.pop_back();
+                C2GNode* op2 = m_nodes.back();
+                m_nodes.pop_back();
+                currentNode = m_arena.create<OperatorNode>(op, op1, op2, lineNo);
+                m_nodes.push_back(currentNode);
+                pos += opLength;
+            } else {
+                // Treat anything we don't recognize as junk, and store
+                // it for the checker to flag
+                currentNode = m_arena.create<JunkNode>(m_arena.copyString(pos, strlen(pos)),
+                                                       lineNo);
+                m_nodes.push_back(currentNode);
+                break;
+            }
         }
     }
 }
+
+std::vector<cc2::ScriptMapEntry>
+cc2::GameScript::mapList(const QString& scriptFilename, std::string* gameName,
+                         bool* complete, std::vector<std::string>* missingChains) const
+{
+    ScriptFlow flow = ExploreScript(*this, scriptFilename);
+    FollowChains(flow, scriptFilename);
+    if (gameName)
+        *gameName = flow.gameName;
+    if (complete)
+        *complete = flow.complete;
+    if (missingChains)
+        *missingChains = std::move(flow.missingChains);
+    return std::move(flow.maps);
+}
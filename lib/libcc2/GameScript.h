@@ -18,13 +18,102 @@
 #ifndef _CC2GAMESCRIPT_H
 #define _CC2GAMESCRIPT_H
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
 #include <string>
-#include <list>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 class QString;
 
 namespace cc2 {
 
+/* Bump allocator for a parsed script.  Everything allocated from the arena
+ * is released together when it is cleared or destroyed.  Objects which
+ * need their destructor run are recorded by create() and destroyed in
+ * reverse order of creation.
+ */
+class ScriptArena {
+public:
+    ScriptArena() : m_current(), m_remaining(), m_cleanup() { }
+    ~ScriptArena() { clear(); }
+
+    ScriptArena(const ScriptArena&) = delete;
+    ScriptArena& operator=(const ScriptArena&) = delete;
+
+    void* allocate(size_t size, size_t align);
+
+    // Copy text into the arena, adding a NUL terminator
+    const char* copyString(const char* text, size_t length);
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            addCleanup(object, [](void* ptr) { static_cast<T*>(ptr)->~T(); });
+        return object;
+    }
+
+    void clear();
+
+private:
+    enum { BlockSize = 16384 };
+
+    struct Cleanup {
+        void (*destroy)(void*);
+        void* object;
+        Cleanup* next;
+    };
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_current;
+    size_t m_remaining;
+    Cleanup* m_cleanup;
+
+    void addCleanup(void* object, void (*destroy)(void*));
+};
+
+/* Interned identifier and label names.  Each distinct name is stored once
+ * in the arena and identified by a dense index, so variables can be kept
+ * in a flat array instead of a map keyed by name.  Names are case
+ * sensitive, matching how the game treats variables.
+ */
+class ScriptAtoms {
+public:
+    enum : uint32_t { NoAtom = 0xffffffff };
+
+    explicit ScriptAtoms(ScriptArena* arena) : m_arena(arena) { }
+
+    uint32_t intern(const char* name, size_t length);
+    uint32_t find(const char* name) const;
+
+    const char* name(uint32_t atom) const { return m_names[atom].text; }
+    size_t size() const { return m_names.size(); }
+
+    void clear();
+
+private:
+    struct Name {
+        const char* text;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    ScriptArena* m_arena;
+    std::vector<Name> m_names;
+    std::vector<uint32_t> m_slots;      // Open addressed, NoAtom when empty
+
+    size_t probe(const char* name, size_t length, uint32_t hash) const;
+    void grow();
+};
+
+/* Script nodes live in the GameScript's arena and are never deleted
+ * individually, so they hold plain pointers to their children and text.
+ */
 class C2GNode {
 public:
     enum NodeType {
@@ -53,9 +142,9 @@ public:
     };
 
     C2GNode(int type, int line) : m_type(type), m_line(line) { }
-    virtual ~C2GNode() = default;
 
     int type() const { return m_type; }
+    int line() const { return m_line; }
 
 private:
     int m_type;
@@ -64,46 +153,52 @@ private:
 
 class JunkNode : public C2GNode {
 public:
-    JunkNode(std::string junk, int line)
-        : C2GNode(NodeJunk, line), m_junk(std::move(junk)) { }
+    JunkNode(const char* junk, int line)
+        : C2GNode(NodeJunk, line), m_junk(junk) { }
 
-    const std::string& junk() const { return m_junk; }
+    const char* junk() const { return m_junk; }
 
 private:
-    std::string m_junk;
+    const char* m_junk;
 };
 
 class IdentifierNode : public C2GNode {
 public:
-    IdentifierNode(std::string name, int line)
-        : C2GNode(NodeIdentifier, line), m_name(std::move(name)) { }
+    IdentifierNode(uint32_t atom, const char* name, int line)
+        : C2GNode(NodeIdentifier, line), m_atom(atom), m_name(name) { }
 
-    const std::string& name() const { return m_name; }
+    uint32_t atom() const { return m_atom; }
+    const char* name() const { return m_name; }
 
 private:
-    std::string m_name;
+    uint32_t m_atom;
+    const char* m_name;
 };
 
 class OperatorNode : public C2GNode {
 public:
-    OperatorNode(std::string token, C2GNode* op1, C2GNode* op2, int line)
-        : C2GNode(NodeOperator, line), m_token(std::move(token))
+    enum Operator {
+        OpAssign, OpLess, OpLessEqual, OpGreater, OpGreaterEqual, OpEqual,
+        OpNotEqual, OpMultiply, OpDivide, OpAdd, OpSubtract, OpModulo,
+        OpXor, OpLogicalAnd, OpBitAnd, OpLogicalOr, OpBitOr,
+        NUM_OPERATORS
+    };
+
+    OperatorNode(Operator op, C2GNode* op1, C2GNode* op2, int line)
+        : C2GNode(NodeOperator, line), m_op(op)
     {
         m_operands[0] = op1;
         m_operands[1] = op2;
     }
 
-    ~OperatorNode() override
-    {
-        for (auto op : m_operands)
-            delete op;
-    }
-
-    const std::string& token() const { return m_token; }
+    Operator op() const { return m_op; }
+    const char* token() const { return tokenName(m_op); }
     C2GNode* operand(size_t which) const { return m_operands[which]; }
 
+    static const char* tokenName(Operator op);
+
 private:
-    std::string m_token;
+    Operator m_op;
     C2GNode* m_operands[2];
 };
 
@@ -120,30 +215,33 @@ private:
 
 class StringNode : public C2GNode {
 public:
-    StringNode(std::string text, int line)
-        : C2GNode(NodeString, line), m_text(std::move(text)) { }
+    StringNode(const char* text, size_t length, int line)
+        : C2GNode(NodeString, line), m_text(text), m_length(length) { }
 
-    std::string text() const { return m_text; }
+    const char* text() const { return m_text; }
+    size_t length() const { return m_length; }
 
 private:
-    std::string m_text;
+    const char* m_text;
+    size_t m_length;
 };
 
 class LabelNode : public C2GNode {
 public:
-    LabelNode(std::string name, int line)
-        : C2GNode(NodeLabel, line), m_name(std::move(name)) { }
+    LabelNode(uint32_t atom, const char* name, int line)
+        : C2GNode(NodeLabel, line), m_atom(atom), m_name(name) { }
 
-    std::string name() const { return m_name; }
+    uint32_t atom() const { return m_atom; }
+    const char* name() const { return m_name; }
 
 private:
-    std::string m_name;
+    uint32_t m_atom;
+    const char* m_name;
 };
 
 class CommandNode : public C2GNode {
 public:
     CommandNode(int type, int line) : C2GNode(type, line), m_param() { }
-    ~CommandNode() override { delete m_param; }
 
     void setParam(C2GNode* param) { m_param = param; }
     C2GNode* param() const { return m_param; }
@@ -156,35 +254,54 @@ class ScriptNode : public C2GNode {
 public:
     explicit ScriptNode(int line) : C2GNode(NodeScript, line) { }
 
-    ~ScriptNode() override
-    {
-        for (auto line : m_lines)
-            delete line;
-    }
-
-    const std::list<C2GNode*>& lines() const { return m_lines; }
+    const std::vector<C2GNode*>& lines() const { return m_lines; }
     void addLine(C2GNode* line) { m_lines.push_back(line); }
 
 private:
-    std::list<C2GNode*> m_lines;
+    std::vector<C2GNode*> m_lines;
+};
+
+struct ScriptMapEntry {
+    int levelNum;
+    std::string filename;   // Absolute path, UTF-8 encoded
 };
 
 class GameScript {
 public:
-    GameScript() = default;
+    GameScript() : m_atoms(&m_arena) { }
 
-    ~GameScript()
-    {
-        for (auto node : m_nodes)
-            delete node;
-    }
+    GameScript(const GameScript&) = delete;
+    GameScript& operator=(const GameScript&) = delete;
 
     void read(const QString& filename);
 
-    const std::list<C2GNode *>& nodes() const { return m_nodes; }
+    // Parse script text, replacing any previously parsed script
+    void parse(const char* text, size_t length);
+
+    const std::vector<C2GNode*>& nodes() const { return m_nodes; }
+    const ScriptAtoms& atoms() const { return m_atoms; }
+
+    /* List the maps the script can reach, in the order they are first
+     * reached (see ExploreScript), resolving their paths relative to
+     * scriptFilename's directory.  Chained scripts are read and followed,
+     * and their maps are listed after this script's (see FollowChains).
+     * If gameName is provided, it receives the name set by the first
+     * reachable game command.  If complete is provided, it is set to false
+     * when the exploration ran out of steps, in which case the list may be
+     * missing maps.  If missingChains is provided, it receives the chained
+     * scripts that could not be read.
+     */
+    std::vector<ScriptMapEntry> mapList(const QString& scriptFilename,
+                                        std::string* gameName = nullptr,
+                                        bool* complete = nullptr,
+                                        std::vector<std::string>* missingChains = nullptr) const;
 
 private:
-    std::list<C2GNode *> m_nodes;
+    ScriptArena m_arena;
+    ScriptAtoms m_atoms;
+    std::vector<C2GNode*> m_nodes;
+
+    void parseLine(const char* line, int lineNo);
 };
 
 }
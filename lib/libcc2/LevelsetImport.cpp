@@ -0,0 +1,265 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "LevelsetImport.h"
+#include "Map.h"
+#include "libcc1/Levelset.h"
+#include "libcc1/Stream.h"
+#include "libcc1/Parallel.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstdio>
+
+static std::string formatWarning(const char* format, int count, int x, int y)
+{
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), format, count, x, y);
+    return buffer;
+}
+
+static bool haveTile(const ccl::LevelMap& map, int x, int y, tile_t tile)
+{
+    return map.getFG(x, y) == tile || map.getBG(x, y) == tile;
+}
+
+/* CC2 has no connection lists; each brown or red button is connected to
+ * the next trap or cloner in reading order, wrapping around the map.
+ */
+static bool implicitTarget(const ccl::LevelMap& map, int x, int y, tile_t target,
+                           ccl::Point* found)
+{
+    const int start = (y * CCL_WIDTH) + x;
+    for (int i = 1; i < CCL_WIDTH * CCL_HEIGHT; ++i) {
+        const int index = (start + i) % (CCL_WIDTH * CCL_HEIGHT);
+        if (haveTile(map, index % CCL_WIDTH, index / CCL_WIDTH, target)) {
+            *found = ccl::Point { index % CCL_WIDTH, index / CCL_WIDTH };
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool standardConnection(const ccl::LevelMap& map, int x, int y, tile_t target,
+                               const ccl::PointSpan& links)
+{
+    ccl::Point next;
+    if (!implicitTarget(map, x, y, target, &next))
+        return links.empty();
+    return links.size() == 1 && links.front() == next;
+}
+
+/* Counts a class of problem, keeping the first location so the warning can
+ * point at it without listing every tile.
+ */
+struct WarningCount {
+    int count;
+    int x, y;
+
+    WarningCount() : count(), x(), y() { }
+
+    void add(int tx, int ty)
+    {
+        if (count++ == 0) {
+            x = tx;
+            y = ty;
+        }
+    }
+
+    void report(std::vector<std::string>& warnings, const char* format) const
+    {
+        if (count)
+            warnings.push_back(formatWarning(format, count, x, y));
+    }
+};
+
+std::vector<std::string> cc2::ImportWarnings(const ccl::LevelData* level,
+                                             const MapData& mapData)
+{
+    const ccl::LevelMap& map = level->map();
+
+    WarningCount badUpper, badLower, lostLower, trapLinks, cloneLinks, unlisted;
+    int chipCount = 0;
+    for (int y = 0; y < CCL_HEIGHT; ++y) {
+        for (int x = 0; x < CCL_WIDTH; ++x) {
+            const Tile& tile = mapData.tile(x, y);
+            const Tile* lower = tile.lower();
+            if (tile.type() == Tile::Invalid)
+                badUpper.add(x, y);
+            else if (lower && lower->type() == Tile::Invalid)
+                badLower.add(x, y);
+            else if (!lower && map.getBG(x, y) != ccl::TileFloor)
+                lostLower.add(x, y);
+
+            if (haveTile(map, x, y, ccl::TileTrapButton)
+                    && !standardConnection(map, x, y, ccl::TileTrap, level->linkedTraps(x, y)))
+                trapLinks.add(x, y);
+            if (haveTile(map, x, y, ccl::TileCloneButton)
+                    && !standardConnection(map, x, y, ccl::TileCloner, level->linkedCloners(x, y)))
+                cloneLinks.add(x, y);
+            if (MONSTER_TILE(map.getFG(x, y)) && map.getBG(x, y) != ccl::TileCloner
+                    && !level->checkMove(x, y))
+                unlisted.add(x, y);
+
+            chipCount += (map.getFG(x, y) == ccl::TileChip) ? 1 : 0;
+            chipCount += (map.getBG(x, y) == ccl::TileChip) ? 1 : 0;
+        }
+    }
+
+    std::vector<std::string> warnings;
+    badUpper.report(warnings, "%d tiles have no CC2 equivalent and were replaced "
+                              "with floor, first at (%d, %d)");
+    badLower.report(warnings, "%d lower layer tiles have no CC2 equivalent and were "
+                              "replaced with floor, first at (%d, %d)");
+    lostLower.report(warnings, "%d lower layer tiles were discarded under terrain, "
+                               "first at (%d, %d)");
+    trapLinks.report(warnings, "%d trap buttons will connect to a different trap "
+                               "in CC2, first at (%d, %d)");
+    cloneLinks.report(warnings, "%d clone buttons will connect to a different "
+                                "cloner in CC2, first at (%d, %d)");
+    unlisted.report(warnings, "%d monsters are not in the monster list but will "
+                              "move in CC2, first at (%d, %d)");
+
+    const std::vector<ccl::Point>& moveList = level->moveList();
+    if (!std::is_sorted(moveList.begin(), moveList.end(),
+                        [](const ccl::Point& lhs, const ccl::Point& rhs) {
+                            return (lhs.Y * CCL_WIDTH + lhs.X) < (rhs.Y * CCL_WIDTH + rhs.X);
+                        }))
+        warnings.push_back("The custom monster order is not preserved");
+    if (level->chips() > chipCount) {
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer), "The level requires %d chips, but CC2 "
+                 "will only require the %d on the map", level->chips(), chipCount);
+        warnings.push_back(buffer);
+    }
+    return warnings;
+}
+
+int cc2::ReplaceInvalidTiles(MapData& mapData)
+{
+    int replaced = 0;
+    for (int y = 0; y < mapData.height(); ++y) {
+        for (int x = 0; x < mapData.width(); ++x) {
+            Tile& tile = mapData.tile(x, y);
+            Tile* lower = tile.lower();
+            if (tile.type() == Tile::Invalid) {
+                tile = Tile(Tile::Floor);
+                ++replaced;
+            } else if (lower && lower->type() == Tile::Invalid) {
+                *lower = Tile(Tile::Floor);
+                ++replaced;
+            }
+        }
+    }
+    return replaced;
+}
+
+std::vector<cc2::ImportResult> cc2::ImportLevelset(const ccl::Levelset* levelset,
+                                                   const QString& scriptFilename,
+                                                   const std::string& gameName,
+                                                   bool autoResize, unsigned int threads)
+{
+    const QFileInfo scriptInfo(scriptFilename);
+    const QDir scriptDir(scriptInfo.absolutePath());
+    const QString baseName = scriptInfo.completeBaseName();
+
+    std::vector<ImportResult> results;
+    results.resize((size_t)levelset->levelCount());
+
+    // Each level is independent, and the LevelData link index is only
+    // ever touched by the worker converting that level.
+    ccl::RunParallel(results.size(), threads, [&](unsigned int, size_t index) {
+        const ccl::LevelData* level = levelset->level((int)index);
+        ImportResult& result = results[index];
+        result.levelNum = (int)index + 1;
+        result.name = level->name();
+        result.filename = QStringLiteral("%1-%2.c2m").arg(baseName)
+                                .arg(result.levelNum, 3, 10, QLatin1Char('0'))
+                                .toStdString();
+
+        try {
+            // Convert once at full size, so the warnings can use CC1
+            // coordinates, and only then trim the edges
+            Map map;
+            map.importFrom(level, false);
+            result.warnings = ImportWarnings(level, map.mapData());
+            if (autoResize)
+                map.mapData().trimBlankEdges();
+            ReplaceInvalidTiles(map.mapData());
+
+            const QString filename = scriptDir.absoluteFilePath(
+                        QString::fromStdString(result.filename));
+            ccl::FileStream fs;
+            if (!fs.open(filename, ccl::FileStream::Write))
+                throw ccl::IOError(ccl::RuntimeError::tr("Could not open %1 for writing")
+                                   .arg(filename));
+            map.write(&fs);
+        } catch (const ccl::RuntimeError& err) {
+            result.error = err.message().toStdString();
+        }
+    });
+
+    // The script lists every level, even ones which failed to write, so a
+    // map fixed up by hand later doesn't shift the level numbers.
+    std::string title = gameName;
+    std::replace(title.begin(), title.end(), '"', '\'');
+    std::string script = "game \"" + title + "\"\n"
+                         "0 flags =\n"
+                         "0 score =\n"
+                         "0 hispeed =\n"
+                         "1 level =\n";
+    for (const ImportResult& result : results)
+        script += "map \"" + result.filename + "\"\n";
+
+    ccl::unique_FILE file = ccl::FileStream::Fopen(scriptFilename, ccl::FileStream::WriteText);
+    if (!file || fwrite(script.c_str(), 1, script.size(), file.get()) != script.size())
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not write %1").arg(scriptFilename));
+
+    return results;
+}
+
+std::string cc2::FormatImportReport(const std::vector<ImportResult>& results)
+{
+    std::string report;
+    char buffer[64];
+    int warningCount = 0, errorCount = 0;
+    for (const auto& result : results) {
+        if (result.warnings.empty() && result.error.empty())
+            continue;
+        snprintf(buffer, sizeof(buffer), "%4d  ", result.levelNum);
+        report += buffer + result.name + " (" + result.filename + ")\n";
+        if (!result.error.empty()) {
+            report += "      ERROR: " + result.error + "\n";
+            ++errorCount;
+        }
+        for (const std::string& warning : result.warnings) {
+            report += "      " + warning + "\n";
+            ++warningCount;
+        }
+    }
+
+    snprintf(buffer, sizeof(buffer), "\n%d levels imported, %d warnings",
+             (int)results.size() - errorCount, warningCount);
+    report += buffer;
+    if (errorCount) {
+        snprintf(buffer, sizeof(buffer), ", %d errors", errorCount);
+        report += buffer;
+    }
+    report += "\n";
+    return report;
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_LEVELSETIMPORT_H
+#define _CC2_LEVELSETIMPORT_H
+
+#include <string>
+#include <vector>
+
+class QString;
+namespace ccl { class Levelset; class LevelData; }
+
+namespace cc2 {
+
+class MapData;
+
+struct ImportResult {
+    int levelNum;
+    std::string name;
+    std::string filename;               // Map filename, relative to the script
+    std::vector<std::string> warnings;  // Features lost or changed by the import
+    std::string error;                  // Set if the map could not be written
+
+    ImportResult() : levelNum() { }
+};
+
+/* Check a CC1 level for features which CC2 maps can't represent, such as
+ * unsupported tiles, discarded lower layer tiles, non-standard button
+ * connections and the monster list.  mapData is the level as converted by
+ * MapData::importFrom(), without resizing or ReplaceInvalidTiles().
+ */
+std::vector<std::string> ImportWarnings(const ccl::LevelData* level,
+                                        const MapData& mapData);
+
+/* Replace tiles which have no CC2 equivalent with floor, so the map can be
+ * loaded by the game.  Returns the number of tiles replaced.
+ */
+int ReplaceInvalidTiles(MapData& mapData);
+
+/* Convert every level of a CC1 levelset into a .c2m map in the directory of
+ * scriptFilename, and write a C2G game script there which plays the maps in
+ * level order.  Levels are converted on a pool of worker threads.  Results
+ * are returned in level order.  Throws ccl::IOError if the script can't be
+ * written.
+ */
+std::vector<ImportResult> ImportLevelset(const ccl::Levelset* levelset,
+                                         const QString& scriptFilename,
+                                         const std::string& gameName,
+                                         bool autoResize, unsigned int threads = 0);
+
+// Produce a plain text report of the warnings and errors for each level
+std::string FormatImportReport(const std::vector<ImportResult>& results);
+
+}
+
+#endif
@@ -28,6 +28,19 @@ void cc2::MapOption::setReplayMD5(const uint8_t* md5)
     memcpy(m_replayMD5, md5, sizeof(m_replayMD5));
 }
 
+bool cc2::MapOption::operator==(const MapOption& other) const
+{
+    return m_view == other.m_view
+        && m_blobPattern == other.m_blobPattern
+        && m_timeLimit == other.m_timeLimit
+        && memcmp(m_replayMD5, other.m_replayMD5, sizeof(m_replayMD5)) == 0
+        && m_replayValid == other.m_replayValid
+        && m_hidden == other.m_hidden
+        && m_readOnly == other.m_readOnly
+        && m_hideLogic == other.m_hideLogic
+        && m_cc1Boots == other.m_cc1Boots;
+}
+
 #define KNOWN_OPTION_LENGTH 25
 
 void cc2::MapOption::read(ccl::Stream* stream, size_t size)
@@ -149,6 +162,18 @@ bool cc2::Tile::operator==(const Tile& other) const
     return true;
 }
 
+uint64_t cc2::Tile::hash() const
+{
+    uint64_t hash = 0;
+    for (const Tile* tp = this; tp; tp = tp->lower()) {
+        hash = ccl::HashCombine(hash, ((uint64_t)tp->m_modifier << 24)
+                                      | ((uint32_t)tp->m_tileFlags << 16)
+                                      | ((uint32_t)tp->m_direction << 8)
+                                      | tp->m_type);
+    }
+    return hash;
+}
+
 void cc2::Tile::read(ccl::Stream* stream)
 {
     m_type = stream->read8();
@@ -218,48 +243,63 @@ bool cc2::Tile::haveTile(Tile::Type type) const
     return false;
 }
 
-bool cc2::Tile::haveTile(const std::vector<Tile::Type>& types) const
+bool cc2::Tile::haveTile(const TypeSet& types) const
 {
     const cc2::Tile* stile = this;
     do {
-        for (Tile::Type type : types) {
-            if (stile->type() == type)
-                return true;
-        }
+        if (types.contains(stile->type()))
+            return true;
         stile = stile->lower();
     } while (stile);
 
     return false;
 }
 
-cc2::Tile::DrawLayer cc2::Tile::layer() const
+const cc2::Tile* cc2::Tile::findClass(unsigned int classMask) const
 {
-    if (m_type == Disallow)
-        return DisallowLayer;
-    if (!haveLower() || isInvalidClass())
-        return BaseLayer;
-    if (isItem())
-        return ItemLayer;
-    if (isCreature() || isPlayer() || isBlock())
-        return MobLayer;
-    if (isPanelCanopy())
-        return PanelCanopyLayer;
+    const cc2::Tile* stile = this;
+    do {
+        if (stile->haveClass(classMask))
+            return stile;
+        stile = stile->lower();
+    } while (stile);
 
-    return InvalidLayer;
+    return nullptr;
 }
 
-std::vector<const cc2::Tile*> cc2::Tile::sortedLayers() const
+cc2::Tile::LayerIterator::LayerIterator(const Tile* stack)
+    : m_stack(stack), m_tile(), m_layerMask()
 {
-    std::vector<const Tile*> sorted;
-    const Tile* tp = this;
-    while (tp) {
-        sorted.push_back(tp);
-        tp = tp->lower();
+    for (const Tile* tp = stack; tp; tp = tp->lower())
+        m_layerMask |= 1u << tp->layer();
+    seekLayer();
+}
+
+cc2::Tile::LayerIterator& cc2::Tile::LayerIterator::operator++()
+{
+    const DrawLayer layer = m_tile->layer();
+    for (m_tile = m_tile->lower(); m_tile; m_tile = m_tile->lower()) {
+        if (m_tile->layer() == layer)
+            return *this;
     }
-    std::stable_sort(sorted.begin(), sorted.end(), [](const Tile* t1, const Tile* t2) {
-        return t1->layer() < t2->layer();
-    });
-    return sorted;
+
+    m_layerMask &= ~(1u << layer);
+    seekLayer();
+    return *this;
+}
+
+void cc2::Tile::LayerIterator::seekLayer()
+{
+    m_tile = nullptr;
+    if (m_layerMask == 0)
+        return;
+
+    int layer = 0;
+    while ((m_layerMask & (1u << layer)) == 0)
+        ++layer;
+    m_tile = m_stack;
+    while (m_tile->layer() != layer)
+        m_tile = m_tile->lower();
 }
 
 cc2::Tile* cc2::Tile::topVisible()
@@ -274,286 +314,201 @@ cc2::Tile* cc2::Tile::topVisible()
     return top;
 }
 
-bool cc2::Tile::haveLower(int type)
+template <typename Def, size_t Count>
+static constexpr bool traitDefsInOrder(const Def (&defs)[Count])
 {
-    switch (type) {
-    case Player:
-    case DirtBlock:
-    case Walker:
-    case Ship:
-    case IceBlock:
-    case CC1_Barrier_E:
-    case CC1_Barrier_S:
-    case CC1_Barrier_SE:
-    case BlueTank:
-    case Key_Red:
-    case Key_Blue:
-    case Key_Yellow:
-    case Key_Green:
-    case Chip:
-    case ExtraChip:
-    case Ant:
-    case Centipede:
-    case Ball:
-    case Blob:
-    case AngryTeeth:
-    case FireBox:
-    case IceCleats:
-    case MagnoShoes:
-    case FireShoes:
-    case Flippers:
-    case RedBomb:
-    case TimeBonus:
-    case ToggleClock:
-    case TimeBomb:
-    case Helmet:
-    case UNUSED_53:
-    case Player2:
-    case TimidTeeth:
-    case UNUSED_Explosion:
-    case HikingBoots:
-    case UNUSED_5d:
-    case Lightning:
-    case YellowTank:
-    case MirrorPlayer:
-    case MirrorPlayer2:
-    case BowlingBall:
-    case Rover:
-    case TimePenalty:
-    case PanelCanopy:
-    case RRSign:
-    case UNUSED_79:
-    case Flag10:
-    case Flag100:
-    case Flag1000:
-    case Disallow:
-    case Flag2x:
-    case DirBlock:
-    case FloorMimic:
-    case GreenBomb:
-    case GreenChip:
-    case UNUSED_85:
-    case UNUSED_86:
-    case Ghost:
-    case SteelFoil:
-    case Eye:
-    case Bribe:
-    case SpeedShoes:
-    case Hook:
-        return true;
-    default:
-        return false;
-    }
-}
-
-bool cc2::Tile::haveDirection(int type)
-{
-    switch (type) {
-    case Player:
-    case DirtBlock:
-    case Walker:
-    case Ship:
-    case IceBlock:
-    case BlueTank:
-    case Ant:
-    case Centipede:
-    case Ball:
-    case Blob:
-    case AngryTeeth:
-    case FireBox:
-    case UNUSED_53:
-    case Player2:
-    case TimidTeeth:
-    case UNUSED_Explosion:
-    case UNUSED_5d:
-    case YellowTank:
-    case MirrorPlayer:
-    case MirrorPlayer2:
-    case Rover:
-    case UNUSED_79:
-    case DirBlock:
-    case FloorMimic:
-    case Ghost:
-        return true;
-    default:
-        return false;
+    for (size_t i = 0; i < Count; ++i) {
+        if (defs[i].type != i)
+            return false;
     }
+    return true;
 }
 
-bool cc2::Tile::supportsWires(int type)
+constexpr cc2::Tile::TraitTable cc2::Tile::buildTraitTable()
 {
-    switch (type) {
-    case Floor:
-    case Teleport_Red:
-    case Teleport_Blue:
-    case Transformer:
-    case SteelWall:
-    case LogicButton:
-    case RevLogicButton:
-    case Switch_Off:
-    case Switch_On:
-        return true;
-    default:
-        return false;
+    // One entry per tile type, in enum order.  The tile class is also used
+    // for the combine rules (see EditorWidget.cpp).
+    constexpr TraitDef defs[] = {
+        { Invalid,          ClassInvalid,     0 },
+        { Floor,            ClassTerrain,     TraitWires },
+        { Wall,             ClassOther,       0 },
+        { Ice,              ClassTerrain,     0 },
+        { Ice_NE,           ClassTerrain,     0 },
+        { Ice_SE,           ClassTerrain,     0 },
+        { Ice_SW,           ClassTerrain,     0 },
+        { Ice_NW,           ClassTerrain,     0 },
+        { Water,            ClassTerrain,     0 },
+        { Fire,             ClassTerrain,     0 },
+        { Force_N,          ClassTerrain,     0 },
+        { Force_E,          ClassTerrain,     0 },
+        { Force_S,          ClassTerrain,     0 },
+        { Force_W,          ClassTerrain,     0 },
+        { ToggleWall,       ClassTerrain,     0 },
+        { ToggleFloor,      ClassTerrain,     0 },
+        { Teleport_Red,     ClassOther,       TraitWires },
+        { Teleport_Blue,    ClassOther,       TraitWires },
+        { Teleport_Yellow,  ClassOther,       0 },
+        { Teleport_Green,   ClassOther,       0 },
+        { Exit,             ClassOther,       0 },
+        { Slime,            ClassTerrain,     0 },
+        { Player,           ClassPlayer,      TraitLower | TraitDirection },
+        { DirtBlock,        ClassBlock,       TraitLower | TraitDirection | TraitClonerArrows },
+        { Walker,           ClassCreature,    TraitLower | TraitDirection },
+        { Ship,             ClassCreature,    TraitLower | TraitDirection },
+        { IceBlock,         ClassBlock,       TraitLower | TraitDirection | TraitClonerArrows },
+        { CC1_Barrier_S,    ClassPanelCanopy, TraitLower },
+        { CC1_Barrier_E,    ClassPanelCanopy, TraitLower },
+        { CC1_Barrier_SE,   ClassPanelCanopy, TraitLower },
+        { Gravel,           ClassTerrain,     0 },
+        { ToggleButton,     ClassTerrain,     0 },
+        { TankButton,       ClassTerrain,     0 },
+        { BlueTank,         ClassCreature,    TraitLower | TraitDirection },
+        { Door_Red,         ClassOther,       0 },
+        { Door_Blue,        ClassOther,       0 },
+        { Door_Yellow,      ClassOther,       0 },
+        { Door_Green,       ClassOther,       0 },
+        { Key_Red,          ClassItem,        TraitLower },
+        { Key_Blue,         ClassItem,        TraitLower },
+        { Key_Yellow,       ClassItem,        TraitLower },
+        { Key_Green,        ClassItem,        TraitLower },
+        { Chip,             ClassItem,        TraitLower },
+        { ExtraChip,        ClassItem,        TraitLower },
+        { Socket,           ClassOther,       0 },
+        { PopUpWall,        ClassTerrain,     0 },
+        { AppearingWall,    ClassTerrain,     0 },
+        { InvisWall,        ClassTerrain,     0 },
+        { BlueWall,         ClassTerrain,     0 },
+        { BlueFloor,        ClassTerrain,     0 },
+        { Dirt,             ClassTerrain,     0 },
+        { Ant,              ClassCreature,    TraitLower | TraitDirection },
+        { Centipede,        ClassCreature,    TraitLower | TraitDirection },
+        { Ball,             ClassCreature,    TraitLower | TraitDirection },
+        { Blob,             ClassCreature,    TraitLower | TraitDirection },
+        { AngryTeeth,       ClassCreature,    TraitLower | TraitDirection },
+        { FireBox,          ClassCreature,    TraitLower | TraitDirection },
+        { CloneButton,      ClassTerrain,     0 },
+        { TrapButton,       ClassTerrain,     0 },
+        { IceCleats,        ClassItem,        TraitLower },
+        { MagnoShoes,       ClassItem,        TraitLower },
+        { FireShoes,        ClassItem,        TraitLower },
+        { Flippers,         ClassItem,        TraitLower },
+        { ToolThief,        ClassTerrain,     0 },
+        { RedBomb,          ClassItem,        TraitLower },
+        { Trap_Open,        ClassInvalid,     0 },
+        { Trap,             ClassTerrain,     0 },
+        { CC1_Cloner,       ClassOther,       0 },
+        { Cloner,           ClassOther,       0 },
+        { Clue,             ClassTerrain,     0 },
+        { Force_Rand,       ClassTerrain,     0 },
+        { AreaCtlButton,    ClassTerrain,     0 },
+        { RevolvDoor_SW,    ClassTerrain,     0 },
+        { RevolvDoor_NW,    ClassTerrain,     0 },
+        { RevolvDoor_NE,    ClassTerrain,     0 },
+        { RevolvDoor_SE,    ClassTerrain,     0 },
+        { TimeBonus,        ClassItem,        TraitLower },
+        { ToggleClock,      ClassItem,        TraitLower },
+        { Transformer,      ClassTerrain,     TraitWires },
+        { TrainTracks,      ClassTerrain,     0 },
+        { SteelWall,        ClassOther,       TraitWires },
+        { TimeBomb,         ClassItem,        TraitLower },
+        { Helmet,           ClassItem,        TraitLower },
+        { UNUSED_53,        ClassInvalid,     TraitLower | TraitDirection },
+        { UNUSED_54,        ClassInvalid,     0 },
+        { UNUSED_55,        ClassInvalid,     0 },
+        { Player2,          ClassPlayer,      TraitLower | TraitDirection },
+        { TimidTeeth,       ClassCreature,    TraitLower | TraitDirection },
+        { UNUSED_Explosion, ClassInvalid,     TraitLower | TraitDirection },
+        { HikingBoots,      ClassItem,        TraitLower },
+        { MaleOnly,         ClassTerrain,     0 },
+        { FemaleOnly,       ClassTerrain,     0 },
+        { LogicGate,        ClassTerrain,     0 },
+        { UNUSED_5d,        ClassInvalid,     TraitLower | TraitDirection },
+        { LogicButton,      ClassTerrain,     TraitWires },
+        { FlameJet_Off,     ClassTerrain,     0 },
+        { FlameJet_On,      ClassTerrain,     0 },
+        { FlameJetButton,   ClassTerrain,     0 },
+        { Lightning,        ClassItem,        TraitLower },
+        { YellowTank,       ClassCreature,    TraitLower | TraitDirection },
+        { YellowTankCtrl,   ClassTerrain,     0 },
+        { MirrorPlayer,     ClassCreature,    TraitLower | TraitDirection },
+        { MirrorPlayer2,    ClassCreature,    TraitLower | TraitDirection },
+        { UNUSED_67,        ClassInvalid,     0 },
+        { BowlingBall,      ClassItem,        TraitLower },
+        { Rover,            ClassCreature,    TraitLower | TraitDirection },
+        { TimePenalty,      ClassItem,        TraitLower },
+        { StyledFloor,      ClassTerrain,     0 },
+        { UNUSED_6c,        ClassInvalid,     0 },
+        { PanelCanopy,      ClassPanelCanopy, TraitLower },
+        { UNUSED_6e,        ClassInvalid,     0 },
+        { RRSign,           ClassItem,        TraitLower },
+        { StyledWall,       ClassOther,       0 },
+        { AsciiGlyph,       ClassTerrain,     0 },
+        { LSwitchFloor,     ClassTerrain,     0 },
+        { LSwitchWall,      ClassTerrain,     0 },
+        { UNUSED_74,        ClassInvalid,     0 },
+        { UNUSED_75,        ClassInvalid,     0 },
+        { Modifier8,        ClassInvalid,     0 },
+        { Modifier16,       ClassInvalid,     0 },
+        { Modifier32,       ClassInvalid,     0 },
+        { UNUSED_79,        ClassInvalid,     TraitLower | TraitDirection },
+        { Flag10,           ClassItem,        TraitLower },
+        { Flag100,          ClassItem,        TraitLower },
+        { Flag1000,         ClassItem,        TraitLower },
+        { StayUpGWall,      ClassTerrain,     0 },
+        { PopDownGWall,     ClassTerrain,     0 },
+        { Disallow,         ClassOther,       TraitLower },
+        { Flag2x,           ClassItem,        TraitLower },
+        { DirBlock,         ClassBlock,       TraitLower | TraitDirection | TraitClonerArrows },
+        { FloorMimic,       ClassCreature,    TraitLower | TraitDirection },
+        { GreenBomb,        ClassItem,        TraitLower },
+        { GreenChip,        ClassItem,        TraitLower },
+        { UNUSED_85,        ClassInvalid,     TraitLower },
+        { UNUSED_86,        ClassInvalid,     TraitLower },
+        { RevLogicButton,   ClassTerrain,     TraitWires },
+        { Switch_Off,       ClassTerrain,     TraitWires },
+        { Switch_On,        ClassTerrain,     TraitWires },
+        { KeyThief,         ClassTerrain,     0 },
+        { Ghost,            ClassCreature,    TraitLower | TraitDirection },
+        { SteelFoil,        ClassItem,        TraitLower },
+        { Turtle,           ClassTerrain,     0 },
+        { Eye,              ClassItem,        TraitLower },
+        { Bribe,            ClassItem,        TraitLower },
+        { SpeedShoes,       ClassItem,        TraitLower },
+        { UNUSED_91,        ClassInvalid,     0 },
+        { Hook,             ClassItem,        TraitLower },
+    };
+    static_assert(sizeof(defs) / sizeof(defs[0]) == NUM_TILE_TYPES,
+                  "Tile trait list does not cover every tile type");
+    static_assert(traitDefsInOrder(defs), "Tile trait list is out of order");
+
+    TraitTable table { };
+    for (size_t i = 0; i < NUM_TILE_TYPES; ++i) {
+        const TraitDef& def = defs[i];
+        DrawLayer layer = InvalidLayer;
+        if (def.type == Disallow)
+            layer = DisallowLayer;
+        else if (!(def.flags & TraitLower) || def.tileClass == ClassInvalid)
+            layer = BaseLayer;
+        else if (def.tileClass == ClassItem)
+            layer = ItemLayer;
+        else if (def.tileClass & (ClassCreature | ClassPlayer | ClassBlock))
+            layer = MobLayer;
+        else if (def.tileClass == ClassPanelCanopy)
+            layer = PanelCanopyLayer;
+        table.bits[i] = def.tileClass | def.flags | (layer << TraitLayerShift);
     }
+    return table;
 }
 
-cc2::Tile::TileClass cc2::Tile::tileClass(int type)
-{
-    // Classification for combine rules (see EditorWidget.cpp)
-
-    switch (type) {
-    case Key_Red:
-    case Key_Blue:
-    case Key_Yellow:
-    case Key_Green:
-    case Chip:
-    case ExtraChip:
-    case IceCleats:
-    case MagnoShoes:
-    case FireShoes:
-    case Flippers:
-    case RedBomb:
-    case TimeBonus:
-    case ToggleClock:
-    case TimeBomb:
-    case Helmet:
-    case HikingBoots:
-    case Lightning:
-    case BowlingBall:
-    case TimePenalty:
-    case RRSign:
-    case Flag10:
-    case Flag100:
-    case Flag1000:
-    case Flag2x:
-    case GreenBomb:
-    case GreenChip:
-    case SteelFoil:
-    case Eye:
-    case Bribe:
-    case SpeedShoes:
-    case Hook:
-        return ClassItem;
-    case Walker:
-    case Ship:
-    case BlueTank:
-    case Ant:
-    case Centipede:
-    case Ball:
-    case Blob:
-    case AngryTeeth:
-    case FireBox:
-    case TimidTeeth:
-    case YellowTank:
-    case MirrorPlayer:
-    case MirrorPlayer2:
-    case Rover:
-    case FloorMimic:
-    case Ghost:
-        return ClassCreature;
-    case Player:
-    case Player2:
-        return ClassPlayer;
-    case DirtBlock:
-    case IceBlock:
-    case DirBlock:
-        return ClassBlock;
-    case Floor:
-    case Ice:
-    case Ice_NE:
-    case Ice_SE:
-    case Ice_SW:
-    case Ice_NW:
-    case Water:
-    case Fire:
-    case Force_N:
-    case Force_E:
-    case Force_S:
-    case Force_W:
-    case ToggleWall:
-    case ToggleFloor:
-    case Slime:
-    case Gravel:
-    case ToggleButton:
-    case TankButton:
-    case PopUpWall:
-    case AppearingWall:
-    case InvisWall:
-    case BlueWall:
-    case BlueFloor:
-    case Dirt:
-    case CloneButton:
-    case TrapButton:
-    case ToolThief:
-    case Trap:
-    case Clue:
-    case Force_Rand:
-    case AreaCtlButton:
-    case RevolvDoor_SW:
-    case RevolvDoor_NW:
-    case RevolvDoor_NE:
-    case RevolvDoor_SE:
-    case Transformer:
-    case TrainTracks:
-    case MaleOnly:
-    case FemaleOnly:
-    case LogicGate:
-    case LogicButton:
-    case FlameJet_Off:
-    case FlameJet_On:
-    case FlameJetButton:
-    case YellowTankCtrl:
-    case StyledFloor:
-    case AsciiGlyph:
-    case LSwitchFloor:
-    case LSwitchWall:
-    case StayUpGWall:
-    case PopDownGWall:
-    case RevLogicButton:
-    case Switch_Off:
-    case Switch_On:
-    case KeyThief:
-    case Turtle:
-        return ClassTerrain;
-    case CC1_Barrier_S:
-    case CC1_Barrier_E:
-    case CC1_Barrier_SE:
-    case PanelCanopy:
-        return ClassPanelCanopy;
-    case Wall:
-    case Teleport_Red:
-    case Teleport_Blue:
-    case Teleport_Yellow:
-    case Teleport_Green:
-    case Exit:
-    case Door_Red:
-    case Door_Blue:
-    case Door_Yellow:
-    case Door_Green:
-    case Socket:
-    case CC1_Cloner:
-    case Cloner:
-    case SteelWall:
-    case StyledWall:
-    case Disallow:
-        return ClassOther;
-    default:
-        return ClassInvalid;
-    }
-}
+const cc2::Tile::TraitTable cc2::Tile::s_traits = cc2::Tile::buildTraitTable();
 
 bool cc2::Tile::needArrows() const
 {
-    switch (m_type) {
-    case DirtBlock:
-    case IceBlock:
-    case DirBlock:
+    if (traits(m_type) & TraitClonerArrows) {
         return (m_lower->type() == CC1_Cloner)
             || (m_lower->type() == Cloner);
-    default:
-        return haveDirection();
     }
+    return haveDirection();
 }
 
 static constexpr uint8_t rol4(uint8_t bits)
@@ -769,8 +724,15 @@ cc2::Tile* cc2::Tile::checkLower()
 
 
 cc2::MapData::MapData(const MapData& other)
-    : m_width(other.m_width), m_height(other.m_height), m_map()
+    : m_width(other.m_width), m_height(other.m_height), m_map(), m_hash()
 {
+    std::lock_guard<std::mutex> guard(other.m_cacheLock);
+    m_cellHash = other.m_cellHash;
+    m_cellTotals = other.m_cellTotals;
+    m_cellDirty = other.m_cellDirty;
+    m_dirtyCells = other.m_dirtyCells;
+    m_hash = other.m_hash;
+    m_totals = other.m_totals;
     if (other.m_map) {
         const size_t mapSize = m_width * m_height;
         m_map = new Tile[mapSize];
@@ -781,6 +743,10 @@ cc2::MapData::MapData(const MapData& other)
 
 cc2::MapData& cc2::MapData::operator=(const MapData& other)
 {
+    if (this == &other)
+        return *this;
+
+    std::lock_guard<std::mutex> guard(other.m_cacheLock);
     delete[] m_map;
     m_width = other.m_width;
     m_height = other.m_height;
@@ -792,6 +758,12 @@ cc2::MapData& cc2::MapData::operator=(const MapData& other)
     } else {
         m_map = nullptr;
     }
+    m_cellHash = other.m_cellHash;
+    m_cellTotals = other.m_cellTotals;
+    m_cellDirty = other.m_cellDirty;
+    m_dirtyCells = other.m_dirtyCells;
+    m_hash = other.m_hash;
+    m_totals = other.m_totals;
     return *this;
 }
 
@@ -1042,70 +1014,74 @@ void cc2::MapData::importFrom(const ccl::LevelData* level, bool autoResize)
         }
     }
 
-    if (autoResize) {
-        const Tile blankTile;
-        int blankRows = 0;
-        for (int y = 0; y < m_height; ++y, ++blankRows) {
-            bool rowEmpty = true;
-            for (int x = 0; rowEmpty && x < m_width; ++x) {
-                if (tile(x, y) != blankTile)
-                    rowEmpty = false;
-            }
-            if (!rowEmpty)
-                break;
+    if (autoResize)
+        trimBlankEdges();
+}
+
+void cc2::MapData::trimBlankEdges()
+{
+    const Tile blankTile;
+    int blankRows = 0;
+    for (int y = 0; y < m_height; ++y, ++blankRows) {
+        bool rowEmpty = true;
+        for (int x = 0; rowEmpty && x < m_width; ++x) {
+            if (tile(x, y) != blankTile)
+                rowEmpty = false;
         }
-        if (blankRows) {
-            // Move tiles up blankCount rows
-            for (int y = 0; y < m_height - blankRows; ++y) {
-                for (int x = 0; x < m_width; ++x)
-                    tile(x, y) = tile(x, y + blankRows);
-            }
-            resize(m_width, m_height - blankRows);
+        if (!rowEmpty)
+            break;
+    }
+    if (blankRows) {
+        // Move tiles up blankCount rows
+        for (int y = 0; y < m_height - blankRows; ++y) {
+            for (int x = 0; x < m_width; ++x)
+                tile(x, y) = tile(x, y + blankRows);
         }
+        resize(m_width, m_height - blankRows);
+    }
 
-        int blankCols = 0;
-        for (int x = 0; x < m_width; ++x, ++blankCols) {
-            bool colEmpty = true;
-            for (int y = 0; colEmpty && y < m_height; ++y) {
-                if (tile(x, y) != blankTile)
-                    colEmpty = false;
-            }
-            if (!colEmpty)
-                break;
+    int blankCols = 0;
+    for (int x = 0; x < m_width; ++x, ++blankCols) {
+        bool colEmpty = true;
+        for (int y = 0; colEmpty && y < m_height; ++y) {
+            if (tile(x, y) != blankTile)
+                colEmpty = false;
         }
-        if (blankCols) {
-            // Move tiles left blankCount columns
-            for (int x = 0; x < m_width - blankCols; ++x) {
-                for (int y = 0; y < m_height; ++y)
-                    tile(x, y) = tile(x + blankCols, y);
-            }
-            resize(m_width - blankCols, m_height);
+        if (!colEmpty)
+            break;
+    }
+    if (blankCols) {
+        // Move tiles left blankCount columns
+        for (int x = 0; x < m_width - blankCols; ++x) {
+            for (int y = 0; y < m_height; ++y)
+                tile(x, y) = tile(x + blankCols, y);
         }
+        resize(m_width - blankCols, m_height);
+    }
 
-        blankRows = 0;
-        blankCols = 0;
-        for (int y = m_height - 1; y > 0; --y, ++blankRows) {
-            bool rowEmpty = true;
-            for (int x = 0; rowEmpty && x < m_width; ++x) {
-                if (tile(x, y) != blankTile)
-                    rowEmpty = false;
-            }
-            if (!rowEmpty)
-                break;
+    blankRows = 0;
+    blankCols = 0;
+    for (int y = m_height - 1; y > 0; --y, ++blankRows) {
+        bool rowEmpty = true;
+        for (int x = 0; rowEmpty && x < m_width; ++x) {
+            if (tile(x, y) != blankTile)
+                rowEmpty = false;
         }
-        for (int x = m_width - 1; x > 0; --x, ++blankCols) {
-            bool colEmpty = true;
-            for (int y = 0; colEmpty && y < m_height; ++y) {
-                if (tile(x, y) != blankTile)
-                    colEmpty = false;
-            }
-            if (!colEmpty)
-                break;
+        if (!rowEmpty)
+            break;
+    }
+    for (int x = m_width - 1; x > 0; --x, ++blankCols) {
+        bool colEmpty = true;
+        for (int y = 0; colEmpty && y < m_height; ++y) {
+            if (tile(x, y) != blankTile)
+                colEmpty = false;
         }
-        // Ensure 10x10 minimum size even with blank area removal
-        resize(std::max(10, m_width - blankCols),
-               std::max(10, m_height - blankRows));
+        if (!colEmpty)
+            break;
     }
+    // Ensure 10x10 minimum size even with blank area removal
+    resize(std::max(10, m_width - blankCols),
+           std::max(10, m_height - blankRows));
 }
 
 void cc2::MapData::read(ccl::Stream* stream, size_t size)
@@ -1113,6 +1089,7 @@ void cc2::MapData::read(ccl::Stream* stream, size_t size)
     long start = stream->tell();
 
     delete[] m_map;
+    invalidateHash();
     m_width = stream->read8();
     m_height = stream->read8();
     const size_t mapSize = m_width * m_height;
@@ -1134,6 +1111,7 @@ void cc2::MapData::write(ccl::Stream* stream) const
 
 void cc2::MapData::resize(uint8_t width, uint8_t height)
 {
+    invalidateHash();
     if (width == 0 || height == 0) {
         delete[] m_map;
         m_map = nullptr;
@@ -1158,79 +1136,147 @@ void cc2::MapData::resize(uint8_t width, uint8_t height)
     m_height = height;
 }
 
-static std::tuple<int, int> tileChips(const cc2::Tile* tile)
+static uint64_t cellKey(int index, uint64_t stackHash)
 {
-    const cc2::Tile* lower = tile->lower();
-    auto chips = lower ? tileChips(lower) : std::make_tuple(0, 0);
+    return ccl::HashMix64(stackHash + ((uint64_t)index << 32) + 0x9E3779B97F4A7C15ULL);
+}
 
-    switch (tile->type()) {
-    case cc2::Tile::Chip:
-    case cc2::Tile::GreenChip:
-    case cc2::Tile::GreenBomb:
-        std::get<0>(chips) += 1;
-        /* fall through */
-    case cc2::Tile::ExtraChip:
-        std::get<1>(chips) += 1;
-        break;
-    default:
-        break;
+static cc2::MapTotals cellTotals(const cc2::Tile* tile)
+{
+    cc2::MapTotals totals;
+    for ( ; tile; tile = tile->lower()) {
+        switch (tile->type()) {
+        case cc2::Tile::Chip:
+        case cc2::Tile::GreenChip:
+        case cc2::Tile::GreenBomb:
+            totals.chips += 1;
+            break;
+        case cc2::Tile::ExtraChip:
+            totals.extraChips += 1;
+            break;
+        case cc2::Tile::Flag10:
+            totals.points += 10;
+            break;
+        case cc2::Tile::Flag100:
+            totals.points += 100;
+            break;
+        case cc2::Tile::Flag1000:
+            totals.points += 1000;
+            break;
+        case cc2::Tile::Flag2x:
+            totals.multipliers += 1;
+            break;
+        default:
+            break;
+        }
     }
-
-    return chips;
+    return totals;
 }
 
-std::tuple<int, int> cc2::MapData::countChips() const
+void cc2::MapData::updateCellCache() const
 {
-    auto chips = std::make_tuple(0, 0);
-    const Tile* mapEnd = m_map + (m_width * m_height);
-    for (const Tile* tp = m_map; tp != mapEnd; ++tp) {
-        const std::tuple<int, int> tc = tileChips(tp);
-        std::get<0>(chips) += std::get<0>(tc);
-        std::get<1>(chips) += std::get<1>(tc);
+    if (m_cellHash.empty()) {
+        rebuildCellCache();
+        return;
+    }
+
+    // Open cells stay listed, since the caller may still write through
+    // a Tile reference it got from them
+    for (int index : m_dirtyCells) {
+        const uint64_t stackHash = m_map[index].hash();
+        if (stackHash == m_cellHash[index])
+            continue;
+        m_hash ^= cellKey(index, m_cellHash[index]) ^ cellKey(index, stackHash);
+        m_cellHash[index] = stackHash;
+
+        const MapTotals counts = cellTotals(&m_map[index]);
+        m_totals -= m_cellTotals[index];
+        m_totals += counts;
+        m_cellTotals[index] = counts;
     }
-    return chips;
 }
 
-static std::tuple<int, int> tilePoints(const cc2::Tile* tile)
+void cc2::MapData::settleCells()
 {
-    const cc2::Tile* lower = tile->lower();
-    auto points = lower ? tilePoints(lower) : std::make_tuple(0, 0);
+    std::lock_guard<std::mutex> guard(m_cacheLock);
+    updateCellCache();
+    for (int index : m_dirtyCells)
+        m_cellDirty[index] = 0;
+    m_dirtyCells.clear();
+}
 
-    switch (tile->type()) {
-    case cc2::Tile::Flag10:
-        std::get<0>(points) += 10;
-        break;
-    case cc2::Tile::Flag100:
-        std::get<0>(points) += 100;
-        break;
-    case cc2::Tile::Flag1000:
-        std::get<0>(points) += 1000;
-        break;
-    case cc2::Tile::Flag2x:
-        std::get<1>(points) += 1;
-        break;
-    default:
-        break;
-    }
+uint64_t cc2::MapData::hash() const
+{
+    std::lock_guard<std::mutex> guard(m_cacheLock);
+    updateCellCache();
+    return ccl::HashCombine(m_hash, ((uint32_t)m_width << 8) | m_height);
+}
 
-    return points;
+uint64_t cc2::MapData::recomputeHash() const
+{
+    std::lock_guard<std::mutex> guard(m_cacheLock);
+    rebuildCellCache();
+    return ccl::HashCombine(m_hash, ((uint32_t)m_width << 8) | m_height);
 }
 
-std::tuple<int, int> cc2::MapData::countPoints() const
+void cc2::MapData::rebuildCellCache() const
 {
-    // Raw points and multiplier
-    auto points = std::make_tuple(0, 0);
-    const Tile* mapEnd = m_map + (m_width * m_height);
-    for (const Tile* tp = m_map; tp != mapEnd; ++tp) {
-        auto p = tilePoints(tp);
-        std::get<0>(points) += std::get<0>(p);
-        std::get<1>(points) += std::get<1>(p);
+    const size_t mapSize = m_width * m_height;
+    m_cellHash.resize(mapSize);
+    m_cellTotals.resize(mapSize);
+    m_hash = 0;
+    m_totals = MapTotals();
+    for (size_t i = 0; i < mapSize; ++i) {
+        m_cellHash[i] = m_map[i].hash();
+        m_hash ^= cellKey((int)i, m_cellHash[i]);
+        m_cellTotals[i] = cellTotals(&m_map[i]);
+        m_totals += m_cellTotals[i];
     }
-    return points;
 }
 
+std::vector<uint64_t> cc2::MapData::cellHashes() const
+{
+    std::lock_guard<std::mutex> guard(m_cacheLock);
+    updateCellCache();
+    return m_cellHash;
+}
+
+cc2::MapTotals cc2::MapData::totals() const
+{
+    std::lock_guard<std::mutex> guard(m_cacheLock);
+    updateCellCache();
+    return m_totals;
+}
+
+bool cc2::MapData::verifyTotals() const
+{
+    MapTotals counted;
+    for (size_t i = 0; i < (size_t)(m_width * m_height); ++i)
+        counted += cellTotals(&m_map[i]);
+    return counted == totals();
+}
+
+std::tuple<int, int> cc2::MapData::countChips() const
+{
+    Q_ASSERT(verifyTotals());
+    const MapTotals counts = totals();
+    return std::make_tuple(counts.chips, counts.chips + counts.extraChips);
+}
+
+std::tuple<int, int> cc2::MapData::countPoints() const
+{
+    Q_ASSERT(verifyTotals());
+    const MapTotals counts = totals();
+    return std::make_tuple(counts.points, counts.multipliers);
+}
 
 void cc2::Map::copyFrom(const cc2::Map* map)
+{
+    copyMetadataFrom(map);
+    m_mapData = map->m_mapData;
+}
+
+void cc2::Map::copyMetadataFrom(const cc2::Map* map)
 {
     m_version = map->m_version;
     m_lock = map->m_lock;
@@ -1239,14 +1285,58 @@ void cc2::Map::copyFrom(const cc2::Map* map)
     m_editorVersion = map->m_editorVersion;
     m_clue = map->m_clue;
     m_note = map->m_note;
+    m_clues.noteValid = false;
     m_option = map->m_option;
-    m_mapData = map->m_mapData;
     memcpy(m_key, map->m_key, sizeof(m_key));
     m_replay = map->m_replay;
     m_readOnly = map->m_readOnly;
     m_unknown = map->m_unknown;
 }
 
+bool cc2::Map::metadataEquals(const cc2::Map* map) const
+{
+    if (m_version != map->m_version || m_lock != map->m_lock
+            || m_title != map->m_title || m_author != map->m_author
+            || m_editorVersion != map->m_editorVersion
+            || m_clue != map->m_clue || m_note != map->m_note
+            || m_option != map->m_option
+            || memcmp(m_key, map->m_key, sizeof(m_key)) != 0
+            || m_replay != map->m_replay || m_readOnly != map->m_readOnly
+            || m_unknown.size() != map->m_unknown.size())
+        return false;
+
+    for (size_t i = 0; i < m_unknown.size(); ++i) {
+        if (memcmp(m_unknown[i].tag, map->m_unknown[i].tag, sizeof(m_unknown[i].tag)) != 0
+                || m_unknown[i].data != map->m_unknown[i].data)
+            return false;
+    }
+    return true;
+}
+
+uint64_t cc2::Map::contentHash() const
+{
+    uint64_t hash = m_mapData.hash();
+    hash = ccl::HashCombine(hash, ccl::HashString(m_version));
+    hash = ccl::HashCombine(hash, ccl::HashString(m_lock));
+    hash = ccl::HashCombine(hash, ccl::HashString(m_title));
+    hash = ccl::HashCombine(hash, ccl::HashString(m_author));
+    hash = ccl::HashCombine(hash, ccl::HashString(m_editorVersion));
+    hash = ccl::HashCombine(hash, ccl::HashString(m_clue));
+    hash = ccl::HashCombine(hash, ccl::HashString(m_note));
+    hash = ccl::HashCombine(hash, ccl::HashBytes(m_replay.data(), m_replay.size()));
+    hash = ccl::HashCombine(hash, ccl::HashBytes(m_option.replayMD5(), 16));
+    hash = ccl::HashCombine(hash, ((uint64_t)m_option.timeLimit() << 32)
+                                  | ((uint32_t)m_option.view() << 16)
+                                  | ((uint32_t)m_option.blobPattern() << 8)
+                                  | (m_option.replayValid() ? 0x01 : 0)
+                                  | (m_option.hidden() ? 0x02 : 0)
+                                  | (m_option.readOnly() ? 0x04 : 0)
+                                  | (m_option.hideLogic() ? 0x08 : 0)
+                                  | (m_option.cc1Boots() ? 0x10 : 0)
+                                  | (m_readOnly ? 0x20 : 0));
+    return hash;
+}
+
 void cc2::Map::importFrom(const ccl::LevelData* level, bool autoResize)
 {
     m_version = "7";
@@ -1256,6 +1346,7 @@ void cc2::Map::importFrom(const ccl::LevelData* level, bool autoResize)
     m_editorVersion = std::string();
     m_clue = level->hint();     // TODO: Apply word wrap
     m_note = "Imported by CCTools 3.0";
+    m_clues.noteValid = false;
     m_option.setView(MapOption::View9x9);
     m_option.setBlobPattern(MapOption::BlobsDeterministic);
     m_option.setTimeLimit(level->timer());
@@ -1333,6 +1424,7 @@ void cc2::Map::read(ccl::Stream* stream)
             m_clue = toGenericLF(stream->readString(size));
         } else if (memcmp(tag, "NOTE", 4) == 0) {
             m_note = toGenericLF(stream->readString(size));
+            m_clues.noteValid = false;
         } else if (memcmp(tag, "OPTN", 4) == 0) {
             m_option.read(stream, size);
         } else if (memcmp(tag, "MAP ", 4) == 0) {
@@ -1460,39 +1552,67 @@ void cc2::Map::write(ccl::Stream* stream) const
     writeTaggedBlock<0>(stream, "END ");
 }
 
-std::string cc2::Map::clueForTile(int x, int y) const
+const cc2::Map::ClueIndex& cc2::Map::clueIndex() const
 {
-    if (m_mapData.tile(x, y).bottom().type() != Tile::Clue)
-        return std::string();
-
-    size_t start = 0;
-    for (int sy = 0; sy < m_mapData.height(); ++sy) {
-        for (int sx = 0; sx < m_mapData.width(); ++sx) {
-            if (m_mapData.tile(sx, sy).bottom().type() != Tile::Clue)
-                continue;
+    const uint64_t mapHash = m_mapData.hash();
+    if (!m_clues.cellsValid || m_clues.mapHash != mapHash) {
+        m_clues.cells.clear();
+        for (int sy = 0; sy < m_mapData.height(); ++sy) {
+            for (int sx = 0; sx < m_mapData.width(); ++sx) {
+                if (m_mapData.tile(sx, sy).bottom().type() == Tile::Clue)
+                    m_clues.cells.push_back((sy * m_mapData.width()) + sx);
+            }
+        }
+        m_clues.mapHash = mapHash;
+        m_clues.cellsValid = true;
+    }
 
-            // Scan the NOTE for the next [CLUE] tag
-            start = m_note.find("[CLUE]", start);
-            if (start == std::string::npos)
-                return m_clue;
+    if (!m_clues.noteValid) {
+        m_clues.tags.clear();
+        m_clues.text.clear();
+        size_t start = 0;
+        for ( ;; ) {
+            const size_t tag = m_note.find("[CLUE]", start);
+            if (tag == std::string::npos)
+                break;
 
             // Find the newline...  CC2 discards anything else on the same
             // line as the [CLUE] tag.
-            start = m_note.find('\n', start);
-            if (start == std::string::npos)
-                return m_clue;
-            ++start;
-
-            if (sx == x && sy == y) {
-                size_t next = m_note.find("[CLUE]", start);
-                if (next == std::string::npos)
-                    return m_clue;
-                return m_note.substr(start, next - start);
+            start = m_note.find('\n', tag);
+            m_clues.tags.push_back(tag);
+            if (start == std::string::npos) {
+                m_clues.text.push_back(std::string::npos);
+                break;
             }
+            m_clues.text.push_back(++start);
         }
+        m_clues.noteValid = true;
     }
 
-    Q_UNREACHABLE();
+    return m_clues;
+}
+
+int cc2::Map::cluesBefore(int x, int y) const
+{
+    const ClueIndex& index = clueIndex();
+    const int cell = (y * m_mapData.width()) + x;
+    return (int)(std::lower_bound(index.cells.begin(), index.cells.end(), cell)
+                 - index.cells.begin());
+}
+
+std::string cc2::Map::clueForTile(int x, int y) const
+{
+    if (m_mapData.tile(x, y).bottom().type() != Tile::Clue)
+        return std::string();
+
+    // The clue's text runs from its own tag's line to the next tag.  If
+    // either is missing, CC2 falls back to the map's global clue.
+    const ClueIndex& index = clueIndex();
+    const size_t ordinal = (size_t)cluesBefore(x, y);
+    if (ordinal + 1 >= index.tags.size())
+        return m_clue;
+    const size_t start = index.text[ordinal];
+    return m_note.substr(start, index.tags[ordinal + 1] - start);
 }
 
 static size_t scanNextClue(std::string& note, size_t start)
@@ -1524,37 +1644,28 @@ void cc2::Map::setClueForTile(int x, int y, const std::string& clue)
     // clue, rather than the global one in m_clue.  If there aren't enough
     // clue fields in the NOTE, we will add tags as necessary.
 
+    const int ordinal = cluesBefore(x, y);
+    m_clues.noteValid = false;
+
     size_t start = 0;
-    for (int sy = 0; sy < m_mapData.height(); ++sy) {
-        for (int sx = 0; sx < m_mapData.width(); ++sx) {
-            if (m_mapData.tile(sx, sy).bottom().type() != Tile::Clue)
-                continue;
-
-            // Scan the NOTE for the next [CLUE] tag
-            start = scanNextClue(m_note, start);
-
-            if (sx == x && sy == y) {
-                size_t next = m_note.find("[CLUE]", start);
-                if (next == std::string::npos) {
-                    m_note.insert(start, clue);
-                    start += clue.size();
-                    if (!clue.empty() && clue.back() != '\n') {
-                        m_note.insert(start, "\n");
-                        ++start;
-                    }
-                    m_note.insert(start, "[CLUE]\n");
-                } else {
-                    if (!clue.empty() && clue.back() != '\n')
-                        m_note.replace(start, next - start, clue + "\n");
-                    else
-                        m_note.replace(start, next - start, clue);
-                }
-                return;
-            }
+    for (int i = 0; i <= ordinal; ++i)
+        start = scanNextClue(m_note, start);
+
+    size_t next = m_note.find("[CLUE]", start);
+    if (next == std::string::npos) {
+        m_note.insert(start, clue);
+        start += clue.size();
+        if (!clue.empty() && clue.back() != '\n') {
+            m_note.insert(start, "\n");
+            ++start;
         }
+        m_note.insert(start, "[CLUE]\n");
+    } else {
+        if (!clue.empty() && clue.back() != '\n')
+            m_note.replace(start, next - start, clue + "\n");
+        else
+            m_note.replace(start, next - start, clue);
     }
-
-    Q_UNREACHABLE();
 }
 
 void cc2::Map::insertClue(int x, int y)
@@ -1562,23 +1673,15 @@ void cc2::Map::insertClue(int x, int y)
     if (m_note.find("[CLUE]") == std::string::npos)
         return;
 
-    size_t start = 0;
-    for (int sy = 0; sy < m_mapData.height(); ++sy) {
-        for (int sx = 0; sx < m_mapData.width(); ++sx) {
-            if (m_mapData.tile(sx, sy).bottom().type() == Tile::Clue
-                    || (sx == x && sy == y)) {
-                // Scan the NOTE for the next [CLUE] tag
-                start = scanNextClue(m_note, start);
-            }
-
-            if (sx == x && sy == y) {
-                m_note.insert(start, "[CLUE]\n");
-                return;
-            }
-        }
-    }
+    // Skip past the sections of every clue tile before (x, y), plus the
+    // one which (x, y) is taking over
+    const int ordinal = cluesBefore(x, y);
+    m_clues.noteValid = false;
 
-    Q_UNREACHABLE();
+    size_t start = 0;
+    for (int i = 0; i <= ordinal; ++i)
+        start = scanNextClue(m_note, start);
+    m_note.insert(start, "[CLUE]\n");
 }
 
 void cc2::Map::deleteClue(int x, int y)
@@ -1586,34 +1689,24 @@ void cc2::Map::deleteClue(int x, int y)
     if (m_note.find("[CLUE]") == std::string::npos)
         return;
 
-    size_t start = 0;
-    for (int sy = 0; sy < m_mapData.height(); ++sy) {
-        for (int sx = 0; sx < m_mapData.width(); ++sx) {
-            if (m_mapData.tile(sx, sy).bottom().type() == Tile::Clue
-                    || (sx == x && sy == y)) {
-                // Scan the NOTE for the next [CLUE] tag
-                start = scanNextClue(m_note, start);
-            }
+    const int ordinal = cluesBefore(x, y);
+    m_clues.noteValid = false;
 
-            if (sx == x && sy == y) {
-                size_t next = m_note.find("[CLUE]", start);
-                if (next != std::string::npos) {
-                    m_note.erase(start, next - start);
-                    next = m_note.find('\n', start);
-                    if (next != std::string::npos)
-                        m_note.erase(start, (next - start) + 1);
-                    else
-                        m_note.erase(start);
-                }
-                return;
-            }
-        }
+    size_t start = 0;
+    for (int i = 0; i <= ordinal; ++i)
+        start = scanNextClue(m_note, start);
+
+    size_t next = m_note.find("[CLUE]", start);
+    if (next != std::string::npos) {
+        m_note.erase(start, next - start);
+        next = m_note.find('\n', start);
+        if (next != std::string::npos)
+            m_note.erase(start, (next - start) + 1);
+        else
+            m_note.erase(start);
     }
-
-    Q_UNREACHABLE();
 }
 
-
 void cc2::ClipboardMap::read(ccl::Stream* stream)
 {
     char tag[4];
@@ -22,7 +22,9 @@
 
 #include <vector>
 #include <tuple>
+#include <mutex>
 #include <stdexcept>
+#include <initializer_list>
 
 namespace ccl { class LevelData; }
 
@@ -50,6 +52,9 @@ public:
     MapOption(const MapOption&) = default;
     MapOption& operator=(const MapOption&) = default;
 
+    bool operator==(const MapOption& other) const;
+    bool operator!=(const MapOption& other) const { return !operator==(other); }
+
     Viewport view() const { return m_view; }
     BlobPattern blobPattern() const { return m_blobPattern; }
     uint16_t timeLimit() const { return m_timeLimit; }
@@ -263,6 +268,9 @@ public:
     bool operator==(const Tile& other) const;
     bool operator!=(const Tile& other) const { return !operator==(other); }
 
+    // Hash of this tile and every layer below it
+    uint64_t hash() const;
+
     Type type() const { return (Type)m_type; }
     void setType(int type)
     {
@@ -301,22 +309,99 @@ public:
         return *tp;
     }
 
+    // Bit set of tile types, for matching a stack against several at once
+    class TypeSet {
+    public:
+        constexpr TypeSet() : m_bits() { }
+
+        constexpr TypeSet(std::initializer_list<Type> types) : m_bits()
+        {
+            for (Type type : types)
+                m_bits[(uint8_t)type >> 6] |= (uint64_t)1 << (type & 63);
+        }
+
+        constexpr bool contains(int type) const
+        {
+            return ((m_bits[(uint8_t)type >> 6] >> (type & 63)) & 1) != 0;
+        }
+
+    private:
+        uint64_t m_bits[4];
+    };
+
     bool haveTile(Tile::Type type) const;
-    bool haveTile(const std::vector<Tile::Type>& types) const;
+    bool haveTile(const TypeSet& types) const;
+
+    // First tile in this stack matching any of the TileClass bits
+    const Tile* findClass(unsigned int classMask) const;
 
     // For drawing tiles in the appropriate render order
     enum DrawLayer {
         BaseLayer, ItemLayer, DisallowLayer, MobLayer, PanelCanopyLayer,
         InvalidLayer,
     };
-    DrawLayer layer() const;
-    std::vector<const Tile*> sortedLayers() const;
+    DrawLayer layer() const
+    {
+        return (DrawLayer)((traits(m_type) & TraitLayerMask) >> TraitLayerShift);
+    }
+
+    /* Visits the layers of a stack in DrawLayer order, keeping the stack
+     * order within a layer.  Each layer is found by re-walking the stack,
+     * which is short, so nothing needs to be allocated. */
+    class LayerIterator {
+    public:
+        LayerIterator() : m_stack(), m_tile(), m_layerMask() { }
+        explicit LayerIterator(const Tile* stack);
+
+        const Tile* operator*() const { return m_tile; }
+        LayerIterator& operator++();
+
+        bool operator==(const LayerIterator& other) const { return m_tile == other.m_tile; }
+        bool operator!=(const LayerIterator& other) const { return m_tile != other.m_tile; }
+
+    private:
+        const Tile* m_stack;
+        const Tile* m_tile;
+        unsigned int m_layerMask;   // Layers not yet visited
+
+        void seekLayer();
+    };
+
+    class LayerRange {
+    public:
+        explicit LayerRange(const Tile* stack) : m_stack(stack) { }
+
+        LayerIterator begin() const { return LayerIterator(m_stack); }
+        LayerIterator end() const { return LayerIterator(); }
+
+    private:
+        const Tile* m_stack;
+    };
+
+    LayerRange sortedLayers() const { return LayerRange(this); }
 
     Tile* topVisible();
 
-    static bool haveLower(int type);
-    static bool haveDirection(int type);
-    static bool supportsWires(int type);
+    // Per-type properties, packed into a single table entry
+    enum TypeTrait {
+        TraitClassMask = 0xff,          // TileClass of the type
+        TraitLower = 0x100,             // Has a lower layer
+        TraitDirection = 0x200,         // Has a facing direction
+        TraitWires = 0x400,             // Can carry wires
+        TraitClonerArrows = 0x800,      // Only shows arrows when on a cloner
+        TraitLayerMask = 0x7000,        // DrawLayer of the type
+        TraitLayerShift = 12,
+    };
+
+    static uint16_t traits(int type)
+    {
+        return (type >= 0 && type < NUM_TILE_TYPES) ? s_traits.bits[type]
+                                                    : (uint16_t)ClassInvalid;
+    }
+
+    static bool haveLower(int type) { return (traits(type) & TraitLower) != 0; }
+    static bool haveDirection(int type) { return (traits(type) & TraitDirection) != 0; }
+    static bool supportsWires(int type) { return (traits(type) & TraitWires) != 0; }
 
     bool haveLower() const { return haveLower(m_type); }
     bool haveDirection() const { return haveDirection(m_type); }
@@ -338,7 +423,10 @@ public:
         ClassOther = 0x40,
         ClassInvalid = 0x80,
     };
-    static TileClass tileClass(int type);
+    static TileClass tileClass(int type)
+    {
+        return (TileClass)(traits(type) & TraitClassMask);
+    }
 
     TileClass tileClass() const { return tileClass(m_type); }
     bool haveClass(unsigned int classMask) const { return (tileClass() & classMask) != 0; }
@@ -368,11 +456,58 @@ private:
 
     // This will create the lower layer if necessary
     Tile* checkLower();
+
+    struct TraitDef {
+        uint8_t type;
+        uint8_t tileClass;
+        uint16_t flags;
+    };
+
+    struct TraitTable {
+        uint16_t bits[NUM_TILE_TYPES];
+    };
+
+    static constexpr TraitTable buildTraitTable();
+    static const TraitTable s_traits;
+};
+
+// Chip and score counts for a whole map or a single cell
+struct MapTotals {
+    int chips;          // Chips and green bombs, required by sockets
+    int extraChips;     // Extra chips, not required by sockets
+    int points;         // Raw flag points
+    int multipliers;    // Number of 2x flags
+
+    MapTotals() : chips(), extraChips(), points(), multipliers() { }
+
+    MapTotals& operator+=(const MapTotals& other)
+    {
+        chips += other.chips;
+        extraChips += other.extraChips;
+        points += other.points;
+        multipliers += other.multipliers;
+        return *this;
+    }
+
+    MapTotals& operator-=(const MapTotals& other)
+    {
+        chips -= other.chips;
+        extraChips -= other.extraChips;
+        points -= other.points;
+        multipliers -= other.multipliers;
+        return *this;
+    }
+
+    bool operator==(const MapTotals& other) const
+    {
+        return chips == other.chips && extraChips == other.extraChips
+            && points == other.points && multipliers == other.multipliers;
+    }
 };
 
 class MapData {
 public:
-    MapData() : m_width(), m_height(), m_map() { }
+    MapData() : m_width(), m_height(), m_map(), m_hash() { }
     ~MapData() { delete[] m_map; }
 
     MapData(const MapData& other);
@@ -383,6 +518,9 @@ public:
                   int width = 100, int height = 100);
     void importFrom(const ccl::LevelData* level, bool autoResize);
 
+    // Remove blank rows and columns from the edges, down to 10x10 at least
+    void trimBlankEdges();
+
     void read(ccl::Stream* stream, size_t size);
     void write(ccl::Stream* stream) const;
 
@@ -391,14 +529,24 @@ public:
 
     void resize(uint8_t width, uint8_t height);
 
+    // (required chips, total chips) and (raw points, 2x multipliers)
     std::tuple<int, int> countChips() const;
     std::tuple<int, int> countPoints() const;
 
+    /* Running chip and score totals.  These share the per-cell cache used
+     * by hash(), so only cells touched since settleCells() are recounted.
+     * verifyTotals() recounts the whole map and compares; debug builds
+     * check it on every countChips() and countPoints() call. */
+    MapTotals totals() const;
+    bool verifyTotals() const;
+
     Tile& tile(int x, int y)
     {
         if (!m_map || x >= m_width || y >= m_height)
             throw std::out_of_range("Map index out of bounds");
-        return m_map[(y * m_width) + x];
+        const int index = (y * m_width) + x;
+        touchCell(index);
+        return m_map[index];
     }
 
     const Tile& tile(int x, int y) const
@@ -408,9 +556,62 @@ public:
         return m_map[(y * m_width) + x];
     }
 
+    /* 64-bit content hash of the map size and every cell.  Any cell handed
+     * out through the mutable tile() accessor stays open: it is rehashed
+     * on every call until settleCells() closes it, so Tile pointers and
+     * references may be held and written through across calls.  The cost
+     * is proportional to the number of open cells.  recomputeHash()
+     * discards the cached cell hashes and totals and rebuilds everything.
+     * The const accessors lock the cache, so any number of threads may
+     * read one MapData at once, but not while another thread modifies it.
+     */
+    uint64_t hash() const;
+    uint64_t recomputeHash() const;
+
+    // Stack hash of every cell in reading order, from the same cache
+    std::vector<uint64_t> cellHashes() const;
+
+    /* Fold the open cells into the cache and close them.  Call this once
+     * nothing still holds a Tile from the mutable tile() accessor (e.g.
+     * at the end of an edit); skipping it only costs time on later hashes.
+     */
+    void settleCells();
+
+    void touchCell(int index)
+    {
+        if (m_cellDirty.empty())
+            m_cellDirty.resize(m_width * m_height);
+        if (!m_cellDirty[index]) {
+            m_cellDirty[index] = 1;
+            m_dirtyCells.push_back(index);
+        }
+    }
+
 private:
     uint8_t m_width, m_height;
     Tile* m_map;
+
+    // Lazily built per-cell cache; empty until the first hash() or
+    // totals() call.  Open cells are tracked even before then.
+    mutable std::vector<uint64_t> m_cellHash;
+    mutable std::vector<MapTotals> m_cellTotals;
+    mutable std::vector<uint8_t> m_cellDirty;
+    mutable std::vector<int> m_dirtyCells;
+    mutable uint64_t m_hash;
+    mutable MapTotals m_totals;
+    mutable std::mutex m_cacheLock;
+
+    // Both expect m_cacheLock to be held
+    void updateCellCache() const;
+    void rebuildCellCache() const;
+
+    void invalidateHash()
+    {
+        m_cellHash.clear();
+        m_cellTotals.clear();
+        m_cellDirty.clear();
+        m_dirtyCells.clear();
+    }
 };
 
 struct CC2FieldStorage
@@ -428,6 +629,10 @@ public:
     Map& operator=(const Map&) = delete;
 
     void copyFrom(const cc2::Map* map);
+    // Everything except the map data
+    void copyMetadataFrom(const cc2::Map* map);
+    // Compares everything copyMetadataFrom() copies
+    bool metadataEquals(const cc2::Map* map) const;
     void importFrom(const ccl::LevelData* level, bool autoResize);
 
     void read(ccl::Stream* stream);
@@ -448,7 +653,11 @@ public:
     void setAuthor(std::string author) { m_author = std::move(author); }
     void setEditorVersion(std::string version) { m_editorVersion = std::move(version); }
     void setClue(std::string clue) { m_clue = std::move(clue); }
-    void setNote(std::string note) { m_note = std::move(note); }
+    void setNote(std::string note)
+    {
+        m_note = std::move(note);
+        m_clues.noteValid = false;
+    }
     void setReadOnly(bool ro) { m_readOnly = ro; }
 
     MapOption& option() { return m_option; }
@@ -468,12 +677,20 @@ public:
         m_option.setReplayMD5(zero_md5);
     }
 
+    /* Per-tile clues are stored in order in the NOTE field, one section
+     * after each [CLUE] tag.  Lookups use a cached index of the clue tile
+     * positions and NOTE sections, which is rebuilt after the map data
+     * (detected through MapData::hash()) or the NOTE changes. */
     std::string clueForTile(int x, int y) const;
     void setClueForTile(int x, int y, const std::string& clue);
 
     void insertClue(int x, int y);
     void deleteClue(int x, int y);
 
+    // Hash of the map data plus all metadata, options and replay.  The
+    // unknown fields and the key are not included.
+    uint64_t contentHash() const;
+
     void ref()
     {
         ++m_refs;
@@ -504,6 +721,20 @@ private:
     bool m_readOnly;
 
     std::vector<CC2FieldStorage> m_unknown;
+
+    struct ClueIndex {
+        ClueIndex() : mapHash(), cellsValid(), noteValid() { }
+
+        uint64_t mapHash;
+        bool cellsValid, noteValid;
+        std::vector<int> cells;         // Clue tile cells, in reading order
+        std::vector<size_t> tags;       // Offset of each [CLUE] tag in the NOTE
+        std::vector<size_t> text;       // Start of each tag's text, or npos
+    };
+    mutable ClueIndex m_clues;
+
+    const ClueIndex& clueIndex() const;
+    int cluesBefore(int x, int y) const;
 };
 
 class ClipboardMap {
@@ -0,0 +1,30 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "PatternSearch.h"
+
+std::vector<uint64_t> cc2::MapCellCodes(const MapData& map, int x, int y,
+                                        int width, int height)
+{
+    std::vector<uint64_t> codes;
+    codes.reserve((size_t)(width * height));
+    for (int py = y; py < y + height; ++py) {
+        for (int px = x; px < x + width; ++px)
+            codes.push_back(map.tile(px, py).hash());
+    }
+    return codes;
+}
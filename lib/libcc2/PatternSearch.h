@@ -0,0 +1,34 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_PATTERNSEARCH_H
+#define _CC2_PATTERNSEARCH_H
+
+#include "Map.h"
+#include "libcc1/PatternSearch.h"
+
+namespace cc2 {
+
+/* Cell codes for a region of a CC2 map, for use with ccl::FindPattern2D.
+ * Each code is the hash of the cell's full tile stack.
+ */
+std::vector<uint64_t> MapCellCodes(const MapData& map, int x, int y,
+                                   int width, int height);
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "ScriptBytecode.h"
+#include "GameScript.h"
+
+#include <algorithm>
+#include <cstdio>
+
+static_assert((int)cc2::ScriptBytecode::OpBitOr == (int)cc2::OperatorNode::OpBitOr,
+              "Binary opcodes must match OperatorNode::Operator");
+
+cc2::ScriptBytecode::Entry cc2::ScriptBytecode::compile(const C2GNode* node)
+{
+    const Entry entry = (Entry)m_code.size();
+
+    // Assignments are only meaningful at the top of an expression
+    auto opNode = (node->type() == C2GNode::NodeOperator)
+                ? static_cast<const OperatorNode*>(node) : nullptr;
+    if (opNode && opNode->op() == OperatorNode::OpAssign
+            && opNode->operand(0)->type() == C2GNode::NodeIdentifier) {
+        compileNode(opNode->operand(1), 1);
+        emit(OpStore, static_cast<const IdentifierNode*>(opNode->operand(0))->atom());
+    } else {
+        compileNode(node, 1);
+    }
+    emit(OpReturn);
+    return entry;
+}
+
+void cc2::ScriptBytecode::emitValue(unsigned long value)
+{
+    if (value <= MaxSmall) {
+        emit(OpPushSmall, (uint32_t)value);
+    } else {
+        emit(OpPushConst, (uint32_t)m_constants.size());
+        m_constants.push_back(value);
+    }
+}
+
+void cc2::ScriptBytecode::compileNode(const C2GNode* node, size_t depth)
+{
+    m_maxDepth = std::max(m_maxDepth, depth);
+
+    switch (node->type()) {
+    case C2GNode::NodeNumber:
+        emitValue(static_cast<const NumberNode*>(node)->value());
+        break;
+    case C2GNode::NodeIdentifier:
+        emit(OpLoad, static_cast<const IdentifierNode*>(node)->atom());
+        break;
+    case C2GNode::NodeOperator:
+        {
+            auto opNode = static_cast<const OperatorNode*>(node);
+            if (opNode->op() == OperatorNode::OpAssign) {
+                // Nested assignments have no effect, and their operands
+                // can't have side effects either
+                fprintf(stderr, "Unexpected operator \"%s\" in expression\n", opNode->token());
+                emitValue(0);
+                break;
+            }
+            compileNode(opNode->operand(0), depth);
+            compileNode(opNode->operand(1), depth + 1);
+            emit((Opcode)opNode->op());
+        }
+        break;
+    default:
+        fprintf(stderr, "Unexpected node type %d in expression\n", node->type());
+        emitValue(0);
+        break;
+    }
+}
+
+unsigned long cc2::ScriptBytecode::run(Entry entry, unsigned long* slots) const
+{
+    // Expressions are rarely more than a few levels deep
+    unsigned long localStack[32];
+    std::vector<unsigned long> heapStack;
+    unsigned long* stack = localStack;
+    if (m_maxDepth > 32) {
+        heapStack.resize(m_maxDepth);
+        stack = heapStack.data();
+    }
+
+    unsigned long* top = stack;     // Points past the top value
+    const uint32_t* pc = m_code.data() + entry;
+    for ( ;; ) {
+        const uint32_t insn = *pc++;
+        const uint32_t operand = insn >> OperandShift;
+        switch ((Opcode)(insn & 0xff)) {
+        case OpPushSmall:
+            *top++ = operand;
+            break;
+        case OpPushConst:
+            *top++ = m_constants[operand];
+            break;
+        case OpLoad:
+            *top++ = slots[operand];
+            break;
+        case OpStore:
+            slots[operand] = top[-1];
+            break;
+        case OpReturn:
+            return (top == stack) ? 0 : top[-1];
+
+#define BINARY_OP(opcode, expr)                 \
+        case opcode:                            \
+            {                                   \
+                const unsigned long rhs = *--top; \
+                const unsigned long lhs = top[-1]; \
+                top[-1] = (expr);               \
+            }                                   \
+            break
+
+        BINARY_OP(OpLess, (lhs < rhs) ? 1 : 0);
+        BINARY_OP(OpLessEqual, (lhs <= rhs) ? 1 : 0);
+        BINARY_OP(OpGreater, (lhs > rhs) ? 1 : 0);
+        BINARY_OP(OpGreaterEqual, (lhs >= rhs) ? 1 : 0);
+        BINARY_OP(OpEqual, (lhs == rhs) ? 1 : 0);
+        BINARY_OP(OpNotEqual, (lhs != rhs) ? 1 : 0);
+        BINARY_OP(OpMultiply, lhs * rhs);
+        BINARY_OP(OpAdd, lhs + rhs);
+        BINARY_OP(OpSubtract, lhs - rhs);
+        BINARY_OP(OpXor, lhs ^ rhs);
+        BINARY_OP(OpLogicalAnd, (lhs && rhs) ? 1 : 0);
+        BINARY_OP(OpBitAnd, lhs & rhs);
+        BINARY_OP(OpLogicalOr, (lhs || rhs) ? 1 : 0);
+        BINARY_OP(OpBitOr, lhs | rhs);
+#undef BINARY_OP
+
+        case OpDivide:
+        case OpModulo:
+            {
+                const unsigned long rhs = *--top;
+                const unsigned long lhs = top[-1];
+                if (rhs == 0) {
+                    fprintf(stderr, "Divide by zero in expression\n");
+                    top[-1] = 0;
+                } else {
+                    top[-1] = ((insn & 0xff) == OpDivide) ? (lhs / rhs) : (lhs % rhs);
+                }
+            }
+            break;
+
+        case OpAssign:
+        default:
+            // Never emitted
+            return 0;
+        }
+    }
+}
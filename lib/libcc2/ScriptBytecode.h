@@ -0,0 +1,83 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_SCRIPTBYTECODE_H
+#define _CC2_SCRIPTBYTECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cc2 {
+
+class C2GNode;
+
+/* C2G expressions compiled to a compact stack bytecode.  Each instruction
+ * is one 32-bit word holding an opcode and a 24-bit operand.  Variables are
+ * slots indexed by the script's atoms, so evaluating an expression never
+ * touches a string or a hash table.  Any number of expressions can be
+ * compiled into one ScriptBytecode; each is identified by its entry point.
+ */
+class ScriptBytecode {
+public:
+    // Binary opcodes are in the same order as OperatorNode::Operator
+    enum Opcode : uint8_t {
+        OpAssign, OpLess, OpLessEqual, OpGreater, OpGreaterEqual, OpEqual,
+        OpNotEqual, OpMultiply, OpDivide, OpAdd, OpSubtract, OpModulo,
+        OpXor, OpLogicalAnd, OpBitAnd, OpLogicalOr, OpBitOr,
+
+        OpPushSmall,    // Push the operand as a value
+        OpPushConst,    // Push constant pool entry [operand]
+        OpLoad,         // Push slot [operand]
+        OpStore,        // Pop a value into slot [operand], and push it back
+        OpReturn,       // Return the top of the stack, or 0 if it's empty
+    };
+
+    typedef uint32_t Entry;
+
+    ScriptBytecode() : m_maxDepth() { }
+
+    /* Compile an expression, returning its entry point.  An assignment to
+     * a variable stores the value and evaluates to it.  Nodes which aren't
+     * part of an expression evaluate to 0.
+     */
+    Entry compile(const C2GNode* node);
+
+    // Evaluate a compiled expression against the variables in slots
+    unsigned long run(Entry entry, unsigned long* slots) const;
+
+    size_t size() const { return m_code.size(); }
+
+private:
+    enum { OperandShift = 8, MaxSmall = 0xffffff };
+
+    std::vector<uint32_t> m_code;
+    std::vector<unsigned long> m_constants;
+    size_t m_maxDepth;
+
+    void emit(Opcode op, uint32_t operand = 0)
+    {
+        m_code.push_back((uint32_t)op | (operand << OperandShift));
+    }
+
+    void emitValue(unsigned long value);
+    void compileNode(const C2GNode* node, size_t depth);
+};
+
+}
+
+#endif
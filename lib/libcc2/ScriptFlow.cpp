@@ -0,0 +1,441 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "ScriptFlow.h"
+#include "ScriptBytecode.h"
+#include "Map.h"
+
+#include "libcc1/Errors.h"
+#include <QDir>
+#include <QFileInfo>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Variables the game sets when a map ends
+const char* const s_mapResultVars[] = {
+    "reason", "exit", "result", "time", "tleft", "chips", "bonus", "keys",
+    "tools", "gender", "menu",
+};
+
+struct FlowState {
+    size_t pc;
+    size_t dir;
+    std::vector<unsigned long> vars;
+    std::vector<bool> unknown;
+
+    // Every concrete state other can stand for is also one of ours
+    bool covers(const FlowState& other) const
+    {
+        if (dir != other.dir)
+            return false;
+        for (size_t i = 0; i < vars.size(); ++i) {
+            if (!unknown[i] && (other.unknown[i] || vars[i] != other.vars[i]))
+                return false;
+        }
+        return true;
+    }
+
+    void join(const FlowState& other)
+    {
+        for (size_t i = 0; i < vars.size(); ++i) {
+            if (other.unknown[i] || vars[i] != other.vars[i])
+                unknown[i] = true;
+        }
+    }
+};
+
+class FlowExplorer {
+public:
+    FlowExplorer(const cc2::GameScript& script, const QString& scriptFilename);
+
+    cc2::ScriptFlow run(size_t maxSteps);
+
+private:
+    enum { MaxStatesPerLabel = 8 };
+    static constexpr size_t NoTarget = (size_t)-1;
+
+    struct Expression {
+        cc2::ScriptBytecode::Entry entry;
+        std::vector<uint32_t> reads;    // Slots the expression depends on
+        size_t target;                  // Slot assigned to, or NoTarget
+    };
+
+    const std::vector<cc2::C2GNode*>& m_nodes;
+    cc2::ScriptBytecode m_bytecode;
+    std::unordered_map<size_t, Expression> m_exprs;
+    std::vector<size_t> m_nextLine;
+    std::vector<size_t> m_gotoTarget;
+    std::vector<bool> m_labelDef;
+    std::vector<size_t> m_resultSlots;
+    size_t m_levelSlot;
+    size_t m_slotCount;
+    FlowState m_initial;
+
+    std::vector<QString> m_dirs;
+    std::unordered_map<size_t, std::vector<FlowState>> m_seen;
+    std::unordered_set<std::string> m_mapsReached;
+    std::unordered_set<std::string> m_chainsReached;
+    int m_lastLevel;
+
+    void collectReads(const cc2::C2GNode* node, std::vector<uint32_t>& reads);
+    bool visitLabel(FlowState& state);
+    QString resolvePath(size_t dir, const cc2::C2GNode* param) const;
+    size_t changeDir(size_t dir, const cc2::C2GNode* param);
+};
+
+constexpr size_t FlowExplorer::NoTarget;
+
+void addConstants(const cc2::ScriptAtoms& atoms, std::vector<unsigned long>& locals)
+{
+    // TODO: This should be read-only
+    static const struct {
+        const char* name;
+        unsigned long value;
+    } constants[] = {
+        { "male", cc2::Tile::Player },
+        { "female", cc2::Tile::Player2 },
+        { "continue", 0x1 },
+        { "replay", 0x2 },
+        { "silent", 0x4 },
+        { "ktools", 0x10 },
+        { "ktime", 0x20 },
+        { "no_bonus", 0x40 },
+    };
+
+    // Constants the script never names can't affect it
+    for (const auto& constant : constants) {
+        const uint32_t atom = atoms.find(constant.name);
+        if (atom != cc2::ScriptAtoms::NoAtom)
+            locals[atom] = constant.value;
+    }
+}
+
+const cc2::StringNode* stringParam(const cc2::C2GNode* node)
+{
+    auto param = static_cast<const cc2::CommandNode*>(node)->param();
+    return (param && param->type() == cc2::C2GNode::NodeString)
+           ? static_cast<const cc2::StringNode*>(param) : nullptr;
+}
+
+}
+
+FlowExplorer::FlowExplorer(const cc2::GameScript& script, const QString& scriptFilename)
+    : m_nodes(script.nodes()), m_lastLevel()
+{
+    using cc2::C2GNode;
+
+    const cc2::ScriptAtoms& atoms = script.atoms();
+    const uint32_t levelAtom = atoms.find("level");
+    m_levelSlot = (levelAtom != cc2::ScriptAtoms::NoAtom) ? levelAtom : atoms.size();
+    m_slotCount = atoms.size() + 1;
+    for (const char* name : s_mapResultVars) {
+        const uint32_t atom = atoms.find(name);
+        if (atom != cc2::ScriptAtoms::NoAtom)
+            m_resultSlots.push_back(atom);
+    }
+
+    m_initial.pc = 0;
+    m_initial.dir = 0;
+    m_initial.vars.assign(m_slotCount, 0);
+    m_initial.unknown.assign(m_slotCount, false);
+    addConstants(atoms, m_initial.vars);
+    m_initial.vars[m_levelSlot] = 1;
+
+    QDir scriptDir(scriptFilename);
+    scriptDir.cdUp();
+    m_dirs.push_back(scriptDir.absolutePath());
+
+    // Index the lines, labels and expressions once up front
+    const size_t count = m_nodes.size();
+    m_nextLine.assign(count, count);
+    for (size_t i = count; i-- > 1; ) {
+        m_nextLine[i - 1] = (m_nodes[i]->line() != m_nodes[i - 1]->line())
+                            ? i : m_nextLine[i];
+    }
+
+    std::unordered_map<uint32_t, size_t> labels;
+    m_labelDef.assign(count, false);
+    m_gotoTarget.assign(count, NoTarget);
+    for (size_t i = 0; i < count; ++i) {
+        const C2GNode* node = m_nodes[i];
+        if (node->type() == C2GNode::NodeLabel) {
+            // A label right after a goto is its target, not a definition
+            const bool isTarget = i > 0 && m_nodes[i - 1]->type() == C2GNode::NodeGoto
+                                  && m_nodes[i - 1]->line() == node->line();
+            if (!isTarget) {
+                m_labelDef[i] = true;
+                labels.emplace(static_cast<const cc2::LabelNode*>(node)->atom(), i);
+            }
+        } else if (node->type() == C2GNode::NodeOperator
+                   || node->type() == C2GNode::NodeIdentifier
+                   || node->type() == C2GNode::NodeNumber) {
+            Expression expr;
+            expr.entry = m_bytecode.compile(node);
+            expr.target = NoTarget;
+            auto opNode = static_cast<const cc2::OperatorNode*>(node);
+            if (node->type() == C2GNode::NodeOperator && opNode->op() == cc2::OperatorNode::OpAssign
+                    && opNode->operand(0)->type() == C2GNode::NodeIdentifier) {
+                expr.target = static_cast<const cc2::IdentifierNode*>(opNode->operand(0))->atom();
+                collectReads(opNode->operand(1), expr.reads);
+            } else {
+                collectReads(node, expr.reads);
+            }
+            m_exprs.emplace(i, std::move(expr));
+        }
+    }
+    for (size_t i = 0; i + 1 < count; ++i) {
+        if (m_nodes[i]->type() != C2GNode::NodeGoto || m_nodes[i + 1]->type() != C2GNode::NodeLabel
+                || m_nodes[i + 1]->line() != m_nodes[i]->line())
+            continue;
+        auto iter = labels.find(static_cast<const cc2::LabelNode*>(m_nodes[i + 1])->atom());
+        if (iter != labels.end())
+            m_gotoTarget[i] = iter->second;
+    }
+}
+
+void FlowExplorer::collectReads(const cc2::C2GNode* node, std::vector<uint32_t>& reads)
+{
+    if (node->type() == cc2::C2GNode::NodeIdentifier) {
+        reads.push_back(static_cast<const cc2::IdentifierNode*>(node)->atom());
+    } else if (node->type() == cc2::C2GNode::NodeOperator) {
+        auto opNode = static_cast<const cc2::OperatorNode*>(node);
+        // Nested assignments evaluate to 0 without reading anything
+        if (opNode->op() != cc2::OperatorNode::OpAssign) {
+            collectReads(opNode->operand(0), reads);
+            collectReads(opNode->operand(1), reads);
+        }
+    }
+}
+
+bool FlowExplorer::visitLabel(FlowState& state)
+{
+    std::vector<FlowState>& seen = m_seen[state.pc];
+    for (const FlowState& prev : seen) {
+        if (prev.covers(state))
+            return false;
+    }
+
+    if (seen.size() >= MaxStatesPerLabel) {
+        // Too many variations; generalize instead of enumerating them
+        state.join(seen.front());
+        for (const FlowState& prev : seen) {
+            if (prev.covers(state))
+                return false;
+        }
+    }
+    seen.push_back(state);
+    return true;
+}
+
+QString FlowExplorer::resolvePath(size_t dir, const cc2::C2GNode* param) const
+{
+    auto stringNode = static_cast<const cc2::StringNode*>(param);
+    // Convert this to use the native directory separator so that C2G-referenced paths are loaded properly
+    // on systems with different directory separators.
+    const QString path = QDir::toNativeSeparators(
+                            QString::fromUtf8(stringNode->text(), (int)stringNode->length())
+                            .replace(QStringLiteral("\\"), QStringLiteral("/")));
+    return QDir::cleanPath(QDir(m_dirs[dir]).absoluteFilePath(path));
+}
+
+size_t FlowExplorer::changeDir(size_t dir, const cc2::C2GNode* param)
+{
+    const QString path = resolvePath(dir, param);
+    for (size_t i = 0; i < m_dirs.size(); ++i) {
+        if (m_dirs[i] == path)
+            return i;
+    }
+    m_dirs.push_back(path);
+    return m_dirs.size() - 1;
+}
+
+cc2::ScriptFlow FlowExplorer::run(size_t maxSteps)
+{
+    using cc2::C2GNode;
+
+    cc2::ScriptFlow flow;
+    std::vector<FlowState> pending { m_initial };
+    size_t steps = 0;
+    while (!pending.empty()) {
+        FlowState state = std::move(pending.back());
+        pending.pop_back();
+
+        while (state.pc < m_nodes.size()) {
+            if (++steps > maxSteps) {
+                flow.complete = false;
+                return flow;
+            }
+
+            const size_t pc = state.pc;
+            const C2GNode* node = m_nodes[pc];
+            switch (node->type()) {
+            case C2GNode::NodeLabel:
+                if (m_labelDef[pc] && !visitLabel(state))
+                    state.pc = m_nodes.size();
+                else
+                    state.pc = pc + 1;
+                break;
+
+            case C2GNode::NodeOperator:
+            case C2GNode::NodeIdentifier:
+            case C2GNode::NodeNumber:
+                {
+                    const Expression& expr = m_exprs.at(pc);
+                    bool unknown = false;
+                    for (uint32_t slot : expr.reads)
+                        unknown = unknown || state.unknown[slot];
+
+                    // A known expression only reads known slots, and only
+                    // writes its own target, so it can run on the state
+                    const unsigned long value = unknown ? 0
+                                              : m_bytecode.run(expr.entry, state.vars.data());
+
+                    if (expr.target != NoTarget) {
+                        state.vars[expr.target] = value;
+                        state.unknown[expr.target] = unknown;
+                        state.pc = pc + 1;
+                    } else if (unknown) {
+                        // Follow the rest of the line later; skip it now
+                        FlowState taken = state;
+                        taken.pc = pc + 1;
+                        pending.push_back(std::move(taken));
+                        state.pc = m_nextLine[pc];
+                    } else {
+                        state.pc = value ? pc + 1 : m_nextLine[pc];
+                    }
+                }
+                break;
+
+            case C2GNode::NodeMap:
+                if (const cc2::StringNode* param = stringParam(node)) {
+                    const bool levelKnown = !state.unknown[m_levelSlot];
+                    const int levelNum = levelKnown ? (int)state.vars[m_levelSlot]
+                                                    : m_lastLevel + 1;
+                    // The same map line can name a different file after a chdir
+                    std::string filename = resolvePath(state.dir, param).toStdString();
+                    if (m_mapsReached.insert(filename).second) {
+                        cc2::ScriptMapEntry entry;
+                        entry.levelNum = levelNum;
+                        entry.filename = std::move(filename);
+                        flow.maps.push_back(std::move(entry));
+                    }
+                    m_lastLevel = levelNum;
+                    if (levelKnown)
+                        state.vars[m_levelSlot] += 1;
+                    for (size_t slot : m_resultSlots)
+                        state.unknown[slot] = true;
+                }
+                state.pc = pc + 1;
+                break;
+
+            case C2GNode::NodeGame:
+                if (const cc2::StringNode* param = stringParam(node)) {
+                    if (flow.gameName.empty())
+                        flow.gameName = std::string(param->text(), param->length());
+                }
+                state.pc = pc + 1;
+                break;
+
+            case C2GNode::NodeChdir:
+                if (const cc2::StringNode* param = stringParam(node))
+                    state.dir = changeDir(state.dir, param);
+                state.pc = pc + 1;
+                break;
+
+            case C2GNode::NodeChain:
+                if (const cc2::StringNode* param = stringParam(node)) {
+                    std::string path = resolvePath(state.dir, param).toStdString();
+                    if (m_chainsReached.insert(path).second)
+                        flow.chains.push_back(std::move(path));
+                }
+                state.pc = m_nodes.size();
+                break;
+
+            case C2GNode::NodeEnd:
+                state.pc = m_nodes.size();
+                break;
+
+            case C2GNode::NodeDo:
+                // do takes no operand.  The commands after it on the line are
+                // nodes of their own and run next, just as they would without
+                // the do, so it can't change which maps are reached.
+                state.pc = pc + 1;
+                break;
+
+            case C2GNode::NodeGoto:
+                // A goto to a missing label is ignored
+                state.pc = (m_gotoTarget[pc] != NoTarget) ? m_gotoTarget[pc] : m_nextLine[pc];
+                break;
+
+            default:
+                // Nothing that affects which maps are reached
+                state.pc = pc + 1;
+                break;
+            }
+        }
+    }
+
+    return flow;
+}
+
+cc2::ScriptFlow cc2::ExploreScript(const GameScript& script, const QString& scriptFilename,
+                                   size_t maxSteps)
+{
+    FlowExplorer explorer(script, scriptFilename);
+    return explorer.run(maxSteps);
+}
+
+void cc2::FollowChains(ScriptFlow& flow, const QString& scriptFilename, size_t maxSteps)
+{
+    std::unordered_set<std::string> mapsReached;
+    for (const ScriptMapEntry& entry : flow.maps)
+        mapsReached.insert(entry.filename);
+    const std::string rootPath =
+            QDir::cleanPath(QFileInfo(scriptFilename).absoluteFilePath()).toStdString();
+    std::unordered_set<std::string> chainsReached(flow.chains.begin(), flow.chains.end());
+    chainsReached.insert(rootPath);
+
+    // flow.chains grows as chained scripts are explored
+    for (size_t i = 0; i < flow.chains.size(); ++i) {
+        if (flow.chains[i] == rootPath)
+            continue;
+
+        const QString chainFilename = QString::fromStdString(flow.chains[i]);
+        GameScript chained;
+        try {
+            chained.read(chainFilename);
+        } catch (const ccl::RuntimeError&) {
+            flow.missingChains.push_back(flow.chains[i]);
+            continue;
+        }
+
+        ScriptFlow chainFlow = ExploreScript(chained, chainFilename, maxSteps);
+        for (ScriptMapEntry& entry : chainFlow.maps) {
+            if (mapsReached.insert(entry.filename).second)
+                flow.maps.push_back(std::move(entry));
+        }
+        for (std::string& chain : chainFlow.chains) {
+            if (chainsReached.insert(chain).second)
+                flow.chains.push_back(std::move(chain));
+        }
+        if (flow.gameName.empty())
+            flow.gameName = std::move(chainFlow.gameName);
+        flow.complete = flow.complete && chainFlow.complete;
+    }
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_SCRIPTFLOW_H
+#define _CC2_SCRIPTFLOW_H
+
+#include "GameScript.h"
+
+namespace cc2 {
+
+struct ScriptFlow {
+    std::vector<ScriptMapEntry> maps;   // Reachable maps, in the order first reached
+    std::vector<std::string> chains;    // Reachable chained scripts, absolute and UTF-8 encoded
+    std::vector<std::string> missingChains; // Chained scripts FollowChains() couldn't read
+    std::string gameName;
+    bool complete;                      // False if the step budget ran out
+
+    ScriptFlow() : complete(true) { }
+};
+
+/* Follow every path through a game script, and collect the maps and chained
+ * scripts it can reach.  Labels, goto, end, chain, chdir, do and
+ * conditional lines are honored, and a map file reached more than once is
+ * only listed once.  A line which starts with an expression other than an
+ * assignment only runs the rest of the line if the expression is nonzero.
+ *
+ * Variables which the game sets when a map ends (reason, exit, time, etc.)
+ * are unknown after each map, and a condition which depends on them follows
+ * both outcomes.  The states seen at each label are remembered, so a path
+ * stops once it revisits a state, and a label reached with too many
+ * different states has the differing variables treated as unknown.  This
+ * guarantees loops terminate.  maxSteps bounds the total work for
+ * pathological scripts.
+ */
+ScriptFlow ExploreScript(const GameScript& script, const QString& scriptFilename,
+                         size_t maxSteps = 1000000);
+
+/* Read and explore each script chained from flow, and the scripts those
+ * chain to in turn, adding their maps and chains to flow.  A map or script
+ * reached more than once is only listed once.  Chained scripts that can't
+ * be read are added to flow.missingChains.
+ */
+void FollowChains(ScriptFlow& flow, const QString& scriptFilename,
+                  size_t maxSteps = 1000000);
+
+}
+
+#endif
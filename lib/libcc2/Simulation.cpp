@@ -0,0 +1,1139 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#define DIR_RIGHT(dir)  (((dir) + 1) & 0x03)
+#define DIR_BACK(dir)   (((dir) + 2) & 0x03)
+#define DIR_LEFT(dir)   (((dir) + 3) & 0x03)
+
+static const uint8_t s_inputDirs[] = {
+    cc2::InputNorth, cc2::InputEast, cc2::InputSouth, cc2::InputWest,
+};
+
+void cc2::Replay::decode(const std::vector<uint8_t>& data)
+{
+    m_inputs.clear();
+    if (data.size() < 3)
+        throw ccl::FormatError(ccl::RuntimeError::tr("Invalid replay data"));
+
+    // data[0] is unused
+    m_forceDirection = (Tile::Direction)(data[1] & 0x03);
+    m_blobSeed = data[2];
+
+    // The remaining data is a list of (frames, input) pairs, where each input
+    // is held for the specified number of frames
+    unsigned int frame = 0;
+    for (size_t pos = 3; pos < data.size(); pos += 2) {
+        if (data[pos] == 0xFF)
+            break;
+        if (pos + 1 >= data.size())
+            throw ccl::FormatError(ccl::RuntimeError::tr("Truncated replay data"));
+
+        const unsigned int holdFrames = data[pos];
+        const uint8_t input = data[pos + 1];
+        for (unsigned int i = 0; i < holdFrames; ++i, ++frame) {
+            if ((frame % Simulation::FramesPerTick) == 0)
+                m_inputs.push_back(input);
+        }
+    }
+}
+
+static bool isIce(int type)
+{
+    return type == cc2::Tile::Ice || (type >= cc2::Tile::Ice_NE && type <= cc2::Tile::Ice_NW);
+}
+
+static bool isForce(int type)
+{
+    return (type >= cc2::Tile::Force_N && type <= cc2::Tile::Force_W)
+            || type == cc2::Tile::Force_Rand;
+}
+
+static bool isTeleport(int type)
+{
+    return type >= cc2::Tile::Teleport_Red && type <= cc2::Tile::Teleport_Green;
+}
+
+static bool isTool(int type)
+{
+    switch (type) {
+    case cc2::Tile::IceCleats:
+    case cc2::Tile::MagnoShoes:
+    case cc2::Tile::FireShoes:
+    case cc2::Tile::Flippers:
+    case cc2::Tile::HikingBoots:
+    case cc2::Tile::SpeedShoes:
+    case cc2::Tile::Helmet:
+    case cc2::Tile::RRSign:
+    case cc2::Tile::Bribe:
+    case cc2::Tile::SteelFoil:
+    case cc2::Tile::Lightning:
+    case cc2::Tile::Eye:
+    case cc2::Tile::Hook:
+    case cc2::Tile::BowlingBall:
+    case cc2::Tile::TimeBomb:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Describe a tile the simulation can't play, or return nullptr if it can
+static const char* unmodeledFeature(const cc2::Tile& tile)
+{
+    using cc2::Tile;
+
+    switch (tile.type()) {
+    case Tile::LogicGate:
+    case Tile::LogicButton:
+    case Tile::RevLogicButton:
+    case Tile::Switch_Off:
+    case Tile::Switch_On:
+        return "wired logic";
+    case Tile::TrainTracks:
+        return "train tracks";
+    case Tile::Rover:
+        return "rovers";
+    case Tile::MirrorPlayer:
+    case Tile::MirrorPlayer2:
+        return "mirror players";
+    case Tile::YellowTank:
+    case Tile::YellowTankCtrl:
+        return "yellow tanks";
+    case Tile::FlameJet_Off:
+    case Tile::FlameJet_On:
+    case Tile::FlameJetButton:
+        return "flame jets";
+    case Tile::AreaCtlButton:
+        return "gray buttons";
+    case Tile::Transformer:
+        return "transmogrifiers";
+    default:
+        if (tile.supportsWires() && (tile.modifier() & (cc2::TileModifier::WireMask
+                                                        | cc2::TileModifier::WireTunnelMask)) != 0)
+            return "wires";
+        return nullptr;
+    }
+}
+
+// Walls preventing a mob from leaving an ice corner in the given direction
+static bool exitBlocked(int terrain, int dir)
+{
+    switch (terrain) {
+    case cc2::Tile::Ice_SE:
+        return dir == cc2::Tile::North || dir == cc2::Tile::West;
+    case cc2::Tile::Ice_SW:
+        return dir == cc2::Tile::North || dir == cc2::Tile::East;
+    case cc2::Tile::Ice_NW:
+        return dir == cc2::Tile::South || dir == cc2::Tile::East;
+    case cc2::Tile::Ice_NE:
+        return dir == cc2::Tile::South || dir == cc2::Tile::West;
+    default:
+        return false;
+    }
+}
+
+// Walls preventing a mob moving in the given direction from entering
+static bool entryBlocked(int terrain, int dir)
+{
+    switch (terrain) {
+    case cc2::Tile::Ice_SE:
+        return dir == cc2::Tile::South || dir == cc2::Tile::East;
+    case cc2::Tile::Ice_SW:
+        return dir == cc2::Tile::South || dir == cc2::Tile::West;
+    case cc2::Tile::Ice_NW:
+        return dir == cc2::Tile::North || dir == cc2::Tile::West;
+    case cc2::Tile::Ice_NE:
+        return dir == cc2::Tile::North || dir == cc2::Tile::East;
+    default:
+        return false;
+    }
+}
+
+// Direction a mob leaves an ice corner after entering it
+static int deflect(int terrain, int dir)
+{
+    using cc2::Tile;
+
+    switch (terrain) {
+    case Tile::Ice_SE:
+        return (dir == Tile::North) ? Tile::East : (dir == Tile::West) ? Tile::South : dir;
+    case Tile::Ice_SW:
+        return (dir == Tile::North) ? Tile::West : (dir == Tile::East) ? Tile::South : dir;
+    case Tile::Ice_NW:
+        return (dir == Tile::South) ? Tile::West : (dir == Tile::East) ? Tile::North : dir;
+    case Tile::Ice_NE:
+        return (dir == Tile::South) ? Tile::East : (dir == Tile::West) ? Tile::North : dir;
+    default:
+        return dir;
+    }
+}
+
+cc2::Simulation::Simulation()
+    : m_width(), m_height(), m_status(SimNoPlayer), m_unsupported(), m_tick(), m_timed(),
+      m_timeFrozen(), m_timeLeft(), m_chipsLeft(), m_bonus(), m_playersLeft(),
+      m_activePlayer(-1), m_lastInput(), m_keys(), m_tools(), m_forceDir(),
+      m_blobPattern(MapOption::BlobsDeterministic), m_blobModifier(),
+      m_prng1(), m_prng2()
+{
+}
+
+void cc2::Simulation::reset(const Map* map, Tile::Direction forceDirection,
+                            uint8_t blobSeed)
+{
+    const MapData& mapData = map->mapData();
+    m_width = mapData.width();
+    m_height = mapData.height();
+
+    const Cell emptyCell { 0, Tile::Floor, Tile::Invalid, 0, false, -1 };
+    m_cells.assign((size_t)(m_width * m_height), emptyCell);
+    m_mobs.clear();
+    m_trapLinks.clear();
+    m_cloneLinks.clear();
+
+    m_status = SimRunning;
+    m_unsupported = nullptr;
+    m_tick = 0;
+    m_timed = (map->option().timeLimit() != 0);
+    m_timeFrozen = false;
+    m_timeLeft = map->option().timeLimit() * TicksPerSecond;
+    m_chipsLeft = std::get<0>(mapData.countChips());
+    m_bonus = 0;
+    m_playersLeft = 0;
+    m_activePlayer = -1;
+    m_lastInput = InputNone;
+    std::fill(std::begin(m_keys), std::end(m_keys), 0);
+    std::fill(std::begin(m_tools), std::end(m_tools), (uint8_t)Tile::Invalid);
+    m_forceDir = forceDirection & 0x03;
+    m_prng1 = 0;
+    m_prng2 = 0;
+
+    m_blobPattern = map->option().blobPattern();
+    switch (m_blobPattern) {
+    case MapOption::Blobs4Pattern:
+        m_blobModifier = blobSeed & 0x03;
+        break;
+    case MapOption::BlobsExtraRandom:
+        m_blobModifier = blobSeed;
+        break;
+    default:
+        m_blobModifier = 0x55;
+        break;
+    }
+
+    for (int pos = 0; pos < m_width * m_height; ++pos) {
+        Cell& cell = m_cells[pos];
+        const Tile* tile = &mapData.tile(pos % m_width, pos / m_width);
+        while (tile) {
+            if (!m_unsupported)
+                m_unsupported = unmodeledFeature(*tile);
+            switch (tile->layer()) {
+            case Tile::BaseLayer:
+                cell.terrain = tile->type();
+                cell.terrainMod = tile->modifier();
+                break;
+            case Tile::ItemLayer:
+                cell.item = tile->type();
+                break;
+            case Tile::DisallowLayer:
+                cell.noSign = true;
+                break;
+            case Tile::PanelCanopyLayer:
+                if (tile->type() == Tile::PanelCanopy)
+                    cell.panels |= tile->tileFlags();
+                if (tile->type() == Tile::CC1_Barrier_S || tile->type() == Tile::CC1_Barrier_SE)
+                    cell.panels |= Tile::PanelSouth;
+                if (tile->type() == Tile::CC1_Barrier_E || tile->type() == Tile::CC1_Barrier_SE)
+                    cell.panels |= Tile::PanelEast;
+                break;
+            case Tile::MobLayer:
+                if (cell.mob < 0) {
+                    Mob mob;
+                    mob.pos = pos;
+                    mob.type = tile->type();
+                    mob.dir = tile->direction() & 0x03;
+                    mob.moveDir = mob.dir;
+                    mob.tileFlags = tile->tileFlags();
+                    mob.pending = -1;
+                    mob.moving = 0;
+                    mob.flags = 0;
+                    cell.mob = (int16_t)m_mobs.size();
+                    if (tile->isPlayer()) {
+                        if (m_activePlayer < 0)
+                            m_activePlayer = cell.mob;
+                        ++m_playersLeft;
+                    }
+                    m_mobs.push_back(mob);
+                }
+                break;
+            default:
+                break;
+            }
+            tile = tile->lower();
+        }
+    }
+
+    // Buttons are connected to the next matching tile in reading order
+    const int numCells = m_width * m_height;
+    for (int pos = 0; pos < numCells; ++pos) {
+        const bool isTrap = (m_cells[pos].terrain == Tile::TrapButton);
+        if (!isTrap && m_cells[pos].terrain != Tile::CloneButton)
+            continue;
+
+        for (int scan = (pos + 1) % numCells; scan != pos; scan = (scan + 1) % numCells) {
+            const int target = m_cells[scan].terrain;
+            if (isTrap && target == Tile::Trap) {
+                m_trapLinks.emplace_back(pos, scan);
+                break;
+            } else if (!isTrap && (target == Tile::Cloner || target == Tile::CC1_Cloner)) {
+                m_cloneLinks.emplace_back(pos, scan);
+                break;
+            }
+        }
+    }
+
+    if (m_unsupported)
+        m_status = SimUnsupported;
+    else if (m_activePlayer < 0)
+        m_status = SimNoPlayer;
+}
+
+cc2::SimulationStatus cc2::Simulation::replay(const Map* map)
+{
+    Replay replay;
+    replay.decode(map->replay());
+    reset(map, replay.forceDirection(), replay.blobSeed());
+
+    // Allow a short grace period past the recorded input, since the final
+    // move may still need a few ticks to complete
+    const unsigned int lastTick = replay.tickCount() + TicksPerSecond;
+    while (m_status == SimRunning && m_tick < lastTick)
+        tick(replay.input(m_tick));
+
+    return m_status;
+}
+
+void cc2::Simulation::exportState(MapData& mapData) const
+{
+    const int width = std::min<int>(m_width, mapData.width());
+    const int height = std::min<int>(m_height, mapData.height());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const Cell& cell = m_cells[(y * m_width) + x];
+            Tile stack(cell.terrain, cell.terrainMod);
+            auto pushLayer = [&stack](Tile top) {
+                *top.lower() = std::move(stack);
+                stack = std::move(top);
+            };
+
+            if (cell.item != Tile::Invalid)
+                pushLayer(Tile(cell.item));
+            if (cell.noSign)
+                pushLayer(Tile(Tile::Disallow));
+            if (cell.mob >= 0) {
+                const Mob& mob = m_mobs[cell.mob];
+                Tile mobTile(mob.type, (Tile::Direction)mob.dir, 0);
+                mobTile.setTileFlags(mob.tileFlags);
+                pushLayer(std::move(mobTile));
+            }
+            if (cell.panels != 0)
+                pushLayer(Tile::panelTile(cell.panels));
+
+            mapData.tile(x, y) = std::move(stack);
+        }
+    }
+}
+
+cc2::Simulation::MobClass cc2::Simulation::classOf(const Mob& mob)
+{
+    switch (mob.type) {
+    case Tile::Player:
+    case Tile::Player2:
+        return ClassPlayer;
+    case Tile::DirtBlock:
+    case Tile::IceBlock:
+    case Tile::DirBlock:
+        return ClassBlock;
+    default:
+        return ClassMonster;
+    }
+}
+
+uint8_t cc2::Simulation::random()
+{
+    uint8_t n = (uint8_t)((m_prng1 >> 2) - m_prng1);
+    if ((m_prng1 & 0x02) == 0)
+        --n;
+    m_prng1 = (uint8_t)((m_prng1 >> 1) | (m_prng2 & 0x80));
+    m_prng2 = (uint8_t)((m_prng2 << 1) | (n & 0x01));
+    return m_prng1 ^ m_prng2;
+}
+
+uint8_t cc2::Simulation::blobModifier()
+{
+    const uint8_t modifier = m_blobModifier;
+    if (m_blobPattern == MapOption::Blobs4Pattern) {
+        m_blobModifier = (m_blobModifier + 1) & 0x03;
+    } else {
+        int next = m_blobModifier * 2;
+        if (next < 255)
+            next ^= 0x1d;
+        m_blobModifier = (uint8_t)next;
+    }
+    return modifier;
+}
+
+int cc2::Simulation::neighbor(int pos, int dir) const
+{
+    const int x = pos % m_width;
+    const int y = pos / m_width;
+    switch (dir) {
+    case Tile::North:
+        return (y > 0) ? pos - m_width : -1;
+    case Tile::East:
+        return (x < m_width - 1) ? pos + 1 : -1;
+    case Tile::South:
+        return (y < m_height - 1) ? pos + m_width : -1;
+    case Tile::West:
+        return (x > 0) ? pos - 1 : -1;
+    default:
+        return -1;
+    }
+}
+
+bool cc2::Simulation::haveTool(uint8_t tool) const
+{
+    return std::find(std::begin(m_tools), std::end(m_tools), tool) != std::end(m_tools);
+}
+
+void cc2::Simulation::addTool(uint8_t tool)
+{
+    // When the inventory is full, the oldest tool is lost
+    uint8_t* slot = std::find(std::begin(m_tools), std::end(m_tools), (uint8_t)Tile::Invalid);
+    if (slot == std::end(m_tools)) {
+        std::rotate(std::begin(m_tools), std::begin(m_tools) + 1, std::end(m_tools));
+        slot = std::end(m_tools) - 1;
+    }
+    *slot = tool;
+}
+
+bool cc2::Simulation::trapOpen(int pos) const
+{
+    for (const auto& link : m_trapLinks) {
+        if (link.second == pos && m_cells[link.first].mob >= 0)
+            return true;
+    }
+    return false;
+}
+
+bool cc2::Simulation::canEnter(const Mob& mob, int dest, int dir) const
+{
+    const Cell& cell = m_cells[dest];
+    if ((cell.panels & (1 << DIR_BACK(dir))) != 0 || entryBlocked(cell.terrain, dir))
+        return false;
+
+    const MobClass mobClass = classOf(mob);
+    const bool isPlayer = (mobClass == ClassPlayer);
+    switch (cell.terrain) {
+    case Tile::Door_Red:
+    case Tile::Door_Blue:
+    case Tile::Door_Yellow:
+    case Tile::Door_Green:
+        return isPlayer && m_keys[cell.terrain - Tile::Door_Red] > 0;
+    case Tile::Socket:
+        return isPlayer && m_chipsLeft == 0;
+    case Tile::Exit:
+    case Tile::Dirt:
+    case Tile::BlueFloor:
+    case Tile::PopUpWall:
+    case Tile::PopDownGWall:
+    case Tile::ToolThief:
+    case Tile::KeyThief:
+        if (!isPlayer)
+            return false;
+        break;
+    case Tile::MaleOnly:
+        if (mob.type != Tile::Player)
+            return false;
+        break;
+    case Tile::FemaleOnly:
+        if (mob.type != Tile::Player2)
+            return false;
+        break;
+    case Tile::Gravel:
+        if (mobClass == ClassMonster)
+            return false;
+        break;
+    case Tile::Fire:
+    case Tile::FlameJet_On:
+        // Monsters treat fire as a wall, except for fireballs
+        if (mobClass == ClassMonster && mob.type != Tile::FireBox)
+            return false;
+        break;
+    case Tile::AppearingWall:
+    case Tile::InvisWall:
+    case Tile::BlueWall:
+        // Solid, although they look like floor; bump() reveals them
+        return false;
+    case Tile::ToggleWall:
+    case Tile::LSwitchWall:
+    case Tile::StayUpGWall:
+    case Tile::LogicGate:
+    case Tile::RevolvDoor_SW:
+    case Tile::RevolvDoor_NW:
+    case Tile::RevolvDoor_NE:
+    case Tile::RevolvDoor_SE:
+        return false;
+    default:
+        if (!isTeleport(cell.terrain) && Tile::tileClass(cell.terrain) != Tile::ClassTerrain)
+            return false;
+        break;
+    }
+
+    if (cell.item != Tile::Invalid) {
+        const bool isBomb = (cell.item == Tile::RedBomb || cell.item == Tile::GreenBomb);
+        if (mobClass == ClassMonster && !isBomb && mob.type != Tile::Ghost)
+            return false;
+        if (isPlayer && cell.noSign && haveTool(cell.item))
+            return false;
+    }
+    return true;
+}
+
+bool cc2::Simulation::canMove(const Mob& mob, int from, int dir, int depth) const
+{
+    const Cell& src = m_cells[from];
+    if ((src.panels & (1 << dir)) != 0 || exitBlocked(src.terrain, dir))
+        return false;
+    if (src.terrain == Tile::Trap && !trapOpen(from))
+        return false;
+
+    const int dest = neighbor(from, dir);
+    if (dest < 0 || !canEnter(mob, dest, dir))
+        return false;
+
+    const int occupant = m_cells[dest].mob;
+    if (occupant < 0)
+        return true;
+
+    const Mob& other = m_mobs[occupant];
+    const MobClass mobClass = classOf(mob);
+    const MobClass otherClass = classOf(other);
+    if (otherClass == ClassBlock && (mobClass == ClassPlayer
+            || (mobClass == ClassBlock && mob.type != Tile::DirtBlock))) {
+        // Players can push blocks, and ice and directional blocks can push
+        // other blocks in turn
+        if (depth >= 8 || other.moving > 0)
+            return false;
+        if (other.type == Tile::DirBlock && (other.tileFlags & (1 << dir)) == 0)
+            return false;
+        return canMove(other, dest, dir, depth + 1);
+    }
+    if (mobClass == ClassPlayer)
+        return otherClass == ClassMonster;
+    return otherClass == ClassPlayer;
+}
+
+cc2::SimulationStatus cc2::Simulation::tick(uint8_t input)
+{
+    if (m_status != SimRunning)
+        return m_status;
+    if (m_timed && !m_timeFrozen && m_timeLeft <= 0) {
+        m_status = SimTimeOut;
+        return m_status;
+    }
+
+    const uint8_t pressed = input & ~m_lastInput;
+    m_lastInput = input;
+    if ((pressed & InputSwitch) != 0) {
+        for (size_t i = 1; i <= m_mobs.size(); ++i) {
+            const size_t idx = (m_activePlayer + i) % m_mobs.size();
+            if (classOf(m_mobs[idx]) == ClassPlayer && (m_mobs[idx].flags & MobHidden) == 0) {
+                m_activePlayer = (int)idx;
+                break;
+            }
+        }
+    }
+    if ((pressed & InputCycle) != 0)
+        std::rotate(std::begin(m_tools), std::begin(m_tools) + 1, std::end(m_tools));
+    if ((pressed & InputDrop) != 0)
+        dropTool(m_mobs[m_activePlayer]);
+
+    // Mobs cloned during this tick don't act until the next one
+    const size_t count = m_mobs.size();
+    for (size_t i = count; i > 0; --i)
+        m_mobs[i - 1].pending = (int8_t)chooseMove(i - 1, input);
+
+    for (size_t i = count; i > 0 && m_status == SimRunning; --i) {
+        Mob& mob = m_mobs[i - 1];
+        if (mob.pending < 0 || (mob.flags & MobHidden) != 0 || mob.moving > 0)
+            continue;
+
+        const int dir = mob.pending;
+        mob.pending = -1;
+        if (canMove(mob, mob.pos, dir))
+            startMove(i - 1, dir);
+        else if (classOf(mob) == ClassPlayer)
+            bump(mob.pos, dir);
+    }
+
+    for (size_t i = count; i > 0 && m_status == SimRunning; --i) {
+        Mob& mob = m_mobs[i - 1];
+        if ((mob.flags & MobHidden) != 0 || mob.moving <= 0)
+            continue;
+
+        if (--mob.moving == 0)
+            arrive(i - 1);
+    }
+
+    ++m_tick;
+    if (m_timed && !m_timeFrozen)
+        --m_timeLeft;
+    return m_status;
+}
+
+int cc2::Simulation::chooseMove(size_t idx, int input)
+{
+    Mob& mob = m_mobs[idx];
+    if ((mob.flags & MobHidden) != 0 || mob.moving > 0)
+        return -1;
+
+    const MobClass mobClass = classOf(mob);
+    const int terrain = m_cells[mob.pos].terrain;
+    if (mobClass != ClassPlayer && (terrain == Tile::Cloner || terrain == Tile::CC1_Cloner)) {
+        // Mobs on a clone machine only move when cloned
+        return -1;
+    }
+    if (terrain == Tile::Trap && !trapOpen(mob.pos))
+        return -1;
+
+    if ((mob.flags & MobSliding) != 0) {
+        const int dir = forcedMove(mob, ((int)idx == m_activePlayer) ? input : InputNone);
+        if (dir >= 0)
+            return dir;
+    }
+    mob.flags &= ~(MobSliding | MobFast);
+
+    if (mobClass == ClassMonster)
+        return chooseMonsterMove(mob);
+    if (mobClass == ClassBlock || (int)idx != m_activePlayer)
+        return -1;
+
+    int tryDirs[4];
+    int numDirs = 0;
+    for (int dir = Tile::North; dir <= Tile::West; ++dir) {
+        if ((input & s_inputDirs[dir]) != 0)
+            tryDirs[numDirs++] = dir;
+    }
+    if (numDirs == 0)
+        return -1;
+
+    // For diagonal input, try turning away from the current facing first
+    if (numDirs == 2 && (tryDirs[0] & 0x01) == (mob.dir & 0x01))
+        std::swap(tryDirs[0], tryDirs[1]);
+
+    for (int i = 0; i < numDirs; ++i) {
+        if (canMove(mob, mob.pos, tryDirs[i]))
+            return tryDirs[i];
+        bump(mob.pos, tryDirs[i]);
+    }
+    mob.dir = tryDirs[0];
+    return -1;
+}
+
+int cc2::Simulation::forcedMove(Mob& mob, int input)
+{
+    const int terrain = m_cells[mob.pos].terrain;
+    if (classOf(mob) == ClassPlayer && isForce(terrain) && (input & InputDirMask) != 0) {
+        // The player may step off of a force floor, but not against it
+        for (int dir = Tile::North; dir <= Tile::West; ++dir) {
+            if ((input & s_inputDirs[dir]) != 0 && dir != DIR_BACK(mob.moveDir)
+                    && canMove(mob, mob.pos, dir)) {
+                mob.flags &= ~(MobSliding | MobFast);
+                return dir;
+            }
+        }
+    }
+
+    if (canMove(mob, mob.pos, mob.moveDir)) {
+        mob.flags |= MobFast;
+        return mob.moveDir;
+    }
+    if (isIce(terrain)) {
+        // Bounce off of walls while sliding on ice
+        const int back = DIR_BACK(mob.moveDir);
+        if (canMove(mob, mob.pos, back)) {
+            mob.flags |= MobFast;
+            return back;
+        }
+    }
+    return -1;
+}
+
+int cc2::Simulation::chooseMonsterMove(Mob& mob)
+{
+    int dirs[4];
+    int numDirs = 0;
+    const int facing = mob.dir;
+
+    switch (mob.type) {
+    case Tile::Ant:
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case Tile::Centipede:
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case Tile::FireBox:
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case Tile::Ship:
+    case Tile::Ghost:
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_LEFT(facing);
+        dirs[numDirs++] = DIR_RIGHT(facing);
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case Tile::Ball:
+        dirs[numDirs++] = facing;
+        dirs[numDirs++] = DIR_BACK(facing);
+        break;
+    case Tile::BlueTank:
+        dirs[numDirs++] = facing;
+        break;
+    case Tile::Walker:
+        if (canMove(mob, mob.pos, facing))
+            return facing;
+        // Turn in a random direction when blocked
+        dirs[numDirs++] = (facing + (random() % 3) + 1) & 0x03;
+        break;
+    case Tile::Blob:
+        dirs[numDirs++] = (random() + blobModifier()) & 0x03;
+        break;
+    case Tile::AngryTeeth:
+    case Tile::TimidTeeth:
+        {
+            const Mob& player = m_mobs[m_activePlayer];
+            int dx = (player.pos % m_width) - (mob.pos % m_width);
+            int dy = (player.pos / m_width) - (mob.pos / m_width);
+            if (mob.type == Tile::TimidTeeth) {
+                dx = -dx;
+                dy = -dy;
+            }
+            const int horiz = (dx < 0) ? Tile::West : (dx > 0) ? Tile::East : -1;
+            const int vert = (dy < 0) ? Tile::North : (dy > 0) ? Tile::South : -1;
+            if (std::abs(dx) > std::abs(dy)) {
+                dirs[numDirs++] = horiz;
+                if (vert >= 0)
+                    dirs[numDirs++] = vert;
+            } else if (vert >= 0) {
+                dirs[numDirs++] = vert;
+                if (horiz >= 0)
+                    dirs[numDirs++] = horiz;
+            }
+            // Teeth always face their target, even when blocked
+            if (numDirs > 0)
+                mob.dir = dirs[0];
+        }
+        break;
+    default:
+        return -1;
+    }
+
+    for (int i = 0; i < numDirs; ++i) {
+        if (canMove(mob, mob.pos, dirs[i]))
+            return dirs[i];
+    }
+    return -1;
+}
+
+void cc2::Simulation::startMove(size_t idx, int dir)
+{
+    Mob& mob = m_mobs[idx];
+    const int dest = neighbor(mob.pos, dir);
+    Q_ASSERT(dest >= 0);
+
+    const MobClass mobClass = classOf(mob);
+    const int occupant = m_cells[dest].mob;
+    if (occupant >= 0) {
+        Mob& other = m_mobs[occupant];
+        if (classOf(other) == ClassBlock && mobClass != ClassMonster) {
+            other.flags &= ~(MobSliding | MobFast);
+            startMove(occupant, dir);
+        } else {
+            // Either a player walked into a monster, or a monster or
+            // block walked into a player
+            killPlayer();
+        }
+    }
+
+    Cell& src = m_cells[mob.pos];
+    if (src.mob == (int16_t)idx)
+        src.mob = -1;
+    if (src.terrain == Tile::Turtle)
+        src.terrain = Tile::Water;
+
+    Cell& dst = m_cells[dest];
+    if (mobClass == ClassPlayer) {
+        if (src.terrain == Tile::PopUpWall)
+            src.terrain = Tile::Wall;
+
+        switch (dst.terrain) {
+        case Tile::Door_Red:
+        case Tile::Door_Blue:
+        case Tile::Door_Yellow:
+            --m_keys[dst.terrain - Tile::Door_Red];
+            dst.terrain = Tile::Floor;
+            break;
+        case Tile::Door_Green:
+            // Green keys are never used up
+            dst.terrain = Tile::Floor;
+            break;
+        case Tile::Socket:
+        case Tile::Dirt:
+        case Tile::BlueFloor:
+        case Tile::PopDownGWall:
+            dst.terrain = Tile::Floor;
+            break;
+        default:
+            break;
+        }
+    }
+
+    dst.mob = (int16_t)idx;
+    mob.pos = dest;
+    mob.dir = dir;
+    mob.moveDir = dir;
+    mob.flags &= ~MobSliding;
+
+    if ((mob.flags & MobFast) != 0)
+        mob.moving = 2;
+    else if (mobClass == ClassPlayer && haveTool(Tile::SpeedShoes))
+        mob.moving = 2;
+    else if (mob.type == Tile::Blob || mob.type == Tile::AngryTeeth || mob.type == Tile::TimidTeeth)
+        mob.moving = 8;
+    else
+        mob.moving = 4;
+}
+
+void cc2::Simulation::arrive(size_t idx)
+{
+    const int pos = m_mobs[idx].pos;
+    Cell& cell = m_cells[pos];
+    m_mobs[idx].flags &= ~MobFast;
+
+    const MobClass mobClass = classOf(m_mobs[idx]);
+    const int mobType = m_mobs[idx].type;
+    if (cell.item == Tile::RedBomb || cell.item == Tile::GreenBomb) {
+        cell.item = Tile::Invalid;
+        if (mobClass == ClassPlayer)
+            killPlayer();
+        else
+            removeMob(idx);
+        return;
+    }
+
+    switch (mobClass) {
+    case ClassPlayer:
+        if (cell.item != Tile::Invalid && !cell.noSign) {
+            switch (cell.item) {
+            case Tile::Chip:
+            case Tile::GreenChip:
+                if (m_chipsLeft > 0)
+                    --m_chipsLeft;
+                break;
+            case Tile::Key_Red:
+            case Tile::Key_Blue:
+            case Tile::Key_Yellow:
+            case Tile::Key_Green:
+                if (m_keys[cell.item - Tile::Key_Red] < 255)
+                    ++m_keys[cell.item - Tile::Key_Red];
+                break;
+            case Tile::Flag10:
+                m_bonus += 10;
+                break;
+            case Tile::Flag100:
+                m_bonus += 100;
+                break;
+            case Tile::Flag1000:
+                m_bonus += 1000;
+                break;
+            case Tile::Flag2x:
+                m_bonus *= 2;
+                break;
+            case Tile::TimeBonus:
+                if (m_timed)
+                    m_timeLeft += 10 * TicksPerSecond;
+                break;
+            case Tile::TimePenalty:
+                if (m_timed)
+                    m_timeLeft = std::max(0, m_timeLeft - (10 * TicksPerSecond));
+                break;
+            case Tile::ToggleClock:
+                m_timeFrozen = !m_timeFrozen;
+                break;
+            default:
+                if (isTool(cell.item))
+                    addTool(cell.item);
+                break;
+            }
+            cell.item = Tile::Invalid;
+        }
+
+        switch (cell.terrain) {
+        case Tile::Water:
+            if (!haveTool(Tile::Flippers))
+                killPlayer();
+            break;
+        case Tile::Fire:
+        case Tile::FlameJet_On:
+            if (!haveTool(Tile::FireShoes))
+                killPlayer();
+            break;
+        case Tile::Slime:
+            killPlayer();
+            break;
+        case Tile::ToolThief:
+        case Tile::KeyThief:
+            if (haveTool(Tile::Bribe)) {
+                *std::find(std::begin(m_tools), std::end(m_tools), (uint8_t)Tile::Bribe)
+                        = Tile::Invalid;
+            } else {
+                if (cell.terrain == Tile::ToolThief)
+                    std::fill(std::begin(m_tools), std::end(m_tools), (uint8_t)Tile::Invalid);
+                else
+                    std::fill(std::begin(m_keys), std::end(m_keys), 0);
+                m_bonus /= 2;
+            }
+            break;
+        case Tile::Exit:
+            removeMob(idx);
+            if (--m_playersLeft == 0) {
+                m_status = SimSuccess;
+            } else if ((int)idx == m_activePlayer) {
+                // Control passes to the next remaining player
+                for (size_t i = 0; i < m_mobs.size(); ++i) {
+                    if (classOf(m_mobs[i]) == ClassPlayer && (m_mobs[i].flags & MobHidden) == 0) {
+                        m_activePlayer = (int)i;
+                        break;
+                    }
+                }
+            }
+            return;
+        default:
+            break;
+        }
+        break;
+    case ClassBlock:
+        if (cell.terrain == Tile::Water) {
+            cell.terrain = (mobType == Tile::DirtBlock) ? Tile::Dirt
+                         : (mobType == Tile::IceBlock) ? Tile::Ice : Tile::Floor;
+            removeMob(idx);
+            return;
+        }
+        if (mobType == Tile::IceBlock && (cell.terrain == Tile::Fire
+                                          || cell.terrain == Tile::FlameJet_On)) {
+            cell.terrain = Tile::Water;
+            removeMob(idx);
+            return;
+        }
+        if (cell.terrain == Tile::Slime)
+            cell.terrain = Tile::Floor;
+        break;
+    case ClassMonster:
+        if ((cell.terrain == Tile::Water && mobType != Tile::Ship && mobType != Tile::Ghost)
+                || ((cell.terrain == Tile::Fire || cell.terrain == Tile::FlameJet_On)
+                    && mobType != Tile::FireBox)
+                || (cell.terrain == Tile::Slime && mobType != Tile::Blob)) {
+            removeMob(idx);
+            return;
+        }
+        break;
+    }
+
+    if (m_status != SimRunning)
+        return;
+
+    // Pressing a clone button may add to the mob list, so don't hold any
+    // references across this call
+    pressButton(pos);
+    if (isTeleport(cell.terrain)) {
+        teleport(idx);
+        return;
+    }
+
+    Mob& mob = m_mobs[idx];
+    const bool isPlayer = (mobClass == ClassPlayer);
+    if (isIce(cell.terrain) && !(isPlayer && haveTool(Tile::IceCleats))) {
+        mob.moveDir = deflect(cell.terrain, mob.moveDir);
+        if (!isPlayer)
+            mob.dir = mob.moveDir;
+        mob.flags |= MobSliding;
+    } else if (isForce(cell.terrain) && !(isPlayer && haveTool(Tile::MagnoShoes))) {
+        if (cell.terrain == Tile::Force_Rand) {
+            mob.moveDir = m_forceDir;
+            m_forceDir = DIR_RIGHT(m_forceDir);
+        } else {
+            mob.moveDir = cell.terrain - Tile::Force_N;
+        }
+        mob.flags |= MobSliding;
+    }
+}
+
+void cc2::Simulation::bump(int pos, int dir)
+{
+    // The player reveals hidden walls by bumping into them
+    const int dest = neighbor(pos, dir);
+    if (dest < 0)
+        return;
+    if (m_cells[dest].terrain == Tile::BlueWall || m_cells[dest].terrain == Tile::AppearingWall)
+        m_cells[dest].terrain = Tile::Wall;
+}
+
+void cc2::Simulation::dropTool(Mob& player)
+{
+    Cell& cell = m_cells[player.pos];
+    if (m_tools[0] == Tile::Invalid || cell.item != Tile::Invalid || cell.noSign)
+        return;
+
+    cell.item = m_tools[0];
+    std::rotate(std::begin(m_tools), std::begin(m_tools) + 1, std::end(m_tools));
+    m_tools[3] = Tile::Invalid;
+}
+
+void cc2::Simulation::pressButton(int pos)
+{
+    switch (m_cells[pos].terrain) {
+    case Tile::ToggleButton:
+        for (Cell& cell : m_cells) {
+            if (cell.terrain == Tile::ToggleWall)
+                cell.terrain = Tile::ToggleFloor;
+            else if (cell.terrain == Tile::ToggleFloor)
+                cell.terrain = Tile::ToggleWall;
+            if (cell.item == Tile::GreenChip)
+                cell.item = Tile::GreenBomb;
+            else if (cell.item == Tile::GreenBomb)
+                cell.item = Tile::GreenChip;
+        }
+        break;
+    case Tile::TankButton:
+        for (Mob& mob : m_mobs) {
+            if (mob.type == Tile::BlueTank && (mob.flags & MobHidden) == 0) {
+                mob.dir = DIR_BACK(mob.dir);
+                if (mob.moving <= 0)
+                    mob.moveDir = mob.dir;
+            }
+        }
+        break;
+    case Tile::CloneButton:
+        for (const auto& link : m_cloneLinks) {
+            if (link.first == pos)
+                cloneMob(link.second);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void cc2::Simulation::cloneMob(int clonerPos)
+{
+    const int idx = m_cells[clonerPos].mob;
+    if (idx < 0)
+        return;
+
+    const Mob& original = m_mobs[idx];
+    if (m_mobs.size() >= MaxMobs || classOf(original) == ClassPlayer || original.moving > 0
+            || !canMove(original, clonerPos, original.dir))
+        return;
+
+    // The original leaves the clone machine, and the copy remains behind
+    // to be cloned again later
+    Mob clone = original;
+    clone.pending = -1;
+    clone.moving = 0;
+    clone.flags = 0;
+    startMove(idx, original.dir);
+
+    m_cells[clonerPos].mob = (int16_t)m_mobs.size();
+    m_mobs.push_back(clone);
+}
+
+void cc2::Simulation::teleport(size_t idx)
+{
+    Mob& mob = m_mobs[idx];
+    const int start = mob.pos;
+    const int type = m_cells[start].terrain;
+    const int numCells = m_width * m_height;
+
+    int dest = start;
+    if (type == Tile::Teleport_Green) {
+        // Green teleports pick a random destination
+        std::vector<int> targets;
+        for (int pos = 0; pos < numCells; ++pos) {
+            if (pos != start && m_cells[pos].terrain == type && m_cells[pos].mob < 0
+                    && canMove(mob, pos, mob.moveDir))
+                targets.push_back(pos);
+        }
+        if (!targets.empty())
+            dest = targets[random() % targets.size()];
+    } else {
+        // Search backwards in reading order for a matching teleport the mob
+        // can exit from
+        int pos = start;
+        do {
+            pos = (pos == 0 ? numCells : pos) - 1;
+            if (m_cells[pos].terrain == type && m_cells[pos].mob < 0
+                    && canMove(mob, pos, mob.moveDir)) {
+                dest = pos;
+                break;
+            }
+        } while (pos != start);
+    }
+
+    if (dest != start) {
+        m_cells[start].mob = -1;
+        m_cells[dest].mob = (int16_t)idx;
+        mob.pos = dest;
+    }
+    mob.flags |= MobSliding;
+}
+
+void cc2::Simulation::removeMob(size_t idx)
+{
+    Mob& mob = m_mobs[idx];
+    mob.flags |= MobHidden;
+    if (m_cells[mob.pos].mob == (int16_t)idx)
+        m_cells[mob.pos].mob = -1;
+}
+
+void cc2::Simulation::killPlayer()
+{
+    m_status = SimDied;
+}
@@ -0,0 +1,190 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_SIMULATION_H
+#define _CC2_SIMULATION_H
+
+#include "Map.h"
+
+namespace cc2 {
+
+/* Input bits, as stored in CC2 replay data */
+enum InputFlags {
+    InputNone   = 0,
+    InputDrop   = 0x01,
+    InputSouth  = 0x02,
+    InputWest   = 0x04,
+    InputEast   = 0x08,
+    InputNorth  = 0x10,
+    InputSwitch = 0x20,     // Switch between players
+    InputCycle  = 0x40,     // Cycle the inventory
+    InputDirMask = InputNorth | InputEast | InputSouth | InputWest,
+};
+
+class Replay {
+public:
+    Replay() : m_forceDirection(Tile::North), m_blobSeed() { }
+
+    void decode(const std::vector<uint8_t>& data);
+
+    Tile::Direction forceDirection() const { return m_forceDirection; }
+    uint8_t blobSeed() const { return m_blobSeed; }
+
+    unsigned int tickCount() const { return (unsigned int)m_inputs.size(); }
+    uint8_t input(unsigned int tick) const
+    {
+        return (tick < m_inputs.size()) ? m_inputs[tick] : (uint8_t)InputNone;
+    }
+
+private:
+    Tile::Direction m_forceDirection;
+    uint8_t m_blobSeed;
+
+    // Input held at the start of each tick
+    std::vector<uint8_t> m_inputs;
+};
+
+enum SimulationStatus {
+    SimRunning,     // Level is still in progress
+    SimSuccess,     // All players reached the exit
+    SimDied,        // A player was killed
+    SimTimeOut,     // Level timer ran out
+    SimNoPlayer,    // Map has no player to control
+    SimUnsupported, // Map uses tiles the simulation does not model
+};
+
+/* Experimental headless simulation of the CC2 ruleset over MapData.
+ * Wires and wired logic, trains, rovers, mirror players, yellow tanks,
+ * flame jets, gray buttons and transmogrifiers are not modeled yet, so maps
+ * using them end with SimUnsupported instead of being played.  An instance
+ * may be reset() and reused for any number of maps, which avoids
+ * reallocating state when verifying an entire game.
+ */
+class Simulation {
+public:
+    enum { TicksPerSecond = 20, FramesPerTick = 3 };
+
+    // Mobs are indexed by int16_t, so clone machines stop at this many
+    enum { MaxMobs = 0x7fff };
+
+    Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    void reset(const Map* map, Tile::Direction forceDirection = Tile::North,
+               uint8_t blobSeed = 0);
+    SimulationStatus tick(uint8_t input);
+
+    // Play back the replay stored with the map from the start of the level
+    SimulationStatus replay(const Map* map);
+
+    SimulationStatus status() const { return m_status; }
+    unsigned int tickCount() const { return m_tick; }
+    int chipsLeft() const { return m_chipsLeft; }
+    int bonusPoints() const { return m_bonus; }
+
+    // The first unmodeled feature found by reset(), or nullptr
+    const char* unsupportedFeature() const { return m_unsupported; }
+
+    // Remaining time in ticks, or -1 if the level has no time limit
+    int timeLeft() const { return m_timed ? m_timeLeft : -1; }
+
+    // Write the current simulation state back to a map's tile data
+    void exportState(MapData& mapData) const;
+
+private:
+    struct Cell {
+        uint32_t terrainMod;
+        uint8_t terrain;
+        uint8_t item;
+        uint8_t panels;
+        bool noSign;
+        int16_t mob;
+    };
+
+    struct Mob {
+        int pos;
+        uint8_t type;
+        uint8_t dir;
+        uint8_t moveDir;
+        uint8_t tileFlags;
+        int8_t pending;
+        int8_t moving;      // Ticks remaining in the current move
+        uint8_t flags;
+    };
+
+    enum MobFlags {
+        MobHidden   = (1<<0),   // Removed from play
+        MobSliding  = (1<<1),   // Next move is forced by the terrain
+        MobFast     = (1<<2),   // Current move is a slide
+    };
+
+    enum MobClass { ClassPlayer, ClassBlock, ClassMonster };
+
+    int m_width, m_height;
+    std::vector<Cell> m_cells;
+    std::vector<Mob> m_mobs;
+    std::vector<std::pair<int, int>> m_trapLinks;
+    std::vector<std::pair<int, int>> m_cloneLinks;
+
+    SimulationStatus m_status;
+    const char* m_unsupported;
+    unsigned int m_tick;
+    bool m_timed, m_timeFrozen;
+    int m_timeLeft;
+    int m_chipsLeft;
+    int m_bonus;
+    int m_playersLeft;
+    int m_activePlayer;
+    uint8_t m_lastInput;
+    int m_keys[4];
+    uint8_t m_tools[4];
+    int m_forceDir;
+    MapOption::BlobPattern m_blobPattern;
+    uint8_t m_blobModifier;
+    uint8_t m_prng1, m_prng2;
+
+    static MobClass classOf(const Mob& mob);
+    uint8_t random();
+    uint8_t blobModifier();
+
+    int neighbor(int pos, int dir) const;
+    bool haveTool(uint8_t tool) const;
+    void addTool(uint8_t tool);
+    bool trapOpen(int pos) const;
+    bool canEnter(const Mob& mob, int dest, int dir) const;
+    bool canMove(const Mob& mob, int from, int dir, int depth = 0) const;
+
+    int chooseMove(size_t idx, int input);
+    int chooseMonsterMove(Mob& mob);
+    int forcedMove(Mob& mob, int input);
+    void startMove(size_t idx, int dir);
+    void arrive(size_t idx);
+    void bump(int pos, int dir);
+    void dropTool(Mob& player);
+
+    void pressButton(int pos);
+    void cloneMob(int clonerPos);
+    void teleport(size_t idx);
+    void removeMob(size_t idx);
+    void killPlayer();
+};
+
+}
+
+#endif
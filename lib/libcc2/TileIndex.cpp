@@ -0,0 +1,399 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "TileIndex.h"
+#include "libcc1/DacFile.h"
+#include "libcc1/Levelset.h"
+#include "libcc1/Parallel.h"
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <cstring>
+
+enum { IndexVersion = 1 };
+
+std::vector<uint32_t> cc2::TileIndex::levelTerms(const ccl::LevelData* level)
+{
+    // Terms are collected in bitsets first, which leaves them sorted
+    std::vector<bool> tiles(256), pairs(256 * 256);
+    const ccl::LevelMap& map = level->map();
+    for (int y = 0; y < CCL_HEIGHT; ++y) {
+        for (int x = 0; x < CCL_WIDTH; ++x) {
+            const tile_t upper = map.getFG(x, y);
+            const tile_t lower = map.getBG(x, y);
+            tiles[upper] = true;
+            if (lower != ccl::TileFloor) {
+                tiles[lower] = true;
+                pairs[(upper << 8) | lower] = true;
+            }
+        }
+    }
+
+    std::vector<uint32_t> terms;
+    for (int tile = 0; tile < 256; ++tile) {
+        if (tiles[tile])
+            terms.push_back(cc1Tile((tile_t)tile));
+    }
+    for (int pair = 0; pair < 256 * 256; ++pair) {
+        if (pairs[pair])
+            terms.push_back(cc1Pair((tile_t)(pair >> 8), (tile_t)(pair & 0xFF)));
+    }
+    return terms;
+}
+
+std::vector<uint32_t> cc2::TileIndex::mapTerms(const MapData& map)
+{
+    std::vector<uint32_t> terms;
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            for (const Tile* tile = &map.tile(x, y); tile; tile = tile->lower()) {
+                terms.push_back(cc2Tile(tile->type()));
+                if (tile->modifier() != 0)
+                    terms.push_back(cc2Modifier(tile->type(), tile->modifier()));
+                if (tile->lower())
+                    terms.push_back(cc2Pair(tile->type(), tile->lower()->type()));
+            }
+        }
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    return terms;
+}
+
+void cc2::TileIndex::load(const QString& filename)
+{
+    ccl::FileStream stream;
+    if (!stream.open(filename, ccl::FileStream::Read))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not open %1 for reading")
+                           .arg(filename));
+
+    char magic[4];
+    if (stream.read(magic, 1, sizeof(magic)) != sizeof(magic)
+            || memcmp(magic, "CCTI", 4) != 0 || stream.read32() != IndexVersion)
+        throw ccl::FormatError(ccl::RuntimeError::tr("Invalid tile index file"));
+
+    const long streamSize = stream.size();
+    auto checkCount = [&stream, streamSize](uint32_t count) {
+        // Every counted item takes at least one byte
+        if ((long)count > streamSize - stream.tell())
+            throw ccl::FormatError(ccl::RuntimeError::tr("Corrupt tile index file"));
+    };
+
+    std::vector<FileEntry> files;
+    std::vector<Document> docs;
+    uint32_t count = stream.read32();
+    checkCount(count);
+    files.resize(count);
+    for (FileEntry& file : files) {
+        file.filename = QString::fromUtf8(stream.readZString().c_str());
+        file.modified = stream.read32();
+        file.modified |= (int64_t)stream.read32() << 32;
+        file.size = stream.read32();
+        file.size |= (int64_t)stream.read32() << 32;
+        file.firstDoc = (uint32_t)docs.size();
+        file.docCount = stream.read32();
+        checkCount(file.docCount);
+        for (uint32_t i = 0; i < file.docCount; ++i) {
+            Document doc;
+            doc.file = (uint32_t)(&file - &files[0]);
+            doc.levelNum = stream.read16();
+            doc.name = stream.readZString();
+            docs.push_back(std::move(doc));
+        }
+    }
+
+    std::vector<uint32_t> terms, offsets, postings;
+    count = stream.read32();
+    checkCount(count);
+    terms.reserve(count);
+    offsets.reserve(count + 1);
+    std::vector<uint8_t> buffer;
+    for (uint32_t i = 0; i < count; ++i) {
+        terms.push_back(stream.read32());
+        offsets.push_back((uint32_t)postings.size());
+        const uint32_t docCount = stream.read32();
+        const uint32_t byteCount = stream.read32();
+        checkCount(byteCount);
+        buffer.resize(byteCount);
+        if (stream.read(buffer.data(), 1, byteCount) != byteCount)
+            throw ccl::IOError(ccl::RuntimeError::tr("Read past end of stream"));
+
+        const uint8_t* bp = buffer.data();
+        const uint8_t* end = bp + byteCount;
+        uint32_t doc = 0;
+        for (uint32_t j = 0; j < docCount; ++j) {
+            uint32_t delta = 0;
+            for (int shift = 0; ; shift += 7) {
+                if (bp == end || shift > 28)
+                    throw ccl::FormatError(ccl::RuntimeError::tr("Corrupt tile index file"));
+                delta |= (uint32_t)(*bp & 0x7F) << shift;
+                if ((*bp++ & 0x80) == 0)
+                    break;
+            }
+            doc += delta;
+            if (doc >= docs.size())
+                throw ccl::FormatError(ccl::RuntimeError::tr("Corrupt tile index file"));
+            postings.push_back(doc);
+        }
+    }
+    offsets.push_back((uint32_t)postings.size());
+
+    m_files = std::move(files);
+    m_docs = std::move(docs);
+    m_terms = std::move(terms);
+    m_offsets = std::move(offsets);
+    m_postings = std::move(postings);
+}
+
+void cc2::TileIndex::save(const QString& filename) const
+{
+    ccl::FileStream stream;
+    if (!stream.open(filename, ccl::FileStream::Write))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not open %1 for writing")
+                           .arg(filename));
+
+    stream.write("CCTI", 1, 4);
+    stream.write32(IndexVersion);
+    stream.write32((uint32_t)m_files.size());
+    for (const FileEntry& file : m_files) {
+        stream.writeZString(file.filename.toUtf8().constData());
+        stream.write32((uint32_t)file.modified);
+        stream.write32((uint32_t)(file.modified >> 32));
+        stream.write32((uint32_t)file.size);
+        stream.write32((uint32_t)(file.size >> 32));
+        stream.write32(file.docCount);
+        for (uint32_t i = 0; i < file.docCount; ++i) {
+            const Document& doc = m_docs[file.firstDoc + i];
+            stream.write16((uint16_t)doc.levelNum);
+            stream.writeZString(doc.name);
+        }
+    }
+
+    stream.write32((uint32_t)m_terms.size());
+    std::vector<uint8_t> buffer;
+    for (size_t i = 0; i < m_terms.size(); ++i) {
+        buffer.clear();
+        uint32_t last = 0;
+        for (uint32_t j = m_offsets[i]; j < m_offsets[i + 1]; ++j) {
+            uint32_t delta = m_postings[j] - last;
+            last = m_postings[j];
+            while (delta >= 0x80) {
+                buffer.push_back((uint8_t)(delta | 0x80));
+                delta >>= 7;
+            }
+            buffer.push_back((uint8_t)delta);
+        }
+        stream.write32(m_terms[i]);
+        stream.write32(m_offsets[i + 1] - m_offsets[i]);
+        stream.write32((uint32_t)buffer.size());
+        if (stream.write(buffer.data(), 1, buffer.size()) != buffer.size())
+            throw ccl::IOError(ccl::RuntimeError::tr("Error writing to stream"));
+    }
+}
+
+namespace {
+
+struct ScannedFile {
+    std::vector<cc2::TileIndex::Document> docs;
+    std::vector<std::vector<uint32_t>> terms;
+};
+
+}
+
+static void scanFile(const QString& filename, ScannedFile& scanned)
+{
+    if (filename.endsWith(QLatin1String(".c2m"), Qt::CaseInsensitive)) {
+        cc2::Map map;
+        ccl::FileStream stream;
+        if (!stream.open(filename, ccl::FileStream::Read))
+            throw ccl::IOError(ccl::RuntimeError::tr("Could not open %1 for reading")
+                               .arg(filename));
+        map.read(&stream);
+        scanned.docs.push_back(cc2::TileIndex::Document { 0, 0, map.title() });
+        scanned.terms.push_back(cc2::TileIndex::mapTerms(map.mapData()));
+    } else {
+        std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(filename));
+        for (int i = 0; i < levelset->levelCount(); ++i) {
+            const ccl::LevelData* level = levelset->level(i);
+            scanned.docs.push_back(cc2::TileIndex::Document { 0, i + 1, level->name() });
+            scanned.terms.push_back(cc2::TileIndex::levelTerms(level));
+        }
+    }
+}
+
+size_t cc2::TileIndex::update(const QStringList& files, unsigned int threads)
+{
+    std::map<QString, size_t> oldFiles;
+    for (size_t i = 0; i < m_files.size(); ++i)
+        oldFiles[m_files[i].filename] = i;
+
+    std::vector<FileEntry> newFiles;
+    std::vector<size_t> source;     // Old file index, or -1 to rescan
+    std::vector<size_t> rescan;     // Indices into newFiles
+    std::map<QString, bool> seen;
+    for (const QString& filename : files) {
+        QFileInfo info(filename);
+        FileEntry entry;
+        entry.filename = info.absoluteFilePath();
+        if (seen[entry.filename])
+            continue;
+        seen[entry.filename] = true;
+        entry.modified = info.lastModified().toMSecsSinceEpoch();
+        entry.size = info.size();
+        entry.firstDoc = 0;
+        entry.docCount = 0;
+
+        auto iter = oldFiles.find(entry.filename);
+        if (iter != oldFiles.end() && m_files[iter->second].modified == entry.modified
+                && m_files[iter->second].size == entry.size) {
+            source.push_back(iter->second);
+        } else {
+            source.push_back((size_t)-1);
+            rescan.push_back(newFiles.size());
+        }
+        newFiles.push_back(entry);
+    }
+
+    std::vector<ScannedFile> scanned(rescan.size());
+    ccl::RunParallel(rescan.size(), threads, [&](unsigned int, size_t index) {
+        try {
+            scanFile(newFiles[rescan[index]].filename, scanned[index]);
+        } catch (const ccl::RuntimeError&) {
+            // Unreadable files are kept with no documents, so they aren't
+            // retried until they change
+            scanned[index] = ScannedFile();
+        }
+    });
+
+    // Renumber documents in file order, and gather (term, doc) pairs from
+    // both the surviving postings and the newly scanned files
+    std::vector<Document> newDocs;
+    std::vector<uint32_t> remap(m_docs.size(), (uint32_t)-1);
+    std::vector<uint64_t> pairs;
+    size_t scanIndex = 0;
+    for (size_t i = 0; i < newFiles.size(); ++i) {
+        FileEntry& file = newFiles[i];
+        file.firstDoc = (uint32_t)newDocs.size();
+        if (source[i] != (size_t)-1) {
+            const FileEntry& oldFile = m_files[source[i]];
+            file.docCount = oldFile.docCount;
+            for (uint32_t j = 0; j < oldFile.docCount; ++j) {
+                remap[oldFile.firstDoc + j] = (uint32_t)newDocs.size();
+                newDocs.push_back(m_docs[oldFile.firstDoc + j]);
+                newDocs.back().file = (uint32_t)i;
+            }
+        } else {
+            ScannedFile& scan = scanned[scanIndex++];
+            file.docCount = (uint32_t)scan.docs.size();
+            for (size_t j = 0; j < scan.docs.size(); ++j) {
+                const uint64_t doc = newDocs.size();
+                for (uint32_t term : scan.terms[j])
+                    pairs.push_back(((uint64_t)term << 32) | doc);
+                newDocs.push_back(std::move(scan.docs[j]));
+                newDocs.back().file = (uint32_t)i;
+            }
+            scan = ScannedFile();
+        }
+    }
+    for (size_t i = 0; i < m_terms.size(); ++i) {
+        for (uint32_t j = m_offsets[i]; j < m_offsets[i + 1]; ++j) {
+            const uint32_t doc = remap[m_postings[j]];
+            if (doc != (uint32_t)-1)
+                pairs.push_back(((uint64_t)m_terms[i] << 32) | doc);
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    m_terms.clear();
+    m_offsets.clear();
+    m_postings.clear();
+    m_postings.reserve(pairs.size());
+    for (uint64_t pair : pairs) {
+        const uint32_t term = (uint32_t)(pair >> 32);
+        if (m_terms.empty() || m_terms.back() != term) {
+            m_terms.push_back(term);
+            m_offsets.push_back((uint32_t)m_postings.size());
+        }
+        m_postings.push_back((uint32_t)pair);
+    }
+    m_offsets.push_back((uint32_t)m_postings.size());
+
+    m_files = std::move(newFiles);
+    m_docs = std::move(newDocs);
+    return rescan.size();
+}
+
+const uint32_t* cc2::TileIndex::findPostings(uint32_t term, size_t* count) const
+{
+    auto iter = std::lower_bound(m_terms.begin(), m_terms.end(), term);
+    if (iter == m_terms.end() || *iter != term) {
+        *count = 0;
+        return nullptr;
+    }
+    const size_t index = iter - m_terms.begin();
+    *count = m_offsets[index + 1] - m_offsets[index];
+    return &m_postings[m_offsets[index]];
+}
+
+size_t cc2::TileIndex::documentCount(uint32_t term) const
+{
+    size_t count;
+    findPostings(term, &count);
+    return count;
+}
+
+std::vector<uint32_t> cc2::TileIndex::query(const std::vector<uint32_t>& terms) const
+{
+    if (terms.empty())
+        return std::vector<uint32_t>();
+
+    // Intersect starting from the rarest term, so the candidate list only
+    // ever shrinks
+    typedef std::pair<const uint32_t*, size_t> PostingList;
+    std::vector<PostingList> lists;
+    for (uint32_t term : terms) {
+        size_t count;
+        const uint32_t* postings = findPostings(term, &count);
+        if (count == 0)
+            return std::vector<uint32_t>();
+        lists.emplace_back(postings, count);
+    }
+    std::sort(lists.begin(), lists.end(), [](const PostingList& left, const PostingList& right) {
+        return left.second < right.second;
+    });
+
+    std::vector<uint32_t> result(lists[0].first, lists[0].first + lists[0].second);
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+        const uint32_t* first = lists[i].first;
+        const uint32_t* last = first + lists[i].second;
+        auto out = result.begin();
+        for (uint32_t doc : result) {
+            // Galloping would help for very skewed lists, but a binary
+            // search from the last match is already logarithmic
+            first = std::lower_bound(first, last, doc);
+            if (first == last)
+                break;
+            if (*first == doc)
+                *out++ = doc;
+        }
+        result.erase(out, result.end());
+    }
+    return result;
+}
@@ -0,0 +1,125 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_TILEINDEX_H
+#define _CC2_TILEINDEX_H
+
+#include <QStringList>
+#include <string>
+#include <vector>
+#include "Map.h"
+
+namespace cc2 {
+
+/* Persistent inverted index from tile terms to the CC1 levels and CC2 maps
+ * that contain them, for searching large collections without opening each
+ * file.  The index lives in libcc2 because it covers both formats.
+ *
+ * A term is a 32-bit value with the TermKind in the top byte.  Postings are
+ * kept in memory as sorted document lists, and stored on disk as
+ * delta-encoded varints.  update() only re-reads files whose size or
+ * modification time changed since the last update.
+ */
+class TileIndex {
+public:
+    enum TermKind {
+        CC1Tile = 1,    // CC1 tile in either layer
+        CC1Pair,        // CC1 upper tile over a non-floor lower tile
+        CC2Tile,        // CC2 tile type anywhere in a stack
+        CC2Pair,        // CC2 tile type directly above another in a stack
+        CC2Modifier,    // CC2 tile type with a specific (16-bit) modifier
+    };
+
+    static uint32_t cc1Tile(tile_t tile)
+    {
+        return ((uint32_t)CC1Tile << 24) | tile;
+    }
+
+    static uint32_t cc1Pair(tile_t upper, tile_t lower)
+    {
+        return ((uint32_t)CC1Pair << 24) | ((uint32_t)upper << 8) | lower;
+    }
+
+    static uint32_t cc2Tile(int type)
+    {
+        return ((uint32_t)CC2Tile << 24) | (uint8_t)type;
+    }
+
+    static uint32_t cc2Pair(int upper, int lower)
+    {
+        return ((uint32_t)CC2Pair << 24) | ((uint32_t)(uint8_t)upper << 8) | (uint8_t)lower;
+    }
+
+    static uint32_t cc2Modifier(int type, uint32_t modifier)
+    {
+        return ((uint32_t)CC2Modifier << 24) | ((uint32_t)(uint8_t)type << 16)
+               | (modifier & 0xFFFF);
+    }
+
+    struct FileEntry {
+        QString filename;       // Absolute path
+        int64_t modified;       // Milliseconds since the epoch
+        int64_t size;
+        uint32_t firstDoc;
+        uint32_t docCount;      // 0 if the file could not be read
+    };
+
+    struct Document {
+        uint32_t file;
+        int levelNum;           // 1-based, or 0 for a standalone CC2 map
+        std::string name;
+    };
+
+    TileIndex() { }
+
+    void load(const QString& filename);
+    void save(const QString& filename) const;
+
+    /* Bring the index in line with the given list of level files.  Files
+     * which are no longer listed are dropped, and new or changed files are
+     * read on a pool of worker threads.  Returns the number of files that
+     * were read.
+     */
+    size_t update(const QStringList& files, unsigned int threads = 0);
+
+    // Documents containing all of the given terms, in ascending order
+    std::vector<uint32_t> query(const std::vector<uint32_t>& terms) const;
+    size_t documentCount(uint32_t term) const;
+
+    const std::vector<FileEntry>& files() const { return m_files; }
+    const std::vector<Document>& documents() const { return m_docs; }
+    size_t termCount() const { return m_terms.size(); }
+
+    static std::vector<uint32_t> levelTerms(const ccl::LevelData* level);
+    static std::vector<uint32_t> mapTerms(const MapData& map);
+
+private:
+    std::vector<FileEntry> m_files;
+    std::vector<Document> m_docs;
+
+    // Postings in compressed sparse row form:  The documents containing
+    // m_terms[i] are m_postings[m_offsets[i]] up to m_postings[m_offsets[i+1]]
+    std::vector<uint32_t> m_terms;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_postings;
+
+    const uint32_t* findPostings(uint32_t term, size_t* count) const;
+};
+
+}
+
+#endif
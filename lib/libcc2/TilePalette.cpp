@@ -0,0 +1,83 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "TilePalette.h"
+
+#include <stdexcept>
+
+uint16_t cc2::TilePalette::intern(const Tile& tile, uint64_t stackHash)
+{
+    auto range = m_lookup.equal_range(stackHash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (m_stacks[it->second] == tile)
+            return it->second;
+    }
+
+    if (m_stacks.size() >= MaxStacks)
+        throw std::length_error("Tile palette is full");
+
+    const auto index = (uint16_t)m_stacks.size();
+    m_stacks.push_back(tile);
+    m_lookup.emplace(stackHash, index);
+    return index;
+}
+
+void cc2::PackedMapData::pack(const MapData& map, std::shared_ptr<TilePalette> palette)
+{
+    m_palette = std::move(palette);
+    m_width = map.width();
+    m_height = map.height();
+    m_cells.resize(m_width * m_height);
+
+    // The map's cached stack hashes save rehashing every cell
+    const std::vector<uint64_t> hashes = map.cellHashes();
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            const int index = (y * m_width) + x;
+            m_cells[index] = m_palette->intern(map.tile(x, y), hashes[index]);
+        }
+    }
+}
+
+void cc2::PackedMapData::unpack(MapData& map) const
+{
+    if (map.width() != m_width || map.height() != m_height)
+        map.resize(m_width, m_height);
+
+    const MapData& source = map;
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            const Tile& stack = tile(x, y);
+            if (source.tile(x, y) != stack)
+                map.tile(x, y) = stack;
+        }
+    }
+}
+
+bool cc2::PackedMapData::operator==(const PackedMapData& other) const
+{
+    if (m_width != other.m_width || m_height != other.m_height)
+        return false;
+    if (m_palette == other.m_palette)
+        return m_cells == other.m_cells;
+
+    for (size_t i = 0; i < m_cells.size(); ++i) {
+        if (m_palette->tile(m_cells[i]) != other.m_palette->tile(other.m_cells[i]))
+            return false;
+    }
+    return true;
+}
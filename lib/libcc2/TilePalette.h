@@ -0,0 +1,92 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_TILEPALETTE_H
+#define _CC2_TILEPALETTE_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Map.h"
+
+namespace cc2 {
+
+/* Interned, immutable tile stacks.  Each distinct stack (a tile and all of
+ * its lower layers) is stored once and identified by a 16-bit index, which
+ * stays valid for the lifetime of the palette.  Most maps only use a few
+ * hundred distinct stacks, so a palette can be shared by many snapshots.
+ * Not thread safe.
+ */
+class TilePalette {
+public:
+    enum { MaxStacks = 0x10000 };
+
+    TilePalette() { }
+
+    // Index of the stack equal to tile, adding it if necessary.  Throws
+    // std::length_error if the palette is full.
+    uint16_t intern(const Tile& tile, uint64_t stackHash);
+    uint16_t intern(const Tile& tile) { return intern(tile, tile.hash()); }
+
+    // References are invalidated by intern()
+    const Tile& tile(uint16_t index) const { return m_stacks[index]; }
+
+    size_t size() const { return m_stacks.size(); }
+    bool canHold(size_t newStacks) const
+    {
+        return m_stacks.size() + newStacks <= MaxStacks;
+    }
+
+private:
+    std::vector<Tile> m_stacks;
+    std::unordered_multimap<uint64_t, uint16_t> m_lookup;
+};
+
+/* Compact copy of a MapData's tiles:  One palette index per cell, in
+ * reading order.  Copies and comparisons against snapshots sharing the
+ * same palette are plain array operations.
+ */
+class PackedMapData {
+public:
+    PackedMapData() : m_width(), m_height() { }
+
+    void pack(const MapData& map, std::shared_ptr<TilePalette> palette);
+
+    // Overwrites the cells of map which differ from the snapshot, resizing
+    // it first if necessary
+    void unpack(MapData& map) const;
+
+    uint8_t width() const { return m_width; }
+    uint8_t height() const { return m_height; }
+
+    uint16_t cell(int x, int y) const { return m_cells[(y * m_width) + x]; }
+    const Tile& tile(int x, int y) const { return m_palette->tile(cell(x, y)); }
+
+    const std::shared_ptr<TilePalette>& palette() const { return m_palette; }
+
+    bool operator==(const PackedMapData& other) const;
+    bool operator!=(const PackedMapData& other) const { return !operator==(other); }
+
+private:
+    std::shared_ptr<TilePalette> m_palette;
+    uint8_t m_width, m_height;
+    std::vector<uint16_t> m_cells;
+};
+
+}
+
+#endif
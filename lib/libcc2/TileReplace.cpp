@@ -0,0 +1,109 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "TileReplace.h"
+
+static bool removesLayer(const cc2::TileReplaceRule& rule)
+{
+    return rule.replace.type() == cc2::Tile::Floor
+        && rule.find.layer() != cc2::Tile::BaseLayer;
+}
+
+bool cc2::TileReplaceRule::isValid() const
+{
+    return removesLayer(*this) || find.layer() == replace.layer();
+}
+
+bool cc2::TileReplaceRule::matches(const Tile& layer) const
+{
+    if (layer.type() != find.type())
+        return false;
+    if ((flags & MatchDirection) && layer.direction() != find.direction())
+        return false;
+    if ((flags & MatchModifier) && layer.modifier() != find.modifier())
+        return false;
+    if ((flags & MatchTileFlags) && layer.tileFlags() != find.tileFlags())
+        return false;
+    return true;
+}
+
+int cc2::CountTileMatches(const MapData& map, const TileReplaceRule& rule)
+{
+    int count = 0;
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            for (const Tile* layer = &map.tile(x, y); layer; layer = layer->lower()) {
+                if (rule.matches(*layer))
+                    ++count;
+            }
+        }
+    }
+    return count;
+}
+
+static int replaceStack(cc2::Tile& cell, const cc2::TileReplaceRule& rule)
+{
+    int count = 0;
+    cc2::Tile* layer = &cell;
+    while (layer) {
+        if (!rule.matches(*layer)) {
+            layer = layer->lower();
+            continue;
+        }
+
+        ++count;
+        if (removesLayer(rule) && layer->lower()) {
+            // Check the layer which moved up in its place next
+            cc2::Tile lower = *layer->lower();
+            *layer = std::move(lower);
+            continue;
+        }
+
+        cc2::Tile replacement(rule.replace.type(), rule.replace.direction(),
+                              rule.replace.modifier());
+        replacement.setTileFlags(rule.replace.tileFlags());
+        if ((rule.flags & cc2::TileReplaceRule::KeepDirection)
+                && layer->haveDirection() && replacement.haveDirection())
+            replacement.setDirection(layer->direction());
+        if (replacement.lower() && layer->lower())
+            *replacement.lower() = *layer->lower();
+        *layer = std::move(replacement);
+        layer = layer->lower();
+    }
+    return count;
+}
+
+int cc2::ReplaceTiles(MapData& map, const TileReplaceRule& rule)
+{
+    if (!rule.isValid())
+        return 0;
+
+    // Scan through the const accessor, so only the cells which actually
+    // change are marked dirty for the map's hash cache
+    const MapData& cmap = map;
+    int count = 0;
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            bool found = false;
+            for (const Tile* layer = &cmap.tile(x, y); layer && !found; layer = layer->lower())
+                found = rule.matches(*layer);
+            if (found)
+                count += replaceStack(map.tile(x, y), rule);
+        }
+    }
+    return count;
+}
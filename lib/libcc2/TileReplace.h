@@ -0,0 +1,57 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_TILEREPLACE_H
+#define _CC2_TILEREPLACE_H
+
+#include "Map.h"
+
+namespace cc2 {
+
+/* Replace every layer of a tile stack that matches the top layer of find
+ * with the top layer of replace.  Layers below a replaced layer are kept.
+ * Replacing an item, creature, panel or other upper layer with floor
+ * removes that layer from the stack instead.
+ */
+struct TileReplaceRule {
+    enum Flags {
+        MatchDirection = 0x1,   // Only match layers facing the same way
+        MatchModifier = 0x2,    // Only match layers with the same modifier
+        MatchTileFlags = 0x4,   // Only match the same arrows or panels
+        KeepDirection = 0x8,    // Replaced layers keep their old direction
+    };
+
+    TileReplaceRule() : flags() { }
+
+    // The replacement must go in the same layer as the tile it replaces
+    bool isValid() const;
+    bool matches(const Tile& layer) const;
+
+    Tile find;
+    Tile replace;
+    unsigned int flags;
+};
+
+// Number of matching layers in the map, counting each layer of a stack
+int CountTileMatches(const MapData& map, const TileReplaceRule& rule);
+
+// Apply the rule to every cell, returning the number of layers replaced
+int ReplaceTiles(MapData& map, const TileReplaceRule& rule);
+
+}
+
+#endif
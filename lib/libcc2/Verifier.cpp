@@ -0,0 +1,119 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "Verifier.h"
+#include "Simulation.h"
+#include "libcc1/Parallel.h"
+#include "libcc1/Errors.h"
+
+#include <QFileInfo>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+static const char* statusName(cc2::SimulationStatus status)
+{
+    switch (status) {
+    case cc2::SimRunning:
+        return "Level did not finish";
+    case cc2::SimSuccess:
+        return "Level completed";
+    case cc2::SimDied:
+        return "Player died";
+    case cc2::SimTimeOut:
+        return "Time ran out";
+    case cc2::SimNoPlayer:
+        return "Map has no player";
+    case cc2::SimUnsupported:
+        return "Map uses features the simulation does not model";
+    }
+    return "Unknown status";
+}
+
+std::vector<ccl::VerifyResult> cc2::VerifyMaps(const std::vector<ScriptMapEntry>& maps,
+                                               unsigned int threads)
+{
+    std::vector<ccl::VerifyResult> results;
+    results.resize(maps.size());
+
+    // Each worker keeps its own simulation, which is reset for every map
+    std::vector<std::unique_ptr<Simulation>> sims;
+    sims.resize(threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+
+    ccl::RunParallel(maps.size(), (unsigned int)sims.size(),
+                     [&](unsigned int worker, size_t index) {
+        const QString filename = QString::fromStdString(maps[index].filename);
+        ccl::VerifyResult& result = results[index];
+        result.levelNum = maps[index].levelNum;
+        result.name = QFileInfo(filename).fileName().toStdString();
+
+        auto startTime = std::chrono::steady_clock::now();
+        try {
+            Map map;
+            ccl::FileStream fs;
+            if (!fs.open(filename, ccl::FileStream::Read))
+                throw ccl::IOError(ccl::RuntimeError::tr("Could not open %1 for reading")
+                                   .arg(filename));
+            map.read(&fs);
+            if (!map.title().empty())
+                result.name = map.title();
+
+            if (map.replay().empty()) {
+                result.outcome = ccl::VerifyResult::NoSolution;
+                result.detail = "No recorded replay";
+                return;
+            }
+
+            Replay replay;
+            replay.decode(map.replay());
+            result.expectedTicks = replay.tickCount();
+
+            auto& sim = sims[worker];
+            if (!sim)
+                sim.reset(new Simulation);
+            SimulationStatus status = sim->replay(&map);
+            if (status == SimUnsupported) {
+                result.outcome = ccl::VerifyResult::Unsupported;
+                result.detail = std::string("Map uses ") + sim->unsupportedFeature()
+                              + ", which the simulation does not model";
+            } else {
+                result.outcome = (status == SimSuccess) ? ccl::VerifyResult::Passed
+                                                        : ccl::VerifyResult::Failed;
+                result.detail = statusName(status);
+            }
+            result.ticks = sim->tickCount();
+        } catch (const ccl::RuntimeError& err) {
+            result.outcome = ccl::VerifyResult::Error;
+            result.detail = err.message().toStdString();
+        }
+        std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - startTime;
+        result.elapsed = elapsed.count();
+    });
+
+    return results;
+}
+
+std::vector<ccl::VerifyResult> cc2::VerifyGame(const QString& scriptFilename,
+                                               unsigned int threads, bool* complete,
+                                               std::vector<std::string>* missingChains)
+{
+    GameScript script;
+    script.read(scriptFilename);
+    return VerifyMaps(script.mapList(scriptFilename, nullptr, complete, missingChains),
+                      threads);
+}
@@ -0,0 +1,43 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_VERIFIER_H
+#define _CC2_VERIFIER_H
+
+#include "GameScript.h"
+#include "libcc1/Verifier.h"
+
+namespace cc2 {
+
+/* Load each map and play back the replay stored with it, on a pool of
+ * worker threads.  Results are returned in the same order as maps.  The
+ * simulation is experimental, and maps it does not model are reported as
+ * VerifyResult::Unsupported.
+ */
+std::vector<ccl::VerifyResult> VerifyMaps(const std::vector<ScriptMapEntry>& maps,
+                                          unsigned int threads = 0);
+
+// Verify every map referenced by a C2G game script or the scripts it
+// chains to.  complete and missingChains are set as by GameScript::mapList().
+std::vector<ccl::VerifyResult> VerifyGame(const QString& scriptFilename,
+                                          unsigned int threads = 0,
+                                          bool* complete = nullptr,
+                                          std::vector<std::string>* missingChains = nullptr);
+
+}
+
+#endif
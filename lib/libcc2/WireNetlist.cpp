@@ -0,0 +1,341 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "WireNetlist.h"
+
+#include <algorithm>
+#include <numeric>
+
+/* Cell signature bits.  Wire and tunnel bits match TileModifier, and gate
+ * port bits are one per Tile::Direction. */
+#define SIG_WIRES           0x0000000f
+#define SIG_TUNNELS         0x000000f0
+#define SIG_CROSSING        0x00000100
+#define SIG_INPUT_SHIFT     16
+#define SIG_OUTPUT_SHIFT    20
+#define SIG_PORTS           0x00ff0000
+
+// Nodes per cell: the wire node, the east/west node of a crossing, and
+// one node for each gate port
+#define NODES_PER_CELL      6
+#define NODE_CROSSING       1
+#define NODE_PORT           2
+
+static int opposite(int side)
+{
+    return (side + 2) & 3;
+}
+
+static uint32_t gatePorts(uint32_t gate)
+{
+    // Ports are given relative to the gate's output direction
+    auto ports = [](int dir, uint32_t inputs, uint32_t outputs) {
+        auto rotate = [dir](uint32_t mask) {
+            mask <<= dir;
+            return (mask | (mask >> 4)) & 0xf;
+        };
+        return (rotate(inputs) << SIG_INPUT_SHIFT) | (rotate(outputs) << SIG_OUTPUT_SHIFT);
+    };
+
+    // Relative sides, clockwise from the output
+    enum { Front = 0x1, Right = 0x2, Back = 0x4, Left = 0x8 };
+
+    if (gate <= cc2::TileModifier::Inverter_W)
+        return ports(gate & 3, Back, Front);
+    if (gate <= cc2::TileModifier::XorGate_W)
+        return ports(gate & 3, Left | Right, Front);
+    if (gate <= cc2::TileModifier::LatchGateCW_W)
+        return ports(gate & 3, Right | Back, Front);
+    if (gate <= cc2::TileModifier::NandGate_W)
+        return ports(gate & 3, Left | Right, Front);
+    if (gate >= cc2::TileModifier::CounterGate_0 && gate <= cc2::TileModifier::CounterGate_9) {
+        // Counters always face north, with an underflow output to the west
+        return ports(cc2::Tile::North, Right | Back, Front | Left);
+    }
+    if (gate >= cc2::TileModifier::LatchGateCCW_N && gate <= cc2::TileModifier::LatchGateCCW_W)
+        return ports(gate & 3, Left | Back, Front);
+    return 0;
+}
+
+static uint32_t cellSignature(const cc2::Tile& tile)
+{
+    const cc2::Tile& base = tile.bottom();
+    if (base.type() == cc2::Tile::LogicGate)
+        return gatePorts(base.modifier());
+    if (!base.supportsWires())
+        return 0;
+
+    uint32_t sig = base.modifier() & (SIG_WIRES | SIG_TUNNELS);
+    if ((sig & SIG_WIRES) == SIG_WIRES
+            && (base.type() == cc2::Tile::Floor || base.type() == cc2::Tile::SteelWall))
+        sig |= SIG_CROSSING;
+    return sig;
+}
+
+void cc2::WireNetlist::build(const MapData& map)
+{
+    m_width = map.width();
+    m_height = map.height();
+    const int cellCount = m_width * m_height;
+
+    m_cells.resize(cellCount);
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x)
+            m_cells[(y * m_width) + x] = cellSignature(map.tile(x, y));
+    }
+    pairTunnels();
+
+    m_parent.resize(cellCount * NODES_PER_CELL);
+    std::iota(m_parent.begin(), m_parent.end(), 0);
+    m_size.assign(m_parent.size(), 1);
+    m_next = m_parent;
+    for (int cell = 0; cell < cellCount; ++cell)
+        mergeCell(cell);
+}
+
+void cc2::WireNetlist::update(const MapData& map, int x, int y)
+{
+    if (map.width() != m_width || map.height() != m_height) {
+        build(map);
+        return;
+    }
+
+    const int cell = (y * m_width) + x;
+    const uint32_t oldSig = m_cells[cell];
+    const uint32_t newSig = cellSignature(map.tile(x, y));
+    if (newSig == oldSig)
+        return;
+    if ((newSig ^ oldSig) & SIG_TUNNELS) {
+        build(map);
+        return;
+    }
+
+    if ((newSig & oldSig) == oldSig && ((newSig ^ oldSig) & SIG_CROSSING) == 0) {
+        // Only new wires or ports, which can't split any net
+        m_cells[cell] = newSig;
+        mergeCell(cell);
+        return;
+    }
+
+    // Split up every net which ran through the cell, and re-trace them
+    // from the edges of their cells
+    std::vector<int> roots;
+    std::vector<int> retrace;
+    for (int node = cell * NODES_PER_CELL; node < (cell + 1) * NODES_PER_CELL; ++node) {
+        const int root = find(node);
+        if (std::find(roots.begin(), roots.end(), root) != roots.end())
+            continue;
+        roots.push_back(root);
+        const std::vector<int> net = members(root);
+        retrace.insert(retrace.end(), net.begin(), net.end());
+    }
+    std::sort(retrace.begin(), retrace.end());
+    for (int node : retrace) {
+        m_parent[node] = node;
+        m_size[node] = 1;
+        m_next[node] = node;
+    }
+
+    m_cells[cell] = newSig;
+    int lastCell = -1;
+    for (int node : retrace) {
+        if (node / NODES_PER_CELL != lastCell) {
+            lastCell = node / NODES_PER_CELL;
+            mergeCell(lastCell);
+        }
+    }
+}
+
+int cc2::WireNetlist::netAt(int x, int y, Tile::Direction side) const
+{
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height || side == Tile::InvalidDir)
+        return -1;
+    const int node = terminal((y * m_width) + x, side);
+    return (node < 0) ? -1 : find(node);
+}
+
+std::vector<int> cc2::WireNetlist::netsAt(int x, int y) const
+{
+    std::vector<int> nets;
+    for (int side = Tile::North; side <= Tile::West; ++side) {
+        const int net = netAt(x, y, (Tile::Direction)side);
+        if (net >= 0 && std::find(nets.begin(), nets.end(), net) == nets.end())
+            nets.push_back(net);
+    }
+    return nets;
+}
+
+std::vector<cc2::WireNetlist::Terminal> cc2::WireNetlist::terminals(int net) const
+{
+    std::vector<Terminal> result;
+    if (net < 0 || net >= (int)m_parent.size())
+        return result;
+
+    std::vector<int> cells = members(net);
+    for (int& node : cells)
+        node /= NODES_PER_CELL;
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    const int root = find(net);
+    for (int cell : cells) {
+        for (int side = Tile::North; side <= Tile::West; ++side) {
+            const int node = terminal(cell, side);
+            if (node >= 0 && find(node) == root)
+                result.push_back(Terminal { cell % m_width, cell / m_width, (Tile::Direction)side });
+        }
+    }
+    return result;
+}
+
+std::vector<cc2::WireNetlist::Terminal> cc2::WireNetlist::drivenGates(int x, int y) const
+{
+    // Port node ids sort in reading order, then by side
+    std::vector<int> inputs;
+    for (int net : netsAt(x, y)) {
+        for (int node : members(net)) {
+            const int port = (node % NODES_PER_CELL) - NODE_PORT;
+            const int cell = node / NODES_PER_CELL;
+            if (port >= 0 && (m_cells[cell] & ((1 << port) << SIG_INPUT_SHIFT)))
+                inputs.push_back(node);
+        }
+    }
+    std::sort(inputs.begin(), inputs.end());
+
+    std::vector<Terminal> result;
+    for (int node : inputs) {
+        const int cell = node / NODES_PER_CELL;
+        const int side = (node % NODES_PER_CELL) - NODE_PORT;
+        result.push_back(Terminal { cell % m_width, cell / m_width, (Tile::Direction)side });
+    }
+    return result;
+}
+
+int cc2::WireNetlist::terminal(int cell, int side) const
+{
+    const uint32_t sig = m_cells[cell];
+    if (sig & (1 << side)) {
+        if ((sig & SIG_CROSSING) && (side == Tile::East || side == Tile::West))
+            return (cell * NODES_PER_CELL) + NODE_CROSSING;
+        return cell * NODES_PER_CELL;
+    }
+    if (sig & (((1 << side) << SIG_INPUT_SHIFT) | ((1 << side) << SIG_OUTPUT_SHIFT)))
+        return (cell * NODES_PER_CELL) + NODE_PORT + side;
+    return -1;
+}
+
+int cc2::WireNetlist::find(int node) const
+{
+    // Path halving: point every other node on the way at its grandparent
+    while (m_parent[node] != node) {
+        m_parent[node] = m_parent[m_parent[node]];
+        node = m_parent[node];
+    }
+    return node;
+}
+
+void cc2::WireNetlist::merge(int left, int right)
+{
+    left = find(left);
+    right = find(right);
+    if (left == right)
+        return;
+    if (m_size[left] < m_size[right])
+        std::swap(left, right);
+    m_parent[right] = left;
+    m_size[left] += m_size[right];
+
+    // Splice the two rings into one
+    std::swap(m_next[left], m_next[right]);
+}
+
+std::vector<int> cc2::WireNetlist::members(int net) const
+{
+    std::vector<int> nodes;
+    int node = net;
+    do {
+        nodes.push_back(node);
+        node = m_next[node];
+    } while (node != net);
+    return nodes;
+}
+
+void cc2::WireNetlist::mergeCell(int cell)
+{
+    if (m_cells[cell] == 0)
+        return;
+
+    const int x = cell % m_width;
+    const int y = cell / m_width;
+    for (int side = Tile::North; side <= Tile::West; ++side) {
+        const int node = terminal(cell, side);
+        if (node < 0)
+            continue;
+
+        static const int dx[] = { 0, 1, 0, -1 };
+        static const int dy[] = { -1, 0, 1, 0 };
+        const int nx = x + dx[side];
+        const int ny = y + dy[side];
+        if (nx >= 0 && nx < m_width && ny >= 0 && ny < m_height) {
+            const int other = terminal((ny * m_width) + nx, opposite(side));
+            if (other >= 0)
+                merge(node, other);
+        }
+
+        const int partner = m_tunnels[(cell * 4) + side];
+        if (partner >= 0) {
+            const int other = terminal(partner, opposite(side));
+            if (other >= 0)
+                merge(node, other);
+        }
+    }
+}
+
+void cc2::WireNetlist::pairTunnels()
+{
+    // Tunnels nest, so each one pairs with the first unmatched tunnel
+    // facing back towards it
+    m_tunnels.assign(m_cells.size() * 4, -1);
+    static const int dx[] = { 0, 1, 0, -1 };
+    static const int dy[] = { -1, 0, 1, 0 };
+    for (int cell = 0; cell < (int)m_cells.size(); ++cell) {
+        const uint32_t tunnels = (m_cells[cell] & SIG_TUNNELS) >> 4;
+        for (int side = Tile::North; side <= Tile::West; ++side) {
+            if ((tunnels & (1 << side)) == 0)
+                continue;
+
+            const uint32_t openBit = (1 << side) << 4;
+            const uint32_t closeBit = (1 << opposite(side)) << 4;
+            int x = cell % m_width;
+            int y = cell / m_width;
+            int depth = 1;
+            for ( ;; ) {
+                x += dx[side];
+                y += dy[side];
+                if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+                    break;
+                const uint32_t sig = m_cells[(y * m_width) + x];
+                if ((sig & closeBit) && --depth == 0) {
+                    m_tunnels[(cell * 4) + side] = (y * m_width) + x;
+                    break;
+                }
+                if (sig & openBit)
+                    ++depth;
+            }
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _CC2_WIRENETLIST_H
+#define _CC2_WIRENETLIST_H
+
+#include "Map.h"
+
+namespace cc2 {
+
+/* Connectivity of the wires in a map, as a set of nets.  A net joins the
+ * wires on adjacent cells, wire tunnel pairs and the ports of logic gates
+ * and wired tiles such as buttons and switches.
+ *
+ * A wired cell has one node shared by all of its wired sides, except for
+ * a four-way crossing on floor or steel wall, which keeps its north/south
+ * and east/west wires apart.  Each logic gate port is a separate node.
+ * Nodes are merged into nets with a union-find, and a net's id is the id
+ * of its root node.  Ids are only stable until the next update().  Each
+ * net also keeps a ring of its nodes, so listing or re-tracing a net only
+ * visits that net.  Lookups compress paths in place, so not even the const
+ * methods may be called on one netlist from several threads at once.
+ */
+class WireNetlist {
+public:
+    struct Terminal {
+        int x, y;
+        Tile::Direction side;
+    };
+
+    WireNetlist() : m_width(), m_height() { }
+    explicit WireNetlist(const MapData& map) { build(map); }
+
+    void build(const MapData& map);
+
+    /* Bring the netlist up to date after the stack at (x, y) changed.
+     * Adding wires or ports only merges nets.  Removing them re-traces
+     * just the nets which ran through the cell, at a cost proportional to
+     * their size.  Changing a wire tunnel
+     * can re-pair other tunnels on the same row or column, so that (or a
+     * map resize) rebuilds everything.
+     */
+    void update(const MapData& map, int x, int y);
+
+    // Net on one side of a cell, or -1 if that side carries no signal
+    int netAt(int x, int y, Tile::Direction side) const;
+
+    // Every net touching a cell, without duplicates
+    std::vector<int> netsAt(int x, int y) const;
+
+    // Every cell side on a net, in reading order
+    std::vector<Terminal> terminals(int net) const;
+
+    // Logic gate inputs on any net touching (x, y), e.g. the gates which
+    // a button or switch drives
+    std::vector<Terminal> drivenGates(int x, int y) const;
+
+private:
+    int m_width, m_height;
+    std::vector<uint32_t> m_cells;      // Wire and port signature per cell
+    std::vector<int> m_tunnels;         // Partner cell of each tunnel side
+    mutable std::vector<int> m_parent;  // Compressed by find()
+    std::vector<int> m_size;
+    std::vector<int> m_next;            // Next node in the same net
+
+    int terminal(int cell, int side) const;
+    int find(int node) const;
+    void merge(int left, int right);
+    std::vector<int> members(int net) const;
+    void mergeCell(int cell);
+    void pairTunnels();
+};
+
+}
+
+#endif
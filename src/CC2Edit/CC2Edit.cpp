@@ -24,10 +24,18 @@
 #include "ResizeDialog.h"
 #include "HintEdit.h"
 #include "MapProperties.h"
+#include "ReplaceTiles.h"
 #include "libcc1/Levelset.h"
+#include "libcc1/DacFile.h"
+#include "libcc1/Parallel.h"
 #include "libcc2/GameLogic.h"
+#include "libcc2/Verifier.h"
+#include "libcc2/LevelsetImport.h"
+#include "libcc2/PatternSearch.h"
 #include "CommonWidgets/CCTools.h"
 #include "CommonWidgets/EditorTabWidget.h"
+#include "CommonWidgets/ReportDialog.h"
+#include "CommonWidgets/PatternSearchDialog.h"
 
 #include <QApplication>
 #include <QDesktopServices>
@@ -52,6 +60,8 @@
 #include <QProgressDialog>
 #include <QTextBlock>
 #include <QElapsedTimer>
+#include <algorithm>
+#include <memory>
 
 Q_DECLARE_METATYPE(CC2ETileset*)
 
@@ -74,7 +84,8 @@ enum TileListId {
 
 CC2EditMain::CC2EditMain(QWidget* parent)
     : QMainWindow(parent), m_currentTileset(), m_savedDrawMode(ActionDrawPencil),
-      m_currentDrawMode(CC2EditorWidget::DrawPencil), m_subProc()
+      m_currentDrawMode(CC2EditorWidget::DrawPencil), m_patternSearch(),
+      m_subProc()
 {
     setWindowTitle(QStringLiteral("CC2Edit " CCTOOLS_VERSION));
 
@@ -91,6 +102,8 @@ CC2EditMain::CC2EditMain(QWidget* parent)
     m_actions[ActionImportCC1] = new QAction(ICON("document-open"), tr("&Import CC1 Map..."), this);
     m_actions[ActionImportCC1]->setStatusTip(tr("Import a map from a CC1 levelset"));
     m_actions[ActionImportCC1]->setShortcut(Qt::CTRL | Qt::SHIFT | Qt::Key_O);
+    m_actions[ActionImportCC1Set] = new QAction(tr("Import CC1 &Levelset..."), this);
+    m_actions[ActionImportCC1Set]->setStatusTip(tr("Convert every level of a CC1 levelset into a CC2 game"));
     m_actions[ActionSave] = new QAction(ICON("document-save"), tr("&Save"), this);
     m_actions[ActionSave]->setStatusTip(tr("Save the current document to the same file"));
     m_actions[ActionSave]->setShortcut(Qt::CTRL | Qt::Key_S);
@@ -182,6 +195,16 @@ CC2EditMain::CC2EditMain(QWidget* parent)
     m_actions[ActionToggleGreens]->setStatusTip(tr("Toggle all toggle doors and chips in the current level"));
     m_actions[ActionToggleGreens]->setShortcut(Qt::CTRL | Qt::Key_G);
     m_actions[ActionToggleGreens]->setEnabled(false);
+    m_actions[ActionVerifyReplays] = new QAction(tr("&Verify Replays (Experimental)..."), this);
+    m_actions[ActionVerifyReplays]->setStatusTip(tr("Play back the saved replay of every map in the current game.  "
+                                                    "Maps with wires, tracks and some other tiles are skipped."));
+    m_actions[ActionVerifyReplays]->setEnabled(false);
+    m_actions[ActionFindPattern] = new QAction(tr("Find &Pattern..."), this);
+    m_actions[ActionFindPattern]->setStatusTip(tr("Find every copy of the selected region in the current game or open maps"));
+    m_actions[ActionFindPattern]->setEnabled(false);
+    m_actions[ActionReplaceTiles] = new QAction(tr("&Replace Tiles..."), this);
+    m_actions[ActionReplaceTiles]->setStatusTip(tr("Replace one tile with another across the current game or open maps"));
+    m_actions[ActionReplaceTiles]->setEnabled(false);
     m_drawModeGroup = new QActionGroup(this);
     m_drawModeGroup->addAction(m_actions[ActionDrawPencil]);
     m_drawModeGroup->addAction(m_actions[ActionDrawLine]);
@@ -738,6 +761,7 @@ CC2EditMain::CC2EditMain(QWidget* parent)
     fileMenu->addSeparator();
     fileMenu->addAction(m_actions[ActionOpen]);
     fileMenu->addAction(m_actions[ActionImportCC1]);
+    fileMenu->addAction(m_actions[ActionImportCC1Set]);
     m_recentFiles = fileMenu->addMenu(tr("Open &Recent"));
     populateRecentFiles();
     fileMenu->addSeparator();
@@ -760,6 +784,8 @@ CC2EditMain::CC2EditMain(QWidget* parent)
     editMenu->addAction(m_actions[ActionPaste]);
     editMenu->addSeparator();
     editMenu->addAction(m_actions[ActionClear]);
+    editMenu->addSeparator();
+    editMenu->addAction(m_actions[ActionReplaceTiles]);
 
     QMenu* toolsMenu = menuBar()->addMenu(tr("&Tools"));
     toolsMenu->addAction(m_actions[ActionDrawPencil]);
@@ -774,6 +800,9 @@ CC2EditMain::CC2EditMain(QWidget* parent)
     toolsMenu->addAction(m_actions[ActionInspectTiles]);
     toolsMenu->addSeparator();
     toolsMenu->addAction(m_actions[ActionToggleGreens]);
+    toolsMenu->addSeparator();
+    toolsMenu->addAction(m_actions[ActionVerifyReplays]);
+    toolsMenu->addAction(m_actions[ActionFindPattern]);
 
     QMenu* viewMenu = menuBar()->addMenu(tr("&View"));
     viewMenu->addAction(m_actions[ActionViewViewport]);
@@ -848,6 +877,7 @@ CC2EditMain::CC2EditMain(QWidget* parent)
     connect(m_actions[ActionNewScript], &QAction::triggered, this, &CC2EditMain::createNewScript);
     connect(m_actions[ActionOpen], &QAction::triggered, this, &CC2EditMain::onOpenAction);
     connect(m_actions[ActionImportCC1], &QAction::triggered, this, &CC2EditMain::onImportCC1Action);
+    connect(m_actions[ActionImportCC1Set], &QAction::triggered, this, &CC2EditMain::onImportCC1SetAction);
     connect(m_actions[ActionSave], &QAction::triggered, this, &CC2EditMain::onSaveAction);
     connect(m_actions[ActionSaveAs], &QAction::triggered, this, &CC2EditMain::onSaveAsAction);
     connect(m_actions[ActionCloseTab], &QAction::triggered, this, [this] {
@@ -877,6 +907,9 @@ CC2EditMain::CC2EditMain(QWidget* parent)
     connect(m_actions[ActionInspectHints], &QAction::toggled, this, &CC2EditMain::onInspectHints);
     connect(m_actions[ActionInspectTiles], &QAction::toggled, this, &CC2EditMain::onInspectTiles);
     connect(m_actions[ActionToggleGreens], &QAction::triggered, this, &CC2EditMain::onToggleGreensAction);
+    connect(m_actions[ActionVerifyReplays], &QAction::triggered, this, &CC2EditMain::onVerifyReplaysAction);
+    connect(m_actions[ActionFindPattern], &QAction::triggered, this, &CC2EditMain::onFindPatternAction);
+    connect(m_actions[ActionReplaceTiles], &QAction::triggered, this, &CC2EditMain::onReplaceTilesAction);
 
     connect(m_actions[ActionViewViewport], &QAction::toggled, this, &CC2EditMain::onViewViewportToggled);
     connect(m_actions[ActionViewMonsterPaths], &QAction::toggled, this, &CC2EditMain::onViewMonsterPathsToggled);
@@ -1162,6 +1195,8 @@ bool CC2EditMain::loadScript(const QString& filename)
         m_gameProperties->setEnabled(true);
         m_actions[ActionCloseGame]->setEnabled(true);
         m_actions[ActionGenReport]->setEnabled(true);
+        m_actions[ActionVerifyReplays]->setEnabled(true);
+        m_actions[ActionReplaceTiles]->setEnabled(true);
         return true;
     } else {
         closeScript();
@@ -1200,6 +1235,12 @@ void CC2EditMain::closeScript()
     m_gameProperties->setEnabled(false);
     m_actions[ActionCloseGame]->setEnabled(false);
     m_actions[ActionGenReport]->setEnabled(false);
+    m_actions[ActionVerifyReplays]->setEnabled(false);
+    m_actions[ActionReplaceTiles]->setEnabled(currentEditor() != nullptr);
+    if (m_patternSearch) {
+        m_patternSearch->stopSearch();
+        m_patternSearch->hide();
+    }
 }
 
 bool CC2EditMain::saveTab(int index)
@@ -1727,6 +1768,53 @@ void CC2EditMain::onImportCC1Action()
     }
 }
 
+void CC2EditMain::onImportCC1SetAction()
+{
+    QSettings settings;
+    QString filename = QFileDialog::getOpenFileName(this, tr("Import Levelset..."),
+                            settings.value(QStringLiteral("Import/DialogDir")).toString(),
+                            tr("CC1 Levelsets (*.ccl *.dat *.DAT *.dac)"));
+    if (filename.isEmpty())
+        return;
+
+    std::unique_ptr<ccl::Levelset> levelset;
+    try {
+        levelset.reset(ccl::LoadLevelset(filename));
+    } catch (const ccl::RuntimeError& err) {
+        QMessageBox::critical(this, tr("Error importing levelset"),
+                tr("Failed to load '%1': %2").arg(filename).arg(err.message()));
+        return;
+    }
+    settings.setValue(QStringLiteral("Import/DialogDir"),
+                      QFileInfo(filename).dir().absolutePath());
+
+    // The maps are written next to the script, named after it
+    QFileInfo info(filename);
+    QString scriptFilename = QFileDialog::getSaveFileName(this, tr("Save Game Script..."),
+                            info.dir().absoluteFilePath(info.completeBaseName() + QStringLiteral(".c2g")),
+                            tr("CC2 Game Scripts (*.c2g)"));
+    if (scriptFilename.isEmpty())
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    std::vector<cc2::ImportResult> results;
+    try {
+        results = cc2::ImportLevelset(levelset.get(), scriptFilename,
+                        ccl::toLatin1(info.completeBaseName()),
+                        settings.value(QStringLiteral("Import/AutoResize"), false).toBool());
+    } catch (const ccl::RuntimeError& err) {
+        QApplication::restoreOverrideCursor();
+        QMessageBox::critical(this, tr("Error importing levelset"), err.message());
+        return;
+    }
+    std::string report = cc2::FormatImportReport(results);
+    QApplication::restoreOverrideCursor();
+
+    ReportDialog dlg(tr("Import CC1 Levelset"), QString::fromStdString(report), this);
+    dlg.exec();
+    loadFile(scriptFilename);
+}
+
 void CC2EditMain::onSaveAction()
 {
     saveTab(m_editorTabs->currentIndex());
@@ -2288,6 +2376,235 @@ void CC2EditMain::onToggleGreensAction()
     editor->endEdit();
 }
 
+void CC2EditMain::onVerifyReplaysAction()
+{
+    if (m_currentGameScript.isEmpty())
+        return;
+
+    // The maps are read from disk by the worker, so the editor stays usable
+    // while the replays are played back
+    const QString scriptFilename = m_currentGameScript;
+    auto dlg = new ReportDialog(tr("Verify Replays (Experimental)"), [scriptFilename]() {
+        QElapsedTimer timer;
+        timer.start();
+        try {
+            bool complete = true;
+            std::vector<std::string> missingChains;
+            auto results = cc2::VerifyGame(scriptFilename, 0, &complete, &missingChains);
+            QString report = QString::fromStdString(ccl::FormatVerifyReport(results,
+                                                    timer.nsecsElapsed() / 1.0e6));
+            if (!complete) {
+                report.prepend(tr("Warning: The script's control flow is too large to "
+                                  "follow completely, so some maps may not have been "
+                                  "verified.\n\n"));
+            }
+            for (const std::string& chain : missingChains) {
+                report.prepend(tr("Warning: The chained script %1 could not be read, "
+                                  "so its maps were not verified.\n\n")
+                               .arg(QString::fromStdString(chain)));
+            }
+            return report;
+        } catch (const ccl::RuntimeError& err) {
+            return tr("Error loading script: %1").arg(err.message());
+        }
+    }, this);
+    dlg->setAttribute(Qt::WA_DeleteOnClose);
+    dlg->show();
+}
+
+std::vector<CC2EditMain::MapSource> CC2EditMain::mapSources()
+{
+    std::vector<MapSource> sources;
+    if (!m_currentGameScript.isEmpty()) {
+        for (int i = 0; i < m_gameMapList->count(); ++i) {
+            QListWidgetItem* item = m_gameMapList->item(i);
+            MapSource source;
+            source.name = item->text();
+            source.filename = item->data(Qt::UserRole).toString();
+            const QString canonicalName = QFileInfo(source.filename).canonicalFilePath();
+            for (int j = 0; j < m_editorTabs->count(); ++j) {
+                CC2EditorWidget* editor = getEditorAt(j);
+                if (editor && editor->filename() == canonicalName) {
+                    source.editor = editor;
+                    break;
+                }
+            }
+            sources.push_back(source);
+        }
+    } else {
+        for (int i = 0; i < m_editorTabs->count(); ++i) {
+            CC2EditorWidget* editor = getEditorAt(i);
+            if (editor) {
+                MapSource source;
+                source.name = m_editorTabs->tabText(i);
+                source.filename = editor->filename();
+                source.editor = editor;
+                sources.push_back(source);
+            }
+        }
+    }
+    return sources;
+}
+
+std::vector<std::shared_ptr<cc2::MapData>>
+CC2EditMain::loadMapSources(const std::vector<MapSource>& sources)
+{
+    // Copy the open maps here; the others are read from disk in parallel.
+    // Maps which can't be read are left null.
+    std::vector<std::shared_ptr<cc2::MapData>> maps(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (sources[i].editor)
+            maps[i] = std::make_shared<cc2::MapData>(sources[i].editor->map()->mapData());
+    }
+    ccl::RunParallel(sources.size(), 0, [&sources, &maps](unsigned int, size_t index) {
+        if (maps[index] || sources[index].filename.isEmpty())
+            return;
+        ccl::FileStream fs;
+        if (!fs.open(sources[index].filename, ccl::FileStream::Read))
+            return;
+        cc2::Map map;
+        try {
+            map.read(&fs);
+        } catch (const ccl::RuntimeError&) {
+            return;
+        }
+        maps[index] = std::make_shared<cc2::MapData>(map.mapData());
+    });
+    return maps;
+}
+
+void CC2EditMain::onFindPatternAction()
+{
+    CC2EditorWidget* editor = currentEditor();
+    if (!editor)
+        return;
+
+    const QRect region = editor->selection();
+    if (region.width() <= 0 || region.height() <= 0) {
+        QMessageBox::information(this, tr("Find Pattern"),
+                tr("Select the region of the map to search for first."));
+        return;
+    }
+
+    // Maps that are open in an editor are searched from a snapshot, so they
+    // can be edited while the search is running; the rest are loaded from
+    // disk on the search thread.
+    m_patternSources = mapSources();
+    std::vector<std::shared_ptr<cc2::MapData>> snapshots;
+    QStringList names;
+    QStringList files;
+    for (const MapSource& source : m_patternSources) {
+        names << source.name;
+        files << source.filename;
+        snapshots.push_back(source.editor
+                ? std::make_shared<cc2::MapData>(source.editor->map()->mapData())
+                : nullptr);
+    }
+
+    const std::vector<uint64_t> pattern = cc2::MapCellCodes(editor->map()->mapData(),
+            region.x(), region.y(), region.width(), region.height());
+    const int patternWidth = region.width();
+    const int patternHeight = region.height();
+
+    if (!m_patternSearch) {
+        m_patternSearch = new PatternSearchDialog(this);
+        connect(m_patternSearch, &PatternSearchDialog::matchActivated, this,
+                [this](int index, const QRect& match) {
+            if (index < 0 || (size_t)index >= m_patternSources.size())
+                return;
+
+            const MapSource& source = m_patternSources[index];
+            CC2EditorWidget* target = source.editor;
+            if (target) {
+                for (int i = 0; i < m_editorTabs->count(); ++i) {
+                    if (getEditorAt(i) == target) {
+                        m_editorTabs->setCurrentIndex(i);
+                        break;
+                    }
+                }
+            } else if (!source.filename.isEmpty() && loadMap(source.filename, true)) {
+                target = currentEditor();
+            }
+            if (target) {
+                target->selectRegion(match.x(), match.y(), match.width(), match.height());
+                target->update();
+            }
+        });
+    }
+    m_patternSearch->startSearch(names, region.size(),
+                                 [snapshots, files, pattern, patternWidth, patternHeight](int index) {
+        std::vector<QPoint> matches;
+        cc2::Map map;
+        const cc2::MapData* mapData = snapshots[index].get();
+        if (!mapData) {
+            ccl::FileStream fs;
+            if (!fs.open(files[index], ccl::FileStream::Read))
+                return matches;
+            try {
+                map.read(&fs);
+            } catch (const ccl::RuntimeError&) {
+                return matches;
+            }
+            mapData = &map.mapData();
+        }
+
+        const std::vector<uint64_t> cells = cc2::MapCellCodes(*mapData, 0, 0,
+                                                              mapData->width(), mapData->height());
+        for (const ccl::Point& match : ccl::FindPattern2D(cells, mapData->width(), mapData->height(),
+                                                          pattern, patternWidth, patternHeight))
+            matches.emplace_back(match.X, match.Y);
+        return matches;
+    });
+    m_patternSearch->show();
+    m_patternSearch->raise();
+}
+
+void CC2EditMain::onReplaceTilesAction()
+{
+    const std::vector<MapSource> sources = mapSources();
+    if (sources.empty())
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const std::vector<std::shared_ptr<cc2::MapData>> maps = loadMapSources(sources);
+    QApplication::restoreOverrideCursor();
+
+    QStringList names;
+    for (const MapSource& source : sources)
+        names << source.name;
+
+    ReplaceTilesDialog dlg(m_leftTile, m_rightTile, this);
+    dlg.setMaps(names, maps);
+    if (dlg.exec() != QDialog::Accepted)
+        return;
+
+    // Maps which aren't open yet are opened in new tabs, so each change
+    // can be reviewed or undone before anything is written to disk
+    const cc2::TileReplaceRule rule = dlg.rule();
+    std::vector<CC2EditorWidget*> editors;
+    for (int index : dlg.matchingMaps()) {
+        CC2EditorWidget* editor = sources[index].editor;
+        if (!editor) {
+            if (!loadMap(sources[index].filename, false))
+                continue;
+            editor = currentEditor();
+        }
+        // A game may use the same map more than once
+        if (std::find(editors.begin(), editors.end(), editor) == editors.end())
+            editors.push_back(editor);
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    for (CC2EditorWidget* editor : editors)
+        editor->beginEdit(CC2EditHistory::EditMap);
+    ccl::RunParallel(editors.size(), 0, [&editors, &rule](unsigned int, size_t index) {
+        cc2::ReplaceTiles(editors[index]->map()->mapData(), rule);
+    });
+    for (CC2EditorWidget* editor : editors)
+        editor->endEdit();
+    QApplication::restoreOverrideCursor();
+}
+
 void CC2EditMain::onViewViewportToggled(bool view)
 {
     for (int i = 0; i < m_editorTabs->count(); ++i) {
@@ -2761,6 +3078,8 @@ void CC2EditMain::onTabChanged(int index)
     m_actions[ActionPaste]->setEnabled(false);
     m_actions[ActionClear]->setEnabled(false);
     m_actions[ActionToggleGreens]->setEnabled(!!mapEditor);
+    m_actions[ActionFindPattern]->setEnabled(!!mapEditor);
+    m_actions[ActionReplaceTiles]->setEnabled(mapEditor || !m_currentGameScript.isEmpty());
     m_actions[ActionTestCC2]->setEnabled(!!mapEditor);
     m_actions[ActionTestLexy]->setEnabled(!!mapEditor);
     m_drawModeGroup->setEnabled(!!mapEditor);
@@ -20,6 +20,10 @@
 
 #include <QMainWindow>
 #include <QProcess>
+#include <QPointer>
+#include <QStringList>
+#include <memory>
+#include <vector>
 #include "libcc2/Map.h"
 #include "libcc2/Tileset.h"
 #include "EditorWidget.h"
@@ -31,6 +35,7 @@ class QListWidgetItem;
 class QActionGroup;
 
 class EditorTabWidget;
+class PatternSearchDialog;
 class MapProperties;
 
 class CC2EditMain : public QMainWindow {
@@ -75,6 +80,7 @@ protected:
 private slots:
     void onOpenAction();
     void onImportCC1Action();
+    void onImportCC1SetAction();
     void onSaveAction();
     void onSaveAsAction();
     void onReportAction();
@@ -96,6 +102,9 @@ private slots:
     void onInspectHints(bool);
     void onInspectTiles(bool);
     void onToggleGreensAction();
+    void onVerifyReplaysAction();
+    void onFindPatternAction();
+    void onReplaceTilesAction();
 
     void onViewViewportToggled(bool);
     void onViewMonsterPathsToggled(bool);
@@ -136,12 +145,13 @@ private slots:
 
 private:
     enum ActionType {
-        ActionNewMap, ActionNewScript, ActionOpen, ActionImportCC1, ActionSave,
-        ActionSaveAs, ActionCloseTab, ActionCloseGame, ActionGenReport, ActionExit,
-        ActionSelect, ActionCut, ActionCopy, ActionPaste, ActionClear,
+        ActionNewMap, ActionNewScript, ActionOpen, ActionImportCC1, ActionImportCC1Set,
+        ActionSave, ActionSaveAs, ActionCloseTab, ActionCloseGame, ActionGenReport,
+        ActionExit, ActionSelect, ActionCut, ActionCopy, ActionPaste, ActionClear,
         ActionUndo, ActionRedo, ActionDrawPencil, ActionDrawLine, ActionDrawRect,
         ActionDrawFill, ActionDrawFlood, ActionPathMaker, ActionDrawWire,
         ActionInspectHints, ActionInspectTiles, ActionToggleGreens,
+        ActionVerifyReplays, ActionFindPattern, ActionReplaceTiles,
         ActionViewViewport, ActionViewMonsterPaths, ActionZoom200, ActionZoom150,
         ActionZoom100, ActionZoom75, ActionZoom50, ActionZoom25, ActionZoom125,
         ActionZoomCust, ActionZoomFit, ActionTestCC2, ActionTestLexy,
@@ -171,6 +181,18 @@ private:
     QListWidget* m_gameMapList;
     QString m_currentGameScript;
 
+    // A map in the current game, or an open map if there is no game
+    struct MapSource {
+        QString name;
+        QString filename;
+        QPointer<CC2EditorWidget> editor;
+    };
+    std::vector<MapSource> mapSources();
+    std::vector<std::shared_ptr<cc2::MapData>> loadMapSources(const std::vector<MapSource>& sources);
+
+    PatternSearchDialog* m_patternSearch;
+    std::vector<MapSource> m_patternSources;
+
     // Map properties
     MapProperties *m_mapProperties;
 
@@ -18,12 +18,12 @@
 #include "EditorWidget.h"
 #include "CommonWidgets/CCTools.h"
 #include "libcc2/GameLogic.h"
+#include "libcc1/FloodFill.h"
 
 #include <QUndoStack>
 #include <QPainter>
 #include <QPaintEvent>
 #include <QMouseEvent>
-#include <queue>
 
 static CC2EditorWidget::CombineMode select_cmode(Qt::KeyboardModifiers keys)
 {
@@ -109,42 +109,27 @@ static void plot_line(CC2EditorWidget* self, QPoint from, QPoint to,
 static void plot_flood(CC2EditorWidget* self, QPoint start,
                        const cc2::Tile& drawTile, CC2EditorWidget::CombineMode mode)
 {
-    cc2::MapData& map = self->map()->mapData();
+    const cc2::MapData& map = self->map()->mapData();
     const cc2::Tile replaceTile = map.tile(start.x(), start.y());
 
-    std::queue<QPoint> floodQueue;
-    floodQueue.push(start);
-    self->putTile(drawTile, start.x(), start.y(), mode);
+    // Find the whole region up front, comparing cached stack hashes
+    // rather than whole tile stacks
+    const std::vector<ccl::FillSpan> region = ccl::ScanlineFill(
+            map.cellHashes().data(), map.width(), map.height(), start.x(), start.y());
+
+    self->placeTile(drawTile, start.x(), start.y(), mode);
     if (map.tile(start.x(), start.y()) == replaceTile) {
-        // No change was made.  Exit to avoid an infinite loop
+        // No change was made, so nothing else in the region would change
         return;
     }
 
-    while (!floodQueue.empty()) {
-        QPoint pt = floodQueue.front();
-        floodQueue.pop();
-
-        if (pt.x() > 0 && map.tile(pt.x() - 1, pt.y()) == replaceTile) {
-            QPoint next(pt.x() - 1, pt.y());
-            self->putTile(drawTile, next.x(), next.y(), mode);
-            floodQueue.push(next);
-        }
-        if (pt.x() < map.width() - 1 && map.tile(pt.x() + 1, pt.y()) == replaceTile) {
-            QPoint next(pt.x() + 1, pt.y());
-            self->putTile(drawTile, next.x(), next.y(), mode);
-            floodQueue.push(next);
-        }
-        if (pt.y() > 0 && map.tile(pt.x(), pt.y() - 1) == replaceTile) {
-            QPoint next(pt.x(), pt.y() - 1);
-            self->putTile(drawTile, next.x(), next.y(), mode);
-            floodQueue.push(next);
-        }
-        if (pt.y() < map.height() - 1 && map.tile(pt.x(), pt.y() + 1) == replaceTile) {
-            QPoint next(pt.x(), pt.y() + 1);
-            self->putTile(drawTile, next.x(), next.y(), mode);
-            floodQueue.push(next);
+    for (const ccl::FillSpan& span : region) {
+        for (int x = span.left; x <= span.right; ++x) {
+            if (x != start.x() || span.y != start.y())
+                self->placeTile(drawTile, x, span.y, mode);
         }
     }
+    self->dirtyBuffer();
 }
 
 static cc2::Tile::Direction calc_dir(const QPoint& from, const QPoint& to)
@@ -197,7 +182,7 @@ static cc2::Tile directionalize(const cc2::Tile& tile, cc2::Tile::Direction dir)
 CC2EditorWidget::CC2EditorWidget(QWidget* parent)
     : QWidget(parent), m_tileset(), m_map(), m_drawMode(DrawPencil),
       m_paintFlags(), m_cachedButton(Qt::NoButton), m_lastDir(cc2::Tile::InvalidDir),
-      m_undoCommand(), m_zoomFactor(1.0)
+      m_undoCommand(), m_wiresHash(), m_zoomFactor(1.0)
 {
     m_undoStack = new QUndoStack(this);
     connect(m_undoStack, &QUndoStack::canUndoChanged, this, &CC2EditorWidget::canUndoChanged);
@@ -226,6 +211,7 @@ void CC2EditorWidget::setMap(cc2::Map* map)
     if (m_map)
         m_map->unref();
     m_map = map;
+    m_wireCells.clear();
 
     m_tileBuffer = QPixmap(m_map->mapData().width() * m_tileset->size(),
                            m_map->mapData().height() * m_tileset->size());
@@ -291,6 +277,9 @@ void CC2EditorWidget::endEdit()
         if (editType == CC2EditHistory::EditMap)
             emit updateCounters();
         m_undoCommand = nullptr;
+
+        // The edit is over, so nothing still holds a tile from it
+        m_map->mapData().settleCells();
     }
     dirtyBuffer();
 }
@@ -335,17 +324,6 @@ void CC2EditorWidget::paintEvent(QPaintEvent*)
     renderTo(painter);
 }
 
-static const cc2::Tile* findCreature(const cc2::Tile* tile)
-{
-    do {
-        if (tile->isCreature())
-            return tile;
-        tile = tile->lower();
-    } while (tile);
-
-    return nullptr;
-}
-
 void CC2EditorWidget::renderTo(QPainter& painter)
 {
     if (m_cacheDirty) {
@@ -371,14 +349,15 @@ void CC2EditorWidget::renderTo(QPainter& painter)
         for (int y = 0; y < mapData.height(); ++y) {
             for (int x = 0; x < mapData.width(); ++x) {
                 const cc2::Tile* tile = &mapData.tile(x, y);
-                while (tile && (tile = findCreature(tile)) != nullptr) {
+                while (tile && (tile = tile->findClass(cc2::Tile::ClassCreature)) != nullptr) {
                     std::fill(looked.begin(), looked.end(), 0);
-                    cc2::MoveState move = cc2::CheckMove(mapData, tile, x, y);
+                    const cc2::Tile::Type creType = tile->type();
+                    cc2::Tile::Direction creDir = tile->direction();
+                    cc2::MoveState move = cc2::CheckMove(mapData, creType, creDir, x, y);
 
-                    cc2::Tile tmpCre(*tile);
                     QPoint from(x, y);
                     do {
-                        looked[(from.y() * mapData.width()) + from.x()] |= 1 << (int)tmpCre.direction();
+                        looked[(from.y() * mapData.width()) + from.x()] |= 1 << (int)creDir;
                         if ((move & cc2::MoveDirMask) < cc2::MoveBlocked) {
                             if ((move & cc2::MoveTrapped) != 0)
                                 break;
@@ -393,13 +372,13 @@ void CC2EditorWidget::renderTo(QPainter& painter)
                                 break;
                             }
                             from = to;
-                            cc2::TurnCreature(&tmpCre, move);
+                            creDir = (cc2::Tile::Direction)(move & cc2::MoveDirMask);
                         } else {
                             break;
                         }
-                        move = cc2::CheckMove(mapData, &tmpCre, from.x(), from.y());
+                        move = cc2::CheckMove(mapData, creType, creDir, from.x(), from.y());
                     } while ((looked[(from.y() * mapData.width()) + from.x()]
-                               & (1 << (int)tmpCre.direction())) == 0);
+                               & (1 << (int)creDir)) == 0);
 
                     tile = tile->lower();
                 }
@@ -528,7 +507,7 @@ static QList<QPoint> scanForAll(cc2::Tile::Type type, const cc2::MapData& map)
     return matches;
 }
 
-static QPoint scanForControl(const std::vector<cc2::Tile::Type>& controlTypes,
+static QPoint scanForControl(const cc2::Tile::TypeSet& controlTypes,
                              int x, int y, const cc2::MapData& map)
 {
     int sx = x, sy = y;
@@ -550,7 +529,7 @@ static QPoint scanForControl(const std::vector<cc2::Tile::Type>& controlTypes,
 }
 
 static QList<QPoint> scanForButtons(cc2::Tile::Type buttonType,
-                                    const std::vector<cc2::Tile::Type>& controlTypes,
+                                    const cc2::Tile::TypeSet& controlTypes,
                                     int x, int y, const cc2::MapData& map)
 {
     QList<QPoint> matches;
@@ -577,6 +556,17 @@ static QList<QPoint> scanForButtons(cc2::Tile::Type buttonType,
 
 static QList<QPoint> areaCtlSearch(int x, int y, const cc2::MapData& map)
 {
+    static constexpr cc2::Tile::TypeSet areaCtlTypes {
+        cc2::Tile::Force_N, cc2::Tile::Force_E,
+        cc2::Tile::Force_S, cc2::Tile::Force_W,
+        cc2::Tile::ToggleWall, cc2::Tile::ToggleFloor,
+        cc2::Tile::CC1_Cloner, cc2::Tile::Cloner,
+        cc2::Tile::RevolvDoor_SW, cc2::Tile::RevolvDoor_NW,
+        cc2::Tile::RevolvDoor_NE, cc2::Tile::RevolvDoor_SE,
+        cc2::Tile::FlameJet_Off, cc2::Tile::FlameJet_On,
+        cc2::Tile::LSwitchFloor, cc2::Tile::LSwitchWall,
+    };
+
     QList<QPoint> matches;
 
     const int xmin = std::max(x - 2, 0);
@@ -585,15 +575,7 @@ static QList<QPoint> areaCtlSearch(int x, int y, const cc2::MapData& map)
     const int ymax = std::min(y + 2, map.height() - 1);
     for (int sy = ymin; sy <= ymax; ++sy) {
         for (int sx = xmin; sx <= xmax; ++sx) {
-            if (map.tile(sx, sy).haveTile({
-                    cc2::Tile::Force_N, cc2::Tile::Force_E,
-                    cc2::Tile::Force_S, cc2::Tile::Force_W,
-                    cc2::Tile::ToggleWall, cc2::Tile::ToggleFloor,
-                    cc2::Tile::CC1_Cloner, cc2::Tile::Cloner,
-                    cc2::Tile::RevolvDoor_SW, cc2::Tile::RevolvDoor_NW,
-                    cc2::Tile::RevolvDoor_NE, cc2::Tile::RevolvDoor_SE,
-                    cc2::Tile::FlameJet_Off, cc2::Tile::FlameJet_On,
-                    cc2::Tile::LSwitchFloor, cc2::Tile::LSwitchWall})) {
+            if (map.tile(sx, sy).haveTile(areaCtlTypes)) {
                 matches << QPoint(sx, sy);
             } else {
                 // Only match track tiles if the track has a switch
@@ -613,7 +595,7 @@ static QList<QPoint> areaCtlSearch(int x, int y, const cc2::MapData& map)
     return matches;
 }
 
-static QPoint diamondClosest(const std::vector<cc2::Tile::Type>& controlTypes,
+static QPoint diamondClosest(const cc2::Tile::TypeSet& controlTypes,
                              int x, int y, const cc2::MapData& map)
 {
     int sx = x + 1, sy = y;
@@ -1031,6 +1013,19 @@ void CC2EditorWidget::mouseMoveEvent(QMouseEvent* event)
         break;
     }
 
+    if (baseTile->type() != cc2::Tile::LogicGate) {
+        // Logic gates driven by a button, switch or wire under the cursor
+        for (const cc2::WireNetlist::Terminal& input : wireNetlist().drivenGates(posX, posY)) {
+            const QPoint gate(input.x, input.y);
+            if (m_hilights.contains(gate))
+                continue;
+            m_hilights << gate;
+            if (!tipText.isEmpty())
+                tipText += QLatin1Char('\n');
+            tipText += tr("Gate: (%1, %2)").arg(gate.x()).arg(gate.y());
+        }
+    }
+
     std::string clue = m_map->clueForTile(posX, posY);
     if (!clue.empty()) {
         if (!tipText.isEmpty())
@@ -1205,6 +1200,12 @@ static void popTile(cc2::Tile& destTile)
 }
 
 void CC2EditorWidget::putTile(const cc2::Tile& tile, int x, int y, CombineMode mode)
+{
+    placeTile(tile, x, y, mode);
+    dirtyBuffer();
+}
+
+void CC2EditorWidget::placeTile(const cc2::Tile& tile, int x, int y, CombineMode mode)
 {
     cc2::Tile& curTile = m_map->mapData().tile(x, y);
     cc2::Tile& baseTile = curTile.bottom();
@@ -1337,8 +1338,6 @@ void CC2EditorWidget::putTile(const cc2::Tile& tile, int x, int y, CombineMode m
         emit clueDeleted(x, y);
     else if (!clueTile && curTile.bottom().type() == cc2::Tile::Clue)
         emit clueAdded(x, y);
-
-    dirtyBuffer();
 }
 
 void CC2EditorWidget::setZoom(double factor)
@@ -1374,3 +1373,26 @@ void CC2EditorWidget::updateForUndoCommand(const QUndoCommand* command)
         dirtyBuffer();
     }
 }
+
+const cc2::WireNetlist& CC2EditorWidget::wireNetlist()
+{
+    // Catch up with every cell changed since the last lookup, whichever
+    // edit made the change
+    const cc2::MapData& map = m_map->mapData();
+    const uint64_t mapHash = map.hash();
+    if (!m_wireCells.empty() && mapHash == m_wiresHash)
+        return m_wires;
+
+    std::vector<uint64_t> cells = map.cellHashes();
+    if (cells.size() != m_wireCells.size()) {
+        m_wires.build(map);
+    } else {
+        for (size_t index = 0; index < cells.size(); ++index) {
+            if (cells[index] != m_wireCells[index])
+                m_wires.update(map, index % map.width(), index / map.width());
+        }
+    }
+    m_wireCells = std::move(cells);
+    m_wiresHash = mapHash;
+    return m_wires;
+}
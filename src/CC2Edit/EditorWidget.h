@@ -22,6 +22,7 @@
 #include "History.h"
 #include "libcc2/Tileset.h"
 #include "libcc2/Map.h"
+#include "libcc2/WireNetlist.h"
 
 class QPainter;
 class QUndoStack;
@@ -141,6 +142,11 @@ signals:
     void clueAdded(int x, int y);
     void clueDeleted(int x, int y);
 
+public:
+    // Like putTile, but leaves refreshing the view to the caller so a
+    // batch of edits only needs one dirtyBuffer() call
+    void placeTile(const cc2::Tile& tile, int x, int y, CombineMode mode);
+
 public slots:
     void putTile(const cc2::Tile& tile, int x, int y, CombineMode mode);
     void setZoom(double factor);
@@ -172,6 +178,11 @@ private:
     MapUndoCommand* m_undoCommand;
     QRect m_selectRect;
 
+    // Wire nets for the hover highlights, and the cell hashes they match
+    cc2::WireNetlist m_wires;
+    std::vector<uint64_t> m_wireCells;
+    uint64_t m_wiresHash;
+
     double m_zoomFactor;
     QPixmap m_tileBuffer;
     QPixmap m_tileCache;
@@ -211,6 +222,7 @@ private:
     void delWire(cc2::Tile& tile, cc2::Tile::Direction direction);
 
     void updateForUndoCommand(const QUndoCommand* command);
+    const cc2::WireNetlist& wireNetlist();
 };
 
 #endif
@@ -18,12 +18,23 @@
 #include "History.h"
 #include "libcc2/Map.h"
 
+static std::shared_ptr<cc2::TilePalette> undoPalette(const cc2::MapData& map)
+{
+    // Shared by every undo step.  Stacks are never removed, so a new palette
+    // is started once another map's worth of new stacks might not fit.
+    static std::shared_ptr<cc2::TilePalette> s_palette;
+    if (!s_palette || !s_palette->canHold(map.width() * map.height()))
+        s_palette = std::make_shared<cc2::TilePalette>();
+    return s_palette;
+}
+
 MapUndoCommand::MapUndoCommand(CC2EditHistory::Type type, cc2::Map* before)
     : m_enter(1), m_type(type), m_targetMap(before),
       m_before(new cc2::Map), m_after()
 {
     m_targetMap->ref();
-    m_before->copyFrom(before);
+    m_before->copyMetadataFrom(before);
+    m_beforeTiles.pack(before->mapData(), undoPalette(before->mapData()));
 }
 
 MapUndoCommand::~MapUndoCommand()
@@ -43,17 +54,10 @@ bool MapUndoCommand::mergeWith(const QUndoCommand* command)
 
     auto mapCommand = dynamic_cast<const MapUndoCommand*>(command);
     Q_ASSERT(mapCommand);
-    m_after->copyFrom(mapCommand->m_after);
+    m_after->copyMetadataFrom(mapCommand->m_after);
+    m_afterTiles = mapCommand->m_afterTiles;
 
-    // Don't bother comparing map edits, since those are never merged
-    if (m_before->version() == m_after->version()
-            && m_before->lock() == m_after->lock()
-            && m_before->title() == m_after->title()
-            && m_before->author() == m_after->author()
-            && m_before->editorVersion() == m_after->editorVersion()
-            && m_before->clue() == m_after->clue()
-            && m_before->note() == m_after->note()
-            && m_before->option().timeLimit() == m_after->option().timeLimit())
+    if (isNoOp())
         setObsolete(true);
 
     return true;
@@ -65,7 +69,12 @@ bool MapUndoCommand::leave(cc2::Map* after)
         Q_ASSERT(!m_after);
         if (after) {
             m_after = new cc2::Map;
-            m_after->copyFrom(after);
+            m_after->copyMetadataFrom(after);
+            m_afterTiles.pack(after->mapData(), undoPalette(after->mapData()));
+
+            // Edits that didn't change anything don't need an undo step
+            if (isNoOp())
+                setObsolete(true);
         }
         return true;
     }
@@ -74,10 +83,22 @@ bool MapUndoCommand::leave(cc2::Map* after)
 
 void MapUndoCommand::undo()
 {
-    m_targetMap->copyFrom(m_before);
+    m_targetMap->copyMetadataFrom(m_before);
+    m_beforeTiles.unpack(m_targetMap->mapData());
 }
 
 void MapUndoCommand::redo()
 {
-    m_targetMap->copyFrom(m_after);
+    m_targetMap->copyMetadataFrom(m_after);
+    m_afterTiles.unpack(m_targetMap->mapData());
+}
+
+bool MapUndoCommand::isNoOp() const
+{
+    // The content hash is only a quick way to reject changed metadata.  It
+    // leaves out the key and unknown fields, so equal hashes still have to
+    // be confirmed field by field.
+    return m_before->contentHash() == m_after->contentHash()
+        && m_beforeTiles == m_afterTiles
+        && m_before->metadataEquals(m_after);
 }
@@ -19,11 +19,7 @@
 #define _CC2_HISTORY_H
 
 #include <QUndoCommand>
-
-namespace cc2
-{
-    class Map;
-}
+#include "libcc2/TilePalette.h"
 
 namespace CC2EditHistory {
     enum Type {
@@ -50,8 +46,14 @@ private:
     int m_enter;
     int m_type;
     cc2::Map* m_targetMap;
+
+    // Metadata only; the tiles are stored separately as palette indices
     cc2::Map* m_before;
     cc2::Map* m_after;
+    cc2::PackedMapData m_beforeTiles;
+    cc2::PackedMapData m_afterTiles;
+
+    bool isNoOp() const;
 };
 
 #endif
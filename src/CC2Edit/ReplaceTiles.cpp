@@ -0,0 +1,182 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "ReplaceTiles.h"
+#include "libcc2/Tileset.h"
+#include "libcc1/Parallel.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QGridLayout>
+#include <QSettings>
+
+ReplaceTilesDialog::ReplaceTilesDialog(const cc2::Tile& find, const cc2::Tile& replace,
+                                       QWidget* parent)
+    : QDialog(parent), m_find(find), m_replace(replace)
+{
+    setWindowTitle(tr("Replace Tiles"));
+    QSettings settings;
+    const unsigned int flags = settings.value(QStringLiteral("ReplaceTilesFlags"),
+                                              cc2::TileReplaceRule::KeepDirection).toUInt();
+
+    auto findLabel = new QLabel(tr("Find:"), this);
+    auto findValue = new QLabel(CC2ETileset::getName(&m_find), this);
+    auto replaceLabel = new QLabel(tr("Replace with:"), this);
+    auto replaceValue = new QLabel(CC2ETileset::getName(&m_replace), this);
+
+    m_matchDirection = new QCheckBox(tr("Match &direction"), this);
+    m_matchDirection->setChecked(flags & cc2::TileReplaceRule::MatchDirection);
+    m_matchModifier = new QCheckBox(tr("Match &modifier (wires, glyphs, ...)"), this);
+    m_matchModifier->setChecked(flags & cc2::TileReplaceRule::MatchModifier);
+    m_matchTileFlags = new QCheckBox(tr("Match &arrows and panels"), this);
+    m_matchTileFlags->setChecked(flags & cc2::TileReplaceRule::MatchTileFlags);
+    m_keepDirection = new QCheckBox(tr("&Keep the direction of replaced tiles"), this);
+    m_keepDirection->setChecked(flags & cc2::TileReplaceRule::KeepDirection);
+
+    m_target = new QComboBox(this);
+    auto targetLabel = new QLabel(tr("&Look in:"), this);
+    targetLabel->setBuddy(m_target);
+
+    m_preview = new QTreeWidget(this);
+    m_preview->setRootIsDecorated(false);
+    m_preview->setHeaderLabels(QStringList() << tr("Map") << tr("Matches"));
+    m_preview->header()->setStretchLastSection(false);
+    m_preview->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_summary = new QLabel(this);
+
+    auto buttonAlign = new QWidget(this);
+    auto btnClose = new QPushButton(tr("Clo&se"), buttonAlign);
+    m_replaceButton = new QPushButton(tr("&Replace"), buttonAlign);
+    auto layButtons = new QGridLayout(buttonAlign);
+    layButtons->setContentsMargins(0, 0, 0, 0);
+    layButtons->setHorizontalSpacing(8);
+    layButtons->addItem(new QSpacerItem(0, 0, QSizePolicy::MinimumExpanding, QSizePolicy::Minimum), 0, 0);
+    layButtons->addWidget(btnClose, 0, 1);
+    layButtons->addWidget(m_replaceButton, 0, 2);
+    m_replaceButton->setDefault(true);
+
+    auto layout = new QGridLayout(this);
+    layout->setContentsMargins(8, 8, 8, 8);
+    layout->setVerticalSpacing(8);
+    layout->addWidget(findLabel, 0, 0);
+    layout->addWidget(findValue, 0, 1);
+    layout->addWidget(replaceLabel, 1, 0);
+    layout->addWidget(replaceValue, 1, 1);
+    layout->addWidget(m_matchDirection, 2, 0, 1, 2);
+    layout->addWidget(m_matchModifier, 3, 0, 1, 2);
+    layout->addWidget(m_matchTileFlags, 4, 0, 1, 2);
+    layout->addWidget(m_keepDirection, 5, 0, 1, 2);
+    layout->addWidget(targetLabel, 6, 0);
+    layout->addWidget(m_target, 6, 1);
+    layout->addWidget(m_preview, 7, 0, 1, 2);
+    layout->addWidget(m_summary, 8, 0, 1, 2);
+    layout->addWidget(buttonAlign, 9, 0, 1, 2);
+
+    connect(btnClose, &QPushButton::clicked, this, &QDialog::reject);
+    connect(m_replaceButton, &QPushButton::clicked, this, &QDialog::accept);
+    for (QCheckBox* check : { m_matchDirection, m_matchModifier, m_matchTileFlags, m_keepDirection })
+        connect(check, &QCheckBox::toggled, this, &ReplaceTilesDialog::updatePreview);
+    connect(m_target, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &ReplaceTilesDialog::updatePreview);
+}
+
+ReplaceTilesDialog::~ReplaceTilesDialog()
+{
+    QSettings settings;
+    settings.setValue(QStringLiteral("ReplaceTilesFlags"), rule().flags);
+}
+
+void ReplaceTilesDialog::setMaps(const QStringList& names,
+                                 const std::vector<std::shared_ptr<cc2::MapData>>& maps)
+{
+    m_names = names;
+    m_maps = maps;
+
+    m_target->blockSignals(true);
+    m_target->clear();
+    m_target->addItem(tr("(All maps)"));
+    m_target->addItems(names);
+    m_target->blockSignals(false);
+    updatePreview();
+}
+
+cc2::TileReplaceRule ReplaceTilesDialog::rule() const
+{
+    cc2::TileReplaceRule replaceRule;
+    replaceRule.find = m_find;
+    replaceRule.replace = m_replace;
+    if (m_matchDirection->isChecked())
+        replaceRule.flags |= cc2::TileReplaceRule::MatchDirection;
+    if (m_matchModifier->isChecked())
+        replaceRule.flags |= cc2::TileReplaceRule::MatchModifier;
+    if (m_matchTileFlags->isChecked())
+        replaceRule.flags |= cc2::TileReplaceRule::MatchTileFlags;
+    if (m_keepDirection->isChecked())
+        replaceRule.flags |= cc2::TileReplaceRule::KeepDirection;
+    return replaceRule;
+}
+
+std::vector<int> ReplaceTilesDialog::matchingMaps() const
+{
+    std::vector<int> maps;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+        if (m_counts[i] > 0)
+            maps.push_back((int)i);
+    }
+    return maps;
+}
+
+void ReplaceTilesDialog::updatePreview()
+{
+    m_preview->clear();
+    m_counts.assign(m_maps.size(), 0);
+
+    const cc2::TileReplaceRule replaceRule = rule();
+    if (!replaceRule.isValid()) {
+        m_summary->setText(tr("%1 cannot be replaced with %2")
+                           .arg(CC2ETileset::getName(&m_find))
+                           .arg(CC2ETileset::getName(&m_replace)));
+        m_replaceButton->setEnabled(false);
+        return;
+    }
+
+    const int target = m_target->currentIndex() - 1;
+    ccl::RunParallel(m_maps.size(), 0, [this, &replaceRule, target](unsigned int, size_t index) {
+        if (m_maps[index] && (target < 0 || (size_t)target == index))
+            m_counts[index] = cc2::CountTileMatches(*m_maps[index], replaceRule);
+    });
+
+    int total = 0, maps = 0;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+        if (m_counts[i] == 0)
+            continue;
+        auto item = new QTreeWidgetItem(m_preview);
+        item->setText(0, m_names.value((int)i));
+        item->setText(1, QString::number(m_counts[i]));
+        item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+        total += m_counts[i];
+        ++maps;
+    }
+
+    m_summary->setText(tr("%1 tile(s) in %2 map(s) will be replaced")
+                       .arg(total).arg(maps));
+    m_replaceButton->setEnabled(total > 0);
+}
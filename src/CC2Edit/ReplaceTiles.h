@@ -0,0 +1,68 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _REPLACETILES_H
+#define _REPLACETILES_H
+
+#include <QDialog>
+#include <memory>
+#include <vector>
+#include "libcc2/TileReplace.h"
+
+class QCheckBox;
+class QComboBox;
+class QTreeWidget;
+class QLabel;
+class QPushButton;
+
+class ReplaceTilesDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    ReplaceTilesDialog(const cc2::Tile& find, const cc2::Tile& replace,
+                       QWidget* parent = nullptr);
+    ~ReplaceTilesDialog() override;
+
+    // Maps which could not be loaded may be null, and are skipped
+    void setMaps(const QStringList& names,
+                 const std::vector<std::shared_ptr<cc2::MapData>>& maps);
+
+    cc2::TileReplaceRule rule() const;
+
+    // Maps with at least one match, as of the last preview
+    std::vector<int> matchingMaps() const;
+
+private slots:
+    void updatePreview();
+
+private:
+    cc2::Tile m_find, m_replace;
+    QStringList m_names;
+    std::vector<std::shared_ptr<cc2::MapData>> m_maps;
+    std::vector<int> m_counts;
+
+    QCheckBox* m_matchDirection;
+    QCheckBox* m_matchModifier;
+    QCheckBox* m_matchTileFlags;
+    QCheckBox* m_keepDirection;
+    QComboBox* m_target;
+    QTreeWidget* m_preview;
+    QLabel* m_summary;
+    QPushButton* m_replaceButton;
+};
+
+#endif
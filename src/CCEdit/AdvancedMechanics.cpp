@@ -348,7 +348,7 @@ void AdvancedMechanicsDialog::setFrom(ccl::LevelData* level)
     m_moveOrder.clear();
     m_moveOrder.reserve(MAX_MOVERS);
 
-    std::list<ccl::Trap>::const_iterator trap_iter;
+    std::vector<ccl::Trap>::const_iterator trap_iter;
     for (trap_iter = level->traps().begin(); trap_iter != level->traps().end(); ++trap_iter) {
         m_traps.push_back(*trap_iter);
         addTrapItem(*trap_iter);
@@ -356,7 +356,7 @@ void AdvancedMechanicsDialog::setFrom(ccl::LevelData* level)
     m_actions[ActionAddTrap]->setEnabled(m_traps.size() < MAX_TRAPS);
     onTrapSelect(0, 0);
 
-    std::list<ccl::Clone>::const_iterator clone_iter;
+    std::vector<ccl::Clone>::const_iterator clone_iter;
     for (clone_iter = level->clones().begin(); clone_iter != level->clones().end(); ++clone_iter) {
         m_clones.push_back(*clone_iter);
         addCloneItem(*clone_iter);
@@ -364,7 +364,7 @@ void AdvancedMechanicsDialog::setFrom(ccl::LevelData* level)
     m_actions[ActionAddClone]->setEnabled(m_clones.size() < MAX_CLONES);
     onCloneSelect(0, 0);
 
-    std::list<ccl::Point>::const_iterator move_iter;
+    std::vector<ccl::Point>::const_iterator move_iter;
     for (move_iter = level->moveList().begin(); move_iter != level->moveList().end(); ++move_iter) {
         m_moveOrder.push_back(*move_iter);
         addMoverItem(*move_iter);
@@ -375,9 +375,9 @@ void AdvancedMechanicsDialog::setFrom(ccl::LevelData* level)
 
 void AdvancedMechanicsDialog::onAccept()
 {
-    m_levelData->traps() = std::list<ccl::Trap>(m_traps.begin(), m_traps.end());
-    m_levelData->clones() = std::list<ccl::Clone>(m_clones.begin(), m_clones.end());
-    m_levelData->moveList() = std::list<ccl::Point>(m_moveOrder.begin(), m_moveOrder.end());
+    m_levelData->setTraps(m_traps);
+    m_levelData->setClones(m_clones);
+    m_levelData->setMoveList(m_moveOrder);
     accept();
 }
 
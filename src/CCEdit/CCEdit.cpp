@@ -43,9 +43,11 @@
 #include <QMimeData>
 #include <QElapsedTimer>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <memory>
 
 #include "LevelsetProps.h"
 #include "Organizer.h"
@@ -55,13 +57,19 @@
 #include "AdvancedMechanics.h"
 #include "TestSetup.h"
 #include "ErrorCheck.h"
+#include "ReplaceTiles.h"
 #include "TileInspector.h"
 #include "libcc1/IniFile.h"
 #include "libcc1/ChipsHax.h"
+#include "libcc1/Verifier.h"
+#include "libcc1/Parallel.h"
+#include "libcc1/PatternSearch.h"
 #include "libcc1/GameLogic.h"
 #include "CommonWidgets/CCTools.h"
 #include "CommonWidgets/EditorTabWidget.h"
 #include "CommonWidgets/LLTextEdit.h"
+#include "CommonWidgets/ReportDialog.h"
+#include "CommonWidgets/PatternSearchDialog.h"
 
 static const QString s_appTitle = QStringLiteral("CCEdit " CCTOOLS_VERSION);
 static const QString s_clipboardFormat = QStringLiteral("CHIPEDIT MAPSECT");
@@ -76,7 +84,7 @@ Q_DECLARE_METATYPE(CCETileset*)
 CCEditMain::CCEditMain(QWidget* parent)
     : QMainWindow(parent), m_undoCommand(), m_currentTileset(),
       m_savedDrawMode(ActionDrawPencil), m_currentDrawMode(EditorWidget::DrawPencil),
-      m_levelset(), m_dirtyFlag(), m_useDac(), m_subProc()
+      m_patternSearch(), m_levelset(), m_dirtyFlag(), m_useDac(), m_subProc()
 {
     setWindowTitle(s_appTitle);
 
@@ -185,6 +193,15 @@ CCEditMain::CCEditMain(QWidget* parent)
     m_actions[ActionCheckErrors]->setStatusTip(tr("Check for errors in the current levelset or a specific level"));
     m_actions[ActionCheckErrors]->setShortcut(Qt::CTRL | Qt::Key_E);
     m_actions[ActionCheckErrors]->setEnabled(false);
+    m_actions[ActionVerifySolutions] = new QAction(tr("&Verify Solutions..."), this);
+    m_actions[ActionVerifySolutions]->setStatusTip(tr("Replay a Tile World solution file against every level in the levelset"));
+    m_actions[ActionVerifySolutions]->setEnabled(false);
+    m_actions[ActionFindPattern] = new QAction(tr("Find &Pattern..."), this);
+    m_actions[ActionFindPattern]->setStatusTip(tr("Find every copy of the selected region in the levelset"));
+    m_actions[ActionFindPattern]->setEnabled(false);
+    m_actions[ActionReplaceTiles] = new QAction(tr("&Replace Tiles..."), this);
+    m_actions[ActionReplaceTiles]->setStatusTip(tr("Replace one tile with another across the levelset or a specific level"));
+    m_actions[ActionReplaceTiles]->setEnabled(false);
     m_drawModeGroup = new QActionGroup(this);
     m_drawModeGroup->addAction(m_actions[ActionDrawPencil]);
     m_drawModeGroup->addAction(m_actions[ActionDrawLine]);
@@ -532,6 +549,8 @@ CCEditMain::CCEditMain(QWidget* parent)
     editMenu->addAction(m_actions[ActionPaste]);
     editMenu->addSeparator();
     editMenu->addAction(m_actions[ActionClear]);
+    editMenu->addSeparator();
+    editMenu->addAction(m_actions[ActionReplaceTiles]);
 
     QMenu* toolsMenu = menuBar()->addMenu(tr("&Tools"));
     toolsMenu->addAction(m_actions[ActionDrawPencil]);
@@ -548,6 +567,8 @@ CCEditMain::CCEditMain(QWidget* parent)
     toolsMenu->addAction(m_actions[ActionToggleWalls]);
     toolsMenu->addSeparator();
     toolsMenu->addAction(m_actions[ActionCheckErrors]);
+    toolsMenu->addAction(m_actions[ActionVerifySolutions]);
+    toolsMenu->addAction(m_actions[ActionFindPattern]);
 
     QMenu* viewMenu = menuBar()->addMenu(tr("&View"));
     viewMenu->addAction(m_actions[ActionViewButtons]);
@@ -651,6 +672,9 @@ CCEditMain::CCEditMain(QWidget* parent)
     connect(m_actions[ActionInspectTiles], &QAction::triggered, this, &CCEditMain::onInspectTilesToggled);
     connect(m_actions[ActionToggleWalls], &QAction::triggered, this, &CCEditMain::onToggleWallsAction);
     connect(m_actions[ActionCheckErrors], &QAction::triggered, this, &CCEditMain::onCheckErrorsAction);
+    connect(m_actions[ActionVerifySolutions], &QAction::triggered, this, &CCEditMain::onVerifySolutionsAction);
+    connect(m_actions[ActionFindPattern], &QAction::triggered, this, &CCEditMain::onFindPatternAction);
+    connect(m_actions[ActionReplaceTiles], &QAction::triggered, this, &CCEditMain::onReplaceTilesAction);
     connect(m_actions[ActionViewButtons], &QAction::toggled, this, &CCEditMain::onViewButtonsToggled);
     connect(m_actions[ActionViewMovers], &QAction::toggled, this, &CCEditMain::onViewMoversToggled);
     connect(m_actions[ActionViewActivePlayer], &QAction::toggled, this, &CCEditMain::onViewActivePlayerToggled);
@@ -928,6 +952,9 @@ void CCEditMain::loadLevelset(const QString& filename)
     m_actions[ActionAddLevel]->setEnabled(true);
     m_actions[ActionOrganize]->setEnabled(true);
     m_actions[ActionCheckErrors]->setEnabled(true);
+    m_actions[ActionVerifySolutions]->setEnabled(true);
+    m_actions[ActionFindPattern]->setEnabled(true);
+    m_actions[ActionReplaceTiles]->setEnabled(true);
 
     QSettings settings;
     addRecentFile(settings, filename);
@@ -1174,6 +1201,13 @@ bool CCEditMain::closeLevelset()
     m_actions[ActionAddLevel]->setEnabled(false);
     m_actions[ActionOrganize]->setEnabled(false);
     m_actions[ActionCheckErrors]->setEnabled(false);
+    m_actions[ActionVerifySolutions]->setEnabled(false);
+    m_actions[ActionFindPattern]->setEnabled(false);
+    m_actions[ActionReplaceTiles]->setEnabled(false);
+    if (m_patternSearch) {
+        m_patternSearch->stopSearch();
+        m_patternSearch->hide();
+    }
 
     return true;
 }
@@ -1390,6 +1424,9 @@ void CCEditMain::createNewLevelset()
     m_actions[ActionAddLevel]->setEnabled(true);
     m_actions[ActionOrganize]->setEnabled(true);
     m_actions[ActionCheckErrors]->setEnabled(true);
+    m_actions[ActionVerifySolutions]->setEnabled(true);
+    m_actions[ActionFindPattern]->setEnabled(true);
+    m_actions[ActionReplaceTiles]->setEnabled(true);
 }
 
 void CCEditMain::onOpenAction()
@@ -1706,6 +1743,15 @@ void CCEditMain::updateForUndoCommand(const QUndoCommand* command)
     } else if (dynamic_cast<const LevelsetUndoCommand*>(command)) {
         doLevelsetLoad();
         m_levelList->setCurrentRow(-1);
+    } else if (auto multiCmd = dynamic_cast<const MultiLevelUndoCommand*>(command)) {
+        const auto& levels = multiCmd->levels();
+        for (int i = 0; i < m_editorTabs->count(); ++i) {
+            auto editor = getEditorAt(i);
+            if (std::find(levels.begin(), levels.end(), editor->levelData()) != levels.end())
+                editor->dirtyBuffer();
+        }
+        if (m_editorTabs->currentIndex() >= 0)
+            onTabChanged(m_editorTabs->currentIndex());
     }
 }
 
@@ -1848,6 +1894,134 @@ void CCEditMain::onCheckErrorsAction()
     dlg.exec();
 }
 
+void CCEditMain::onVerifySolutionsAction()
+{
+    if (!m_levelset)
+        return;
+
+    QSettings settings;
+    QString filename = QFileDialog::getOpenFileName(this, tr("Verify Solutions..."),
+                            settings.value(QStringLiteral("SolutionDir")).toString(),
+                            tr("Tile World Solutions (*.tws)"));
+    if (filename.isEmpty())
+        return;
+    settings.setValue(QStringLiteral("SolutionDir"),
+                      QFileInfo(filename).dir().absolutePath());
+
+    ccl::SolutionSet solutions;
+    ccl::FileStream fs;
+    if (!fs.open(filename, ccl::FileStream::Read)) {
+        QMessageBox::critical(this, tr("Error reading solutions"),
+                              tr("Could not open %1 for reading.").arg(filename));
+        return;
+    }
+    try {
+        solutions.read(&fs);
+    } catch (const ccl::RuntimeError& err) {
+        QMessageBox::critical(this, tr("Error reading solutions"), err.message());
+        return;
+    }
+
+    // Verify a snapshot of the levelset, so levels can be edited while the
+    // solutions are being replayed
+    auto levelset = std::make_shared<ccl::Levelset>(*m_levelset);
+    auto dlg = new ReportDialog(tr("Verify Solutions"), [levelset, solutions]() {
+        QElapsedTimer timer;
+        timer.start();
+        try {
+            auto results = ccl::VerifyLevelset(levelset.get(), solutions);
+            return QString::fromStdString(ccl::FormatVerifyReport(results,
+                                          timer.nsecsElapsed() / 1.0e6));
+        } catch (const ccl::RuntimeError& err) {
+            return err.message();
+        }
+    }, this);
+    dlg->setAttribute(Qt::WA_DeleteOnClose);
+    dlg->show();
+}
+
+void CCEditMain::onFindPatternAction()
+{
+    EditorWidget* editor = currentEditor();
+    if (!m_levelset || !editor)
+        return;
+
+    const QRect region = editor->selection();
+    if (region.width() <= 0 || region.height() <= 0) {
+        QMessageBox::information(this, tr("Find Pattern"),
+                tr("Select the region of the map to search for first."));
+        return;
+    }
+
+    // Search a snapshot of the maps, so levels can be edited while the
+    // search is running
+    auto maps = std::make_shared<std::vector<ccl::LevelMap>>();
+    QStringList names;
+    for (int i = 0; i < m_levelset->levelCount(); ++i) {
+        const ccl::LevelData* level = m_levelset->level(i);
+        maps->push_back(level->map());
+        names << tr("%1 - %2").arg(i + 1).arg(ccl::fromLatin1(level->name()));
+    }
+    const std::vector<uint64_t> pattern = ccl::LevelCellCodes(editor->levelData()->map(),
+            region.x(), region.y(), region.width(), region.height());
+    const int patternWidth = region.width();
+    const int patternHeight = region.height();
+
+    if (!m_patternSearch) {
+        m_patternSearch = new PatternSearchDialog(this);
+        connect(m_patternSearch, &PatternSearchDialog::matchActivated, this,
+                [this](int index, const QRect& match) {
+            loadLevel(index);
+            EditorWidget* editor = currentEditor();
+            if (editor && editor->levelData() == m_levelset->level(index)) {
+                editor->selectRegion(match.x(), match.y(), match.width(), match.height());
+                editor->update();
+            }
+        });
+    }
+    m_patternSearch->startSearch(names, region.size(),
+                                 [maps, pattern, patternWidth, patternHeight](int index) {
+        const std::vector<uint64_t> cells = ccl::LevelCellCodes((*maps)[index], 0, 0,
+                                                                CCL_WIDTH, CCL_HEIGHT);
+        std::vector<QPoint> matches;
+        for (const ccl::Point& match : ccl::FindPattern2D(cells, CCL_WIDTH, CCL_HEIGHT,
+                                                          pattern, patternWidth, patternHeight))
+            matches.emplace_back(match.X, match.Y);
+        return matches;
+    });
+    m_patternSearch->show();
+    m_patternSearch->raise();
+}
+
+void CCEditMain::onReplaceTilesAction()
+{
+    if (!m_levelset)
+        return;
+
+    ReplaceTilesDialog dlg(this);
+    dlg.setLevelsetInfo(m_levelset);
+    dlg.setTiles(m_leftTile, m_rightTile);
+    if (dlg.exec() != QDialog::Accepted)
+        return;
+
+    const ccl::TileReplaceRule rule = dlg.rule();
+    const std::vector<int> levels = dlg.matchingLevels();
+    if (levels.empty())
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    auto undoCommand = new MultiLevelUndoCommand(tr("Replace Tiles"));
+    for (int level : levels)
+        undoCommand->addLevel(m_levelset->level(level));
+    ccl::RunParallel(levels.size(), 0, [this, &levels, &rule](unsigned int, size_t index) {
+        ccl::ReplaceTiles(m_levelset->level(levels[index]), rule);
+    });
+    undoCommand->captureLevels();
+    m_undoStack->push(undoCommand);
+    updateForUndoCommand(undoCommand);
+    QApplication::restoreOverrideCursor();
+}
+
 void CCEditMain::onViewButtonsToggled(bool view)
 {
     if (view) {
@@ -34,6 +34,7 @@ class QUndoStack;
 
 class EditorTabWidget;
 class LevelProperties;
+class PatternSearchDialog;
 
 class CCEditMain : public QMainWindow {
     Q_OBJECT
@@ -71,7 +72,8 @@ private:
         ActionPaste, ActionClear, ActionUndo, ActionRedo, ActionDrawPencil,
         ActionDrawLine, ActionDrawRect, ActionDrawFill, ActionDrawFlood,
         ActionPathMaker, ActionConnect, ActionAdvancedMech, ActionInspectTiles,
-        ActionToggleWalls, ActionCheckErrors,
+        ActionToggleWalls, ActionCheckErrors, ActionVerifySolutions,
+        ActionFindPattern, ActionReplaceTiles,
         ActionViewButtons, ActionViewMovers, ActionViewActivePlayer,
         ActionViewViewport, ActionViewMonsterPaths, ActionViewErrors,
         ActionZoom200, ActionZoom150,
@@ -101,6 +103,7 @@ private:
     EditorTabWidget* m_editorTabs;
     QListWidget* m_levelList;
     LevelProperties* m_levelProperties;
+    PatternSearchDialog* m_patternSearch;
     tile_t m_leftTile, m_rightTile;
 
     ccl::Levelset* m_levelset;
@@ -154,6 +157,9 @@ private slots:
     void onInspectTilesToggled(bool);
     void onToggleWallsAction();
     void onCheckErrorsAction();
+    void onVerifySolutionsAction();
+    void onFindPatternAction();
+    void onReplaceTilesAction();
     void onViewButtonsToggled(bool);
     void onViewMoversToggled(bool);
     void onViewActivePlayerToggled(bool);
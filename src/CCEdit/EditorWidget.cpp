@@ -19,8 +19,9 @@
 
 #include <QPaintEvent>
 #include <QMouseEvent>
-#include <queue>
 #include "libcc1/GameLogic.h"
+#include "libcc1/TilePlanes.h"
+#include "libcc1/FloodFill.h"
 #include "CommonWidgets/CCTools.h"
 
 static EditorWidget::DrawLayer select_layer(Qt::KeyboardModifiers keys)
@@ -107,48 +108,32 @@ static void plot_line(EditorWidget* self, QPoint from, QPoint to, tile_t drawTil
 static void plot_flood(EditorWidget* self, QPoint start, tile_t drawTile,
                        EditorWidget::DrawLayer layer)
 {
-    ccl::LevelMap& map = self->levelData()->map();
-    tile_t replace_bg = map.getBG(start.x(), start.y());
-    tile_t replace_fg = map.getFG(start.x(), start.y());
-
-    std::queue<QPoint> floodQueue;
-    floodQueue.push(start);
-    self->putTile(drawTile, start.x(), start.y(), layer);
+    const ccl::LevelMap& map = self->levelData()->map();
+    const tile_t replace_bg = map.getBG(start.x(), start.y());
+    const tile_t replace_fg = map.getFG(start.x(), start.y());
+
+    // Key each cell by both of its layers, and find the whole region
+    // before changing anything
+    uint64_t keys[CCL_WIDTH * CCL_HEIGHT];
+    for (int i = 0; i < CCL_WIDTH * CCL_HEIGHT; ++i)
+        keys[i] = ((uint64_t)map.fgTiles()[i] << 8) | map.bgTiles()[i];
+    const std::vector<ccl::FillSpan> region = ccl::ScanlineFill(
+            keys, CCL_WIDTH, CCL_HEIGHT, start.x(), start.y());
+
+    self->placeTile(drawTile, start.x(), start.y(), layer);
     if (map.getBG(start.x(), start.y()) == replace_bg
             && map.getFG(start.x(), start.y()) == replace_fg) {
-        // No change was made.  Exit to avoid an infinite loop
+        // No change was made, so nothing else in the region would change
         return;
     }
 
-    while (!floodQueue.empty()) {
-        QPoint pt = floodQueue.front();
-        floodQueue.pop();
-
-        if (pt.x() > 0 && map.getBG(pt.x() - 1, pt.y()) == replace_bg
-                && map.getFG(pt.x() - 1, pt.y()) == replace_fg) {
-            QPoint next(pt.x() - 1, pt.y());
-            self->putTile(drawTile, next.x(), next.y(), layer);
-            floodQueue.push(next);
-        }
-        if (pt.x() < 31 && map.getBG(pt.x() + 1, pt.y()) == replace_bg
-                && map.getFG(pt.x() + 1, pt.y()) == replace_fg) {
-            QPoint next(pt.x() + 1, pt.y());
-            self->putTile(drawTile, next.x(), next.y(), layer);
-            floodQueue.push(next);
-        }
-        if (pt.y() > 0 && map.getBG(pt.x(), pt.y() - 1) == replace_bg
-                && map.getFG(pt.x(), pt.y() - 1) == replace_fg) {
-            QPoint next(pt.x(), pt.y() - 1);
-            self->putTile(drawTile, next.x(), next.y(), layer);
-            floodQueue.push(next);
-        }
-        if (pt.y() < 31 && map.getBG(pt.x(), pt.y() + 1) == replace_bg
-                && map.getFG(pt.x(), pt.y() + 1) == replace_fg) {
-            QPoint next(pt.x(), pt.y() + 1);
-            self->putTile(drawTile, next.x(), next.y(), layer);
-            floodQueue.push(next);
+    for (const ccl::FillSpan& span : region) {
+        for (int x = span.left; x <= span.right; ++x) {
+            if (x != start.x() || span.y != start.y())
+                self->placeTile(drawTile, x, span.y, layer);
         }
     }
+    self->dirtyBuffer();
 }
 
 enum ConnType { ConnNone, ConnTrap, ConnTrapRev, ConnClone, ConnCloneRev };
@@ -279,8 +264,11 @@ void EditorWidget::setTileset(CCETileset* tileset)
 void EditorWidget::setLevelData(ccl::LevelData* level)
 {
     level->ref();
-    if (m_levelData)
+    level->map().refTileIndex();
+    if (m_levelData) {
+        m_levelData->map().unrefTileIndex();
         m_levelData->unref();
+    }
     m_levelData = level;
 
     m_origin = QPoint(-1, -1);
@@ -311,19 +299,15 @@ void EditorWidget::renderTileBuffer()
     }
 
     if ((m_paintFlags & ShowErrors) != 0) {
-        for (int y = 0; y < 32; ++y) {
-            for (int x = 0; x < 32; ++x) {
-                if (m_levelData->map().getBG(x, y) != ccl::TileFloor
-                    && !(m_levelData->map().getFG(x, y) >= ccl::TileBlock_N
-                         && m_levelData->map().getFG(x, y) <= ccl::TileBlock_E)
-                    && m_levelData->map().getFG(x, y) != ccl::TileBlock
-                    && m_levelData->map().getFG(x, y) != ccl::TileIceBlock
-                    && !(m_levelData->map().getFG(x, y) >= ccl::TilePlayer_N
-                        && m_levelData->map().getFG(x, y) <= ccl::TilePlayer_E)
-                    && !MONSTER_TILE(m_levelData->map().getFG(x, y)))
-                    tilePainter.drawPixmap(x * m_tileset->size(), y * m_tileset->size(), m_errmk);
-            }
-        }
+        // Flag anything buried under a tile other than a mobile object
+        const ccl::TilePlanes planes(m_levelData->map());
+        const ccl::TileBitmap mobile = planes.upper(ccl::TilePlanes::ClassBlock)
+                                     | planes.upper(ccl::TilePlanes::ClassPlayer)
+                                     | planes.upper(ccl::TilePlanes::ClassMonster);
+        const ccl::TileBitmap errors = ~(planes.lower(ccl::TilePlanes::ClassFloor) | mobile);
+        errors.forEach([&](int x, int y) {
+            tilePainter.drawPixmap(x * m_tileset->size(), y * m_tileset->size(), m_errmk);
+        });
     }
 }
 
@@ -609,42 +593,19 @@ void EditorWidget::mouseMoveEvent(QMouseEvent* event)
     QString tipText;
 
     m_hilights.clear();
-    for (const auto& trap_iter : m_levelData->traps()) {
-        if (trap_iter.button.X == posX && trap_iter.button.Y == posY) {
-            if (isValidPoint(trap_iter.trap))
-                m_hilights << QPoint(trap_iter.trap.X, trap_iter.trap.Y);
-            if (!tipText.isEmpty())
-                tipText += QLatin1Char('\n');
-            tipText += tr("Trap: (%1, %2)")
-                       .arg(trap_iter.trap.X).arg(trap_iter.trap.Y);
-        }
-        if (trap_iter.trap.X == posX && trap_iter.trap.Y == posY) {
-            if (isValidPoint(trap_iter.button))
-                m_hilights << QPoint(trap_iter.button.X, trap_iter.button.Y);
+    auto addLinks = [this, &tipText](const ccl::PointSpan& links, const QString& label) {
+        for (const ccl::Point& link : links) {
+            if (isValidPoint(link))
+                m_hilights << QPoint(link.X, link.Y);
             if (!tipText.isEmpty())
                 tipText += QLatin1Char('\n');
-            tipText += tr("Button: (%1, %2)")
-                       .arg(trap_iter.button.X).arg(trap_iter.button.Y);
+            tipText += label.arg(link.X).arg(link.Y);
         }
-    }
-    for (const auto& clone_iter : m_levelData->clones()) {
-        if (clone_iter.button.X == posX && clone_iter.button.Y == posY) {
-            if (isValidPoint(clone_iter.clone))
-                m_hilights << QPoint(clone_iter.clone.X, clone_iter.clone.Y);
-            if (!tipText.isEmpty())
-                tipText += QLatin1Char('\n');
-            tipText += tr("Cloner: (%1, %2)")
-                       .arg(clone_iter.clone.X).arg(clone_iter.clone.Y);
-        }
-        if (clone_iter.clone.X == posX && clone_iter.clone.Y == posY) {
-            if (isValidPoint(clone_iter.button))
-                m_hilights << QPoint(clone_iter.button.X, clone_iter.button.Y);
-            if (!tipText.isEmpty())
-                tipText += QLatin1Char('\n');
-            tipText += tr("Button: (%1, %2)")
-                       .arg(clone_iter.button.X).arg(clone_iter.button.Y);
-        }
-    }
+    };
+    addLinks(m_levelData->linkedTraps(posX, posY), tr("Trap: (%1, %2)"));
+    addLinks(m_levelData->linkedTrapButtons(posX, posY), tr("Button: (%1, %2)"));
+    addLinks(m_levelData->linkedCloners(posX, posY), tr("Cloner: (%1, %2)"));
+    addLinks(m_levelData->linkedCloneButtons(posX, posY), tr("Button: (%1, %2)"));
 
     if (tipText.isEmpty() && (m_levelData->map().getFG(posX, posY) == ccl::TileTrap
         || m_levelData->map().getFG(posX, posY) == ccl::TileTrapButton
@@ -658,20 +619,13 @@ void EditorWidget::mouseMoveEvent(QMouseEvent* event)
 
     if (m_levelData->map().getFG(posX, posY) == ccl::TileTeleport
         || m_levelData->map().getBG(posX, posY) == ccl::TileTeleport) {
-        // Scan for next teleport
-        do {
-            if (--posX < 0) {
-                posX = 31;
-                if (--posY < 0)
-                    posY = 31;
-            }
-        } while (m_levelData->map().getFG(posX, posY) != ccl::TileTeleport
-                 && m_levelData->map().getBG(posX, posY) != ccl::TileTeleport);
-        m_hilights << QPoint(posX, posY);
+        // Teleports search backwards in reading order
+        const ccl::Point target = m_levelData->map().findPrev(posX, posY, ccl::TileTeleport);
+        m_hilights << QPoint(target.X, target.Y);
 
         if (!tipText.isEmpty())
             tipText += QLatin1Char('\n');
-        tipText += tr("Teleport to: (%1, %2)").arg(posX).arg(posY);
+        tipText += tr("Teleport to: (%1, %2)").arg(target.X).arg(target.Y);
     }
 
     if (MONSTER_TILE(m_levelData->map().getFG(posX, posY))) {
@@ -733,27 +687,16 @@ void EditorWidget::mousePressEvent(QMouseEvent* event)
         if (m_cachedButton == Qt::RightButton) {
             bool madeChange = false;
             emit editingStarted();
-            std::list<ccl::Trap>::iterator trap_iter = m_levelData->traps().begin();
-            while (trap_iter != m_levelData->traps().end()) {
-                if ((trap_iter->button.X == posX && trap_iter->button.Y == posY)
-                    || (trap_iter->trap.X == posX && trap_iter->trap.Y == posY)) {
-                    trap_iter = m_levelData->traps().erase(trap_iter);
-                    madeChange = true;
-                } else {
-                    ++trap_iter;
-                }
-            }
-
-            std::list<ccl::Clone>::iterator clone_iter = m_levelData->clones().begin();
-            while (clone_iter != m_levelData->clones().end()) {
-                if ((clone_iter->button.X == posX && clone_iter->button.Y == posY)
-                    || (clone_iter->clone.X == posX && clone_iter->clone.Y == posY)) {
-                    clone_iter = m_levelData->clones().erase(clone_iter);
-                    madeChange = true;
-                } else {
-                    ++clone_iter;
-                }
-            }
+            if (m_levelData->removeTraps([posX, posY](const ccl::Trap& trap) {
+                    return (trap.button.X == posX && trap.button.Y == posY)
+                        || (trap.trap.X == posX && trap.trap.Y == posY);
+                }))
+                madeChange = true;
+            if (m_levelData->removeClones([posX, posY](const ccl::Clone& clone) {
+                    return (clone.button.X == posX && clone.button.Y == posY)
+                        || (clone.clone.X == posX && clone.clone.Y == posY);
+                }))
+                madeChange = true;
             if (madeChange)
                 emit editingFinished();
             else
@@ -863,6 +806,12 @@ void EditorWidget::setDrawMode(DrawMode mode)
 }
 
 void EditorWidget::putTile(tile_t tile, int x, int y, DrawLayer layer)
+{
+    placeTile(tile, x, y, layer);
+    dirtyBuffer();
+}
+
+void EditorWidget::placeTile(tile_t tile, int x, int y, DrawLayer layer)
 {
     const tile_t oldUpper = m_levelData->map().getFG(x, y);
     const tile_t oldLower = m_levelData->map().getBG(x, y);
@@ -956,13 +905,9 @@ void EditorWidget::putTile(tile_t tile, int x, int y, DrawLayer layer)
     // Clear or add monsters from replaced tiles into move list
     if ((MONSTER_TILE(oldUpper) && (m_levelData->map().getBG(x, y) == ccl::TileCloner))
         || !MONSTER_TILE(m_levelData->map().getFG(x, y))) {
-        std::list<ccl::Point>::iterator move_iter = m_levelData->moveList().begin();
-        while (move_iter != m_levelData->moveList().end()) {
-            if (move_iter->X == x && move_iter->Y == y)
-                move_iter = m_levelData->moveList().erase(move_iter);
-            else
-                ++move_iter;
-        }
+        m_levelData->removeMovers([x, y](const ccl::Point& mover) {
+            return mover.X == x && mover.Y == y;
+        });
     } else if (MONSTER_TILE(m_levelData->map().getFG(x, y)) && !MONSTER_TILE(oldUpper)
                && m_levelData->map().getBG(x, y) != ccl::TileCloner) {
         if (m_levelData->moveList().size() < MAX_MOVERS)
@@ -974,35 +919,26 @@ void EditorWidget::putTile(tile_t tile, int x, int y, DrawLayer layer)
     }
 
     // Clear connections from replaced tiles
-    std::list<ccl::Trap>::iterator trap_iter = m_levelData->traps().begin();
-    while (trap_iter != m_levelData->traps().end()) {
-        if (trap_iter->button.X == x && trap_iter->button.Y == y
-                && m_levelData->map().getFG(x, y) != ccl::TileTrapButton
-                && m_levelData->map().getBG(x, y) != ccl::TileTrapButton)
-            trap_iter = m_levelData->traps().erase(trap_iter);
-        else if (trap_iter->trap.X == x && trap_iter->trap.Y == y
-                && m_levelData->map().getFG(x, y) != ccl::TileTrap
-                && m_levelData->map().getBG(x, y) != ccl::TileTrap)
-            trap_iter = m_levelData->traps().erase(trap_iter);
-        else
-            ++trap_iter;
-    }
-
-    std::list<ccl::Clone>::iterator clone_iter = m_levelData->clones().begin();
-    while (clone_iter != m_levelData->clones().end()) {
-        if (clone_iter->button.X == x && clone_iter->button.Y == y
-                && m_levelData->map().getFG(x, y) != ccl::TileCloneButton
-                && m_levelData->map().getBG(x, y) != ccl::TileCloneButton)
-            clone_iter = m_levelData->clones().erase(clone_iter);
-        else if (clone_iter->clone.X == x && clone_iter->clone.Y == y
-                && m_levelData->map().getFG(x, y) != ccl::TileCloner
-                && m_levelData->map().getBG(x, y) != ccl::TileCloner)
-            clone_iter = m_levelData->clones().erase(clone_iter);
-        else
-            ++clone_iter;
-    }
-
-    dirtyBuffer();
+    const ccl::LevelMap& map = m_levelData->map();
+    m_levelData->removeTraps([x, y, &map](const ccl::Trap& trap) {
+        if (trap.button.X == x && trap.button.Y == y
+                && map.getFG(x, y) != ccl::TileTrapButton
+                && map.getBG(x, y) != ccl::TileTrapButton)
+            return true;
+        return trap.trap.X == x && trap.trap.Y == y
+                && map.getFG(x, y) != ccl::TileTrap
+                && map.getBG(x, y) != ccl::TileTrap;
+    });
+
+    m_levelData->removeClones([x, y, &map](const ccl::Clone& clone) {
+        if (clone.button.X == x && clone.button.Y == y
+                && map.getFG(x, y) != ccl::TileCloneButton
+                && map.getBG(x, y) != ccl::TileCloneButton)
+            return true;
+        return clone.clone.X == x && clone.clone.Y == y
+                && map.getFG(x, y) != ccl::TileCloner
+                && map.getBG(x, y) != ccl::TileCloner;
+    });
 }
 
 void EditorWidget::setZoom(double factor)
@@ -51,8 +51,10 @@ public:
     EditorWidget(QWidget* parent = nullptr);
     ~EditorWidget() override
     {
-        if (m_levelData)
+        if (m_levelData) {
+            m_levelData->map().unrefTileIndex();
             m_levelData->unref();
+        }
         m_levelEditCache->unref();
     }
 
@@ -112,6 +114,10 @@ public:
     QImage renderReport();
     QImage renderSelection();
 
+    // Like putTile, but leaves refreshing the view to the caller so a
+    // batch of edits only needs one dirtyBuffer() call
+    void placeTile(tile_t tile, int x, int y, DrawLayer layer);
+
 public slots:
     void putTile(tile_t tile, int x, int y, DrawLayer layer);
     void setZoom(double factor);
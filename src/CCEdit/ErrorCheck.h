@@ -45,7 +45,6 @@ private:
     QTreeWidget* m_errors;
 
     void reportError(int level, const QString& text);
-    void checkLevel(int level);
 };
 
 #endif
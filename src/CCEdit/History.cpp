@@ -43,12 +43,7 @@ bool EditorUndoCommand::mergeWith(const QUndoCommand* command)
     Q_ASSERT(editorCmd);
     m_after->copyFrom(editorCmd->m_after);
 
-    // Don't bother comparing map edits, since those are never merged
-    if (m_before->name() == m_after->name()
-            && m_before->password() == m_after->password()
-            && m_before->chips() == m_after->chips()
-            && m_before->timer() == m_after->chips()
-            && m_before->hint() == m_after->hint())
+    if (m_before->contentHash() == m_after->contentHash())
         setObsolete(true);
 
     return true;
@@ -61,6 +56,10 @@ bool EditorUndoCommand::leave(ccl::LevelData* after)
         if (after) {
             m_after = new ccl::LevelData;
             m_after->copyFrom(after);
+
+            // Edits that didn't change anything don't need an undo step
+            if (m_before->contentHash() == m_after->contentHash())
+                setObsolete(true);
         }
         return true;
     }
@@ -78,6 +77,54 @@ void EditorUndoCommand::redo()
 }
 
 
+MultiLevelUndoCommand::MultiLevelUndoCommand(const QString& text)
+    : QUndoCommand(text)
+{ }
+
+MultiLevelUndoCommand::~MultiLevelUndoCommand()
+{
+    for (ccl::LevelData* level : m_levels)
+        level->unref();
+    for (ccl::LevelData* level : m_before)
+        level->unref();
+    for (ccl::LevelData* level : m_after)
+        level->unref();
+}
+
+void MultiLevelUndoCommand::addLevel(ccl::LevelData* level)
+{
+    Q_ASSERT(m_after.empty());
+    level->ref();
+    m_levels.push_back(level);
+
+    auto before = new ccl::LevelData;
+    before->copyFrom(level);
+    m_before.push_back(before);
+}
+
+void MultiLevelUndoCommand::captureLevels()
+{
+    Q_ASSERT(m_after.empty());
+    for (ccl::LevelData* level : m_levels) {
+        auto after = new ccl::LevelData;
+        after->copyFrom(level);
+        m_after.push_back(after);
+    }
+}
+
+void MultiLevelUndoCommand::undo()
+{
+    for (size_t i = 0; i < m_levels.size(); ++i)
+        m_levels[i]->copyFrom(m_before[i]);
+}
+
+void MultiLevelUndoCommand::redo()
+{
+    for (size_t i = 0; i < m_levels.size(); ++i)
+        m_levels[i]->copyFrom(m_after[i]);
+}
+
+
 LevelsetUndoCommand::LevelsetUndoCommand(ccl::Levelset* levelset)
     : m_levelset(levelset)
 {
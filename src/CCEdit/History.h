@@ -74,6 +74,27 @@ private:
     std::vector<ccl::LevelData*> m_after;
 };
 
+// Map edits made to several levels at once, undone as a single step
+class MultiLevelUndoCommand : public QUndoCommand {
+public:
+    explicit MultiLevelUndoCommand(const QString& text);
+    ~MultiLevelUndoCommand() override;
+
+    // Call before editing each level, then captureLevels() afterwards
+    void addLevel(ccl::LevelData* level);
+    void captureLevels();
+
+    const std::vector<ccl::LevelData*>& levels() const { return m_levels; }
+
+    void undo() override;
+    void redo() override;
+
+private:
+    std::vector<ccl::LevelData*> m_levels;
+    std::vector<ccl::LevelData*> m_before;
+    std::vector<ccl::LevelData*> m_after;
+};
+
 class LevelsetPropsUndoCommand : public QUndoCommand {
 public:
     LevelsetPropsUndoCommand(int levelsetType, ccl::DacFile* dacFile, bool useDacFile);
@@ -129,14 +129,5 @@ void LevelProperties::updateLevelProperties(ccl::LevelData* level)
 
 void LevelProperties::countChips(const ccl::LevelMap& map)
 {
-    int chips = 0;
-    for (int x = 0; x < 32; ++x) {
-        for (int y = 0; y < 32; ++y) {
-            if (map.getFG(x, y) == ccl::TileChip)
-                ++chips;
-            if (map.getBG(x, y) == ccl::TileChip)
-                ++chips;
-        }
-    }
-    m_chipEdit->setValue(chips);
+    m_chipEdit->setValue(map.count(ccl::TileChip));
 }
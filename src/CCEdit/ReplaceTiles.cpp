@@ -0,0 +1,183 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include "ReplaceTiles.h"
+#include "libcc1/Tileset.h"
+#include "CommonWidgets/CCTools.h"
+
+#include <QComboBox>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QGridLayout>
+#include <QSettings>
+
+ReplaceTilesDialog::ReplaceTilesDialog(QWidget* parent)
+    : QDialog(parent), m_levelset()
+{
+    setWindowTitle(tr("Replace Tiles"));
+    QSettings settings;
+
+    m_findTile = new QComboBox(this);
+    m_replaceTile = new QComboBox(this);
+    for (int i = 0; i < ccl::NUM_TILE_TYPES; ++i) {
+        m_findTile->addItem(CCETileset::TileName((tile_t)i), i);
+        m_replaceTile->addItem(CCETileset::TileName((tile_t)i), i);
+    }
+
+    m_layers = new QComboBox(this);
+    m_layers->addItem(tr("Upper and lower layers"), (int)ccl::TileReplaceRule::LayerBoth);
+    m_layers->addItem(tr("Upper layer only"), (int)ccl::TileReplaceRule::LayerUpper);
+    m_layers->addItem(tr("Lower layer only"), (int)ccl::TileReplaceRule::LayerLower);
+    m_layers->setCurrentIndex(settings.value(QStringLiteral("ReplaceTilesLayers"), 0).toInt());
+    m_target = new QComboBox(this);
+
+    m_preview = new QTreeWidget(this);
+    m_preview->setRootIsDecorated(false);
+    m_preview->setHeaderLabels(QStringList() << tr("Level") << tr("Matches"));
+    m_preview->header()->setStretchLastSection(false);
+    m_preview->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_summary = new QLabel(this);
+
+    QWidget* buttonAlign = new QWidget(this);
+    QPushButton* btnClose = new QPushButton(tr("Clo&se"), buttonAlign);
+    m_replaceButton = new QPushButton(tr("&Replace"), buttonAlign);
+    QGridLayout* layButtons = new QGridLayout(buttonAlign);
+    layButtons->setContentsMargins(0, 0, 0, 0);
+    layButtons->setHorizontalSpacing(8);
+    layButtons->addItem(new QSpacerItem(0, 0, QSizePolicy::MinimumExpanding, QSizePolicy::Minimum), 0, 0);
+    layButtons->addWidget(btnClose, 0, 1);
+    layButtons->addWidget(m_replaceButton, 0, 2);
+    m_replaceButton->setDefault(true);
+
+    QLabel* findLabel = new QLabel(tr("&Find:"), this);
+    findLabel->setBuddy(m_findTile);
+    QLabel* replaceLabel = new QLabel(tr("Replace &with:"), this);
+    replaceLabel->setBuddy(m_replaceTile);
+    QLabel* layersLabel = new QLabel(tr("L&ayers:"), this);
+    layersLabel->setBuddy(m_layers);
+    QLabel* targetLabel = new QLabel(tr("&Look in:"), this);
+    targetLabel->setBuddy(m_target);
+
+    QGridLayout* layout = new QGridLayout(this);
+    layout->setContentsMargins(8, 8, 8, 8);
+    layout->setVerticalSpacing(8);
+    layout->addWidget(findLabel, 0, 0);
+    layout->addWidget(m_findTile, 0, 1);
+    layout->addWidget(replaceLabel, 1, 0);
+    layout->addWidget(m_replaceTile, 1, 1);
+    layout->addWidget(layersLabel, 2, 0);
+    layout->addWidget(m_layers, 2, 1);
+    layout->addWidget(targetLabel, 3, 0);
+    layout->addWidget(m_target, 3, 1);
+    layout->addWidget(m_preview, 4, 0, 1, 2);
+    layout->addWidget(m_summary, 5, 0, 1, 2);
+    layout->addWidget(buttonAlign, 6, 0, 1, 2);
+
+    connect(btnClose, &QPushButton::clicked, this, &QDialog::reject);
+    connect(m_replaceButton, &QPushButton::clicked, this, &QDialog::accept);
+    for (QComboBox* combo : { m_findTile, m_replaceTile, m_layers, m_target }) {
+        connect(combo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                this, &ReplaceTilesDialog::updatePreview);
+    }
+}
+
+ReplaceTilesDialog::~ReplaceTilesDialog()
+{
+    QSettings settings;
+    settings.setValue(QStringLiteral("ReplaceTilesLayers"), m_layers->currentIndex());
+}
+
+void ReplaceTilesDialog::setLevelsetInfo(ccl::Levelset* levelset)
+{
+    m_levelset = levelset;
+
+    m_target->blockSignals(true);
+    m_target->clear();
+    m_target->addItem(tr("(Entire levelset)"));
+    for (int i = 0; i < m_levelset->levelCount(); ++i) {
+        m_target->addItem(QStringLiteral("%1 - %2").arg(i + 1)
+                          .arg(ccl::fromLatin1(m_levelset->level(i)->name())));
+    }
+    m_target->blockSignals(false);
+    updatePreview();
+}
+
+void ReplaceTilesDialog::setTiles(tile_t find, tile_t replace)
+{
+    m_findTile->blockSignals(true);
+    m_replaceTile->blockSignals(true);
+    if (find < ccl::NUM_TILE_TYPES)
+        m_findTile->setCurrentIndex(find);
+    if (replace < ccl::NUM_TILE_TYPES)
+        m_replaceTile->setCurrentIndex(replace);
+    m_findTile->blockSignals(false);
+    m_replaceTile->blockSignals(false);
+    updatePreview();
+}
+
+ccl::TileReplaceRule ReplaceTilesDialog::rule() const
+{
+    return ccl::TileReplaceRule((tile_t)m_findTile->currentData().toInt(),
+                                (tile_t)m_replaceTile->currentData().toInt(),
+                                m_layers->currentData().toInt());
+}
+
+std::vector<int> ReplaceTilesDialog::matchingLevels() const
+{
+    std::vector<int> levels;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+        if (m_counts[i] > 0)
+            levels.push_back((int)i);
+    }
+    return levels;
+}
+
+void ReplaceTilesDialog::updatePreview()
+{
+    m_preview->clear();
+    m_counts.clear();
+    if (!m_levelset)
+        return;
+
+    const ccl::TileReplaceRule replaceRule = rule();
+    if (m_target->currentIndex() == 0) {
+        m_counts = ccl::CountTileMatches(m_levelset, replaceRule);
+    } else {
+        const int level = m_target->currentIndex() - 1;
+        m_counts.assign(m_levelset->levelCount(), 0);
+        m_counts[level] = ccl::CountTileMatches(m_levelset->level(level)->map(), replaceRule);
+    }
+
+    int total = 0, levels = 0;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+        if (m_counts[i] == 0)
+            continue;
+        auto item = new QTreeWidgetItem(m_preview);
+        item->setText(0, QStringLiteral("%1 - %2").arg(i + 1)
+                         .arg(ccl::fromLatin1(m_levelset->level((int)i)->name())));
+        item->setText(1, QString::number(m_counts[i]));
+        item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+        total += m_counts[i];
+        ++levels;
+    }
+
+    m_summary->setText(tr("%1 tile(s) in %2 level(s) will be replaced")
+                       .arg(total).arg(levels));
+    m_replaceButton->setEnabled(total > 0 && replaceRule.find != replaceRule.replace);
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#ifndef _REPLACETILES_H
+#define _REPLACETILES_H
+
+#include <QDialog>
+#include <vector>
+#include "libcc1/TileReplace.h"
+
+class QComboBox;
+class QTreeWidget;
+class QLabel;
+class QPushButton;
+
+class ReplaceTilesDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit ReplaceTilesDialog(QWidget* parent = nullptr);
+    ~ReplaceTilesDialog() override;
+
+    void setLevelsetInfo(ccl::Levelset* levelset);
+    void setTiles(tile_t find, tile_t replace);
+
+    ccl::TileReplaceRule rule() const;
+
+    // Levels with at least one match, as of the last preview
+    std::vector<int> matchingLevels() const;
+
+private slots:
+    void updatePreview();
+
+private:
+    ccl::Levelset* m_levelset;
+    std::vector<int> m_counts;
+
+    QComboBox* m_findTile;
+    QComboBox* m_replaceTile;
+    QComboBox* m_layers;
+    QComboBox* m_target;
+    QTreeWidget* m_preview;
+    QLabel* m_summary;
+    QPushButton* m_replaceButton;
+};
+
+#endif
@@ -0,0 +1,1194 @@
+/******************************************************************************
+ * This file is part of CCTools.                                              *
+ *                                                                            *
+ * CCTools is free software: you can redistribute it and/or modify            *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * CCTools is distributed in the hope that it will be useful,                 *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with CCTools.  If not, see <http://www.gnu.org/licenses/>.           *
+ ******************************************************************************/
+
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QImage>
+#include <QPainter>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+#include "libcc1/Levelset.h"
+#include "libcc1/DacFile.h"
+#include "libcc1/Verifier.h"
+#include "libcc1/Parallel.h"
+#include "libcc1/Solver.h"
+#include "libcc1/Fingerprint.h"
+#include "libcc1/LevelCheck.h"
+#include "libcc2/Verifier.h"
+#include "libcc2/Fingerprint.h"
+#include "libcc2/TileIndex.h"
+#include "libcc2/LevelsetImport.h"
+#include "libcc1/Tileset.h"
+#include "libcc2/Tileset.h"
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr, "Usage: %s <command> [options] <files...>\n\n", argv0);
+    fputs("Commands:\n"
+          "  verify [-j N] LEVELSET SOLUTIONS.tws\n"
+          "      Replay a Tile World solution file against every level in a CC1\n"
+          "      levelset (.dat, .ccl or .dac)\n"
+          "  verify [-j N] GAME.c2g\n"
+          "      Play back the replay stored in every map of a CC2 game.  The CC2\n"
+          "      simulation is experimental: maps using wires, tracks and some\n"
+          "      other tiles are skipped, and the report counts them\n"
+          "  solve [-j N] [-m MB] [-t SECONDS] [--lynx] LEVELSET\n"
+          "      Search for a solution to every level of a CC1 levelset, and\n"
+          "      report the time each solution takes.  The memory budget is\n"
+          "      shared by all worker threads, and the time budget is per level.\n"
+          "      --lynx forces the Lynx ruleset for MSCC levelsets.\n"
+          "  dupes [-j N] [-s SIMILARITY] [--exact] FILES|DIRECTORIES...\n"
+          "      Find duplicate and near-duplicate levels across a collection of\n"
+          "      CC1 levelsets and CC2 maps.  Directories are searched recursively\n"
+          "      for .dat, .ccl, .dac and .c2m files; .c2g games are only read\n"
+          "      when named explicitly.  SIMILARITY is the minimum estimated\n"
+          "      similarity for near duplicates, from 0 to 1 (default 0.8).\n"
+          "      --exact only reports levels with identical gameplay content.\n"
+          "  index [-j N] -o INDEX FILES|DIRECTORIES...\n"
+          "      Create or update a tile index of CC1 levelsets and CC2 maps, found\n"
+          "      as for dupes.  Only new or modified files are read again.\n"
+          "  find INDEX TERMS...\n"
+          "      List the levels in a tile index which contain all of the terms.\n"
+          "      A term is a tile name (case and spaces are ignored) or number,\n"
+          "      UPPER/LOWER for a tile directly on top of another, or\n"
+          "      TILE=MODIFIER for a CC2 tile with a specific modifier value.\n"
+          "      Prefix a term with cc1: or cc2: to only match one format.\n"
+          "  convert [-j N] [-f dat|ccl|dac] [-r RULESET] -o DIR LEVELSETS|DIRECTORIES...\n"
+          "      Rewrite CC1 levelsets (.dat, .ccl or .dac) into DIR.  .dat and .ccl\n"
+          "      share one format; dac writes a Tile World .dac descriptor with its\n"
+          "      .dat file.  The default keeps each file's own format.  RULESET\n"
+          "      (ms, lynx, pg or lynxpg) changes the levelset's ruleset.\n"
+          "  import [-j N] [--resize] -o DIR LEVELSETS|DIRECTORIES...\n"
+          "      Convert every level of CC1 levelsets into CC2 maps, saved in DIR\n"
+          "      as NAME-NNN.c2m along with a NAME.c2g game script that plays them\n"
+          "      in order.  Features lost in the conversion are reported.  --resize\n"
+          "      shrinks each map to the used area.\n"
+          "  check [-j N] [-m MODE] LEVELSETS|DIRECTORIES...\n"
+          "      Run CCEdit's error checks on CC1 levelsets.  MODE is mscc-strict,\n"
+          "      mscc (default), lynx or lynx-pedantic.  Exits with 1 if any\n"
+          "      problems were found.\n"
+          "  info [-j N] FILES|DIRECTORIES...\n"
+          "      Print the metadata of CC1 levelsets and CC2 maps as JSON.\n"
+          "  repack [-j N] [-o DIR] MAPS|DIRECTORIES...\n"
+          "      Read and rewrite CC2 maps (.c2m), in place or into DIR.\n"
+          "  render [--cc1-tileset FILE] [--cc2-tileset FILE] -o DIR FILES|DIRECTORIES...\n"
+          "      Save a PNG image of every CC1 level and CC2 map into DIR.  The\n"
+          "      tileset for each format is only needed if that format is rendered.\n"
+          "      Rendering uses a single thread.\n\n"
+          "Options:\n"
+          "  -j N    Number of worker threads (default: one per CPU core)\n"
+          "  -o DIR  Output directory.  Files found in a DIRECTORY argument keep\n"
+          "          their path below it inside DIR.  Inputs which would write\n"
+          "          the same output are refused.\n",
+          stderr);
+}
+
+// The map list of a script whose control flow was cut short may be missing maps
+static void print_script_warnings(const QString& filename, bool complete,
+                                  const std::vector<std::string>& missingChains)
+{
+    if (!complete) {
+        fprintf(stderr, "Warning: %s: the script's control flow is too large to follow "
+                        "completely, so some maps may be missing\n",
+                filename.toLocal8Bit().constData());
+    }
+    for (const std::string& chain : missingChains) {
+        fprintf(stderr, "Warning: %s: could not read chained script %s, so its maps "
+                        "are missing\n",
+                filename.toLocal8Bit().constData(),
+                QString::fromStdString(chain).toLocal8Bit().constData());
+    }
+}
+
+/* The options a command accepts.  parse() splits the command line into
+ * those options and the positional arguments.  It fails on an option the
+ * command doesn't take or a missing value, so the command can show usage()
+ * instead of treating a mistyped option as a file name.
+ */
+class CommandOptions {
+public:
+    CommandOptions() : m_threads() { }
+
+    // An option with a value, e.g. "-o DIR"
+    void value(const char* name, QString* value) { m_values.emplace_back(name, value); }
+
+    // An option without a value, e.g. "--lynx"
+    void flag(const char* name, bool* set) { m_flags.emplace_back(name, set); }
+
+    // The worker thread count, as "-j N" or "-jN"
+    void threads(unsigned int* threads) { m_threads = threads; }
+
+    bool parse(const QStringList& args, QStringList& positional) const;
+
+private:
+    std::vector<std::pair<const char*, QString*>> m_values;
+    std::vector<std::pair<const char*, bool*>> m_flags;
+    unsigned int* m_threads;
+};
+
+bool CommandOptions::parse(const QStringList& args, QStringList& positional) const
+{
+    for (int i = 0; i < args.size(); ++i) {
+        const QString& arg = args[i];
+        if (!arg.startsWith(QLatin1String("-")) || arg.size() == 1) {
+            positional << arg;
+            continue;
+        }
+
+        if (m_threads && arg.startsWith(QLatin1String("-j"))) {
+            if (arg.size() == 2 && i + 1 >= args.size())
+                return false;
+            bool ok;
+            *m_threads = (arg.size() == 2 ? args[++i] : arg.mid(2)).toUInt(&ok);
+            if (!ok)
+                return false;
+            continue;
+        }
+
+        auto value = std::find_if(m_values.begin(), m_values.end(),
+                                  [&arg](const std::pair<const char*, QString*>& option) {
+            return arg == QLatin1String(option.first);
+        });
+        if (value != m_values.end()) {
+            if (i + 1 >= args.size())
+                return false;
+            *value->second = args[++i];
+            continue;
+        }
+
+        auto flag = std::find_if(m_flags.begin(), m_flags.end(),
+                                 [&arg](const std::pair<const char*, bool*>& option) {
+            return arg == QLatin1String(option.first);
+        });
+        if (flag == m_flags.end())
+            return false;
+        *flag->second = true;
+    }
+    return true;
+}
+
+static int cmd_verify(const QStringList& args)
+{
+    unsigned int threads = 0;
+    QStringList files;
+    CommandOptions options;
+    options.threads(&threads);
+    if (!options.parse(args, files))
+        return -1;
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<ccl::VerifyResult> results;
+    if (files.size() == 1 && files[0].endsWith(QLatin1String(".c2g"), Qt::CaseInsensitive)) {
+        bool complete = true;
+        std::vector<std::string> missingChains;
+        results = cc2::VerifyGame(files[0], threads, &complete, &missingChains);
+        print_script_warnings(files[0], complete, missingChains);
+    } else if (files.size() == 2) {
+        std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(files[0]));
+
+        ccl::FileStream stream;
+        if (!stream.open(files[1], ccl::FileStream::Read))
+            throw ccl::IOError(ccl::RuntimeError::tr("Could not open file for reading"));
+        ccl::SolutionSet solutions;
+        solutions.read(&stream);
+
+        results = ccl::VerifyLevelset(levelset.get(), solutions, threads);
+    } else {
+        return -1;
+    }
+
+    fputs(ccl::FormatVerifyReport(results, timer.nsecsElapsed() / 1.0e6).c_str(), stdout);
+    for (const auto& result : results) {
+        if (result.outcome == ccl::VerifyResult::Failed
+                || result.outcome == ccl::VerifyResult::Error)
+            return 1;
+    }
+    return 0;
+}
+
+static int cmd_solve(const QStringList& args)
+{
+    unsigned int threads = 0;
+    bool forceLynx = false;
+    QString memoryBudget, timeBudget;
+    QStringList files;
+    CommandOptions commandOptions;
+    commandOptions.threads(&threads);
+    commandOptions.value("-m", &memoryBudget);
+    commandOptions.value("-t", &timeBudget);
+    commandOptions.flag("--lynx", &forceLynx);
+    if (!commandOptions.parse(args, files) || files.size() != 1)
+        return -1;
+
+    ccl::SolverOptions options;
+    if (!memoryBudget.isEmpty())
+        options.memoryBudget = (size_t)memoryBudget.toUInt() * 1024 * 1024;
+    if (!timeBudget.isEmpty())
+        options.timeBudget = timeBudget.toDouble();
+
+    std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(files[0]));
+    const unsigned int rules = forceLynx ? (unsigned int)ccl::Levelset::TypeLynx
+                                         : levelset->type();
+    auto results = ccl::SolveLevelset(levelset.get(), rules, options, threads);
+
+    static const char* outcomeNames[] = {
+        "SOLVED", "NO SOLUTION", "OUT OF MEMORY", "OUT OF TIME", "UNSUPPORTED",
+    };
+    int solved = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ccl::SolverResult& result = results[i];
+        printf("%4d  %-13s %9zu states %10.2f ms  %s", (int)i + 1,
+               outcomeNames[result.outcome], result.statesExplored, result.elapsed,
+               levelset->level((int)i)->name().c_str());
+        if (result.outcome == ccl::SolverResult::Solved) {
+            ++solved;
+            printf(" (%zu moves, par %.2f s)", result.solution.moves.size(),
+                   (double)result.solution.ticks / ccl::Simulation::TicksPerSecond);
+        }
+        printf("\n");
+    }
+    printf("\n%d of %d levels solved\n", solved, (int)results.size());
+    return 0;
+}
+
+struct LevelSource {
+    QString filename;
+    int levelNum;       // 0 for standalone .c2m files
+};
+
+struct DupeLevel {
+    size_t source;
+    int levelNum;
+    std::string name;
+};
+
+static void collect_level_sources(const QString& path, std::vector<LevelSource>& sources)
+{
+    static const QStringList levelFilters {
+        QStringLiteral("*.dat"), QStringLiteral("*.ccl"), QStringLiteral("*.dac"),
+        QStringLiteral("*.c2m"),
+    };
+
+    QFileInfo info(path);
+    if (info.isDir()) {
+        QStringList found;
+        QDirIterator iter(path, levelFilters, QDir::Files, QDirIterator::Subdirectories);
+        while (iter.hasNext())
+            found << iter.next();
+        found.sort();
+        for (const QString& filename : found)
+            sources.push_back(LevelSource { filename, 0 });
+    } else if (path.endsWith(QLatin1String(".c2g"), Qt::CaseInsensitive)) {
+        cc2::GameScript script;
+        script.read(path);
+        bool complete = true;
+        std::vector<std::string> missingChains;
+        for (const cc2::ScriptMapEntry& entry : script.mapList(path, nullptr, &complete,
+                                                               &missingChains))
+            sources.push_back(LevelSource { QString::fromStdString(entry.filename), entry.levelNum });
+        print_script_warnings(path, complete, missingChains);
+    } else {
+        sources.push_back(LevelSource { path, 0 });
+    }
+}
+
+static int cmd_dupes(const QStringList& args)
+{
+    unsigned int threads = 0;
+    QString similarity;
+    bool exactOnly = false;
+    QStringList paths;
+    CommandOptions options;
+    options.threads(&threads);
+    options.value("-s", &similarity);
+    options.flag("--exact", &exactOnly);
+    if (!options.parse(args, paths))
+        return -1;
+
+    std::vector<LevelSource> sources;
+    for (const QString& path : paths)
+        collect_level_sources(path, sources);
+    if (sources.empty())
+        return -1;
+    double threshold = similarity.isEmpty() ? 0.8 : similarity.toDouble();
+    if (exactOnly)
+        threshold = 2.0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    /* Each worker loads one file at a time and keeps only the fingerprints,
+     * so memory use depends on the number of levels, not their size.
+     * CC1 and CC2 fingerprints are not comparable, so they are clustered
+     * separately. */
+    std::mutex lock;
+    std::vector<ccl::Fingerprint> prints[2];
+    std::vector<DupeLevel> levels[2];
+    ccl::RunParallel(sources.size(), threads, [&](unsigned int, size_t index) {
+        const LevelSource& source = sources[index];
+        std::vector<ccl::Fingerprint> filePrints;
+        std::vector<DupeLevel> fileLevels;
+        bool isMap = false;
+        try {
+            if (source.filename.endsWith(QLatin1String(".c2m"), Qt::CaseInsensitive)) {
+                isMap = true;
+                cc2::Map map;
+                ccl::FileStream stream;
+                if (!stream.open(source.filename, ccl::FileStream::Read))
+                    throw ccl::IOError(ccl::RuntimeError::tr("Could not open file for reading"));
+                map.read(&stream);
+                filePrints.push_back(cc2::FingerprintMap(&map));
+                fileLevels.push_back(DupeLevel { index, source.levelNum, map.title() });
+            } else {
+                std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(source.filename));
+                for (int i = 0; i < levelset->levelCount(); ++i) {
+                    const ccl::LevelData* level = levelset->level(i);
+                    filePrints.push_back(ccl::FingerprintLevel(level));
+                    fileLevels.push_back(DupeLevel { index, i + 1, level->name() });
+                }
+            }
+        } catch (const ccl::RuntimeError& err) {
+            std::lock_guard<std::mutex> guard(lock);
+            fprintf(stderr, "Warning: %s: %s\n", source.filename.toLocal8Bit().constData(),
+                    err.message().toLocal8Bit().constData());
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        prints[isMap].insert(prints[isMap].end(), filePrints.begin(), filePrints.end());
+        levels[isMap].insert(levels[isMap].end(), fileLevels.begin(), fileLevels.end());
+    });
+
+    int clusterCount = 0;
+    size_t duplicateCount = 0;
+    for (int kind = 0; kind < 2; ++kind) {
+        // Workers finish in any order; sort so the report is stable
+        std::vector<size_t> order(levels[kind].size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t left, size_t right) {
+            const DupeLevel& lhs = levels[kind][left];
+            const DupeLevel& rhs = levels[kind][right];
+            return std::tie(lhs.source, lhs.levelNum) < std::tie(rhs.source, rhs.levelNum);
+        });
+        std::vector<ccl::Fingerprint> sortedPrints;
+        std::vector<DupeLevel> sortedLevels;
+        sortedPrints.reserve(order.size());
+        sortedLevels.reserve(order.size());
+        for (size_t i : order) {
+            sortedPrints.push_back(prints[kind][i]);
+            sortedLevels.push_back(std::move(levels[kind][i]));
+        }
+        prints[kind] = std::vector<ccl::Fingerprint>();
+        levels[kind] = std::vector<DupeLevel>();
+
+        auto clusters = ccl::FindDuplicates(sortedPrints, threshold, threads);
+        for (const ccl::DuplicateCluster& cluster : clusters) {
+            if (cluster.exact)
+                printf("Cluster %d: %zu exact duplicates\n", ++clusterCount,
+                       cluster.members.size());
+            else
+                printf("Cluster %d: %zu similar levels (>= %.0f%% similar)\n",
+                       ++clusterCount, cluster.members.size(),
+                       cluster.minSimilarity * 100.0);
+            for (size_t member : cluster.members) {
+                const DupeLevel& level = sortedLevels[member];
+                const QString filename = sources[level.source].filename;
+                if (level.levelNum)
+                    printf("    %s #%d: %s\n", filename.toLocal8Bit().constData(),
+                           level.levelNum, level.name.c_str());
+                else
+                    printf("    %s: %s\n", filename.toLocal8Bit().constData(),
+                           level.name.c_str());
+            }
+            duplicateCount += cluster.members.size() - 1;
+        }
+    }
+
+    printf("\n%d clusters, %zu redundant levels, %zu files scanned in %.2f s\n",
+           clusterCount, duplicateCount, sources.size(), timer.elapsed() / 1000.0);
+    return 0;
+}
+
+static int cmd_index(const QStringList& args)
+{
+    unsigned int threads = 0;
+    QString indexFilename;
+    QStringList paths;
+    CommandOptions options;
+    options.threads(&threads);
+    options.value("-o", &indexFilename);
+    if (!options.parse(args, paths))
+        return -1;
+
+    std::vector<LevelSource> sources;
+    for (const QString& path : paths)
+        collect_level_sources(path, sources);
+    if (indexFilename.isEmpty() || sources.empty())
+        return -1;
+
+    QElapsedTimer timer;
+    timer.start();
+    cc2::TileIndex index;
+    if (QFileInfo(indexFilename).exists())
+        index.load(indexFilename);
+
+    QStringList files;
+    for (const LevelSource& source : sources)
+        files << source.filename;
+    const size_t scanned = index.update(files, threads);
+    index.save(indexFilename);
+
+    printf("%zu files (%zu read), %zu levels, %zu terms in %.2f s\n",
+           index.files().size(), scanned, index.documents().size(),
+           index.termCount(), timer.elapsed() / 1000.0);
+    return 0;
+}
+
+static QString normalize_tile_name(const QString& name)
+{
+    QString result;
+    for (QChar ch : name) {
+        if (ch.isLetterOrNumber())
+            result += ch.toLower();
+    }
+    return result;
+}
+
+static bool resolve_tile(const QString& name, bool cc2, int* type)
+{
+    bool isNumber;
+    *type = name.toInt(&isNumber, 0);
+    if (isNumber)
+        return *type >= 0 && *type < 256;
+
+    const QString key = normalize_tile_name(name);
+    const int count = cc2 ? (int)cc2::Tile::NUM_TILE_TYPES : (int)ccl::NUM_TILE_TYPES;
+    for (int i = 0; i < count; ++i) {
+        const QString tileName = cc2 ? CC2ETileset::baseName((cc2::Tile::Type)i)
+                                     : CCETileset::TileName((tile_t)i);
+        if (normalize_tile_name(tileName) == key) {
+            *type = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns false if the term cannot match any level of the given format
+static bool resolve_term(QString text, bool cc2, uint32_t* term)
+{
+    if (text.startsWith(QLatin1String("cc1:"), Qt::CaseInsensitive)) {
+        if (cc2)
+            return false;
+        text = text.mid(4);
+    } else if (text.startsWith(QLatin1String("cc2:"), Qt::CaseInsensitive)) {
+        if (!cc2)
+            return false;
+        text = text.mid(4);
+    }
+
+    int upper, lower;
+    const int pairSplit = text.indexOf(QLatin1Char('/'));
+    const int modSplit = text.indexOf(QLatin1Char('='));
+    if (pairSplit > 0) {
+        if (!resolve_tile(text.left(pairSplit), cc2, &upper)
+                || !resolve_tile(text.mid(pairSplit + 1), cc2, &lower))
+            return false;
+        *term = cc2 ? cc2::TileIndex::cc2Pair(upper, lower)
+                    : cc2::TileIndex::cc1Pair((tile_t)upper, (tile_t)lower);
+    } else if (modSplit > 0) {
+        bool isNumber;
+        const uint32_t modifier = text.mid(modSplit + 1).toUInt(&isNumber, 0);
+        if (!cc2 || !isNumber || !resolve_tile(text.left(modSplit), cc2, &upper))
+            return false;
+        *term = cc2::TileIndex::cc2Modifier(upper, modifier);
+    } else {
+        if (!resolve_tile(text, cc2, &upper))
+            return false;
+        *term = cc2 ? cc2::TileIndex::cc2Tile(upper)
+                    : cc2::TileIndex::cc1Tile((tile_t)upper);
+    }
+    return true;
+}
+
+static int cmd_find(const QStringList& args)
+{
+    if (args.size() < 2)
+        return -1;
+
+    cc2::TileIndex index;
+    index.load(args[0]);
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<uint32_t> matches;
+    for (bool cc2 : { false, true }) {
+        std::vector<uint32_t> terms;
+        for (int i = 1; i < args.size(); ++i) {
+            uint32_t term;
+            if (!resolve_term(args[i], cc2, &term)) {
+                terms.clear();
+                break;
+            }
+            terms.push_back(term);
+        }
+        auto docs = index.query(terms);
+        matches.insert(matches.end(), docs.begin(), docs.end());
+    }
+    std::sort(matches.begin(), matches.end());
+    const double queryTime = timer.nsecsElapsed() / 1.0e6;
+
+    for (uint32_t doc : matches) {
+        const cc2::TileIndex::Document& level = index.documents()[doc];
+        const QString& filename = index.files()[level.file].filename;
+        if (level.levelNum)
+            printf("%s #%d: %s\n", filename.toLocal8Bit().constData(),
+                   level.levelNum, level.name.c_str());
+        else
+            printf("%s: %s\n", filename.toLocal8Bit().constData(), level.name.c_str());
+    }
+    printf("\n%zu of %zu levels matched in %.3f ms\n", matches.size(),
+           index.documents().size(), queryTime);
+    return 0;
+}
+
+static const QStringList s_levelsetFilters {
+    QStringLiteral("*.dat"), QStringLiteral("*.ccl"), QStringLiteral("*.dac"),
+};
+
+static const QStringList s_mapFilters { QStringLiteral("*.c2m") };
+
+// Path of file below root without its suffix, for naming its outputs
+static QString output_name(const QDir& root, const QString& file)
+{
+    const QFileInfo info(root.relativeFilePath(file));
+    if (info.path() == QLatin1String("."))
+        return info.completeBaseName();
+    return info.path() + QLatin1Char('/') + info.completeBaseName();
+}
+
+/* Add path, or every matching file below it if it is a directory.  If
+ * outputNames is given, each file's output name is added to it as well.
+ */
+static void collect_files(const QString& path, const QStringList& filters,
+                          QStringList& files, QStringList* outputNames = nullptr)
+{
+    if (QFileInfo(path).isDir()) {
+        QStringList found;
+        QDirIterator iter(path, filters, QDir::Files, QDirIterator::Subdirectories);
+        while (iter.hasNext())
+            found << iter.next();
+        found.sort();
+        files << found;
+        if (outputNames) {
+            const QDir root(path);
+            for (const QString& file : found)
+                *outputNames << output_name(root, file);
+        }
+    } else {
+        files << path;
+        if (outputNames)
+            *outputNames << QFileInfo(path).completeBaseName();
+    }
+}
+
+/* Create outDir and the subdirectories the outputs need.  Returns false
+ * (after reporting it) if two inputs would write the same output.
+ */
+static bool prepare_outputs(const QString& outDir, const QStringList& files,
+                            const QStringList& outputNames)
+{
+    // Not every file system is case sensitive
+    QHash<QString, int> seen;
+    for (int i = 0; i < outputNames.size(); ++i) {
+        const QString key = outputNames[i].toLower();
+        const auto iter = seen.constFind(key);
+        if (iter != seen.constEnd()) {
+            fprintf(stderr, "Error: %s and %s would both be written as %s\n",
+                    files[iter.value()].toLocal8Bit().constData(),
+                    files[i].toLocal8Bit().constData(),
+                    outputNames[i].toLocal8Bit().constData());
+            return false;
+        }
+        seen.insert(key, i);
+    }
+
+    const QDir dir(outDir);
+    for (const QString& name : outputNames)
+        dir.mkpath(QFileInfo(name).path());
+    return true;
+}
+
+static bool is_map_file(const QString& filename)
+{
+    return filename.endsWith(QLatin1String(".c2m"), Qt::CaseInsensitive);
+}
+
+static QString output_path(const QString& outDir, const QString& outputName,
+                           const QString& suffix)
+{
+    return QDir(outDir).absoluteFilePath(outputName + suffix);
+}
+
+static QString level_suffix(int levelNum, const char* extension)
+{
+    return QStringLiteral("-%1.%2").arg(levelNum, 3, 10, QLatin1Char('0'))
+                                   .arg(QLatin1String(extension));
+}
+
+static void read_map(cc2::Map& map, const QString& filename)
+{
+    ccl::FileStream stream;
+    if (!stream.open(filename, ccl::FileStream::Read))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not open file for reading"));
+    map.read(&stream);
+}
+
+static void write_map(const cc2::Map& map, const QString& filename)
+{
+    ccl::FileStream stream;
+    if (!stream.open(filename, ccl::FileStream::Write))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not open file for writing"));
+    map.write(&stream);
+}
+
+static void write_levelset(const ccl::Levelset& levelset, const QString& filename)
+{
+    ccl::FileStream stream;
+    if (!stream.open(filename, ccl::FileStream::Write))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not open file for writing"));
+    levelset.write(&stream);
+}
+
+static void print_file_error(const QString& filename, const ccl::RuntimeError& err)
+{
+    fprintf(stderr, "Error: %s: %s\n", filename.toLocal8Bit().constData(),
+            err.message().toLocal8Bit().constData());
+}
+
+/* Run job(index, filename) for every file on a pool of worker threads.  A
+ * failed file is reported and does not stop the others.  Returns the
+ * number of files that failed.
+ */
+static int run_batch(const QStringList& files, unsigned int threads,
+                     const std::function<void(size_t, const QString&)>& job)
+{
+    std::mutex lock;
+    int failures = 0;
+    ccl::RunParallel(files.size(), threads, [&](unsigned int, size_t index) {
+        const QString& filename = files[(int)index];
+        try {
+            job(index, filename);
+        } catch (const ccl::RuntimeError& err) {
+            std::lock_guard<std::mutex> guard(lock);
+            print_file_error(filename, err);
+            ++failures;
+        }
+    });
+    return failures;
+}
+
+static bool parse_ruleset(const QString& name, unsigned int* ruleset)
+{
+    if (name == QLatin1String("ms"))
+        *ruleset = ccl::Levelset::TypeMS;
+    else if (name == QLatin1String("lynx"))
+        *ruleset = ccl::Levelset::TypeLynx;
+    else if (name == QLatin1String("pg"))
+        *ruleset = ccl::Levelset::TypePG;
+    else if (name == QLatin1String("lynxpg"))
+        *ruleset = ccl::Levelset::TypeLynxPG;
+    else
+        return false;
+    return true;
+}
+
+static QString ruleset_name(unsigned int ruleset)
+{
+    switch (ruleset) {
+    case ccl::Levelset::TypeMS:
+        return QStringLiteral("ms");
+    case ccl::Levelset::TypeLynx:
+        return QStringLiteral("lynx");
+    case ccl::Levelset::TypePG:
+        return QStringLiteral("pg");
+    case ccl::Levelset::TypeLynxPG:
+        return QStringLiteral("lynxpg");
+    default:
+        return QStringLiteral("unknown");
+    }
+}
+
+static int cmd_convert(const QStringList& args)
+{
+    unsigned int threads = 0;
+    unsigned int ruleset = 0;
+    QString outDir, format, rulesetName;
+    QStringList paths;
+    CommandOptions options;
+    options.threads(&threads);
+    options.value("-o", &outDir);
+    options.value("-f", &format);
+    options.value("-r", &rulesetName);
+    if (!options.parse(args, paths))
+        return -1;
+    if (!rulesetName.isEmpty() && !parse_ruleset(rulesetName.toLower(), &ruleset))
+        return -1;
+    format = format.toLower();
+
+    QStringList files, outputNames;
+    for (const QString& path : paths)
+        collect_files(path, s_levelsetFilters, files, &outputNames);
+    if (outDir.isEmpty() || files.isEmpty())
+        return -1;
+    if (!format.isEmpty() && format != QLatin1String("dat")
+            && format != QLatin1String("ccl") && format != QLatin1String("dac"))
+        return -1;
+    if (!prepare_outputs(outDir, files, outputNames))
+        return 1;
+
+    const int failures = run_batch(files, threads, [&](size_t index, const QString& filename) {
+        const QString& outputName = outputNames[(int)index];
+        std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(filename));
+        if (ruleset)
+            levelset->setType(ruleset);
+
+        const QString suffix = format.isEmpty() ? QFileInfo(filename).suffix().toLower()
+                                                : format;
+        if (suffix == QLatin1String("dac")) {
+            ccl::DacFile dac;
+            dac.setFromLevelset(*levelset);
+            dac.m_filename = QFileInfo(filename).completeBaseName() + QStringLiteral(".dat");
+
+            ccl::unique_FILE dacFile = ccl::FileStream::Fopen(
+                        output_path(outDir, outputName, QStringLiteral(".dac")),
+                        ccl::FileStream::WriteText);
+            if (!dacFile)
+                throw ccl::IOError(ccl::RuntimeError::tr("Could not open file for writing"));
+            dac.write(dacFile.get());
+            write_levelset(*levelset, output_path(outDir, outputName, QStringLiteral(".dat")));
+        } else {
+            write_levelset(*levelset, output_path(outDir, outputName, QStringLiteral(".") + suffix));
+        }
+    });
+
+    printf("%d of %d levelsets converted\n", files.size() - failures, files.size());
+    return failures ? 1 : 0;
+}
+
+static int cmd_import(const QStringList& args)
+{
+    unsigned int threads = 0;
+    bool autoResize = false;
+    QString outDir;
+    QStringList paths;
+    CommandOptions options;
+    options.threads(&threads);
+    options.value("-o", &outDir);
+    options.flag("--resize", &autoResize);
+    if (!options.parse(args, paths))
+        return -1;
+
+    QStringList files, outputNames;
+    for (const QString& path : paths)
+        collect_files(path, s_levelsetFilters, files, &outputNames);
+    if (outDir.isEmpty() || files.isEmpty())
+        return -1;
+    if (!prepare_outputs(outDir, files, outputNames))
+        return 1;
+
+    // Levels within each levelset are converted in parallel.  The maps are
+    // named after the script, so NAME.c2g and its NAME-NNN.c2m files share
+    // the output name's directory and cannot clash with another input.
+    int failures = 0;
+    for (int i = 0; i < files.size(); ++i) {
+        const QString& filename = files[i];
+        try {
+            std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(filename));
+            const QString baseName = QFileInfo(filename).completeBaseName();
+            const auto results = cc2::ImportLevelset(levelset.get(),
+                        output_path(outDir, outputNames[i], QStringLiteral(".c2g")),
+                        baseName.toLatin1().toStdString(), autoResize, threads);
+
+            printf("%s:\n", filename.toLocal8Bit().constData());
+            fputs(cc2::FormatImportReport(results).c_str(), stdout);
+            for (const cc2::ImportResult& result : results)
+                failures += result.error.empty() ? 0 : 1;
+        } catch (const ccl::RuntimeError& err) {
+            print_file_error(filename, err);
+            ++failures;
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+static int cmd_check(const QStringList& args)
+{
+    unsigned int threads = 0;
+    QString modeName;
+    QStringList paths;
+    CommandOptions options;
+    options.threads(&threads);
+    options.value("-m", &modeName);
+    if (!options.parse(args, paths))
+        return -1;
+
+    ccl::CheckMode mode = ccl::CheckMscc;
+    modeName = modeName.toLower();
+    if (modeName == QLatin1String("mscc-strict"))
+        mode = ccl::CheckMsccStrict;
+    else if (modeName.isEmpty() || modeName == QLatin1String("mscc"))
+        mode = ccl::CheckMscc;
+    else if (modeName == QLatin1String("lynx"))
+        mode = ccl::CheckTWorldLynx;
+    else if (modeName == QLatin1String("lynx-pedantic"))
+        mode = ccl::CheckLynxPedantic;
+    else
+        return -1;
+
+    QStringList files;
+    for (const QString& path : paths)
+        collect_files(path, s_levelsetFilters, files);
+    if (files.isEmpty())
+        return -1;
+
+    // Reports are buffered per file so they come out in file order
+    std::vector<std::string> reports(files.size());
+    std::vector<size_t> issueCounts(files.size());
+    const int failures = run_batch(files, threads, [&](size_t index, const QString& filename) {
+        std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(filename));
+        const auto issues = ccl::CheckLevelset(levelset.get(), mode);
+
+        std::string& report = reports[index];
+        const std::string prefix = filename.toLocal8Bit().toStdString();
+        for (const ccl::LevelIssue& issue : issues) {
+            QString text = issue.text;
+            text.replace(QLatin1Char('\n'), QLatin1Char(' '));
+            report += prefix;
+            if (issue.level >= 0)
+                report += " #" + std::to_string(issue.level + 1) + " "
+                          + levelset->level(issue.level)->name();
+            report += ": " + text.toLocal8Bit().toStdString() + "\n";
+        }
+        issueCounts[index] = issues.size();
+    });
+
+    size_t totalIssues = 0;
+    for (size_t i = 0; i < reports.size(); ++i) {
+        fputs(reports[i].c_str(), stdout);
+        totalIssues += issueCounts[i];
+    }
+    printf("\n%zu problems found in %d levelsets\n", totalIssues, files.size() - failures);
+    return (failures || totalIssues) ? 1 : 0;
+}
+
+static QString latin1_string(const std::string& text)
+{
+    return QString::fromLatin1(text.c_str(), (int)text.size());
+}
+
+static void levelset_info(QJsonObject& info, const ccl::Levelset& levelset)
+{
+    QJsonArray levels;
+    for (int i = 0; i < levelset.levelCount(); ++i) {
+        const ccl::LevelData* level = levelset.level(i);
+        QJsonObject info;
+        info[QStringLiteral("number")] = i + 1;
+        info[QStringLiteral("name")] = latin1_string(level->name());
+        info[QStringLiteral("author")] = latin1_string(level->author());
+        info[QStringLiteral("password")] = latin1_string(level->password());
+        info[QStringLiteral("hint")] = latin1_string(level->hint());
+        info[QStringLiteral("chips")] = level->chips();
+        info[QStringLiteral("time")] = level->timer();
+        levels.append(info);
+    }
+
+    info[QStringLiteral("format")] = QStringLiteral("cc1");
+    info[QStringLiteral("ruleset")] = ruleset_name(levelset.type());
+    info[QStringLiteral("levels")] = levels;
+}
+
+static void map_info(QJsonObject& info, const cc2::Map& map)
+{
+    int chips, totalChips, points, multipliers;
+    std::tie(chips, totalChips) = map.mapData().countChips();
+    std::tie(points, multipliers) = map.mapData().countPoints();
+
+    info[QStringLiteral("format")] = QStringLiteral("c2m");
+    info[QStringLiteral("title")] = latin1_string(map.title());
+    info[QStringLiteral("author")] = latin1_string(map.author());
+    info[QStringLiteral("version")] = latin1_string(map.version());
+    info[QStringLiteral("editorVersion")] = latin1_string(map.editorVersion());
+    info[QStringLiteral("lock")] = latin1_string(map.lock());
+    info[QStringLiteral("clue")] = latin1_string(map.clue());
+    info[QStringLiteral("width")] = map.mapData().width();
+    info[QStringLiteral("height")] = map.mapData().height();
+    info[QStringLiteral("time")] = map.option().timeLimit();
+    info[QStringLiteral("chips")] = chips;
+    info[QStringLiteral("totalChips")] = totalChips;
+    info[QStringLiteral("points")] = points;
+    info[QStringLiteral("multipliers")] = multipliers;
+    info[QStringLiteral("hidden")] = map.option().hidden();
+    info[QStringLiteral("readOnly")] = map.readOnly();
+    info[QStringLiteral("hasReplay")] = !map.replay().empty();
+}
+
+static int cmd_info(const QStringList& args)
+{
+    unsigned int threads = 0;
+    QStringList paths;
+    CommandOptions options;
+    options.threads(&threads);
+    if (!options.parse(args, paths))
+        return -1;
+
+    QStringList files;
+    for (const QString& path : paths)
+        collect_files(path, s_levelsetFilters + s_mapFilters, files);
+    if (files.isEmpty())
+        return -1;
+
+    std::vector<QJsonObject> infos(files.size());
+    const int failures = run_batch(files, threads, [&](size_t index, const QString& filename) {
+        QJsonObject info;
+        info[QStringLiteral("file")] = filename;
+        try {
+            if (is_map_file(filename)) {
+                cc2::Map map;
+                read_map(map, filename);
+                map_info(info, map);
+            } else {
+                std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(filename));
+                levelset_info(info, *levelset);
+            }
+        } catch (const ccl::RuntimeError& err) {
+            info[QStringLiteral("error")] = err.message();
+            infos[index] = info;
+            throw;
+        }
+        infos[index] = info;
+    });
+
+    QJsonArray result;
+    for (QJsonObject& info : infos)
+        result.append(info);
+    const QByteArray json = QJsonDocument(result).toJson();
+    fwrite(json.constData(), 1, json.size(), stdout);
+    return failures ? 1 : 0;
+}
+
+static int cmd_repack(const QStringList& args)
+{
+    unsigned int threads = 0;
+    QString outDir;
+    QStringList paths;
+    CommandOptions options;
+    options.threads(&threads);
+    options.value("-o", &outDir);
+    if (!options.parse(args, paths))
+        return -1;
+
+    QStringList files, outputNames;
+    for (const QString& path : paths)
+        collect_files(path, s_mapFilters, files, &outputNames);
+    if (files.isEmpty())
+        return -1;
+    if (!outDir.isEmpty() && !prepare_outputs(outDir, files, outputNames))
+        return 1;
+
+    std::mutex lock;
+    int64_t sizeBefore = 0, sizeAfter = 0;
+    const int failures = run_batch(files, threads, [&](size_t index, const QString& filename) {
+        cc2::Map map;
+        read_map(map, filename);
+        const QString outName = outDir.isEmpty() ? filename
+                              : output_path(outDir, outputNames[(int)index], QStringLiteral(".c2m"));
+        const int64_t oldSize = QFileInfo(filename).size();
+        write_map(map, outName);
+
+        std::lock_guard<std::mutex> guard(lock);
+        sizeBefore += oldSize;
+        sizeAfter += QFileInfo(outName).size();
+    });
+
+    printf("%d of %d maps repacked, %lld bytes -> %lld bytes\n",
+           files.size() - failures, files.size(),
+           (long long)sizeBefore, (long long)sizeAfter);
+    return failures ? 1 : 0;
+}
+
+static void save_image(const QImage& image, const QString& filename)
+{
+    if (!image.save(filename, "PNG"))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not write image %1").arg(filename));
+}
+
+static int cmd_render(const QStringList& args)
+{
+    QString outDir, cc1TilesetFile, cc2TilesetFile;
+    QStringList paths;
+    CommandOptions options;
+    options.value("-o", &outDir);
+    options.value("--cc1-tileset", &cc1TilesetFile);
+    options.value("--cc2-tileset", &cc2TilesetFile);
+    if (!options.parse(args, paths))
+        return -1;
+
+    QStringList files, outputNames;
+    for (const QString& path : paths)
+        collect_files(path, s_levelsetFilters + s_mapFilters, files, &outputNames);
+    if (outDir.isEmpty() || files.isEmpty())
+        return -1;
+    if (!prepare_outputs(outDir, files, outputNames))
+        return 1;
+
+    // The tilesets are made of QPixmaps, which may only be used from the
+    // main thread, so the files are rendered one at a time.
+    CCETileset cc1Tileset;
+    CC2ETileset cc2Tileset;
+    if (!cc1TilesetFile.isEmpty() && !cc1Tileset.load(cc1TilesetFile))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not load tileset %1").arg(cc1TilesetFile));
+    if (!cc2TilesetFile.isEmpty() && !cc2Tileset.load(cc2TilesetFile))
+        throw ccl::IOError(ccl::RuntimeError::tr("Could not load tileset %1").arg(cc2TilesetFile));
+
+    int failures = 0, images = 0;
+    for (int fileIndex = 0; fileIndex < files.size(); ++fileIndex) {
+        const QString& filename = files[fileIndex];
+        const QString& outputName = outputNames[fileIndex];
+        try {
+            if (is_map_file(filename)) {
+                if (cc2Tileset.size() == 0)
+                    throw ccl::RuntimeError(ccl::RuntimeError::tr("No CC2 tileset was given"));
+                cc2::Map map;
+                read_map(map, filename);
+
+                const cc2::MapData& mapData = map.mapData();
+                QImage image(mapData.width() * cc2Tileset.size(),
+                             mapData.height() * cc2Tileset.size(), QImage::Format_RGB32);
+                QPainter painter(&image);
+                for (int y = 0; y < mapData.height(); ++y) {
+                    for (int x = 0; x < mapData.width(); ++x)
+                        cc2Tileset.draw(painter, x, y, &mapData.tile(x, y), true);
+                }
+                painter.end();
+                save_image(image, output_path(outDir, outputName, QStringLiteral(".png")));
+                ++images;
+            } else {
+                if (cc1Tileset.size() == 0)
+                    throw ccl::RuntimeError(ccl::RuntimeError::tr("No CC1 tileset was given"));
+                std::unique_ptr<ccl::Levelset> levelset(ccl::LoadLevelset(filename));
+
+                for (int i = 0; i < levelset->levelCount(); ++i) {
+                    const ccl::LevelMap& levelMap = levelset->level(i)->map();
+                    QImage image(CCL_WIDTH * cc1Tileset.size(), CCL_HEIGHT * cc1Tileset.size(),
+                                 QImage::Format_RGB32);
+                    QPainter painter(&image);
+                    for (int y = 0; y < CCL_HEIGHT; ++y) {
+                        for (int x = 0; x < CCL_WIDTH; ++x)
+                            cc1Tileset.draw(painter, x, y, levelMap.getFG(x, y), levelMap.getBG(x, y));
+                    }
+                    painter.end();
+                    save_image(image, output_path(outDir, outputName, level_suffix(i + 1, "png")));
+                    ++images;
+                }
+            }
+        } catch (const ccl::RuntimeError& err) {
+            print_file_error(filename, err);
+            ++failures;
+        }
+    }
+
+    printf("%d images rendered from %d files\n", images, files.size() - failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // Only rendering needs the GUI module, for the tileset pixmaps.  It
+    // runs without a display unless another platform is requested.
+    std::unique_ptr<QCoreApplication> app;
+    if (argc > 1 && strcmp(argv[1], "render") == 0) {
+        if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        app.reset(new QGuiApplication(argc, argv));
+    } else {
+        app.reset(new QCoreApplication(argc, argv));
+    }
+    QCoreApplication::setOrganizationName(QStringLiteral("CCTools"));
+    QCoreApplication::setApplicationName(QStringLiteral("cctool"));
+
+    QStringList args = QCoreApplication::arguments();
+    if (args.size() < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    const QString command = args[1];
+    args.erase(args.begin(), args.begin() + 2);
+
+    int result = -1;
+    try {
+        if (command == QLatin1String("verify"))
+            result = cmd_verify(args);
+        else if (command == QLatin1String("solve"))
+            result = cmd_solve(args);
+        else if (command == QLatin1String("dupes"))
+            result = cmd_dupes(args);
+        else if (command == QLatin1String("index"))
+            result = cmd_index(args);
+        else if (command == QLatin1String("find"))
+            result = cmd_find(args);
+        else if (command == QLatin1String("convert"))
+            result = cmd_convert(args);
+        else if (command == QLatin1String("import"))
+            result = cmd_import(args);
+        else if (command == QLatin1String("check"))
+            result = cmd_check(args);
+        else if (command == QLatin1String("info"))
+            result = cmd_info(args);
+        else if (command == QLatin1String("repack"))
+            result = cmd_repack(args);
+        else if (command == QLatin1String("render"))
+            result = cmd_render(args);
+    } catch (const ccl::RuntimeError& err) {
+        fprintf(stderr, "Error: %s\n", err.message().toLocal8Bit().constData());
+        return 1;
+    }
+
+    if (result < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    return result;
+}